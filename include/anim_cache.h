@@ -0,0 +1,43 @@
+#ifndef ANIM_CACHE_H
+#define ANIM_CACHE_H
+
+#include <gtk/gtk.h>
+
+// Quadros de uma animação decodificados uma única vez e compartilhados.
+// Depois de criado, o conteúdo nunca muda: quem usa só troca o ponteiro do quadro atual.
+typedef struct {
+    GdkTexture **frames;
+    int *delays;        // duração de cada quadro em ms (-1 = último quadro fica parado)
+    guint n_frames;
+    int width;
+    int height;
+    gint ref_count;
+} AnimFrames;
+
+// Retorna os quadros da imagem/GIF em "path", decodificando apenas no primeiro pedido.
+// O resultado vem com uma referência nova (liberar com anim_frames_unref); NULL em caso de erro.
+// Pode ser chamada de qualquer thread.
+AnimFrames *anim_cache_get(const char *path, GError **error);
+
+// Chamada (na thread que decodifica) para cada quadro assim que ele fica pronto
+typedef void (*AnimFrameFunc)(GdkTexture *frame, int delay, guint index, gpointer user_data);
+
+// Igual a anim_cache_get, mas entrega os quadros progressivamente enquanto decodifica.
+// Pensada para rodar numa thread de trabalho; se já estiver no cache, on_frame não é chamada.
+AnimFrames *anim_cache_get_progressive(const char *path, GCancellable *cancellable,
+    AnimFrameFunc on_frame, gpointer user_data, GError **error);
+
+// Carrega o ícone "name" (ex.: "flip_icon.gif") na variante width×height gerada pelo
+// "make assets" e embutida no binário como GResource. Se a variante não existir,
+// decodifica icons/<name> do disco (ou de $ZENOKA_ICON_DIR).
+AnimFrames *anim_cache_get_asset(const char *name, int width, int height, GError **error);
+AnimFrames *anim_cache_get_asset_progressive(const char *name, int width, int height,
+    GCancellable *cancellable, AnimFrameFunc on_frame, gpointer user_data, GError **error);
+
+AnimFrames *anim_frames_ref(AnimFrames *anim);
+void anim_frames_unref(AnimFrames *anim);
+
+// TRUE se houver mais de um quadro para exibir
+gboolean anim_frames_is_animated(const AnimFrames *anim);
+
+#endif // ANIM_CACHE_H
@@ -0,0 +1,20 @@
+#ifndef ANIM_SCHEDULER_H
+#define ANIM_SCHEDULER_H
+
+#include <gtk/gtk.h>
+#include "anim_cache.h"
+
+// Estado de uma animação registrada (privado ao agendador)
+typedef struct _AnimationData AnimationData;
+
+// Registra um GtkImage ou GtkPicture para exibir "anim" (guarda uma referência própria).
+// Todas as animações avançam juntas no "update" do frame clock do widget, só enquanto
+// ele estiver mapeado, visível e com a janela não minimizada. O registro é desfeito
+// automaticamente quando o widget é destruído.
+AnimationData *anim_scheduler_add(GtkWidget *widget, AnimFrames *anim);
+
+// Congela todas as animações no primeiro quadro (nenhum timer, nenhum repaint)
+// ou as solta de novo
+void anim_scheduler_set_paused(gboolean paused);
+
+#endif // ANIM_SCHEDULER_H
@@ -0,0 +1,36 @@
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <glib.h>
+#include <libavformat/avformat.h>
+#include "packet_queue.h"
+
+// Saída de áudio do player. Uma thread decodifica os pacotes da fila (vindos do
+// demux do vídeo) e converte para o formato do dispositivo num anel SPSC sem
+// trava; o callback do dispositivo só copia do anel, aplica o volume e publica
+// a posição tocada. Nada no callback aloca ou trava. Essa posição é o relógio
+// mestre da apresentação dos quadros.
+typedef struct _AudioEngine AudioEngine;
+
+// Abre o decodificador e o dispositivo (parado). Lê de "packets" até a fila
+// ser abortada; o serial de cada pacote marca os seeks, como no vídeo.
+AudioEngine *audio_engine_open(AVStream *stream, PacketQueue *packets, GError **error);
+
+// A fila de pacotes precisa ter sido abortada antes
+void audio_engine_close(AudioEngine *a);
+
+void audio_engine_set_playing(AudioEngine *a, gboolean playing);
+
+// Próximos pacotes com "serial" começam em "target_us" (pts absoluto): o que
+// vier antes é descartado e o anel é esvaziado
+void audio_engine_seek(AudioEngine *a, gint64 target_us, guint serial);
+
+// Pts (absoluto) do que está saindo no alto-falante agora. FALSE enquanto nada
+// foi tocado desde a abertura ou o último seek.
+gboolean audio_engine_get_clock(AudioEngine *a, gint64 *pts_us);
+
+// Volume de 0 a 1; podem ser chamadas de qualquer thread
+void audio_engine_set_volume(AudioEngine *a, double volume);
+void audio_engine_set_muted(AudioEngine *a, gboolean muted);
+
+#endif // AUDIO_ENGINE_H
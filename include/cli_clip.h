@@ -0,0 +1,17 @@
+#ifndef CLI_CLIP_H
+#define CLI_CLIP_H
+
+// Modo sem interface: "zenoka clip ...". Não inicia o GTK nem o splash; usa o
+// mesmo parser de timecode e o mesmo núcleo de exportação do botão de exportar.
+// O progresso sai em stdout como uma linha JSON por evento. Retorna o código de
+// saída do processo.
+//
+//   zenoka clip --in ARQ --from TC --to TC --out ARQ [--height N] [--threads N]
+//   zenoka clip --in ARQ --manifest LISTA [--out-dir PASTA]
+//
+// Cada linha da lista é "INÍCIO FIM SAÍDA" (timecodes HH:MM:SS[:FF]); linhas
+// vazias e começando com '#' são ignoradas. Saídas relativas ficam em
+// --out-dir, ou na pasta da lista.
+int cli_clip_main(int argc, char **argv);
+
+#endif // CLI_CLIP_H
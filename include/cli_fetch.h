@@ -0,0 +1,15 @@
+#ifndef CLI_FETCH_H
+#define CLI_FETCH_H
+
+// Modo sem interface: "zenoka fetch ...". Baixa um link direto de mídia com o
+// mesmo motor do campo de link (várias conexões, retomada pelo .part.state), o
+// que permite testá-lo contra um servidor HTTP local. O progresso sai em stdout
+// como uma linha JSON por evento. Retorna o código de saída do processo.
+//
+//   zenoka fetch --url URL [--out ARQ] [--connections N]
+//
+// Sem --out, grava no destino padrão (<Downloads>/Zenoka/<nome na URL>).
+// Interromper e rodar de novo com os mesmos argumentos continua de onde parou.
+int cli_fetch_main(int argc, char **argv);
+
+#endif // CLI_FETCH_H
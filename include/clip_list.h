@@ -0,0 +1,33 @@
+#ifndef CLIP_LIST_H
+#define CLIP_LIST_H
+
+#include <glib.h>
+
+// Lista de cortes de uma mesma fonte. Tempos em µs contados do início do
+// vídeo, end exclusivo. Os cortes ficam ordenados pelo início (e depois pelo
+// fim), que é a ordem em que a exportação em lote lê a fonte.
+typedef struct {
+    gint64 start_us;
+    gint64 end_us;
+} ClipRange;
+
+typedef struct _ClipList ClipList;
+
+ClipList *clip_list_new(const char *source);
+void clip_list_free(ClipList *list);
+
+const char *clip_list_get_source(ClipList *list);
+
+// Insere mantendo a ordem; devolve a posição. Trechos vazios são recusados (-1).
+int clip_list_add(ClipList *list, gint64 start_us, gint64 end_us);
+void clip_list_remove(ClipList *list, guint index);
+void clip_list_clear(ClipList *list);
+
+guint clip_list_get_n_clips(ClipList *list);
+const ClipRange *clip_list_get(ClipList *list, guint index);
+
+// Nomes de saída "<pasta>/<nome da fonte>_corteNN<ext>", na ordem da lista;
+// "ext" NULL = a extensão da fonte (liberar com g_strfreev)
+gchar **clip_list_build_outputs(ClipList *list, const char *folder, const char *ext);
+
+#endif // CLIP_LIST_H
@@ -0,0 +1,35 @@
+#ifndef CUT_WRITER_H
+#define CUT_WRITER_H
+
+#include <glib.h>
+#include <libavformat/avformat.h>
+
+// Escreve um trecho [start, end) de uma entrada já aberta num arquivo novo, por
+// smart cut: GOPs inteiros dentro do trecho são copiados sem decodificar, e só
+// os GOPs cortados nas pontas são recodificados (mesmo codec e parâmetros da
+// fonte). O demux é de quem chama: os pacotes chegam por cut_writer_feed, em
+// ordem, o que permite alimentar vários cortes com uma única leitura da fonte.
+typedef struct _CutWriter CutWriter;
+
+// start_us/end_us são absolutos (mesma escala dos timestamps da entrada).
+// Abre "output" e escreve o cabeçalho; o vídeo é o stream "video_stream" e os
+// streams de áudio são copiados.
+CutWriter *cut_writer_new(AVFormatContext *in, int video_stream, const char *output,
+    gint64 start_us, gint64 end_us, GError **error);
+
+// Entrega um pacote da entrada (o writer faz a própria referência)
+gboolean cut_writer_feed(CutWriter *w, const AVPacket *pkt, GError **error);
+
+// TRUE quando nenhum pacote dali em diante interessa mais a este corte
+gboolean cut_writer_is_done(CutWriter *w);
+
+// Fecha o último GOP pendente e escreve o trailer
+gboolean cut_writer_finish(CutWriter *w, GError **error);
+
+// Libera tudo; remove_output apaga o arquivo (corte cancelado ou com erro)
+void cut_writer_free(CutWriter *w, gboolean remove_output);
+
+// Quantos GOPs foram copiados e quantos recodificados
+void cut_writer_get_counts(CutWriter *w, guint *copied_gops, guint *encoded_gops);
+
+#endif // CUT_WRITER_H
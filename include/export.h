@@ -0,0 +1,88 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <gio/gio.h>
+
+// Um corte a exportar. Tempos em µs contados do início do vídeo; end exclusivo.
+typedef struct {
+    const char *input;
+    const char *output;
+    gint64 start_us;
+    gint64 end_us;
+} ExportJob;
+
+// Progresso de 0 a 1, chamado na thread que exporta
+typedef void (*ExportProgressFunc)(double fraction, gpointer user_data);
+
+// Exporta por smart cut (só as pontas são recodificadas). Bloqueia: rodar numa
+// thread de trabalho. Em erro ou cancelamento o arquivo de saída é removido.
+gboolean export_smart_cut(const ExportJob *job, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error);
+
+// Exporta vários cortes da mesma fonte (todos com o mesmo input) por smart
+// cut, lendo a fonte uma vez só em ordem: cada pacote vai para todos os cortes
+// que o cobrem, e intervalos longos entre cortes são pulados com seek. Em erro
+// ou cancelamento os arquivos ainda incompletos são removidos. Bloqueia.
+gboolean export_batch(const ExportJob *jobs, guint n_jobs, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error);
+
+// Cada trecho da recodificação é um pipeline: demux → decode → escala e
+// conversão de cor → encode → mux, um estágio por thread, ligados por filas
+// limitadas. Os contadores somam todos os trechos em andamento e podem ser lidos
+// de qualquer thread com g_atomic_int_get.
+typedef enum {
+    EXPORT_STAGE_DEMUX,
+    EXPORT_STAGE_DECODE,
+    EXPORT_STAGE_SCALE,
+    EXPORT_STAGE_ENCODE,
+    EXPORT_STAGE_MUX,
+    EXPORT_N_STAGES
+} ExportStage;
+
+typedef struct {
+    gint done[EXPORT_N_STAGES];     // itens (pacotes ou quadros) que saíram do estágio
+    gint queued[EXPORT_N_STAGES];   // itens esperando na fila de entrada do estágio
+    gint capacity[EXPORT_N_STAGES]; // tamanho somado dessas filas (demux não tem fila)
+} ExportPipelineStats;
+
+// Recodificação completa (mudança de tamanho ou de codec)
+typedef struct {
+    int max_height;         // 0 = mantém o tamanho da fonte
+    const char *encoder;    // NULL = libx264 (ou o encoder H.264 disponível)
+    int crf;                // 0 = padrão
+    guint threads;          // 0 = orçamento global (export_set_thread_budget)
+    ExportPipelineStats *stats; // opcional, zerado por quem chama
+} TranscodeOptions;
+
+#define EXPORT_MAX_CHUNKS 64
+
+// Progresso de um trecho da exportação paralela (thread de trabalho)
+typedef void (*ExportChunkFunc)(guint chunk, guint n_chunks, double fraction, gpointer user_data);
+
+// Quantas threads a exportação paralela pode usar (0 = uma por núcleo)
+void export_set_thread_budget(guint threads);
+guint export_get_thread_budget(void);
+
+// Divide o corte em trechos alinhados a keyframes, recodifica os trechos em
+// paralelo (cada um no seu pipeline) e junta tudo num arquivo só (áudio copiado
+// da fonte). Bloqueia.
+gboolean export_transcode_parallel(const ExportJob *job, const TranscodeOptions *opts,
+    GCancellable *cancellable, ExportChunkFunc progress, gpointer user_data, GError **error);
+
+// GIF animado do corte
+typedef struct {
+    int max_height;         // 0 = tamanho da fonte
+    double fps;             // 0 = 15
+    gboolean local_palettes;// paleta por quadro em vez de uma só para o clipe
+    guint threads;          // 0 = orçamento global (export_set_thread_budget)
+} GifOptions;
+
+// Paleta por median cut sobre o histograma de cores do clipe (ou de cada quadro),
+// dithering ordenado e LZW em paralelo entre quadros; cada quadro só grava o
+// retângulo que mudou, com o que não mudou transparente. Com paleta única o
+// clipe inteiro fica na memória: se não couber, cai para paleta por quadro, que
+// processa em lotes. Bloqueia; em erro ou cancelamento o arquivo é removido.
+gboolean export_gif(const ExportJob *job, const GifOptions *opts, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error);
+
+#endif // EXPORT_H
@@ -0,0 +1,11 @@
+#ifndef GIF_SCAN_H
+#define GIF_SCAN_H
+
+#include <glib.h>
+
+// Conta os blocos de imagem de um GIF sem decodificar nada (o iterador do
+// gdk-pixbuf não informa quantos quadros existem nem quando o loop recomeça).
+// Retorna 0 se os dados não forem um GIF.
+guint gif_count_frames(const guchar *data, gsize len);
+
+#endif // GIF_SCAN_H
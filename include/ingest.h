@@ -0,0 +1,50 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <gio/gio.h>
+
+// Download de links diretos de mídia (http/https). Quando o servidor informa o
+// tamanho e aceita pedidos de intervalo (Range), o arquivo é dividido em
+// pedaços baixados por várias conexões ao mesmo tempo, cada uma gravando na
+// sua posição de "<destino>.part" (criado já com o tamanho final, esparso).
+// Um mapa de bits dos pedaços prontos fica em "<destino>.part.state": se o
+// download for interrompido (cancelado, sem rede, processo fechado), a próxima
+// chamada com a mesma URL e o mesmo destino baixa só o que falta, desde que o
+// ETag/Last-Modified do remoto não tenha mudado. Sem Range, cai para uma
+// conexão só, do começo. O HTTP é o do FFmpeg (libavformat). O arquivo pronto
+// ganha um registro "<destino>.source" com a URL de origem.
+
+#define INGEST_DEFAULT_CONNECTIONS 4
+#define INGEST_MAX_CONNECTIONS     16
+
+typedef struct {
+    guint64 total_bytes;    // 0 = o servidor não informou o tamanho
+    guint64 done_bytes;     // inclui o que já estava baixado ao retomar
+    double bytes_per_sec;   // média dos últimos segundos
+    guint connections;      // conexões abertas agora
+    gboolean resumed;       // continuou um download interrompido
+} IngestProgress;
+
+// Chamada das threads do download, no máximo umas quatro vezes por segundo
+typedef void (*IngestProgressFunc)(const IngestProgress *progress, gpointer user_data);
+
+// 0 = INGEST_DEFAULT_CONNECTIONS
+void ingest_set_connections(guint connections);
+guint ingest_get_connections(void);
+
+// Baixa "url" para "dest". Bloqueia: rodar numa thread de trabalho. Se "dest"
+// já foi baixado da mesma URL e o remoto não mudou, não baixa de novo; se
+// "dest" existe mas não veio dessa URL, falha com G_IO_ERROR_EXISTS em vez de
+// substituí-lo. Ao cancelar, o que já veio fica guardado para a retomada.
+gboolean ingest_download(const char *url, const char *dest, GCancellable *cancellable,
+    IngestProgressFunc progress, gpointer user_data, GError **error);
+
+// TRUE se "url" parece apontar direto para um arquivo de mídia (pela extensão)
+gboolean ingest_is_direct_link(const char *url);
+
+// Destino padrão de "url": "<Downloads>/Zenoka/<nome>-<hash da URL>.<ext>".
+// Sempre o mesmo para a mesma URL, o que permite retomar, e diferente para
+// URLs diferentes com o mesmo nome de arquivo. Liberar com g_free.
+gchar *ingest_default_path(const char *url);
+
+#endif // INGEST_H
@@ -3,7 +3,7 @@
 
 #include <gtk/gtk.h>
 
-// Função para criar e exibir a janela principal
-void create_main_window(GtkApplication *app);
+// Função para criar a janela principal (ainda escondida; quem chama decide quando apresentá-la)
+GtkWidget *create_main_window(GtkApplication *app);
 
 #endif // MAIN_WINDOW_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef MEDIA_CACHE_H
+#define MEDIA_CACHE_H
+
+#include <glib.h>
+
+// Cache em disco das análises de mídia (índice de keyframes, forma de onda,
+// miniaturas). A chave é um hash do conteúdo, não do caminho: tamanho mais
+// alguns blocos espalhados pelo arquivo, então a mesma gravação copiada,
+// renomeada ou baixada de novo reaproveita o que já foi calculado. Cada
+// análise é um arquivo "<chave>-<tipo>.zc" com cabeçalho versionado, lido por
+// mmap. A pasta tem um orçamento em bytes; passou dele, saem os arquivos usados
+// há mais tempo. Arquivos grandes (proxies) ficam na subpasta "files", com um
+// orçamento à parte, para um proxy não despejar todas as análises.
+//
+// A pasta é ZENOKA_CACHE_DIR ou "<cache do usuário>/zenoka". Tudo aqui pode ser
+// chamado de qualquer thread.
+
+#define MEDIA_CACHE_KEY_LEN 33      // 32 hexadecimais + '\0'
+#define MEDIA_CACHE_DEFAULT_BUDGET (512 * 1024 * 1024)
+#define MEDIA_CACHE_DEFAULT_FILE_BUDGET (G_GUINT64_CONSTANT(8) * 1024 * 1024 * 1024)
+
+typedef struct {
+    gchar hex[MEDIA_CACHE_KEY_LEN];
+} MediaCacheKey;
+
+void media_cache_set_budget(guint64 bytes);
+guint64 media_cache_get_budget(void);
+
+// Orçamento da subpasta dos arquivos grandes
+void media_cache_set_file_budget(guint64 bytes);
+guint64 media_cache_get_file_budget(void);
+
+// Lê ~1MB do arquivo no pior caso; o resultado fica memorizado por caminho
+// enquanto tamanho e data não mudam. FALSE se o arquivo não pode ser lido.
+gboolean media_cache_key(const char *path, MediaCacheKey *key);
+
+// Conteúdo mapeado (sem o cabeçalho), ou NULL se não existe ou foi gravado com
+// outra versão. "kind" tem 4 letras. O uso conta para o LRU.
+GBytes *media_cache_load(const MediaCacheKey *key, const char *kind, guint32 version);
+
+// Grava de forma atômica e, se a pasta passou do orçamento, despeja os mais
+// antigos. Falhar aqui só custa recalcular da próxima vez.
+gboolean media_cache_store(const MediaCacheKey *key, const char *kind, guint32 version,
+    const void *data, gsize size, GError **error);
+
+// Conteúdo grande que outra biblioteca grava e lê direto pelo caminho (o proxy
+// de vídeo): o arquivo não tem cabeçalho, então a versão do formato vai no
+// próprio "kind". Caminho do arquivo pronto, ou NULL se não existe; o uso conta
+// para o LRU.
+gchar *media_cache_lookup_file(const MediaCacheKey *key, const char *kind);
+
+// Cria um arquivo temporário vazio, com nome único, na pasta do cache: quem grava
+// depois chama media_cache_commit_file (ou apaga o temporário se desistir)
+gchar *media_cache_create_temp(const MediaCacheKey *key, const char *kind, GError **error);
+
+// Renomeia o temporário para o nome definitivo e aplica o orçamento. Recusa (e
+// deixa o temporário para quem chamou apagar) um arquivo maior que o orçamento.
+gboolean media_cache_commit_file(const MediaCacheKey *key, const char *kind, const char *temp_path,
+    GError **error);
+
+#endif // MEDIA_CACHE_H
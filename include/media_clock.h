@@ -0,0 +1,28 @@
+#ifndef MEDIA_CLOCK_H
+#define MEDIA_CLOCK_H
+
+#include <glib.h>
+
+// Relógio de apresentação: posição da mídia em µs, avançando com o tempo monotônico
+// enquanto estiver rodando. Pode ser lido de qualquer thread.
+typedef struct {
+    GMutex lock;
+    gint64 base_pts_us;    // posição da mídia no último start/set
+    gint64 base_time_us;   // g_get_monotonic_time() nesse instante
+    gboolean running;
+} MediaClock;
+
+void media_clock_init(MediaClock *c);
+void media_clock_clear(MediaClock *c);
+
+// Começa (ou retoma) a contar a partir de "pts_us"
+void media_clock_start(MediaClock *c, gint64 pts_us);
+void media_clock_pause(MediaClock *c);
+
+// Reposiciona sem mudar o estado rodando/parado
+void media_clock_set(MediaClock *c, gint64 pts_us);
+
+gint64 media_clock_get(MediaClock *c);
+gboolean media_clock_is_running(MediaClock *c);
+
+#endif // MEDIA_CLOCK_H
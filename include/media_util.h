@@ -0,0 +1,36 @@
+#ifndef MEDIA_UTIL_H
+#define MEDIA_UTIL_H
+
+#include <glib.h>
+#include <libavformat/avformat.h>
+
+// Domínio de erro de tudo que lida com mídia (decodificação, índice, exportação)
+#define MEDIA_ERROR media_error_quark()
+GQuark media_error_quark(void);
+
+typedef enum {
+    MEDIA_ERROR_OPEN,
+    MEDIA_ERROR_NO_STREAM,
+    MEDIA_ERROR_CODEC,
+    MEDIA_ERROR_IO,
+    MEDIA_ERROR_INVALID,
+} MediaError;
+
+// Preenche "error" com a mensagem do FFmpeg para o código "averr"
+void media_set_av_error(GError **error, MediaError code, int averr, const char *what);
+
+// Abre o arquivo e lê as informações dos streams
+AVFormatContext *media_open_input(const char *path, GError **error);
+
+// Converte entre timestamps do stream e microssegundos
+gint64 media_ts_to_us(gint64 ts, AVRational time_base);
+gint64 media_us_to_ts(gint64 us, AVRational time_base);
+
+// Instante (em µs) do primeiro quadro do stream; posições "do início do vídeo" contam daqui
+gint64 media_stream_start_us(AVStream *st);
+
+// TRUE se os dois caminhos levam ao mesmo arquivo (inclusive por link); uma
+// exportação nunca pode escrever por cima da fonte que está lendo
+gboolean media_same_file(const char *a, const char *b);
+
+#endif // MEDIA_UTIL_H
@@ -0,0 +1,40 @@
+#ifndef PACKET_QUEUE_H
+#define PACKET_QUEUE_H
+
+#include <glib.h>
+#include <libavcodec/avcodec.h>
+
+// Fila limitada de AVPacket entre a thread de demux e um decodificador.
+// put bloqueia quando está cheia (backpressure) e get quando está vazia.
+typedef struct {
+    GQueue packets;       // AVPacket*; NULL marca o fim do stream
+    guint max_packets;
+    guint serial;         // muda a cada flush, para descartar o que era de antes de um seek
+    guint interrupts;
+    gboolean aborted;
+    GMutex lock;
+    GCond cond;
+} PacketQueue;
+
+void packet_queue_init(PacketQueue *q, guint max_packets);
+void packet_queue_clear(PacketQueue *q);
+
+// Assume a posse de "pkt" (NULL = fim do stream). Retorna FALSE (e descarta o pacote)
+// se a fila foi abortada ou interrompida enquanto esperava espaço.
+gboolean packet_queue_put(PacketQueue *q, AVPacket *pkt);
+
+// Retorna FALSE se a fila foi abortada; *pkt NULL indica fim do stream
+gboolean packet_queue_get(PacketQueue *q, AVPacket **pkt, guint *serial);
+
+// Descarta tudo o que está na fila; os próximos pacotes saem com "serial"
+void packet_queue_flush(PacketQueue *q, guint serial);
+
+// Faz um put que está bloqueado desistir (usado para atender um seek na hora)
+void packet_queue_interrupt(PacketQueue *q);
+
+// Acorda e libera todas as threads bloqueadas na fila
+void packet_queue_abort(PacketQueue *q);
+
+guint packet_queue_length(PacketQueue *q);
+
+#endif // PACKET_QUEUE_H
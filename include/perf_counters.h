@@ -0,0 +1,39 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <glib.h>
+
+// Contadores de desempenho que qualquer subsistema publica e o HUD lê. Publicar
+// é uma operação atômica num inteiro, sem trava, de qualquer thread; só o
+// registro passa por um mutex, e cada módulo registra os seus uma vez só
+// (guardando o ponteiro). Registrar de novo o mesmo nome devolve o mesmo contador.
+typedef enum {
+    PERF_GAUGE,     // valor atual (itens numa fila, animações ativas)
+    PERF_COUNT,     // total acumulado; o HUD mostra também a taxa por segundo
+    PERF_KIB,       // memória atual, em KiB
+} PerfKind;
+
+typedef struct _PerfCounter PerfCounter;
+
+typedef struct {
+    const char *name;
+    PerfKind kind;
+    gint value;
+} PerfSample;
+
+#define PERF_MAX_COUNTERS 64
+
+// "name" é do tipo "grupo.contador" (o HUD agrupa pelo prefixo). Passado o
+// limite, devolve um contador que ninguém lê.
+PerfCounter *perf_counter_register(const char *name, PerfKind kind);
+
+void perf_counter_add(PerfCounter *c, gint delta);
+void perf_counter_set(PerfCounter *c, gint value);
+
+// Cópia de todos os contadores, em ordem de registro; devolve quantos
+guint perf_counters_snapshot(PerfSample *out, guint max);
+
+// Memória residente do processo em KiB (-1 onde não há como saber)
+gint perf_resident_kib(void);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,13 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <gtk/gtk.h>
+
+// Painel de desempenho por cima da janela: tempo de desenho dos quadros da UI
+// (com histograma), memória residente e todos os contadores de perf_counters.
+// Começa escondido; escondido, não mede nem redesenha nada. Não recebe cliques.
+GtkWidget *perf_hud_new(void);
+
+void perf_hud_toggle(GtkWidget *hud);
+
+#endif // PERF_HUD_H
@@ -0,0 +1,28 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <gio/gio.h>
+
+// Proxy de prévia: cópia leve do vídeo para o player, em que todo quadro é
+// keyframe (seek e scrubbing decodificam um quadro só) e a resolução é a da
+// área do player. A exportação continua sempre lendo o original.
+//
+// Mapeamento de tempo: cada quadro que o decodificador do original entrega vira
+// um quadro do proxy com o mesmo pts, no mesmo time base (o container é NUT, que
+// preserva os dois), e o áudio é copiado sem recodificar (ou, se o NUT não o
+// carrega, recodificado a partir do mesmo instante). Um instante do proxy é
+// portanto o mesmo instante do original, com precisão de quadro, sem tabela de
+// conversão. O proxy fica no cache de mídia, pela chave do conteúdo, com um
+// orçamento próprio; um proxy maior que esse orçamento não é gerado.
+
+// Desligado por padrão (--proxy ou ZENOKA_PROXY=1): gerar o proxy de um 4K longo
+// ocupa a CPU e o disco por alguns minutos
+void proxy_set_enabled(gboolean enabled);
+gboolean proxy_get_enabled(void);
+
+// Caminho do proxy de "path", gerado agora se o cache ainda não tem um. Bloqueia:
+// rodar numa thread de trabalho. Devolve NULL sem erro quando o original já cabe
+// em max_width×max_height (o proxy não ganharia nada); liberar com g_free.
+gchar *proxy_build(const char *path, int max_width, int max_height, GCancellable *cancellable, GError **error);
+
+#endif // PROXY_H
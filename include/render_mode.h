@@ -0,0 +1,33 @@
+#ifndef RENDER_MODE_H
+#define RENDER_MODE_H
+
+#include <gtk/gtk.h>
+
+// Modo de renderização leve: fundo opaco, sem cantos arredondados, sem as
+// animações CSS da titlebar e com os ícones animados parados no primeiro
+// quadro. No automático ele liga enquanto o vídeo toca ou quando o tempo
+// medido de desenho dos quadros passa do orçamento.
+typedef enum {
+    RENDER_MODE_AUTO,
+    RENDER_MODE_FULL,
+    RENDER_MODE_LITE,
+} RenderMode;
+
+// Aceita "auto", "full" e "lite"
+gboolean render_mode_parse(const char *text, RenderMode *mode);
+const char *render_mode_to_string(RenderMode mode);
+
+// Pode ser chamada antes de render_mode_attach (vale a partir dali)
+void render_mode_set(RenderMode mode);
+RenderMode render_mode_get(void);
+
+// Passa a medir o tempo de desenho dos quadros de "window"
+void render_mode_attach(GtkWidget *window);
+
+// Avisado pelo player ao começar ou parar de tocar
+void render_mode_set_playing(gboolean playing);
+
+// TRUE se o modo leve está em vigor agora
+gboolean render_mode_is_lite(void);
+
+#endif // RENDER_MODE_H
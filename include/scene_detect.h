@@ -0,0 +1,28 @@
+#ifndef SCENE_DETECT_H
+#define SCENE_DETECT_H
+
+#include <gio/gio.h>
+#include "seek_index.h"
+
+// Detecção de mudanças de cena para sugerir pontos de corte. O vídeo é
+// decodificado em trechos alinhados a keyframes, um worker por núcleo, e reduzido
+// a uma miniatura de luma; cada quadro é comparado ao anterior pela diferença de
+// histograma e pela soma das diferenças absolutas (SSE2/NEON). Uma análise
+// completa vai para o cache de mídia.
+typedef struct {
+    gint64 time_us;     // primeiro quadro da cena nova, contado do início do vídeo
+    float score;        // 0..1: quanto esse quadro difere do anterior
+} SceneCut;
+
+// Chamada numa thread de trabalho a cada trecho analisado, com os cortes achados
+// nele (trechos terminam fora de ordem) e a fração do vídeo já analisada
+typedef void (*SceneCutsFunc)(const SceneCut *cuts, guint n, double fraction, gpointer user_data);
+
+// Analisa o vídeo inteiro (threads = 0: um worker por núcleo). Os trechos são
+// planejados pelo índice de keyframes "index" de "path" (o do player, que já está
+// sendo montado), ou por um próprio se for NULL. Bloqueia: rodar numa thread de
+// trabalho. Devolve todos os cortes em ordem; liberar com g_array_unref.
+GArray *scene_detect_run(const char *path, SeekIndex *index, guint threads, GCancellable *cancellable,
+    SceneCutsFunc func, gpointer user_data, GError **error);
+
+#endif // SCENE_DETECT_H
@@ -0,0 +1,42 @@
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include <gio/gio.h>
+
+// Índice de keyframes do stream de vídeo de um arquivo. É montado numa thread
+// própria lendo só os pacotes do container (nada é decodificado) e pode ser
+// consultado enquanto ainda está sendo construído. Uma varredura completa vai
+// para o cache de mídia, e o mesmo conteúdo aberto de novo nem é lido.
+typedef struct {
+    gint64 pts_us;  // instante de apresentação do keyframe (nunca antes do real)
+    gint64 ts;      // timestamp no time base do stream, usado no seek do demuxer
+    gint64 pos;     // posição em bytes no arquivo (-1 se desconhecida)
+} SeekEntry;
+
+typedef struct _SeekIndex SeekIndex;
+
+// Começa a indexar "path" em segundo plano
+SeekIndex *seek_index_new(const char *path);
+SeekIndex *seek_index_ref(SeekIndex *idx);
+void seek_index_unref(SeekIndex *idx);
+
+// Interrompe a varredura (o que já foi indexado continua valendo)
+void seek_index_cancel(SeekIndex *idx);
+
+// Keyframe mais próximo em ou antes de "pts_us". FALSE se essa região do arquivo
+// ainda não foi varrida (aí o chamador usa o seek normal do demuxer).
+gboolean seek_index_lookup(SeekIndex *idx, gint64 pts_us, SeekEntry *entry);
+
+gboolean seek_index_is_complete(SeekIndex *idx);
+
+// Bloqueia até a varredura terminar; TRUE se o índice ficou completo
+gboolean seek_index_wait(SeekIndex *idx, GCancellable *cancellable);
+
+// Bloqueia só até a varredura passar de "pts_us" (ou terminar); TRUE se os
+// keyframes até "pts_us" já são conhecidos
+gboolean seek_index_wait_until(SeekIndex *idx, gint64 pts_us, GCancellable *cancellable);
+
+// Cópia dos keyframes conhecidos até agora, em ordem (liberar com g_array_unref)
+GArray *seek_index_get_keyframes(SeekIndex *idx);
+
+#endif // SEEK_INDEX_H
@@ -3,8 +3,16 @@
 
 #include <gtk/gtk.h>
 
+#define SPLASH_DEFAULT_MIN_MS 800
+
+typedef struct _SplashScreen SplashScreen;
+
 // Função para criar e exibir a splash screen
-// Recebe um callback que será chamado quando a splash screen terminar
-void create_splash_screen(GtkApplication *app, void (*callback)(GtkApplication*));
+// Recebe um callback que será chamado quando a splash screen terminar.
+// O splash fica aberto por pelo menos "min_display_ms" e até splash_screen_set_ready ser chamada.
+SplashScreen *create_splash_screen(GtkApplication *app, guint min_display_ms, void (*callback)(GtkApplication*));
+
+// Avisa que a janela principal está pronta; o splash fecha assim que o tempo mínimo passar
+void splash_screen_set_ready(SplashScreen *splash);
 
 #endif // SPLASH_H
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <glib.h>
+
+// Anel de bytes sem trava para exatamente um produtor e um consumidor. Cada
+// lado só escreve o próprio índice (com barreira), então nenhuma das pontas
+// bloqueia nem aloca: serve para alimentar o callback de áudio.
+typedef struct {
+    guint8 *data;
+    guint capacity;     // potência de 2
+    guint mask;
+    guint head;         // total escrito (só o produtor altera)
+    guint tail;         // total lido (só o consumidor altera)
+} SpscRing;
+
+// "capacity" é arredondada para cima até uma potência de 2
+void spsc_ring_init(SpscRing *r, guint capacity);
+void spsc_ring_clear(SpscRing *r);
+
+// Produtor: copia até "n" bytes; retorna quantos couberam
+guint spsc_ring_write(SpscRing *r, const void *src, guint n);
+guint spsc_ring_writable(SpscRing *r);
+
+// Consumidor: copia até "n" bytes; retorna quantos havia
+guint spsc_ring_read(SpscRing *r, void *dst, guint n);
+guint spsc_ring_readable(SpscRing *r);
+
+// Esvazia o anel. Só com as duas pontas paradas.
+void spsc_ring_reset(SpscRing *r);
+
+#endif // SPSC_RING_H
@@ -0,0 +1,36 @@
+#ifndef STAGE_QUEUE_H
+#define STAGE_QUEUE_H
+
+#include <glib.h>
+#include "spsc_ring.h"
+
+// Fila limitada de ponteiros entre dois estágios de um pipeline (exatamente um
+// produtor e um consumidor). Empurrar e retirar não travam nada: são o SpscRing.
+// Só quem encontra a fila cheia (contrapressão) ou vazia dorme, e o outro lado
+// só toca no mutex quando há alguém dormindo.
+typedef struct {
+    SpscRing ring;
+    GMutex lock;
+    GCond cond;
+    gint waiting;       // threads dormindo nesta fila
+    gint aborted;
+    gint *depth;        // contador externo da ocupação (opcional, somado atomicamente)
+} StageQueue;
+
+// "capacity" itens (arredondada para potência de 2); "depth" pode ser NULL
+void stage_queue_init(StageQueue *q, guint capacity, gint *depth);
+void stage_queue_clear(StageQueue *q);
+
+// Bloqueia enquanto a fila está cheia. FALSE se ela foi abortada.
+gboolean stage_queue_push(StageQueue *q, gpointer item);
+
+// Bloqueia enquanto a fila está vazia. FALSE se ela foi abortada.
+gboolean stage_queue_pop(StageQueue *q, gpointer *item);
+
+// Acorda as duas pontas; dali em diante push e pop devolvem FALSE
+void stage_queue_abort(StageQueue *q);
+
+guint stage_queue_length(StageQueue *q);
+guint stage_queue_capacity(StageQueue *q);
+
+#endif // STAGE_QUEUE_H
@@ -0,0 +1,31 @@
+#ifndef THUMBNAILER_H
+#define THUMBNAILER_H
+
+#include <gtk/gtk.h>
+
+// Miniaturas de um vídeo para a linha do tempo. Uma thread própria decodifica
+// só keyframes (o mais próximo antes de cada instante pedido), na ordem em que
+// foram pedidos; um pedido novo descarta o que ainda não tinha sido feito. As
+// texturas prontas ficam num LRU limitado em bytes, consultado só na thread
+// principal. O que foi decodificado (dentro do mesmo orçamento em bytes) vai,
+// no fim, para uma faixa de tamanho limitado no cache de mídia; na próxima
+// abertura essas miniaturas saem dela sem decodificar.
+typedef struct _Thumbnailer Thumbnailer;
+
+// Chamada na thread principal sempre que uma miniatura nova entra no cache
+typedef void (*ThumbnailReadyFunc)(gpointer user_data);
+
+// Miniaturas cabem em max_width×max_height; o arquivo é aberto na thread de
+// decodificação, então nada aqui bloqueia quem chama
+Thumbnailer *thumbnailer_new(const char *path, int max_width, int max_height, gsize cache_bytes,
+    ThumbnailReadyFunc ready, gpointer user_data);
+void thumbnailer_free(Thumbnailer *th);
+
+// Troca a fila pelos instantes dados (µs do início do vídeo), em ordem de
+// prioridade. Os que já estão no cache são ignorados.
+void thumbnailer_request(Thumbnailer *th, const gint64 *times_us, guint n);
+
+// Miniatura do instante exato pedido, se já estiver pronta (referência do cache)
+GdkTexture *thumbnailer_lookup(Thumbnailer *th, gint64 time_us);
+
+#endif // THUMBNAILER_H
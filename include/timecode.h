@@ -0,0 +1,17 @@
+#ifndef TIMECODE_H
+#define TIMECODE_H
+
+#include <glib.h>
+
+// Timecodes no formato HH:MM:SS:FF (FF = quadro dentro do segundo)
+
+// Converte "text" para microssegundos. Aceita também HH:MM:SS. FALSE se inválido
+// (campo que não é só dígitos, sobra no fim, minuto/segundo/quadro fora da faixa,
+// hora que não cabe em microssegundos num gint64).
+gboolean timecode_parse(const char *text, double fps, gint64 *us);
+
+// Escreve "us" como HH:MM:SS:FF em "buf" (pelo menos 16 bytes), no quadro mais
+// próximo: timecode_parse do resultado volta ao mesmo quadro
+void timecode_format(gint64 us, double fps, char *buf, gsize size);
+
+#endif // TIMECODE_H
@@ -0,0 +1,33 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <glib.h>
+
+// Rastreamento de latência (formato Chrome trace-event, abrir em chrome://tracing ou
+// ui.perfetto.dev). Desligado, cada ponto de medição custa só um branch em trace_enabled.
+extern gboolean trace_enabled;
+
+// Liga o rastreamento; os eventos são gravados em "path" por trace_shutdown
+void trace_init(const char *path);
+void trace_shutdown(void);
+
+void trace_record(const char *name, const char *category, gint64 start_us, gint64 end_us);
+void trace_record_instant(const char *name, const char *category);
+
+// Marca o início de um intervalo (0 quando desligado)
+static inline gint64 trace_begin(void) {
+    return G_UNLIKELY(trace_enabled) ? g_get_monotonic_time() : 0;
+}
+
+// Fecha o intervalo aberto por trace_begin
+#define trace_end(name, category, start) G_STMT_START { \
+    if (G_UNLIKELY(trace_enabled)) \
+        trace_record((name), (category), (start), g_get_monotonic_time()); \
+} G_STMT_END
+
+#define trace_instant(name, category) G_STMT_START { \
+    if (G_UNLIKELY(trace_enabled)) \
+        trace_record_instant((name), (category)); \
+} G_STMT_END
+
+#endif // TRACE_H
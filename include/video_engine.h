@@ -0,0 +1,75 @@
+#ifndef VIDEO_ENGINE_H
+#define VIDEO_ENGINE_H
+
+#include <gtk/gtk.h>
+#include "seek_index.h"
+
+// Player de vídeo para arquivos locais. Uma thread faz o demux e outra decodifica
+// para um anel de buffers reaproveitados; o quadro atual é exposto como GdkPaintable,
+// sem cópia de pixels na thread principal. Quadros atrasados são descartados.
+typedef struct _VideoEngine VideoEngine;
+
+typedef struct {
+    guint presented;      // quadros mostrados
+    guint dropped;        // quadros descartados por atraso
+    guint queued_packets; // pacotes esperando o decodificador
+    guint ready_frames;   // quadros decodificados esperando a hora de aparecer
+} VideoEngineStats;
+
+VideoEngine *video_engine_new(void);
+void video_engine_free(VideoEngine *e);
+
+// Abre "path" e começa a decodificar (parado, mostrando o primeiro quadro).
+// Os quadros são escalados para caber em max_width×max_height.
+gboolean video_engine_open(VideoEngine *e, const char *path, int max_width, int max_height, GError **error);
+void video_engine_close(VideoEngine *e);
+gboolean video_engine_is_open(VideoEngine *e);
+
+// Passa a prévia do arquivo aberto para o seu proxy (ver proxy.h), na mesma
+// posição e sem parar de tocar. Como o proxy tem os pts do original, posições e
+// duração continuam valendo. Se o proxy não abrir, o original é reaberto.
+gboolean video_engine_use_proxy(VideoEngine *e, const char *proxy_path, GError **error);
+
+// Paintable com o quadro atual (pertence ao engine)
+GdkPaintable *video_engine_get_paintable(VideoEngine *e);
+
+// Widget cujo frame clock conduz a apresentação dos quadros
+void video_engine_attach(VideoEngine *e, GtkWidget *widget);
+
+// Chamada na thread principal sempre que o engine começa ou para de tocar
+// (inclusive quando o vídeo chega ao fim)
+typedef void (*VideoStateFunc)(VideoEngine *e, gpointer user_data);
+void video_engine_set_state_func(VideoEngine *e, VideoStateFunc func, gpointer user_data);
+
+void video_engine_play(VideoEngine *e);
+void video_engine_pause(VideoEngine *e);
+gboolean video_engine_is_playing(VideoEngine *e);
+
+// Vai para "position_us" (contado do início do vídeo) com precisão de quadro.
+// Usa o índice de keyframes montado em segundo plano na abertura.
+void video_engine_seek(VideoEngine *e, gint64 position_us);
+
+gint64 video_engine_get_duration_us(VideoEngine *e);
+gint64 video_engine_get_position_us(VideoEngine *e);
+double video_engine_get_frame_rate(VideoEngine *e);
+void video_engine_get_stats(VideoEngine *e, VideoEngineStats *stats);
+
+// Para engines sem widget (benchmarks, ferramentas): tira da fila o próximo
+// quadro decodificado, esperando até "timeout_us". A posição dele (contada do
+// início do vídeo) vai em "position_us". NULL no fim do vídeo ou se nada chegou
+// a tempo. Liberar com g_object_unref.
+GdkTexture *video_engine_take_frame(VideoEngine *e, gint64 timeout_us, gint64 *position_us);
+
+// Índice de keyframes do arquivo aberto (pertence ao engine; NULL sem arquivo).
+// Quem precisar dele depois de fechar o arquivo usa seek_index_ref.
+SeekIndex *video_engine_get_seek_index(VideoEngine *e);
+
+// Áudio do arquivo aberto. Quando existe, a posição tocada é o relógio mestre da
+// apresentação. Volume (0 a 1) e mudo valem também para os próximos arquivos.
+gboolean video_engine_has_audio(VideoEngine *e);
+void video_engine_set_volume(VideoEngine *e, double volume);
+double video_engine_get_volume(VideoEngine *e);
+void video_engine_set_muted(VideoEngine *e, gboolean muted);
+gboolean video_engine_is_muted(VideoEngine *e);
+
+#endif // VIDEO_ENGINE_H
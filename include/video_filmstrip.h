@@ -0,0 +1,20 @@
+#ifndef VIDEO_FILMSTRIP_H
+#define VIDEO_FILMSTRIP_H
+
+#include <gtk/gtk.h>
+
+// Faixa de miniaturas da linha do tempo. Mostra o trecho [start, end) do vídeo
+// em quadros lado a lado; as miniaturas vêm de um Thumbnailer em segundo plano,
+// pedidas a partir do que está visível, e quem ainda não chegou aparece vazio.
+#define VIDEO_TYPE_FILMSTRIP (video_filmstrip_get_type())
+G_DECLARE_FINAL_TYPE(VideoFilmstrip, video_filmstrip, VIDEO, FILMSTRIP, GtkWidget)
+
+GtkWidget *video_filmstrip_new(void);
+
+// Troca o vídeo (NULL limpa). As miniaturas antigas são descartadas.
+void video_filmstrip_set_source(VideoFilmstrip *self, const char *path);
+
+// Trecho visível, em µs do início do vídeo
+void video_filmstrip_set_range(VideoFilmstrip *self, gint64 start_us, gint64 end_us);
+
+#endif // VIDEO_FILMSTRIP_H
@@ -0,0 +1,16 @@
+#ifndef VIDEO_PAINTABLE_H
+#define VIDEO_PAINTABLE_H
+
+#include <gtk/gtk.h>
+
+// GdkPaintable que mostra o quadro atual do player. O quadro é uma GdkTexture
+// montada pela thread de decodificação; a thread principal só troca o ponteiro.
+#define VIDEO_TYPE_PAINTABLE (video_paintable_get_type())
+G_DECLARE_FINAL_TYPE(VideoPaintable, video_paintable, VIDEO, PAINTABLE, GObject)
+
+VideoPaintable *video_paintable_new(void);
+
+// Troca o quadro exibido (NULL limpa)
+void video_paintable_set_texture(VideoPaintable *self, GdkTexture *texture);
+
+#endif // VIDEO_PAINTABLE_H
@@ -0,0 +1,29 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <gio/gio.h>
+
+// Forma de onda do áudio de um arquivo em pirâmide de resoluções: cada nível
+// guarda min/max/RMS por bloco de 256, 4096 e 65536 amostras (mono). O áudio é
+// decodificado uma vez só; o resultado vai para o cache de mídia e, enquanto o
+// conteúdo não muda, é reaproveitado (mapeado) sem decodificar nada.
+typedef struct _Waveform Waveform;
+
+typedef struct {
+    float min;      // -1..1
+    float max;
+    float rms;      // 0..1
+} WaveformPeak;
+
+// Lê do cache ou analisa o áudio (e grava o cache). Bloqueia: rodar numa
+// thread de trabalho. MEDIA_ERROR_NO_STREAM se o arquivo não tem áudio.
+Waveform *waveform_load(const char *path, GCancellable *cancellable, GError **error);
+void waveform_free(Waveform *wf);
+
+gint64 waveform_get_duration_us(Waveform *wf);
+
+// Resume [start_us, end_us) em "columns" picos, usando o nível mais grosso que
+// ainda tem resolução suficiente: o custo é proporcional às colunas, não ao trecho
+void waveform_get_peaks(Waveform *wf, gint64 start_us, gint64 end_us, guint columns, WaveformPeak *out);
+
+#endif // WAVEFORM_H
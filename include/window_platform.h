@@ -0,0 +1,12 @@
+#ifndef WINDOW_PLATFORM_H
+#define WINDOW_PLATFORM_H
+
+#include <gtk/gtk.h>
+
+// O pouco que depende do sistema de janelas, atrás de uma interface só GDK
+
+// Centraliza a janela (já mapeada) na área útil do monitor em que ela está.
+// Onde o compositor decide o posicionamento (Wayland) não faz nada.
+void window_platform_center(GtkWidget *window, int width, int height);
+
+#endif // WINDOW_PLATFORM_H
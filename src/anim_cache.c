@@ -0,0 +1,276 @@
+#include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
+#include "anim_cache.h"
+#include "gif_scan.h"
+#include "perf_counters.h"
+
+// Limites para GIFs malformados ou muito longos
+#define ANIM_MAX_FRAMES     512
+#define ANIM_MIN_DELAY_MS   20
+#define ANIM_CHUNK_SIZE     (64 * 1024)
+
+#define ASSET_RESOURCE_PREFIX "/com/luquitoos/zenoka/icons"
+
+static GMutex cache_lock;
+static GHashTable *cache = NULL;   // caminho ou "nome@LxA" -> AnimFrames*
+
+// Memória de textura de todos os AnimFrames vivos (no cache ou só nos widgets), para o HUD
+static PerfCounter *perf_textures(void) {
+    static PerfCounter *counter = NULL;
+    if (g_once_init_enter(&counter))
+        g_once_init_leave(&counter, perf_counter_register("anim.texturas", PERF_KIB));
+    return counter;
+}
+
+static gint frames_kib(const AnimFrames *a) {
+    return (gint)((gint64)a->width * a->height * 4 * a->n_frames / 1024);
+}
+
+static AnimFrames *frames_from_list(GPtrArray *textures, GArray *delays, int width, int height) {
+    AnimFrames *a = g_new0(AnimFrames, 1);
+    a->ref_count = 1;
+    a->width = width;
+    a->height = height;
+    a->n_frames = textures->len;
+    a->frames = (GdkTexture **)g_ptr_array_free(textures, FALSE);
+    a->delays = (int *)g_array_free(delays, FALSE);
+    perf_counter_add(perf_textures(), frames_kib(a));
+    return a;
+}
+
+// O iterador do gdk-pixbuf só aceita GTimeVal (obsoleto) para o relógio simulado
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+typedef struct {
+    GdkPixbufAnimationIter *iter;
+    GTimeVal t;
+    GPtrArray *textures;
+    GArray *delays;
+    guint limit;
+    gboolean finished;
+    AnimFrameFunc on_frame;
+    gpointer user_data;
+} Decoder;
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+static void emit_frame(Decoder *dec, GdkPixbuf *pixbuf, int delay) {
+    GdkTexture *tex = gdk_texture_new_for_pixbuf(pixbuf);
+    g_ptr_array_add(dec->textures, tex);
+    g_array_append_val(dec->delays, delay);
+    if (dec->on_frame)
+        dec->on_frame(tex, delay, dec->textures->len - 1, dec->user_data);
+}
+
+// Emite os quadros que o loader já terminou; "done" indica que o arquivo inteiro foi entregue
+static void collect_frames(Decoder *dec, GdkPixbufLoader *loader, gboolean done) {
+    GdkPixbufAnimation *anim = gdk_pixbuf_loader_get_animation(loader);
+    if (!anim || dec->finished)
+        return;
+
+    if (done && dec->textures->len == 0 && gdk_pixbuf_animation_is_static_image(anim)) {
+        emit_frame(dec, gdk_pixbuf_animation_get_static_image(anim), -1);
+        dec->finished = TRUE;
+        return;
+    }
+
+    // Percorre a animação um quadro por vez
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+    if (!dec->iter)
+        dec->iter = gdk_pixbuf_animation_get_iter(anim, &dec->t);
+    while (dec->textures->len < dec->limit) {
+        if (!done && gdk_pixbuf_animation_iter_on_currently_loading_frame(dec->iter))
+            break;
+        int delay = gdk_pixbuf_animation_iter_get_delay_time(dec->iter);
+        if (delay >= 0)
+            delay = MAX(delay, ANIM_MIN_DELAY_MS);
+        emit_frame(dec, gdk_pixbuf_animation_iter_get_pixbuf(dec->iter), delay);
+        if (delay < 0) {
+            dec->finished = TRUE;
+            break;
+        }
+        g_time_val_add(&dec->t, (glong)delay * 1000);
+        gdk_pixbuf_animation_iter_advance(dec->iter, &dec->t);
+    }
+    G_GNUC_END_IGNORE_DEPRECATIONS
+}
+
+static AnimFrames *decode_animation(const char *path, GCancellable *cancellable,
+    AnimFrameFunc on_frame, gpointer user_data, GError **error) {
+    gchar *contents = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(path, &contents, &len, error))
+        return NULL;
+
+    guint expected = gif_count_frames((const guchar *)contents, len);
+    Decoder dec = { 0 };
+    dec.textures = g_ptr_array_new_with_free_func(g_object_unref);
+    dec.delays = g_array_new(FALSE, FALSE, sizeof(int));
+    dec.limit = expected > 0 ? MIN(expected, ANIM_MAX_FRAMES) : ANIM_MAX_FRAMES;
+    dec.on_frame = on_frame;
+    dec.user_data = user_data;
+
+    // Alimenta o loader aos poucos para entregar cada quadro assim que fica pronto
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new();
+    gboolean ok = TRUE;
+    for (gsize off = 0; ok && off < len; off += ANIM_CHUNK_SIZE) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        ok = gdk_pixbuf_loader_write(loader, (const guchar *)contents + off,
+                                     MIN(ANIM_CHUNK_SIZE, len - off), error);
+        if (ok && on_frame)
+            collect_frames(&dec, loader, FALSE);
+    }
+    if (ok)
+        ok = gdk_pixbuf_loader_close(loader, error);
+    else
+        gdk_pixbuf_loader_close(loader, NULL);
+    if (ok)
+        collect_frames(&dec, loader, TRUE);
+    g_free(contents);
+
+    AnimFrames *a = NULL;
+    if (ok && dec.textures->len > 0) {
+        GdkPixbufAnimation *anim = gdk_pixbuf_loader_get_animation(loader);
+        g_ptr_array_set_free_func(dec.textures, NULL);
+        a = frames_from_list(dec.textures, dec.delays,
+                             gdk_pixbuf_animation_get_width(anim), gdk_pixbuf_animation_get_height(anim));
+    } else {
+        if (ok)
+            g_set_error(error, GDK_PIXBUF_ERROR, GDK_PIXBUF_ERROR_CORRUPT_IMAGE, "Nenhum quadro em %s", path);
+        g_ptr_array_free(dec.textures, TRUE);
+        g_array_free(dec.delays, TRUE);
+    }
+    if (dec.iter)
+        g_object_unref(dec.iter);
+    g_object_unref(loader);
+    return a;
+}
+
+// Faixa de quadros gerada pelo "make assets": quadros lado a lado num PNG, com a
+// quantidade e as durações gravadas em chunks tEXt
+static AnimFrames *load_strip(const char *resource_path, AnimFrameFunc on_frame, gpointer user_data, GError **error) {
+    GdkPixbuf *strip = gdk_pixbuf_new_from_resource(resource_path, error);
+    if (!strip)
+        return NULL;
+
+    const char *n_str = gdk_pixbuf_get_option(strip, "tEXt::zenoka-frames");
+    const char *delay_str = gdk_pixbuf_get_option(strip, "tEXt::zenoka-delays");
+    guint n = n_str ? (guint)MAX(atoi(n_str), 1) : 1;
+    gchar **delay_list = delay_str ? g_strsplit(delay_str, ",", -1) : NULL;
+    int fw = gdk_pixbuf_get_width(strip) / (int)n;
+    int fh = gdk_pixbuf_get_height(strip);
+
+    GPtrArray *textures = g_ptr_array_sized_new(n);
+    GArray *delays = g_array_sized_new(FALSE, FALSE, sizeof(int), n);
+    for (guint i = 0; i < n; i++) {
+        GdkPixbuf *sub = gdk_pixbuf_new_subpixbuf(strip, (int)i * fw, 0, fw, fh);
+        GdkTexture *tex = gdk_texture_new_for_pixbuf(sub);
+        int delay = delay_list && i < g_strv_length(delay_list) ? atoi(delay_list[i]) : -1;
+        g_object_unref(sub);
+        g_ptr_array_add(textures, tex);
+        g_array_append_val(delays, delay);
+        if (on_frame)
+            on_frame(tex, delay, i, user_data);
+    }
+    g_strfreev(delay_list);
+    g_object_unref(strip);
+    return frames_from_list(textures, delays, fw, fh);
+}
+
+static AnimFrames *cache_lookup(const char *key) {
+    g_mutex_lock(&cache_lock);
+    if (!cache)
+        cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)anim_frames_unref);
+    AnimFrames *a = g_hash_table_lookup(cache, key);
+    if (a)
+        anim_frames_ref(a);
+    g_mutex_unlock(&cache_lock);
+    return a;
+}
+
+// Decodificamos fora do lock; se outra thread ganhar a corrida, usamos a versão dela
+static AnimFrames *cache_insert(const char *key, AnimFrames *a) {
+    g_mutex_lock(&cache_lock);
+    AnimFrames *existing = g_hash_table_lookup(cache, key);
+    if (existing) {
+        anim_frames_unref(a);
+        a = existing;
+    } else {
+        g_hash_table_insert(cache, g_strdup(key), a);
+    }
+    anim_frames_ref(a);
+    g_mutex_unlock(&cache_lock);
+    return a;
+}
+
+AnimFrames *anim_cache_get(const char *path, GError **error) {
+    return anim_cache_get_progressive(path, NULL, NULL, NULL, error);
+}
+
+AnimFrames *anim_cache_get_progressive(const char *path, GCancellable *cancellable,
+    AnimFrameFunc on_frame, gpointer user_data, GError **error) {
+    g_return_val_if_fail(path != NULL, NULL);
+
+    AnimFrames *a = cache_lookup(path);
+    if (a)
+        return a;
+    a = decode_animation(path, cancellable, on_frame, user_data, error);
+    return a ? cache_insert(path, a) : NULL;
+}
+
+AnimFrames *anim_cache_get_asset(const char *name, int width, int height, GError **error) {
+    return anim_cache_get_asset_progressive(name, width, height, NULL, NULL, NULL, error);
+}
+
+AnimFrames *anim_cache_get_asset_progressive(const char *name, int width, int height,
+    GCancellable *cancellable, AnimFrameFunc on_frame, gpointer user_data, GError **error) {
+    g_return_val_if_fail(name != NULL, NULL);
+
+    gchar *key = g_strdup_printf("%s@%dx%d", name, width, height);
+    AnimFrames *a = cache_lookup(key);
+    if (a) {
+        g_free(key);
+        return a;
+    }
+
+    gchar *stem = g_strndup(name, strcspn(name, "."));
+    gchar *resource = g_strdup_printf(ASSET_RESOURCE_PREFIX "/%s-%dx%d.png", stem, width, height);
+    if (g_resources_get_info(resource, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL, NULL, NULL)) {
+        a = load_strip(resource, on_frame, user_data, error);
+    } else {
+        // Variante não embutida no binário: decodifica o original do disco
+        const char *dir = g_getenv("ZENOKA_ICON_DIR");
+        gchar *path = g_build_filename(dir ? dir : "icons", name, NULL);
+        a = decode_animation(path, cancellable, on_frame, user_data, error);
+        g_free(path);
+    }
+    g_free(resource);
+    g_free(stem);
+
+    if (a)
+        a = cache_insert(key, a);
+    g_free(key);
+    return a;
+}
+
+AnimFrames *anim_frames_ref(AnimFrames *anim) {
+    g_atomic_int_inc(&anim->ref_count);
+    return anim;
+}
+
+void anim_frames_unref(AnimFrames *anim) {
+    if (!anim || !g_atomic_int_dec_and_test(&anim->ref_count))
+        return;
+    perf_counter_add(perf_textures(), -frames_kib(anim));
+    for (guint i = 0; i < anim->n_frames; i++)
+        g_object_unref(anim->frames[i]);
+    g_free(anim->frames);
+    g_free(anim->delays);
+    g_free(anim);
+}
+
+gboolean anim_frames_is_animated(const AnimFrames *anim) {
+    return anim && anim->n_frames > 1;
+}
@@ -0,0 +1,213 @@
+#include <gtk/gtk.h>
+#include "anim_scheduler.h"
+#include "trace.h"
+#include "perf_counters.h"
+
+// Quadros que vencem dentro desta folga entram no mesmo repaint
+#define FRAME_SLACK_US 4000
+
+struct _AnimationData {
+    AnimFrames *anim;
+    guint frame;
+    GtkWidget *widget;
+    GdkFrameClock *clock;   // frame clock enquanto o widget estiver mapeado
+    gint64 next_frame_us;   // horário (monotônico) da próxima troca de quadro
+};
+
+static GList *animations = NULL;
+static guint wake_id = 0;
+static gboolean paused = FALSE;
+
+// HUD: animações registradas, as que estão andando, timers armados e trocas de quadro
+static struct {
+    PerfCounter *registered;
+    PerfCounter *visible;
+    PerfCounter *timers;
+    PerfCounter *frames;
+} perf;
+
+static void perf_init(void) {
+    if (perf.registered)
+        return;
+    perf.registered = perf_counter_register("anim.registradas", PERF_GAUGE);
+    perf.visible = perf_counter_register("anim.visiveis", PERF_GAUGE);
+    perf.timers = perf_counter_register("anim.timers", PERF_GAUGE);
+    perf.frames = perf_counter_register("anim.quadros", PERF_COUNT);
+}
+
+static gboolean is_visible(AnimationData *d) {
+    if (paused || !d->clock || !gtk_widget_is_drawable(d->widget))
+        return FALSE;
+
+    GtkNative *native = gtk_widget_get_native(d->widget);
+    GdkSurface *surface = native ? gtk_native_get_surface(native) : NULL;
+    if (surface && GDK_IS_TOPLEVEL(surface) &&
+        (gdk_toplevel_get_state(GDK_TOPLEVEL(surface)) & GDK_TOPLEVEL_STATE_MINIMIZED))
+        return FALSE;
+    return TRUE;
+}
+
+static void set_frame(AnimationData *d) {
+    GdkPaintable *p = GDK_PAINTABLE(d->anim->frames[d->frame]);
+    if (GTK_IS_PICTURE(d->widget))
+        gtk_picture_set_paintable(GTK_PICTURE(d->widget), p);
+    else
+        gtk_image_set_from_paintable(GTK_IMAGE(d->widget), p);
+}
+
+static gboolean on_wakeup(gpointer user_data);
+
+// Arma um único timer para o próximo quadro visível; sem nada visível, nenhum wakeup
+static void schedule_wakeup(void) {
+    if (wake_id) {
+        g_source_remove(wake_id);
+        wake_id = 0;
+    }
+
+    gint64 next = G_MAXINT64;
+    gint visible = 0;
+    for (GList *l = animations; l; l = l->next) {
+        AnimationData *d = l->data;
+        if (is_visible(d)) {
+            next = MIN(next, d->next_frame_us);
+            visible++;
+        }
+    }
+    perf_counter_set(perf.visible, visible);
+    if (next != G_MAXINT64) {
+        gint64 now = g_get_monotonic_time();
+        guint ms = next > now ? (guint)((next - now + 999) / 1000) : 0;
+        wake_id = g_timeout_add(ms, on_wakeup, NULL);
+    }
+    perf_counter_set(perf.timers, wake_id ? 1 : 0);
+}
+
+// O timer só pede um quadro; as trocas acontecem todas no "update" do frame clock
+static gboolean on_wakeup(gpointer user_data) {
+    (void)user_data;
+    wake_id = 0;
+    perf_counter_set(perf.timers, 0);
+
+    gint64 now = g_get_monotonic_time();
+    for (GList *l = animations; l; l = l->next) {
+        AnimationData *d = l->data;
+        if (is_visible(d) && d->next_frame_us <= now + FRAME_SLACK_US)
+            gdk_frame_clock_request_phase(d->clock, GDK_FRAME_CLOCK_PHASE_UPDATE);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void advance(AnimationData *d, gint64 now) {
+    const AnimFrames *a = d->anim;
+
+    // Atraso maior que um quadro (janela restaurada, sistema ocupado): retoma sem rajada
+    if (now - d->next_frame_us > 1000 * (gint64)MAX(a->delays[d->frame], 0))
+        d->next_frame_us = now;
+
+    while (d->next_frame_us <= now + FRAME_SLACK_US) {
+        d->frame = (d->frame + 1) % a->n_frames;
+        int delay = a->delays[d->frame];
+        if (delay < 0) {
+            d->next_frame_us = G_MAXINT64;
+            break;
+        }
+        d->next_frame_us += (gint64)delay * 1000;
+    }
+    set_frame(d);
+    perf_counter_add(perf.frames, 1);
+}
+
+static void on_clock_update(GdkFrameClock *clock, gpointer user_data) {
+    (void)user_data;
+    gint64 t = trace_begin();
+    gint64 now = gdk_frame_clock_get_frame_time(clock);
+
+    for (GList *l = animations; l; l = l->next) {
+        AnimationData *d = l->data;
+        if (d->clock == clock && is_visible(d) && d->next_frame_us <= now + FRAME_SLACK_US)
+            advance(d, now);
+    }
+    schedule_wakeup();
+    trace_end("animation tick", "anim", t);
+}
+
+static void on_toplevel_state(GObject *surface, GParamSpec *pspec, gpointer user_data) {
+    (void)surface; (void)pspec; (void)user_data;
+    schedule_wakeup();
+}
+
+static void on_widget_map(GtkWidget *widget, AnimationData *d) {
+    d->clock = gtk_widget_get_frame_clock(widget);
+    if (!d->clock)
+        return;
+
+    // Uma única conexão por frame clock e por superfície, para todas as animações
+    if (!g_object_get_data(G_OBJECT(d->clock), "anim-scheduler")) {
+        g_signal_connect(d->clock, "update", G_CALLBACK(on_clock_update), NULL);
+        g_object_set_data(G_OBJECT(d->clock), "anim-scheduler", GINT_TO_POINTER(1));
+    }
+    GdkSurface *surface = gtk_native_get_surface(gtk_widget_get_native(widget));
+    if (surface && !g_object_get_data(G_OBJECT(surface), "anim-scheduler")) {
+        g_signal_connect(surface, "notify::state", G_CALLBACK(on_toplevel_state), NULL);
+        g_object_set_data(G_OBJECT(surface), "anim-scheduler", GINT_TO_POINTER(1));
+    }
+
+    gint64 now = g_get_monotonic_time();
+    if (d->next_frame_us != G_MAXINT64 && d->next_frame_us < now)
+        d->next_frame_us = now + (gint64)d->anim->delays[d->frame] * 1000;
+    schedule_wakeup();
+}
+
+static void on_widget_unmap(GtkWidget *widget, AnimationData *d) {
+    (void)widget;
+    d->clock = NULL;
+    schedule_wakeup();
+}
+
+static void free_animation_data(gpointer user_data) {
+    AnimationData *d = user_data;
+    animations = g_list_remove(animations, d);
+    perf_counter_add(perf.registered, -1);
+    anim_frames_unref(d->anim);
+    g_free(d);
+    schedule_wakeup();
+}
+
+AnimationData *anim_scheduler_add(GtkWidget *widget, AnimFrames *anim) {
+    g_return_val_if_fail(GTK_IS_IMAGE(widget) || GTK_IS_PICTURE(widget), NULL);
+
+    perf_init();
+    AnimationData *d = g_new0(AnimationData, 1);
+    d->anim = anim_frames_ref(anim);
+    d->widget = widget;
+    d->next_frame_us = anim->delays[0] >= 0
+        ? g_get_monotonic_time() + (gint64)anim->delays[0] * 1000
+        : G_MAXINT64;
+    set_frame(d);
+
+    animations = g_list_prepend(animations, d);
+    perf_counter_add(perf.registered, 1);
+    g_signal_connect(widget, "map", G_CALLBACK(on_widget_map), d);
+    g_signal_connect(widget, "unmap", G_CALLBACK(on_widget_unmap), d);
+    g_object_set_data_full(G_OBJECT(widget), "animation-data", d, free_animation_data);
+
+    if (gtk_widget_get_mapped(widget))
+        on_widget_map(widget, d);
+    return d;
+}
+
+void anim_scheduler_set_paused(gboolean pause) {
+    if (paused == pause)
+        return;
+    paused = pause;
+
+    gint64 now = g_get_monotonic_time();
+    for (GList *l = animations; l; l = l->next) {
+        AnimationData *d = l->data;
+        // Parado mostra o primeiro quadro; ao voltar, recomeça dele
+        d->frame = 0;
+        d->next_frame_us = d->anim->delays[0] >= 0 ? now + (gint64)d->anim->delays[0] * 1000 : G_MAXINT64;
+        set_frame(d);
+    }
+    schedule_wakeup();
+}
@@ -0,0 +1,376 @@
+#include <glib.h>
+#include <string.h>
+#include <SDL.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#include "audio_engine.h"
+#include "spsc_ring.h"
+#include "media_util.h"
+
+#define AUDIO_OUT_RATE      48000
+#define AUDIO_OUT_SAMPLES   1024    // por callback (~21ms a 48kHz)
+#define AUDIO_RING_MS       500
+// Espera máxima do decodificador pelo callback com o anel cheio (o callback
+// sinaliza sem trava, então um sinal perdido custa no máximo isso)
+#define RING_WAIT_MAX_US    (100 * G_TIME_SPAN_MILLISECOND)
+
+struct _AudioEngine {
+    AVCodecContext *dec;
+    AVRational time_base;
+    SwrContext *swr;
+    PacketQueue *packets;
+    GThread *thread;
+
+    SDL_AudioDeviceID device;
+    int channels;
+    int rate;
+    int frame_bytes;        // bytes por amostra de todos os canais
+    gint64 latency_us;      // o que o dispositivo já tem na frente do callback
+
+    SpscRing ring;          // só recebe amostras inteiras (todos os canais)
+    GMutex space_lock;
+    GCond space_cond;       // o callback liberou espaço, chegou um seek ou fechou
+    gint quit;
+
+    GMutex seek_lock;
+    gint64 seek_target_us;
+    guint seek_serial;
+    gint latest_serial;     // serial do último seek pedido
+    gint seeking;           // até o decodificador esvaziar o anel: callback toca silêncio
+    gint eof;
+
+    // Só mudam com o dispositivo travado (callback parado)
+    gint64 base_pts_us;     // pts do primeiro byte escrito depois do último reset
+    guint64 read_bytes;     // lidos pelo callback desde então
+
+    // Publicado pelo callback com um seqlock: ímpar = escrevendo
+    gint clock_seq;
+    gint64 clock_pts_us;    // pts do começo do último bloco entregue
+    gint64 clock_time_us;   // quando esse começo sai no alto-falante
+    gint64 clock_span_us;   // duração do bloco (limite da extrapolação)
+    gint clock_valid;
+
+    gint volume;            // por mil
+    gint muted;
+    gboolean playing;
+};
+
+static void publish_clock(AudioEngine *a, gint64 pts_us, gint64 time_us, gint64 span_us) {
+    g_atomic_int_inc(&a->clock_seq);
+    a->clock_pts_us = pts_us;
+    a->clock_time_us = time_us;
+    a->clock_span_us = span_us;
+    g_atomic_int_inc(&a->clock_seq);
+    g_atomic_int_set(&a->clock_valid, 1);
+}
+
+static void read_clock(AudioEngine *a, gint64 *pts_us, gint64 *time_us, gint64 *span_us) {
+    gint seq;
+    do {
+        seq = g_atomic_int_get(&a->clock_seq);
+        *pts_us = a->clock_pts_us;
+        *time_us = a->clock_time_us;
+        *span_us = a->clock_span_us;
+    } while ((seq & 1) || seq != g_atomic_int_get(&a->clock_seq));
+}
+
+// Thread de áudio do SDL: só copia do anel, aplica o ganho e publica a posição
+static void audio_callback(void *userdata, Uint8 *stream, int len) {
+    AudioEngine *a = userdata;
+    guint got = 0;
+    if (!g_atomic_int_get(&a->seeking))
+        got = spsc_ring_read(&a->ring, stream, (guint)len);
+    if (got < (guint)len)
+        memset(stream + got, 0, (guint)len - got);  // faltou dado: silêncio
+    if (got == 0)
+        return;
+    g_cond_signal(&a->space_cond);
+
+    float gain = g_atomic_int_get(&a->muted) ? 0.0f : g_atomic_int_get(&a->volume) / 1000.0f;
+    if (gain != 1.0f) {
+        float *samples = (float *)stream;
+        for (guint i = 0; i < got / sizeof(float); i++)
+            samples[i] *= gain;
+    }
+
+    gint64 bytes_per_sec = (gint64)a->rate * a->frame_bytes;
+    gint64 pts = a->base_pts_us + (gint64)(a->read_bytes * G_USEC_PER_SEC / bytes_per_sec);
+    a->read_bytes += got;
+    publish_clock(a, pts, g_get_monotonic_time() + a->latency_us, (gint64)got * G_USEC_PER_SEC / bytes_per_sec);
+}
+
+static gboolean seek_pending(AudioEngine *a, guint serial) {
+    return (guint)g_atomic_int_get(&a->latest_serial) != serial;
+}
+
+// Começo de um serial novo: esvazia o anel com o callback parado
+static void restart_output(AudioEngine *a, gint64 pts_us, guint serial) {
+    SDL_LockAudioDevice(a->device);
+    spsc_ring_reset(&a->ring);
+    a->base_pts_us = pts_us;
+    a->read_bytes = 0;
+    g_atomic_int_set(&a->clock_valid, 0);
+    g_atomic_int_set(&a->eof, 0);
+    // Um seek que chegou nesse meio tempo continua valendo
+    if (!seek_pending(a, serial))
+        g_atomic_int_set(&a->seeking, 0);
+    SDL_UnlockAudioDevice(a->device);
+}
+
+static gboolean ring_wait_over(AudioEngine *a, guint serial, guint frame) {
+    return spsc_ring_writable(&a->ring) >= frame || seek_pending(a, serial) || g_atomic_int_get(&a->quit);
+}
+
+// Escreve só amostras inteiras: o anel é de bytes e sua capacidade (potência de
+// 2) nem sempre é múltipla do tamanho da amostra, e o callback lê o que houver,
+// então uma amostra pela metade trocaria os canais. Espera espaço; desiste se
+// chegou um seek ou o engine está fechando.
+static void write_ring(AudioEngine *a, const guint8 *data, guint n, guint serial) {
+    guint frame = (guint)a->frame_bytes;
+    while (n > 0) {
+        guint room = spsc_ring_writable(&a->ring) / frame * frame;
+        guint w = spsc_ring_write(&a->ring, data, MIN(n, room));
+        data += w;
+        n -= w;
+        if (n == 0)
+            break;
+        if (seek_pending(a, serial) || g_atomic_int_get(&a->quit))
+            return;
+        g_mutex_lock(&a->space_lock);
+        while (!ring_wait_over(a, serial, frame) &&
+               g_cond_wait_until(&a->space_cond, &a->space_lock, g_get_monotonic_time() + RING_WAIT_MAX_US))
+            ;
+        g_mutex_unlock(&a->space_lock);
+    }
+}
+
+static gpointer decode_thread(gpointer data) {
+    AudioEngine *a = data;
+    AVFrame *frame = av_frame_alloc();
+    guint8 *buf = NULL;
+    int buf_samples = 0;
+    gint64 next_pts_us = G_MININT64;
+    gint64 skip_until_us = G_MININT64;
+    gboolean need_restart = TRUE;
+    guint cur_serial = 0;
+    AVPacket *pkt = NULL;
+    guint serial;
+
+    while (packet_queue_get(a->packets, &pkt, &serial)) {
+        if (serial != cur_serial) {
+            cur_serial = serial;
+            avcodec_flush_buffers(a->dec);
+            swr_close(a->swr);
+            swr_init(a->swr);
+            g_mutex_lock(&a->seek_lock);
+            skip_until_us = a->seek_serial == serial ? a->seek_target_us : G_MININT64;
+            g_mutex_unlock(&a->seek_lock);
+            next_pts_us = G_MININT64;
+            need_restart = TRUE;
+        }
+
+        int ret = avcodec_send_packet(a->dec, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            continue;
+
+        while ((ret = avcodec_receive_frame(a->dec, frame)) >= 0) {
+            gint64 pts_us = media_ts_to_us(frame->best_effort_timestamp, a->time_base);
+            if (pts_us == G_MININT64)
+                pts_us = next_pts_us;
+            gint64 frame_us = (gint64)frame->nb_samples * G_USEC_PER_SEC / frame->sample_rate;
+            next_pts_us = pts_us != G_MININT64 ? pts_us + frame_us : G_MININT64;
+            if (seek_pending(a, cur_serial) || (pts_us != G_MININT64 && pts_us + frame_us <= skip_until_us)) {
+                av_frame_unref(frame);
+                continue;
+            }
+
+            int want = swr_get_out_samples(a->swr, frame->nb_samples);
+            if (want > buf_samples) {
+                buf_samples = want;
+                buf = g_realloc(buf, (gsize)buf_samples * a->frame_bytes);
+            }
+            int n = swr_convert(a->swr, &buf, buf_samples, (const uint8_t **)frame->extended_data, frame->nb_samples);
+            av_frame_unref(frame);
+            if (n <= 0)
+                continue;
+
+            // O destino cai no meio do bloco: corta as amostras anteriores
+            int skip = 0;
+            if (pts_us != G_MININT64 && pts_us < skip_until_us)
+                skip = (int)MIN((skip_until_us - pts_us) * a->rate / G_USEC_PER_SEC, n);
+            if (need_restart) {
+                restart_output(a, pts_us == G_MININT64 ? 0 : MAX(pts_us, skip_until_us), cur_serial);
+                need_restart = FALSE;
+            }
+            write_ring(a, buf + (gsize)skip * a->frame_bytes, (guint)(n - skip) * a->frame_bytes, cur_serial);
+        }
+        if (ret == AVERROR_EOF && !seek_pending(a, cur_serial))
+            g_atomic_int_set(&a->eof, 1);
+    }
+
+    g_free(buf);
+    av_frame_free(&frame);
+    return NULL;
+}
+
+static gboolean init_sdl_audio(void) {
+    static gsize once = 0;
+    static gboolean ok = FALSE;
+    if (g_once_init_enter(&once)) {
+        ok = SDL_InitSubSystem(SDL_INIT_AUDIO) == 0;
+        if (!ok)
+            g_print("Áudio indisponível: %s\n", SDL_GetError());
+        g_once_init_leave(&once, 1);
+    }
+    return ok;
+}
+
+AudioEngine *audio_engine_open(AVStream *stream, PacketQueue *packets, GError **error) {
+    if (!init_sdl_audio()) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_OPEN, "Sem dispositivo de áudio: %s", SDL_GetError());
+        return NULL;
+    }
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Sem decodificador para o áudio");
+        return NULL;
+    }
+
+    AudioEngine *a = g_new0(AudioEngine, 1);
+    a->packets = packets;
+    a->time_base = stream->time_base;
+    a->volume = 1000;
+    a->dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(a->dec, stream->codecpar);
+    a->dec->pkt_timebase = stream->time_base;
+    int ret = avcodec_open2(a->dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&a->dec);
+        g_free(a);
+        return NULL;
+    }
+
+    // Float intercalado; o dispositivo pode preferir outra taxa ou número de canais
+    SDL_AudioSpec want = { 0 }, have;
+    want.freq = a->dec->sample_rate > 0 ? a->dec->sample_rate : AUDIO_OUT_RATE;
+    want.format = AUDIO_F32SYS;
+    want.channels = (Uint8)CLAMP(a->dec->ch_layout.nb_channels, 1, 2);
+    want.samples = AUDIO_OUT_SAMPLES;
+    want.callback = audio_callback;
+    want.userdata = a;
+    a->device = SDL_OpenAudioDevice(NULL, 0, &want, &have,
+                                    SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE);
+    if (a->device == 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_OPEN, "Sem dispositivo de áudio: %s", SDL_GetError());
+        avcodec_free_context(&a->dec);
+        g_free(a);
+        return NULL;
+    }
+    a->rate = have.freq;
+    a->channels = have.channels;
+    a->frame_bytes = have.channels * (int)sizeof(float);
+    a->latency_us = (gint64)have.samples * G_USEC_PER_SEC / have.freq;
+
+    AVChannelLayout out_layout;
+    av_channel_layout_default(&out_layout, a->channels);
+    ret = swr_alloc_set_opts2(&a->swr, &out_layout, AV_SAMPLE_FMT_FLT, a->rate,
+                              &a->dec->ch_layout, a->dec->sample_fmt, a->dec->sample_rate, 0, NULL);
+    if (ret >= 0)
+        ret = swr_init(a->swr);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "swresample");
+        SDL_CloseAudioDevice(a->device);
+        swr_free(&a->swr);
+        avcodec_free_context(&a->dec);
+        g_free(a);
+        return NULL;
+    }
+
+    spsc_ring_init(&a->ring, (guint)((gint64)a->rate * a->frame_bytes * AUDIO_RING_MS / 1000));
+    g_mutex_init(&a->seek_lock);
+    g_mutex_init(&a->space_lock);
+    g_cond_init(&a->space_cond);
+    a->seek_target_us = G_MININT64;
+    a->thread = g_thread_new("audio-decode", decode_thread, a);
+    return a;
+}
+
+// Acorda o decodificador se ele estiver esperando espaço no anel
+static void wake_writer(AudioEngine *a) {
+    g_mutex_lock(&a->space_lock);
+    g_cond_broadcast(&a->space_cond);
+    g_mutex_unlock(&a->space_lock);
+}
+
+void audio_engine_close(AudioEngine *a) {
+    if (!a)
+        return;
+    g_atomic_int_set(&a->quit, 1);
+    wake_writer(a);
+    g_thread_join(a->thread);
+    SDL_CloseAudioDevice(a->device);
+    spsc_ring_clear(&a->ring);
+    g_mutex_clear(&a->seek_lock);
+    g_mutex_clear(&a->space_lock);
+    g_cond_clear(&a->space_cond);
+    swr_free(&a->swr);
+    avcodec_free_context(&a->dec);
+    g_free(a);
+}
+
+void audio_engine_set_playing(AudioEngine *a, gboolean playing) {
+    if (!a || a->playing == playing)
+        return;
+    a->playing = playing;
+    if (playing) {
+        SDL_PauseAudioDevice(a->device, 0);
+        return;
+    }
+    // Parado, o relógio congela onde estava (sem extrapolar)
+    gint64 pts_us;
+    gboolean valid = audio_engine_get_clock(a, &pts_us);
+    SDL_PauseAudioDevice(a->device, 1);
+    if (valid) {
+        SDL_LockAudioDevice(a->device);
+        publish_clock(a, pts_us, g_get_monotonic_time(), 0);
+        SDL_UnlockAudioDevice(a->device);
+    }
+}
+
+void audio_engine_seek(AudioEngine *a, gint64 target_us, guint serial) {
+    if (!a)
+        return;
+    g_mutex_lock(&a->seek_lock);
+    a->seek_target_us = target_us;
+    a->seek_serial = serial;
+    g_mutex_unlock(&a->seek_lock);
+    g_atomic_int_set(&a->latest_serial, (gint)serial);
+    g_atomic_int_set(&a->seeking, 1);
+    g_atomic_int_set(&a->clock_valid, 0);
+    wake_writer(a);
+}
+
+gboolean audio_engine_get_clock(AudioEngine *a, gint64 *pts_us) {
+    if (!a || !g_atomic_int_get(&a->clock_valid) || g_atomic_int_get(&a->seeking))
+        return FALSE;
+    // Terminou o áudio (vídeo mais longo que ele): quem manda é o relógio do sistema
+    if (g_atomic_int_get(&a->eof) && spsc_ring_readable(&a->ring) == 0)
+        return FALSE;
+    gint64 pts, time, span;
+    read_clock(a, &pts, &time, &span);
+    *pts_us = pts + MIN(g_get_monotonic_time() - time, span);
+    return TRUE;
+}
+
+void audio_engine_set_volume(AudioEngine *a, double volume) {
+    if (a)
+        g_atomic_int_set(&a->volume, (gint)(CLAMP(volume, 0.0, 1.0) * 1000.0 + 0.5));
+}
+
+void audio_engine_set_muted(AudioEngine *a, gboolean muted) {
+    if (a)
+        g_atomic_int_set(&a->muted, muted ? 1 : 0);
+}
@@ -0,0 +1,255 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include "cli_clip.h"
+#include "export.h"
+#include "timecode.h"
+#include "media_util.h"
+
+// Intervalo mínimo entre duas linhas de progresso
+#define PROGRESS_INTERVAL_US 250000
+
+typedef struct {
+    gint64 start_time;      // g_get_monotonic_time() no começo da exportação
+    gint64 media_us;        // soma da duração dos cortes
+    gint64 last_print;
+    GMutex lock;
+    double chunk[EXPORT_MAX_CHUNKS];
+} ClipRun;
+
+static gchar *opt_in = NULL;
+static gchar *opt_from = NULL;
+static gchar *opt_to = NULL;
+static gchar *opt_out = NULL;
+static gchar *opt_manifest = NULL;
+static gchar *opt_out_dir = NULL;
+static gint opt_height = 0;
+static gint opt_threads = 0;
+
+static const GOptionEntry clip_options[] = {
+    { "in", 0, 0, G_OPTION_ARG_FILENAME, &opt_in, "Vídeo de origem", "ARQ" },
+    { "from", 0, 0, G_OPTION_ARG_STRING, &opt_from, "Início do corte (HH:MM:SS[:FF])", "TC" },
+    { "to", 0, 0, G_OPTION_ARG_STRING, &opt_to, "Fim do corte (HH:MM:SS[:FF])", "TC" },
+    { "out", 0, 0, G_OPTION_ARG_FILENAME, &opt_out, "Arquivo de saída", "ARQ" },
+    { "manifest", 0, 0, G_OPTION_ARG_FILENAME, &opt_manifest, "Lista de cortes: \"INÍCIO FIM SAÍDA\" por linha", "LISTA" },
+    { "out-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_out_dir, "Pasta das saídas relativas da lista", "PASTA" },
+    { "height", 0, 0, G_OPTION_ARG_INT, &opt_height, "Recodifica com essa altura máxima (0 = smart cut)", "N" },
+    { "threads", 0, 0, G_OPTION_ARG_INT, &opt_threads, "Threads da recodificação (0 = uma por núcleo)", "N" },
+    { NULL }
+};
+
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+static void print_error(const char *message) {
+    printf("{\"event\":\"error\",\"message\":");
+    print_json_string(message);
+    printf("}\n");
+    fflush(stdout);
+}
+
+// Velocidade em segundos de mídia por segundo de relógio
+static double run_speed(const ClipRun *run, double fraction, double elapsed) {
+    return elapsed > 0 ? fraction * run->media_us / G_USEC_PER_SEC / elapsed : 0.0;
+}
+
+// Chamada na thread que exporta (ou, na recodificação, nos trechos via on_chunk)
+static void on_progress(double fraction, gpointer user_data) {
+    ClipRun *run = user_data;
+    gint64 now = g_get_monotonic_time();
+    g_mutex_lock(&run->lock);
+    if (now - run->last_print >= PROGRESS_INTERVAL_US) {
+        run->last_print = now;
+        double elapsed = (now - run->start_time) / (double)G_USEC_PER_SEC;
+        printf("{\"event\":\"progress\",\"fraction\":%.4f,\"elapsed\":%.3f,\"speed\":%.2f}\n",
+               fraction, elapsed, run_speed(run, fraction, elapsed));
+        fflush(stdout);
+    }
+    g_mutex_unlock(&run->lock);
+}
+
+static void on_chunk(guint chunk, guint n_chunks, double fraction, gpointer user_data) {
+    ClipRun *run = user_data;
+    double total = 0;
+    g_mutex_lock(&run->lock);
+    run->chunk[chunk] = fraction;
+    for (guint i = 0; i < n_chunks; i++)
+        total += run->chunk[i];
+    g_mutex_unlock(&run->lock);
+    on_progress(total / n_chunks, run);
+}
+
+// Taxa de quadros e duração da fonte, só pelo demuxer
+static gboolean probe_source(const char *path, double *fps, gint64 *duration_us, GError **error) {
+    AVFormatContext *fmt = media_open_input(path, error);
+    if (!fmt)
+        return FALSE;
+    int idx = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (idx < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", path);
+        avformat_close_input(&fmt);
+        return FALSE;
+    }
+    AVStream *st = fmt->streams[idx];
+    AVRational rate = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+    *fps = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 30.0;
+    *duration_us = fmt->duration != AV_NOPTS_VALUE ? fmt->duration : G_MAXINT64;
+    avformat_close_input(&fmt);
+    return TRUE;
+}
+
+static gboolean parse_range(const char *from, const char *to, double fps, gint64 duration_us,
+    gint64 *start_us, gint64 *end_us, GError **error) {
+    if (!timecode_parse(from, fps, start_us) || !timecode_parse(to, fps, end_us)) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Timecode inválido: %s %s", from, to);
+        return FALSE;
+    }
+    *end_us = MIN(*end_us, duration_us);
+    if (*start_us >= *end_us) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Trecho vazio: %s %s", from, to);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Lê a lista; as strings das saídas ficam em "outputs" (liberar com g_ptr_array_unref)
+static GArray *load_manifest(const char *path, double fps, gint64 duration_us, GPtrArray *outputs, GError **error) {
+    gchar *text = NULL;
+    if (!g_file_get_contents(path, &text, NULL, error))
+        return NULL;
+    gchar *dir = opt_out_dir ? g_strdup(opt_out_dir) : g_path_get_dirname(path);
+    GArray *jobs = g_array_new(FALSE, FALSE, sizeof(ExportJob));
+    gchar **lines = g_strsplit(text, "\n", -1);
+    gboolean ok = TRUE;
+
+    for (int i = 0; ok && lines[i]; i++) {
+        gchar *line = g_strstrip(lines[i]);
+        if (*line == '\0' || *line == '#')
+            continue;
+        char from[64], to[64];
+        int rest = 0;
+        if (sscanf(line, "%63s %63s %n", from, to, &rest) != 2 || line[rest] == '\0') {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "%s:%d: esperado \"INÍCIO FIM SAÍDA\"", path, i + 1);
+            ok = FALSE;
+            break;
+        }
+        ExportJob job = { opt_in, NULL, 0, 0 };
+        if (!parse_range(from, to, fps, duration_us, &job.start_us, &job.end_us, error)) {
+            g_prefix_error(error, "%s:%d: ", path, i + 1);
+            ok = FALSE;
+            break;
+        }
+        const char *out = line + rest;
+        gchar *full = g_path_is_absolute(out) ? g_strdup(out) : g_build_filename(dir, out, NULL);
+        g_ptr_array_add(outputs, full);
+        job.output = full;
+        g_array_append_val(jobs, job);
+    }
+    if (ok && jobs->len == 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "%s: nenhum corte", path);
+        ok = FALSE;
+    }
+
+    g_strfreev(lines);
+    g_free(dir);
+    g_free(text);
+    if (!ok) {
+        g_array_unref(jobs);
+        return NULL;
+    }
+    return jobs;
+}
+
+static gboolean run_jobs(const ExportJob *jobs, guint n_jobs, ClipRun *run, GError **error) {
+    for (guint i = 0; i < n_jobs; i++)
+        run->media_us += jobs[i].end_us - jobs[i].start_us;
+    run->start_time = g_get_monotonic_time();
+    if (n_jobs > 1)
+        return export_batch(jobs, n_jobs, NULL, on_progress, run, error);
+    if (opt_height > 0) {
+        TranscodeOptions opts = { .max_height = opt_height };
+        return export_transcode_parallel(&jobs[0], &opts, NULL, on_chunk, run, error);
+    }
+    return export_smart_cut(&jobs[0], NULL, on_progress, run, error);
+}
+
+int cli_clip_main(int argc, char **argv) {
+    GError *error = NULL;
+    GOptionContext *ctx = g_option_context_new("- corta vídeos sem abrir a interface");
+    g_option_context_add_main_entries(ctx, clip_options, NULL);
+    gboolean parsed = g_option_context_parse(ctx, &argc, &argv, &error);
+    gboolean single = opt_from && opt_to && opt_out;
+    if (!parsed || !opt_in || single == (opt_manifest != NULL) || (opt_manifest && opt_height > 0)) {
+        fprintf(stderr, "%s\n\n", error ? error->message : "Use --from/--to/--out ou --manifest (sem --height)");
+        gchar *help = g_option_context_get_help(ctx, TRUE, NULL);
+        fputs(help, stderr);
+        g_free(help);
+        g_clear_error(&error);
+        g_option_context_free(ctx);
+        return 2;
+    }
+    g_option_context_free(ctx);
+    export_set_thread_budget((guint)MAX(opt_threads, 0));
+
+    double fps;
+    gint64 duration_us;
+    GArray *jobs = NULL;
+    GPtrArray *outputs = g_ptr_array_new_with_free_func(g_free);
+    ClipRun run = { 0 };
+    g_mutex_init(&run.lock);
+
+    gboolean ok = probe_source(opt_in, &fps, &duration_us, &error);
+    if (ok && single) {
+        ExportJob job = { opt_in, opt_out, 0, 0 };
+        ok = parse_range(opt_from, opt_to, fps, duration_us, &job.start_us, &job.end_us, &error);
+        jobs = g_array_new(FALSE, FALSE, sizeof(ExportJob));
+        g_array_append_val(jobs, job);
+    } else if (ok) {
+        jobs = load_manifest(opt_manifest, fps, duration_us, outputs, &error);
+        ok = jobs != NULL;
+    }
+    for (guint i = 0; ok && i < jobs->len; i++) {
+        const char *output = g_array_index(jobs, ExportJob, i).output;
+        if (media_same_file(output, opt_in)) {
+            g_set_error(&error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "%s: a saída não pode ser a própria entrada", output);
+            ok = FALSE;
+        }
+    }
+    if (ok)
+        ok = run_jobs((const ExportJob *)jobs->data, jobs->len, &run, &error);
+
+    if (ok) {
+        double elapsed = (g_get_monotonic_time() - run.start_time) / (double)G_USEC_PER_SEC;
+        guint64 bytes = 0;
+        for (guint i = 0; i < jobs->len; i++) {
+            GStatBuf st;
+            if (g_stat(g_array_index(jobs, ExportJob, i).output, &st) == 0)
+                bytes += (guint64)st.st_size;
+        }
+        printf("{\"event\":\"done\",\"clips\":%u,\"elapsed\":%.3f,\"speed\":%.2f,\"bytes\":%" G_GUINT64_FORMAT "}\n",
+               jobs->len, elapsed, run_speed(&run, 1.0, elapsed), bytes);
+        fflush(stdout);
+    } else {
+        print_error(error->message);
+        g_clear_error(&error);
+    }
+
+    if (jobs)
+        g_array_unref(jobs);
+    g_ptr_array_unref(outputs);
+    g_mutex_clear(&run.lock);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include <glib.h>
+#include <stdio.h>
+#include "cli_fetch.h"
+#include "ingest.h"
+
+static gchar *opt_url = NULL;
+static gchar *opt_out = NULL;
+static gint opt_connections = 0;
+
+static const GOptionEntry fetch_options[] = {
+    { "url", 0, 0, G_OPTION_ARG_STRING, &opt_url, "Link direto do arquivo de mídia", "URL" },
+    { "out", 0, 0, G_OPTION_ARG_FILENAME, &opt_out, "Arquivo de destino (padrão: Downloads/Zenoka)", "ARQ" },
+    { "connections", 0, 0, G_OPTION_ARG_INT, &opt_connections, "Conexões simultâneas (0 = padrão)", "N" },
+    { NULL }
+};
+
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            printf("\\%c", c);
+        else if (c < 0x20)
+            printf("\\u%04x", c);
+        else
+            putchar(c);
+    }
+    putchar('"');
+}
+
+// Chamada pelas conexões, já espaçada pelo motor
+static void on_progress(const IngestProgress *p, gpointer user_data) {
+    (void)user_data;
+    printf("{\"event\":\"progress\",\"bytes\":%" G_GUINT64_FORMAT ",\"total\":%" G_GUINT64_FORMAT
+           ",\"speed\":%.0f,\"connections\":%u,\"resumed\":%s}\n",
+           p->done_bytes, p->total_bytes, p->bytes_per_sec, p->connections, p->resumed ? "true" : "false");
+    fflush(stdout);
+}
+
+int cli_fetch_main(int argc, char **argv) {
+    GError *error = NULL;
+    GOptionContext *ctx = g_option_context_new("- baixa um link direto de mídia");
+    g_option_context_add_main_entries(ctx, fetch_options, NULL);
+    if (!g_option_context_parse(ctx, &argc, &argv, &error) || !opt_url) {
+        fprintf(stderr, "%s\n\n", error ? error->message : "Falta --url");
+        gchar *help = g_option_context_get_help(ctx, TRUE, NULL);
+        fputs(help, stderr);
+        g_free(help);
+        g_clear_error(&error);
+        g_option_context_free(ctx);
+        return 2;
+    }
+    g_option_context_free(ctx);
+    ingest_set_connections((guint)MAX(opt_connections, 0));
+
+    gchar *dest = opt_out ? g_strdup(opt_out) : ingest_default_path(opt_url);
+    gint64 start = g_get_monotonic_time();
+    gboolean ok = ingest_download(opt_url, dest, NULL, on_progress, NULL, &error);
+    if (ok) {
+        double elapsed = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+        printf("{\"event\":\"done\",\"elapsed\":%.3f,\"path\":", elapsed);
+        print_json_string(dest);
+        printf("}\n");
+    } else {
+        printf("{\"event\":\"error\",\"message\":");
+        print_json_string(error->message);
+        printf("}\n");
+        g_clear_error(&error);
+    }
+    fflush(stdout);
+    g_free(dest);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#include <glib.h>
+#include <string.h>
+#include "clip_list.h"
+
+struct _ClipList {
+    gchar *source;
+    GArray *clips;  // ClipRange, ordenado
+};
+
+ClipList *clip_list_new(const char *source) {
+    ClipList *list = g_new0(ClipList, 1);
+    list->source = g_strdup(source);
+    list->clips = g_array_new(FALSE, FALSE, sizeof(ClipRange));
+    return list;
+}
+
+void clip_list_free(ClipList *list) {
+    if (!list)
+        return;
+    g_array_unref(list->clips);
+    g_free(list->source);
+    g_free(list);
+}
+
+const char *clip_list_get_source(ClipList *list) {
+    return list->source;
+}
+
+static gboolean clip_before(const ClipRange *a, const ClipRange *b) {
+    return a->start_us < b->start_us || (a->start_us == b->start_us && a->end_us < b->end_us);
+}
+
+int clip_list_add(ClipList *list, gint64 start_us, gint64 end_us) {
+    if (end_us <= start_us)
+        return -1;
+    ClipRange clip = { MAX(start_us, 0), end_us };
+    guint at = list->clips->len;
+    while (at > 0 && clip_before(&clip, &g_array_index(list->clips, ClipRange, at - 1)))
+        at--;
+    g_array_insert_val(list->clips, at, clip);
+    return (int)at;
+}
+
+void clip_list_remove(ClipList *list, guint index) {
+    if (index < list->clips->len)
+        g_array_remove_index(list->clips, index);
+}
+
+void clip_list_clear(ClipList *list) {
+    g_array_set_size(list->clips, 0);
+}
+
+guint clip_list_get_n_clips(ClipList *list) {
+    return list->clips->len;
+}
+
+const ClipRange *clip_list_get(ClipList *list, guint index) {
+    g_return_val_if_fail(index < list->clips->len, NULL);
+    return &g_array_index(list->clips, ClipRange, index);
+}
+
+gchar **clip_list_build_outputs(ClipList *list, const char *folder, const char *ext) {
+    gchar *base = g_path_get_basename(list->source);
+    const char *dot = strrchr(base, '.');
+    gchar *stem = dot ? g_strndup(base, dot - base) : g_strdup(base);
+    if (!ext)
+        ext = dot ? dot : ".mp4";
+
+    gchar **outputs = g_new0(gchar *, list->clips->len + 1);
+    for (guint i = 0; i < list->clips->len; i++) {
+        gchar *name = g_strdup_printf("%s_corte%02u%s", stem, i + 1, ext);
+        outputs[i] = g_build_filename(folder, name, NULL);
+        g_free(name);
+    }
+    g_free(stem);
+    g_free(base);
+    return outputs;
+}
@@ -0,0 +1,498 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
+#include "cut_writer.h"
+#include "media_util.h"
+
+// Um lote pode ter vários cortes abertos ao mesmo tempo, cada um com seu
+// decoder e, nas pontas, seu encoder: nenhum deles toma todos os núcleos
+#define CODEC_MAX_THREADS 4
+
+struct _CutWriter {
+    AVFormatContext *in;        // não é dono
+    AVFormatContext *out;
+    gchar *path;
+    int vin;
+    AVStream *vst;
+    int *map;                   // stream da entrada -> stream da saída (-1 = ignorado)
+    gint64 *last_dts;           // por stream da saída
+
+    gint64 start_us, end_us;
+    gint64 start_ts, end_ts;    // no time base do vídeo
+
+    AVCodecContext *dec;        // aberto no primeiro GOP de borda
+    AVCodecContext *enc;        // só existe enquanto um GOP de borda é recodificado
+    gboolean reencoding;        // o decoder tem GOPs recodificados ainda não drenados
+    gint64 encode_limit_ts;     // só quadros antes disso são recodificados
+    AVBSFContext *bsf;          // H.264/HEVC em MP4/MKV: pacotes copiados viram Annex B
+    AVFrame *frame;
+    AVPacket *tmp;
+
+    GPtrArray *gop;             // AVPacket* do GOP que está sendo acumulado
+    gint64 gop_key_ts;
+    gint64 gop_end_ts;
+
+    gboolean video_done;
+    gint64 other_until_us;      // maior instante visto nos outros streams
+    guint copied_gops;
+    guint encoded_gops;
+};
+
+static int codec_threads(void) {
+    return MIN((int)g_get_num_processors(), CODEC_MAX_THREADS);
+}
+
+static void packet_free(gpointer data) {
+    AVPacket *pkt = data;
+    av_packet_free(&pkt);
+}
+
+static gint64 packet_ts(const AVPacket *pkt) {
+    return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+// Leva o pacote para a linha do tempo da saída (começando em zero) e escreve.
+// O pacote fica vazio depois, com ou sem erro.
+static gboolean write_out(CutWriter *w, AVPacket *pkt, int in_index, GError **error) {
+    AVStream *ist = w->in->streams[in_index];
+    int o = w->map[in_index];
+    AVStream *ost = w->out->streams[o];
+
+    gint64 offset = av_rescale_q(w->start_us, AV_TIME_BASE_Q, ist->time_base);
+    if (pkt->pts != AV_NOPTS_VALUE)
+        pkt->pts -= offset;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts -= offset;
+    av_packet_rescale_ts(pkt, ist->time_base, ost->time_base);
+
+    // Na emenda entre trecho recodificado e copiado o dts pode repetir
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        if (w->last_dts[o] != AV_NOPTS_VALUE && pkt->dts <= w->last_dts[o]) {
+            pkt->dts = w->last_dts[o] + 1;
+            if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+                pkt->pts = pkt->dts;
+        }
+        w->last_dts[o] = pkt->dts;
+    }
+    pkt->stream_index = o;
+    pkt->pos = -1;
+
+    int ret = av_interleaved_write_frame(w->out, pkt);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, w->path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean copy_video(CutWriter *w, AVPacket *pkt, GError **error) {
+    if (!w->bsf)
+        return write_out(w, pkt, w->vin, error);
+
+    int ret = av_bsf_send_packet(w->bsf, pkt);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "bitstream filter");
+        return FALSE;
+    }
+    while ((ret = av_bsf_receive_packet(w->bsf, w->tmp)) >= 0) {
+        if (!write_out(w, w->tmp, w->vin, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// seq_parameter_set_id do primeiro SPS do avcC da fonte (0 se não houver). No
+// avcC ele vem depois de 6 bytes de cabeçalho, 2 de tamanho, 1 de cabeçalho NAL
+// e 3 de perfil/nível; o ue(v) de um id até 31 cabe nos 2 bytes seguintes.
+static guint avcc_sps_id(const AVCodecParameters *par) {
+    const uint8_t *p = par->extradata;
+    if (!p || par->extradata_size < 14 || p[0] != 1 || (p[5] & 0x1f) == 0)
+        return 0;
+    guint bits = (guint)p[12] << 8 | p[13];
+    guint zeros = 0;
+    while (zeros < 5 && !(bits & (0x8000u >> zeros)))
+        zeros++;
+    return (1u << zeros) - 1 + ((bits >> (15 - 2 * zeros)) & ((1u << zeros) - 1));
+}
+
+static gboolean open_encoder(CutWriter *w, const AVFrame *frame, GError **error) {
+    enum AVCodecID id = w->vst->codecpar->codec_id;
+    const AVCodec *codec = avcodec_find_encoder(id);
+    if (!codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC,
+                    "Sem encoder para %s: não dá para recodificar as pontas do corte", avcodec_get_name(id));
+        return FALSE;
+    }
+
+    AVCodecContext *enc = avcodec_alloc_context3(codec);
+    enc->width = frame->width;
+    enc->height = frame->height;
+    enc->pix_fmt = frame->format;
+    enc->sample_aspect_ratio = frame->sample_aspect_ratio.num ? frame->sample_aspect_ratio
+                                                              : w->dec->sample_aspect_ratio;
+    enc->color_range = frame->color_range;
+    enc->colorspace = frame->colorspace;
+    enc->color_primaries = frame->color_primaries;
+    enc->color_trc = frame->color_trc;
+    enc->time_base = w->vst->time_base;
+    enc->framerate = w->vst->avg_frame_rate;
+    enc->profile = w->dec->profile;
+    enc->bit_rate = w->vst->codecpar->bit_rate > 0 ? w->vst->codecpar->bit_rate : w->in->bit_rate;
+    enc->max_b_frames = 0;  // dts = pts: a emenda com o trecho copiado fica simples
+    enc->thread_count = codec_threads();
+    // Sem cabeçalho global: os parâmetros (SPS/PPS) vão dentro do stream
+
+    AVDictionary *opts = NULL;
+    av_dict_set(&opts, "crf", "18", 0);  // x264/x265: visualmente igual à fonte
+    // A descrição da amostra tem os SPS/PPS da fonte, e os GOPs copiados podem
+    // começar num I-frame sem SPS próprio: os do x264 usam outro id para nunca
+    // substituir os da fonte no decoder
+    if (id == AV_CODEC_ID_H264 && g_strcmp0(codec->name, "libx264") == 0) {
+        gchar *params = g_strdup_printf("sps-id=%u", (avcc_sps_id(w->vst->codecpar) + 1) % 32);
+        av_dict_set(&opts, "x264-params", params, 0);
+        g_free(params);
+    }
+    int ret = avcodec_open2(enc, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&enc);
+        return FALSE;
+    }
+    w->enc = enc;
+    return TRUE;
+}
+
+static gboolean encode(CutWriter *w, AVFrame *frame, GError **error) {
+    int ret = avcodec_send_frame(w->enc, frame);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, w->enc->codec->name);
+        return FALSE;
+    }
+    while ((ret = avcodec_receive_packet(w->enc, w->tmp)) >= 0) {
+        if (!write_out(w, w->tmp, w->vin, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Decodifica um pacote (NULL drena) e recodifica os quadros que caem no trecho
+static gboolean decode(CutWriter *w, const AVPacket *pkt, GError **error) {
+    int ret = avcodec_send_packet(w->dec, pkt);
+    if (ret < 0 && ret != AVERROR_EOF)
+        return TRUE;  // pacote corrompido: segue com o próximo
+
+    while (avcodec_receive_frame(w->dec, w->frame) >= 0) {
+        gint64 pts = w->frame->best_effort_timestamp;
+        if (pts != AV_NOPTS_VALUE && pts >= w->start_ts && pts < MIN(w->end_ts, w->encode_limit_ts)) {
+            if (!w->enc && !open_encoder(w, w->frame, error)) {
+                av_frame_unref(w->frame);
+                return FALSE;
+            }
+            w->frame->pts = pts;
+            w->frame->pict_type = AV_PICTURE_TYPE_NONE;
+            if (!encode(w, w->frame, error)) {
+                av_frame_unref(w->frame);
+                return FALSE;
+            }
+        }
+        av_frame_unref(w->frame);
+    }
+    return TRUE;
+}
+
+// Cortes que só copiam GOPs inteiros nunca decodificam nada
+static gboolean open_decoder(CutWriter *w, GError **error) {
+    const AVCodec *codec = avcodec_find_decoder(w->vst->codecpar->codec_id);
+    if (!codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Codec de vídeo sem suporte");
+        return FALSE;
+    }
+    w->dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(w->dec, w->vst->codecpar);
+    w->dec->pkt_timebase = w->vst->time_base;
+    w->dec->thread_count = codec_threads();
+    int ret = avcodec_open2(w->dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&w->dec);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// GOPs recodificados em sequência passam pelo decoder sem drenar entre eles:
+// os B-frames iniciais de um GOP aberto ainda veem os quadros do anterior
+static gboolean reencode_gop(CutWriter *w, GError **error) {
+    if (!w->dec && !open_decoder(w, error))
+        return FALSE;
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < w->gop->len; i++)
+        ok = decode(w, g_ptr_array_index(w->gop, i), error);
+    w->reencoding = TRUE;
+    w->encoded_gops++;
+    return ok;
+}
+
+// Drena decoder e encoder da recodificação em andamento
+static gboolean end_reencode(CutWriter *w, GError **error) {
+    if (!w->reencoding)
+        return TRUE;
+    w->reencoding = FALSE;
+    gboolean ok = decode(w, NULL, error);
+    avcodec_flush_buffers(w->dec);
+    w->encode_limit_ts = G_MAXINT64;
+
+    if (w->enc) {
+        if (ok)
+            ok = encode(w, NULL, error);
+        avcodec_free_context(&w->enc);
+    }
+    return ok;
+}
+
+static gboolean is_leading(const AVPacket *pkt, gint64 key_pts) {
+    gint64 pts = pkt->pts;
+    return pts != AV_NOPTS_VALUE && key_pts != AV_NOPTS_VALUE && pts < key_pts;
+}
+
+static gboolean copy_gop(CutWriter *w, GError **error) {
+    // Os B-frames iniciais de um GOP aberto (depois do keyframe na decodificação,
+    // antes dele na tela) referenciam o GOP anterior. Só são copiados quando esse
+    // GOP foi copiado também. Logo depois de um GOP recodificado eles são
+    // decodificados junto com a recodificação e recodificados também; no primeiro
+    // GOP da saída o corte começa no keyframe e eles ficam de fora (pts antes do
+    // início). Nos dois casos a cópia começa no keyframe, sem eles.
+    const AVPacket *key = g_ptr_array_index(w->gop, 0);
+    guint leading_end = 1;
+    if (w->reencoding || (w->copied_gops == 0 && w->encoded_gops == 0)) {
+        while (leading_end < w->gop->len && is_leading(g_ptr_array_index(w->gop, leading_end), key->pts))
+            leading_end++;
+    }
+    if (w->reencoding) {
+        gboolean ok = TRUE;
+        if (leading_end > 1) {
+            w->encode_limit_ts = key->pts;
+            for (guint i = 0; ok && i < leading_end; i++)
+                ok = decode(w, g_ptr_array_index(w->gop, i), error);
+        }
+        if (!end_reencode(w, error) || !ok)
+            return FALSE;
+    }
+
+    for (guint i = 0; i < w->gop->len; i++) {
+        if (i > 0 && i < leading_end)
+            continue;
+        if (!copy_video(w, g_ptr_array_index(w->gop, i), error))
+            return FALSE;
+    }
+    w->copied_gops++;
+    return TRUE;
+}
+
+// O GOP acumulado ocupa [gop_key_ts, gop_end_ts): inteiro dentro do trecho é
+// copiado, cortado é recodificado, fora é descartado
+static gboolean flush_gop(CutWriter *w, gint64 gop_end_ts, GError **error) {
+    gboolean ok = TRUE;
+    if (w->gop->len > 0 && w->gop_key_ts < w->end_ts && gop_end_ts > w->start_ts) {
+        if (w->gop_key_ts >= w->start_ts && gop_end_ts <= w->end_ts)
+            ok = copy_gop(w, error);
+        else
+            ok = reencode_gop(w, error);
+    } else {
+        ok = end_reencode(w, error);
+    }
+    g_ptr_array_set_size(w->gop, 0);
+    return ok;
+}
+
+static gboolean needs_annexb(const AVCodecParameters *par) {
+    return (par->codec_id == AV_CODEC_ID_H264 || par->codec_id == AV_CODEC_ID_HEVC) &&
+           par->extradata_size > 0 && par->extradata[0] == 1;
+}
+
+static gboolean setup_bsf(CutWriter *w, GError **error) {
+    const AVCodecParameters *par = w->vst->codecpar;
+    if (!needs_annexb(par))
+        return TRUE;
+
+    // Copiados e recodificados precisam do mesmo formato de pacote; em Annex B os
+    // SPS/PPS da fonte vão junto de cada keyframe copiado
+    const AVBitStreamFilter *filter = av_bsf_get_by_name(
+        par->codec_id == AV_CODEC_ID_H264 ? "h264_mp4toannexb" : "hevc_mp4toannexb");
+    int ret = filter ? av_bsf_alloc(filter, &w->bsf) : AVERROR_BSF_NOT_FOUND;
+    if (ret >= 0) {
+        avcodec_parameters_copy(w->bsf->par_in, par);
+        w->bsf->time_base_in = w->vst->time_base;
+        ret = av_bsf_init(w->bsf);
+    }
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "bitstream filter");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+CutWriter *cut_writer_new(AVFormatContext *in, int video_stream, const char *output,
+    gint64 start_us, gint64 end_us, GError **error) {
+    CutWriter *w = g_new0(CutWriter, 1);
+    w->in = in;
+    w->path = g_strdup(output);
+    w->vin = video_stream;
+    w->vst = in->streams[video_stream];
+    w->start_us = start_us;
+    w->end_us = end_us;
+    w->start_ts = media_us_to_ts(start_us, w->vst->time_base);
+    w->end_ts = media_us_to_ts(end_us, w->vst->time_base);
+    w->encode_limit_ts = G_MAXINT64;
+    w->frame = av_frame_alloc();
+    w->tmp = av_packet_alloc();
+    w->gop = g_ptr_array_new_with_free_func(packet_free);
+    w->other_until_us = G_MAXINT64;
+    w->map = g_new(int, in->nb_streams);
+
+    int ret = avformat_alloc_output_context2(&w->out, NULL, NULL, output);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_OPEN, ret, output);
+        goto fail;
+    }
+    if (!setup_bsf(w, error))
+        goto fail;
+
+    for (unsigned i = 0; i < in->nb_streams; i++) {
+        AVStream *ist = in->streams[i];
+        w->map[i] = -1;
+        if ((int)i != video_stream && ist->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+        AVStream *ost = avformat_new_stream(w->out, NULL);
+        avcodec_parameters_copy(ost->codecpar, ist->codecpar);
+        ost->codecpar->codec_tag = 0;
+        ost->time_base = ist->time_base;
+        if ((int)i == video_stream && w->bsf) {
+            // Os pacotes saem em Annex B; o muxer monta o avcC/hvcC com os SPS/PPS
+            // da fonte (os dos GOPs copiados), e não com os do primeiro pacote,
+            // que pode ser de um GOP recodificado
+            const AVCodecParameters *annexb = w->bsf->par_out;
+            av_freep(&ost->codecpar->extradata);
+            ost->codecpar->extradata_size = 0;
+            if (annexb->extradata_size > 0) {
+                ost->codecpar->extradata = av_mallocz(annexb->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+                memcpy(ost->codecpar->extradata, annexb->extradata, annexb->extradata_size);
+                ost->codecpar->extradata_size = annexb->extradata_size;
+            }
+        }
+        if ((int)i != video_stream)
+            w->other_until_us = G_MININT64;
+        w->map[i] = ost->index;
+    }
+    w->last_dts = g_new(gint64, w->out->nb_streams);
+    for (unsigned i = 0; i < w->out->nb_streams; i++)
+        w->last_dts[i] = AV_NOPTS_VALUE;
+
+    if (!(w->out->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&w->out->pb, output, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+            goto fail;
+        }
+    }
+    ret = avformat_write_header(w->out, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+        goto fail;
+    }
+    return w;
+
+fail:
+    cut_writer_free(w, TRUE);
+    return NULL;
+}
+
+gboolean cut_writer_feed(CutWriter *w, const AVPacket *pkt, GError **error) {
+    int i = pkt->stream_index;
+    if (i < 0 || (unsigned)i >= w->in->nb_streams || w->map[i] < 0)
+        return TRUE;
+
+    gint64 ts = packet_ts(pkt);
+    if (i != w->vin) {
+        gint64 us = media_ts_to_us(ts, w->in->streams[i]->time_base);
+        if (us == G_MININT64)
+            return TRUE;
+        w->other_until_us = MAX(w->other_until_us, us);
+        if (us < w->start_us || us >= w->end_us)
+            return TRUE;
+        AVPacket *copy = av_packet_clone(pkt);
+        gboolean ok = write_out(w, copy, i, error);
+        av_packet_free(&copy);
+        return ok;
+    }
+
+    if (w->video_done)
+        return TRUE;
+    if ((pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE) {
+        // Um keyframe fecha o GOP anterior
+        if (!flush_gop(w, ts, error))
+            return FALSE;
+        if (ts >= w->end_ts) {
+            w->video_done = TRUE;
+            return end_reencode(w, error);
+        }
+        w->gop_key_ts = w->gop_end_ts = ts;
+    } else if (w->gop->len == 0) {
+        return TRUE;  // ainda antes do primeiro keyframe
+    }
+
+    g_ptr_array_add(w->gop, av_packet_clone(pkt));
+    if (ts != AV_NOPTS_VALUE)
+        w->gop_end_ts = MAX(w->gop_end_ts, ts + MAX(pkt->duration, 1));
+    return TRUE;
+}
+
+gboolean cut_writer_is_done(CutWriter *w) {
+    return w->video_done && w->other_until_us >= w->end_us;
+}
+
+gboolean cut_writer_finish(CutWriter *w, GError **error) {
+    gboolean ok = TRUE;
+    if (!w->video_done) {
+        ok = flush_gop(w, w->gop_end_ts, error) && end_reencode(w, error);
+        w->video_done = TRUE;
+    }
+    int ret = av_write_trailer(w->out);
+    if (ok && ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, w->path);
+        ok = FALSE;
+    }
+    return ok;
+}
+
+void cut_writer_free(CutWriter *w, gboolean remove_output) {
+    if (!w)
+        return;
+    if (w->out) {
+        if (!(w->out->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&w->out->pb);
+        avformat_free_context(w->out);
+    }
+    if (remove_output)
+        g_remove(w->path);
+    avcodec_free_context(&w->dec);
+    avcodec_free_context(&w->enc);
+    av_bsf_free(&w->bsf);
+    av_frame_free(&w->frame);
+    av_packet_free(&w->tmp);
+    g_ptr_array_unref(w->gop);
+    g_free(w->map);
+    g_free(w->last_dts);
+    g_free(w->path);
+    g_free(w);
+}
+
+void cut_writer_get_counts(CutWriter *w, guint *copied_gops, guint *encoded_gops) {
+    *copied_gops = w->copied_gops;
+    *encoded_gops = w->encoded_gops;
+}
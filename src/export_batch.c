@@ -0,0 +1,197 @@
+#include <glib.h>
+#include <stdlib.h>
+#include <libavformat/avformat.h>
+#include "export.h"
+#include "cut_writer.h"
+#include "media_util.h"
+#include "trace.h"
+
+// Cortes separados por menos que isso são lidos na mesma passada; acima disso
+// compensa pular o intervalo com um seek para frente
+#define BATCH_GAP_US (30 * G_USEC_PER_SEC)
+
+typedef struct {
+    const ExportJob *job;
+    gint64 start_us;    // absolutos
+    gint64 end_us;
+    CutWriter *writer;
+    gboolean finished;
+} BatchClip;
+
+static void packet_free(gpointer data) {
+    AVPacket *pkt = data;
+    av_packet_free(&pkt);
+}
+
+static gint compare_clips(gconstpointer a, gconstpointer b) {
+    const BatchClip *x = a, *y = b;
+    if (x->start_us != y->start_us)
+        return x->start_us < y->start_us ? -1 : 1;
+    return (x->end_us > y->end_us) - (x->end_us < y->end_us);
+}
+
+// Abre o writer do corte e repassa a ele o GOP que já foi lido (o do keyframe
+// que precede o início do corte)
+static gboolean open_clip(AVFormatContext *in, int vin, BatchClip *clip, GPtrArray *gop, GError **error) {
+    clip->writer = cut_writer_new(in, vin, clip->job->output, clip->start_us, clip->end_us, error);
+    gboolean ok = clip->writer != NULL;
+    for (guint i = 0; ok && i < gop->len; i++)
+        ok = cut_writer_feed(clip->writer, g_ptr_array_index(gop, i), error);
+    return ok;
+}
+
+// Fecha o corte assim que ele termina: o arquivo fica pronto e o writer (com
+// decoder e buffers) sai da memória antes dos próximos
+static gboolean close_clip(BatchClip *clip, GError **error) {
+    gboolean ok = cut_writer_finish(clip->writer, error);
+    clip->finished = ok;
+    cut_writer_free(clip->writer, !ok);
+    clip->writer = NULL;
+    return ok;
+}
+
+// Lê de uma vez só o grupo [first, last) de cortes, entregando cada pacote a
+// todos os cortes abertos. Um corte só abre quando a leitura chega a ele: o GOP
+// corrente (todos os streams desde o último keyframe de vídeo) fica guardado, e
+// no keyframe seguinte os cortes que começam antes dele abrem recebendo esse GOP.
+static gboolean export_group(AVFormatContext *in, int vin, BatchClip *clips, guint first, guint last,
+    gint64 span_start, gint64 span_us, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, double *reported, GError **error) {
+    AVStream *vst = in->streams[vin];
+
+    // Começa no keyframe que precede o primeiro corte do grupo
+    av_seek_frame(in, vin, media_us_to_ts(clips[first].start_us, vst->time_base), AVSEEK_FLAG_BACKWARD);
+
+    AVPacket *pkt = av_packet_alloc();
+    GPtrArray *gop = g_ptr_array_new_with_free_func(packet_free);
+    guint next = first;         // primeiro corte ainda não aberto
+    guint remaining = last - first;
+    gboolean ok = TRUE, eof = FALSE;
+    while (ok && remaining > 0 && !eof) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        int ret = av_read_frame(in, pkt);
+        eof = ret == AVERROR_EOF;
+        if (ret < 0 && !eof) {
+            media_set_av_error(error, MEDIA_ERROR_IO, ret, clips[first].job->input);
+            ok = FALSE;
+            break;
+        }
+
+        gint64 ts = eof ? AV_NOPTS_VALUE : (pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts);
+        gboolean key = !eof && pkt->stream_index == vin && (pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE;
+        if (eof || key) {
+            // O GOP guardado vai até aqui: quem começa antes deste ponto está nele
+            gint64 until = eof ? G_MAXINT64 : media_ts_to_us(ts, vst->time_base);
+            for (; ok && next < last && clips[next].start_us < until; next++)
+                ok = open_clip(in, vin, &clips[next], gop, error);
+            g_ptr_array_set_size(gop, 0);
+        }
+        if (eof || !ok)
+            break;
+
+        if (progress && pkt->stream_index == vin && pkt->pts != AV_NOPTS_VALUE) {
+            double f = (double)(media_ts_to_us(pkt->pts, vst->time_base) - span_start) / span_us;
+            f = CLAMP(f, 0.0, 1.0);
+            if (f - *reported >= 0.01) {
+                *reported = f;
+                progress(f, user_data);
+            }
+        }
+
+        for (guint i = first; ok && i < next; i++) {
+            if (!clips[i].writer)
+                continue;
+            ok = cut_writer_feed(clips[i].writer, pkt, error);
+            if (ok && cut_writer_is_done(clips[i].writer)) {
+                ok = close_clip(&clips[i], error);
+                remaining--;
+            }
+        }
+        if (next < last)
+            g_ptr_array_add(gop, av_packet_clone(pkt));
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    g_ptr_array_unref(gop);
+
+    // Fim da fonte: fecha o que ainda estava aberto
+    for (guint i = first; ok && i < last; i++) {
+        if (clips[i].writer)
+            ok = close_clip(&clips[i], error);
+    }
+    return ok;
+}
+
+gboolean export_batch(const ExportJob *jobs, guint n_jobs, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error) {
+    if (n_jobs == 0)
+        return TRUE;
+    for (guint i = 0; i < n_jobs; i++) {
+        if (jobs[i].end_us <= jobs[i].start_us) {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Corte %u: o fim precisa vir depois do início", i + 1);
+            return FALSE;
+        }
+        if (g_strcmp0(jobs[i].input, jobs[0].input) != 0) {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Os cortes de um lote precisam ser da mesma fonte");
+            return FALSE;
+        }
+    }
+
+    gint64 t = trace_begin();
+    AVFormatContext *in = media_open_input(jobs[0].input, error);
+    if (!in)
+        return FALSE;
+    int vin = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (vin < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", jobs[0].input);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    // Lidos em ordem de início, a fonte é percorrida uma vez só, para frente
+    gint64 origin = media_stream_start_us(in->streams[vin]);
+    BatchClip *clips = g_new0(BatchClip, n_jobs);
+    for (guint i = 0; i < n_jobs; i++) {
+        clips[i].job = &jobs[i];
+        clips[i].start_us = origin + jobs[i].start_us;
+        clips[i].end_us = origin + jobs[i].end_us;
+    }
+    qsort(clips, n_jobs, sizeof(BatchClip), compare_clips);
+
+    gint64 span_start = clips[0].start_us, span_end = clips[0].end_us;
+    for (guint i = 1; i < n_jobs; i++)
+        span_end = MAX(span_end, clips[i].end_us);
+    double reported = -1.0;
+
+    gboolean ok = TRUE;
+    guint groups = 0;
+    for (guint first = 0; ok && first < n_jobs; groups++) {
+        gint64 group_end = clips[first].end_us;
+        guint last = first + 1;
+        while (last < n_jobs && clips[last].start_us <= group_end + BATCH_GAP_US) {
+            group_end = MAX(group_end, clips[last].end_us);
+            last++;
+        }
+        ok = export_group(in, vin, clips, first, last, span_start, span_end - span_start,
+                          cancellable, progress, user_data, &reported, error);
+        for (guint i = first; i < last; i++) {
+            if (clips[i].writer)
+                cut_writer_free(clips[i].writer, !clips[i].finished);
+            clips[i].writer = NULL;
+        }
+        first = last;
+    }
+
+    if (ok) {
+        g_debug("Lote exportado: %u cortes em %u passadas pela fonte", n_jobs, groups);
+        if (progress)
+            progress(1.0, user_data);
+    }
+    g_free(clips);
+    avformat_close_input(&in);
+    trace_end("export batch", "export", t);
+    return ok;
+}
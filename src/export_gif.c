@@ -0,0 +1,793 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "export.h"
+#include "media_util.h"
+#include "trace.h"
+
+#define GIF_DEFAULT_FPS 15.0
+#define GIF_COLORS 255              // o índice 255 é o transparente dos quadros delta
+#define GIF_TRANSPARENT 255
+#define GIF_KEYS 32768              // cores com 5 bits por canal
+#define GIF_GLOBAL_BUDGET (384 * 1024 * 1024)   // quadros na memória para a paleta única
+#define LZW_MAX_CODE 4095
+#define LZW_HASH 8192
+
+typedef struct {
+    guint8 rgb[256][3];
+    guint n;
+    guint16 lut[GIF_KEYS];          // chave de 15 bits -> índice (0xFFFF = ainda não calculado)
+} Palette;
+
+typedef struct _GifFrame {
+    guint8 *pixels;                 // RGB0, liberado depois do dithering
+    guint8 *index;                  // um índice por pixel
+    Palette *palette;               // própria ou a do clipe
+    gboolean own_palette;
+    guint slot;                     // aparece em slot / fps segundos
+    struct _GifFrame *prev;         // quadro mostrado antes deste
+    GByteArray *block;              // bloco de imagem pronto (NULL = igual ao anterior)
+} GifFrame;
+
+typedef enum {
+    PHASE_HISTOGRAM,                // soma o histograma do quadro no do clipe
+    PHASE_PALETTE,                  // paleta própria do quadro
+    PHASE_DITHER,
+    PHASE_ENCODE,                   // retângulo delta + LZW
+} GifPhase;
+
+typedef struct {
+    int width, height;
+    double fps;
+    GCancellable *cancellable;
+    GThreadPool *pool;
+    GifPhase phase;
+    Palette *global;
+    guint32 *hist;                  // histograma do clipe (paleta única)
+
+    GMutex lock;
+    GCond cond;
+    guint remaining;
+
+    FILE *fp;
+    GByteArray *pending;            // último bloco, esperando saber quanto dura
+    guint pending_slot;
+} GifRun;
+
+static const guint8 bayer8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// Chave de 15 bits de cada pixel RGB0 (R no byte mais baixo), 8 pixels por volta
+static void pixel_keys(const guint8 *px, guint n, guint16 *keys) {
+    guint i = 0;
+#if defined(__SSE2__)
+    const __m128i m5 = _mm_set1_epi32(0x1f);
+    for (; i + 8 <= n; i += 8) {
+        __m128i k[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(px + (i + h * 4) * 4));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(v, 3), m5);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(v, 11), m5);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(v, 19), m5);
+            k[h] = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 10), _mm_slli_epi32(g, 5)), b);
+        }
+        _mm_storeu_si128((__m128i *)(keys + i), _mm_packs_epi32(k[0], k[1]));
+    }
+#elif defined(__ARM_NEON)
+    const uint32x4_t m5 = vdupq_n_u32(0x1f);
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(px + i * 4));
+        uint32x4_t r = vandq_u32(vshrq_n_u32(v, 3), m5);
+        uint32x4_t g = vandq_u32(vshrq_n_u32(v, 11), m5);
+        uint32x4_t b = vandq_u32(vshrq_n_u32(v, 19), m5);
+        vst1_u16(keys + i, vmovn_u32(vorrq_u32(vorrq_u32(vshlq_n_u32(r, 10), vshlq_n_u32(g, 5)), b)));
+    }
+#endif
+    for (; i < n; i++) {
+        const guint8 *p = px + i * 4;
+        keys[i] = (guint16)(((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3));
+    }
+}
+
+static void frame_histogram(const guint8 *px, guint n, guint32 *hist) {
+    guint16 keys[1024];
+    for (guint i = 0; i < n; i += G_N_ELEMENTS(keys)) {
+        guint m = MIN(n - i, G_N_ELEMENTS(keys));
+        pixel_keys(px + i * 4, m, keys);
+        for (guint k = 0; k < m; k++)
+            hist[keys[k]]++;
+    }
+}
+
+static inline int expand5(int c) {
+    return (c << 3) | (c >> 2);
+}
+
+typedef struct {
+    guint16 key;
+    guint16 sort;
+    guint32 count;
+} ColorCount;
+
+typedef struct {
+    guint first, last;              // faixa em colors[]
+    guint64 count;
+    int axis;                       // canal de maior amplitude (0 = R, 1 = G, 2 = B)
+    int range;
+} Box;
+
+static inline int key_channel(guint16 key, int axis) {
+    return (key >> (10 - 5 * axis)) & 31;
+}
+
+static void box_measure(Box *b, const ColorCount *colors) {
+    int lo[3] = { 31, 31, 31 }, hi[3] = { 0, 0, 0 };
+    b->count = 0;
+    for (guint i = b->first; i < b->last; i++) {
+        b->count += colors[i].count;
+        for (int a = 0; a < 3; a++) {
+            int c = key_channel(colors[i].key, a);
+            lo[a] = MIN(lo[a], c);
+            hi[a] = MAX(hi[a], c);
+        }
+    }
+    b->axis = 0;
+    for (int a = 1; a < 3; a++)
+        if (hi[a] - lo[a] > hi[b->axis] - lo[b->axis])
+            b->axis = a;
+    b->range = hi[b->axis] - lo[b->axis];
+}
+
+static int compare_sort(const void *a, const void *b) {
+    return (int)((const ColorCount *)a)->sort - (int)((const ColorCount *)b)->sort;
+}
+
+// Median cut: parte sempre a caixa com mais pixels × amplitude, na mediana do
+// canal mais largo. Cada cor da paleta é a média ponderada da sua caixa.
+static void build_palette(const guint32 *hist, Palette *p) {
+    ColorCount *colors = g_new(ColorCount, GIF_KEYS);
+    guint n = 0;
+    for (guint k = 0; k < GIF_KEYS; k++)
+        if (hist[k])
+            colors[n++] = (ColorCount){ (guint16)k, 0, hist[k] };
+
+    Box boxes[GIF_COLORS];
+    guint nb = 0;
+    if (n > 0) {
+        boxes[nb] = (Box){ 0, n, 0, 0, 0 };
+        box_measure(&boxes[nb++], colors);
+    }
+    while (nb < GIF_COLORS) {
+        int best = -1;
+        for (guint i = 0; i < nb; i++)
+            if (boxes[i].range > 0 && (best < 0 ||
+                boxes[i].count * (guint64)boxes[i].range > boxes[best].count * (guint64)boxes[best].range))
+                best = (int)i;
+        if (best < 0)
+            break;
+
+        Box *b = &boxes[best];
+        for (guint i = b->first; i < b->last; i++)
+            colors[i].sort = (guint16)key_channel(colors[i].key, b->axis);
+        qsort(colors + b->first, b->last - b->first, sizeof(ColorCount), compare_sort);
+        guint64 half = b->count / 2, acc = 0;
+        guint mid = b->first;
+        while (mid < b->last - 1 && acc + colors[mid].count <= half)
+            acc += colors[mid++].count;
+        mid = CLAMP(mid, b->first + 1, b->last - 1);
+
+        boxes[nb] = (Box){ mid, b->last, 0, 0, 0 };
+        b->last = mid;
+        box_measure(b, colors);
+        box_measure(&boxes[nb++], colors);
+    }
+
+    memset(p->rgb, 0, sizeof p->rgb);
+    for (guint i = 0; i < nb; i++) {
+        guint64 sum[3] = { 0, 0, 0 };
+        for (guint c = boxes[i].first; c < boxes[i].last; c++)
+            for (int a = 0; a < 3; a++)
+                sum[a] += (guint64)expand5(key_channel(colors[c].key, a)) * colors[c].count;
+        for (int a = 0; a < 3; a++)
+            p->rgb[i][a] = (guint8)((sum[a] + boxes[i].count / 2) / MAX(boxes[i].count, 1));
+    }
+    p->n = MAX(nb, 1);
+    memset(p->lut, 0xFF, sizeof p->lut);
+    g_free(colors);
+}
+
+static guint8 nearest_color(const Palette *p, guint key) {
+    int r = expand5(key >> 10), g = expand5((key >> 5) & 31), b = expand5(key & 31);
+    int best = 0, best_d = G_MAXINT;
+    for (guint i = 0; i < p->n; i++) {
+        int dr = r - p->rgb[i][0], dg = g - p->rgb[i][1], db = b - p->rgb[i][2];
+        int d = 2 * dr * dr + 4 * dg * dg + 3 * db * db;
+        if (d < best_d) {
+            best_d = d;
+            best = (int)i;
+        }
+    }
+    return (guint8)best;
+}
+
+// A paleta do clipe é compartilhada entre workers: a tabela é preenchida antes
+static void fill_lut(Palette *p) {
+    for (guint k = 0; k < GIF_KEYS; k++)
+        p->lut[k] = nearest_color(p, k);
+}
+
+// Dithering ordenado (Bayer 8×8): não espalha ruído de um quadro para o outro,
+// então o que está parado continua idêntico e sai do retângulo delta
+static void dither_frame(GifRun *run, GifFrame *f) {
+    int w = run->width, h = run->height;
+    guint8 *row = g_malloc((gsize)w * 4);
+    guint16 *keys = g_new(guint16, w);
+    Palette *p = f->palette;
+    for (int y = 0; y < h; y++) {
+        guint8 pos[32] = { 0 }, neg[32] = { 0 };
+        for (int x = 0; x < 8; x++) {
+            int d = (bayer8[y & 7][x] >> 2) - 8;    // -8..7
+            for (int c = 0; c < 3; c++) {
+                pos[x * 4 + c] = (guint8)MAX(d, 0);
+                neg[x * 4 + c] = (guint8)MAX(-d, 0);
+            }
+        }
+        const guint8 *src = f->pixels + (gsize)y * w * 4;
+        int x = 0;
+#if defined(__SSE2__)
+        __m128i p0 = _mm_loadu_si128((const __m128i *)pos), p1 = _mm_loadu_si128((const __m128i *)(pos + 16));
+        __m128i n0 = _mm_loadu_si128((const __m128i *)neg), n1 = _mm_loadu_si128((const __m128i *)(neg + 16));
+        for (; x + 8 <= w; x += 8) {
+            __m128i v0 = _mm_loadu_si128((const __m128i *)(src + x * 4));
+            __m128i v1 = _mm_loadu_si128((const __m128i *)(src + x * 4 + 16));
+            _mm_storeu_si128((__m128i *)(row + x * 4), _mm_subs_epu8(_mm_adds_epu8(v0, p0), n0));
+            _mm_storeu_si128((__m128i *)(row + x * 4 + 16), _mm_subs_epu8(_mm_adds_epu8(v1, p1), n1));
+        }
+#elif defined(__ARM_NEON)
+        uint8x16_t p0 = vld1q_u8(pos), p1 = vld1q_u8(pos + 16), n0 = vld1q_u8(neg), n1 = vld1q_u8(neg + 16);
+        for (; x + 8 <= w; x += 8) {
+            vst1q_u8(row + x * 4, vqsubq_u8(vqaddq_u8(vld1q_u8(src + x * 4), p0), n0));
+            vst1q_u8(row + x * 4 + 16, vqsubq_u8(vqaddq_u8(vld1q_u8(src + x * 4 + 16), p1), n1));
+        }
+#endif
+        for (; x < w; x++) {
+            int o = (x & 7) * 4;
+            for (int c = 0; c < 4; c++)
+                row[x * 4 + c] = (guint8)CLAMP((int)src[x * 4 + c] + pos[o + c] - neg[o + c], 0, 255);
+        }
+
+        pixel_keys(row, (guint)w, keys);
+        guint8 *dst = f->index + (gsize)y * w;
+        for (x = 0; x < w; x++) {
+            guint16 k = keys[x];
+            if (p->lut[k] == 0xFFFF)
+                p->lut[k] = nearest_color(p, k);
+            dst[x] = (guint8)p->lut[k];
+        }
+    }
+    g_free(keys);
+    g_free(row);
+    g_clear_pointer(&f->pixels, g_free);
+}
+
+static inline gboolean same_pixel(const GifFrame *a, const GifFrame *b, gsize i) {
+    if (a->palette == b->palette)
+        return a->index[i] == b->index[i];
+    return memcmp(a->palette->rgb[a->index[i]], b->palette->rgb[b->index[i]], 3) == 0;
+}
+
+static gboolean row_changed(const GifFrame *f, const GifFrame *p, gsize o, int w) {
+    if (f->palette == p->palette)
+        return memcmp(f->index + o, p->index + o, (gsize)w) != 0;
+    for (int x = 0; x < w; x++)
+        if (!same_pixel(f, p, o + x))
+            return TRUE;
+    return FALSE;
+}
+
+// Menor retângulo com todos os pixels diferentes do quadro anterior
+static gboolean changed_rect(GifRun *run, const GifFrame *f, int *x0, int *y0, int *x1, int *y1) {
+    int w = run->width, h = run->height;
+    const GifFrame *p = f->prev;
+    if (!p) {
+        *x0 = *y0 = 0;
+        *x1 = w;
+        *y1 = h;
+        return TRUE;
+    }
+    int top = 0, bottom = h;
+    while (top < h && !row_changed(f, p, (gsize)top * w, w))
+        top++;
+    if (top == h)
+        return FALSE;
+    while (bottom > top + 1 && !row_changed(f, p, (gsize)(bottom - 1) * w, w))
+        bottom--;
+    int left = w, right = 0;
+    for (int y = top; y < bottom; y++) {
+        gsize o = (gsize)y * w;
+        for (int x = 0; x < left; x++)
+            if (!same_pixel(f, p, o + x)) {
+                left = x;
+                break;
+            }
+        for (int x = w - 1; x >= right; x--)
+            if (!same_pixel(f, p, o + x)) {
+                right = x + 1;
+                break;
+            }
+    }
+    *x0 = left;
+    *y0 = top;
+    *x1 = MAX(right, left + 1);
+    *y1 = bottom;
+    return TRUE;
+}
+
+typedef struct {
+    GByteArray *out;
+    guint32 acc;
+    int nbits;
+} BitWriter;
+
+static inline void put_code(BitWriter *bw, guint code, int size) {
+    bw->acc |= (guint32)code << bw->nbits;
+    bw->nbits += size;
+    while (bw->nbits >= 8) {
+        guint8 byte = bw->acc & 0xff;
+        g_byte_array_append(bw->out, &byte, 1);
+        bw->acc >>= 8;
+        bw->nbits -= 8;
+    }
+}
+
+// LZW do GIF (código mínimo de 8 bits, até 12), com as mesmas regras de troca
+// de tamanho e de limpeza da tabela do giflib
+static void lzw_encode(const guint8 *px, gsize n, GByteArray *raw) {
+    const guint clear = 256, eoi = 257;
+    gint32 *keys = g_new(gint32, LZW_HASH);
+    guint16 *codes = g_new(guint16, LZW_HASH);
+    memset(keys, 0xFF, LZW_HASH * sizeof(gint32));
+    BitWriter bw = { raw, 0, 0 };
+    int size = 9;
+    guint next = eoi + 1;
+
+    put_code(&bw, clear, size);
+    guint prefix = px[0];
+    for (gsize i = 1; i < n; i++) {
+        guint c = px[i];
+        gint32 key = (gint32)((prefix << 8) | c);
+        guint h = ((guint)key ^ ((guint)key >> 11)) & (LZW_HASH - 1);
+        while (keys[h] != -1 && keys[h] != key)
+            h = (h + 1) & (LZW_HASH - 1);
+        if (keys[h] == key) {
+            prefix = codes[h];
+            continue;
+        }
+        put_code(&bw, prefix, size);
+        if (next >= (1u << size) && size < 12)
+            size++;
+        prefix = c;
+        if (next >= LZW_MAX_CODE) {
+            put_code(&bw, clear, size);
+            size = 9;
+            next = eoi + 1;
+            memset(keys, 0xFF, LZW_HASH * sizeof(gint32));
+        } else {
+            keys[h] = key;
+            codes[h] = (guint16)next++;
+        }
+    }
+    put_code(&bw, prefix, size);
+    if (next >= (1u << size) && size < 12)
+        size++;
+    put_code(&bw, eoi, size);
+    if (bw.nbits > 0)
+        put_code(&bw, 0, 8 - bw.nbits);
+    g_free(codes);
+    g_free(keys);
+}
+
+static void append_u16(GByteArray *b, guint v) {
+    guint8 le[2] = { v & 0xff, (v >> 8) & 0xff };
+    g_byte_array_append(b, le, 2);
+}
+
+// Bloco de imagem completo: controle gráfico (duração preenchida na escrita),
+// descritor, paleta local se houver e o LZW em sub-blocos de 255 bytes
+static void encode_frame(GifRun *run, GifFrame *f) {
+    int x0, y0, x1, y1;
+    if (!changed_rect(run, f, &x0, &y0, &x1, &y1))
+        return;
+    int rw = x1 - x0, rh = y1 - y0;
+    guint8 *rect = g_malloc((gsize)rw * rh);
+    gboolean transparent = FALSE;
+    for (int y = 0; y < rh; y++) {
+        gsize o = (gsize)(y0 + y) * run->width + x0;
+        for (int x = 0; x < rw; x++) {
+            // O que não mudou fica transparente: o quadro anterior aparece por baixo
+            gboolean keep = f->prev && same_pixel(f, f->prev, o + x);
+            rect[(gsize)y * rw + x] = keep ? GIF_TRANSPARENT : f->index[o + x];
+            transparent |= keep;
+        }
+    }
+
+    GByteArray *b = g_byte_array_sized_new((gsize)rw * rh / 2 + 1024);
+    guint8 gce[] = { 0x21, 0xF9, 0x04, (1 << 2) | (transparent ? 1 : 0), 0, 0, GIF_TRANSPARENT, 0 };
+    g_byte_array_append(b, gce, sizeof gce);
+    guint8 sep = 0x2C;
+    g_byte_array_append(b, &sep, 1);
+    append_u16(b, (guint)x0);
+    append_u16(b, (guint)y0);
+    append_u16(b, (guint)rw);
+    append_u16(b, (guint)rh);
+    guint8 packed = f->own_palette ? 0x80 | 7 : 0;
+    g_byte_array_append(b, &packed, 1);
+    if (f->own_palette) {
+        guint8 table[256 * 3] = { 0 };
+        memcpy(table, f->palette->rgb, sizeof f->palette->rgb);
+        g_byte_array_append(b, table, sizeof table);
+    }
+
+    GByteArray *raw = g_byte_array_sized_new((gsize)rw * rh / 2 + 16);
+    lzw_encode(rect, (gsize)rw * rh, raw);
+    guint8 min_code = 8;
+    g_byte_array_append(b, &min_code, 1);
+    for (guint i = 0; i < raw->len; i += 255) {
+        guint8 len = (guint8)MIN(raw->len - i, 255);
+        g_byte_array_append(b, &len, 1);
+        g_byte_array_append(b, raw->data + i, len);
+    }
+    guint8 end = 0;
+    g_byte_array_append(b, &end, 1);
+    g_byte_array_unref(raw);
+    g_free(rect);
+    f->block = b;
+}
+
+static void gif_worker(gpointer data, gpointer user_data) {
+    GifFrame *f = data;
+    GifRun *run = user_data;
+    if (!g_cancellable_is_cancelled(run->cancellable)) {
+        gsize n = (gsize)run->width * run->height;
+        switch (run->phase) {
+        case PHASE_HISTOGRAM: {
+            guint32 *hist = g_new0(guint32, GIF_KEYS);
+            frame_histogram(f->pixels, (guint)n, hist);
+            g_mutex_lock(&run->lock);
+            for (guint k = 0; k < GIF_KEYS; k++)
+                run->hist[k] += hist[k];
+            g_mutex_unlock(&run->lock);
+            g_free(hist);
+            break;
+        }
+        case PHASE_PALETTE: {
+            guint32 *hist = g_new0(guint32, GIF_KEYS);
+            frame_histogram(f->pixels, (guint)n, hist);
+            f->palette = g_new(Palette, 1);
+            f->own_palette = TRUE;
+            build_palette(hist, f->palette);
+            g_free(hist);
+            break;
+        }
+        case PHASE_DITHER:
+            f->index = g_malloc(n);
+            dither_frame(run, f);
+            break;
+        case PHASE_ENCODE:
+            encode_frame(run, f);
+            break;
+        }
+    }
+    g_mutex_lock(&run->lock);
+    run->remaining--;
+    g_cond_signal(&run->cond);
+    g_mutex_unlock(&run->lock);
+}
+
+// Uma fase para todos os quadros do lote, espalhada pelos workers
+static void run_phase(GifRun *run, GPtrArray *frames, GifPhase phase) {
+    run->phase = phase;
+    run->remaining = frames->len;
+    for (guint i = 0; i < frames->len; i++)
+        g_thread_pool_push(run->pool, g_ptr_array_index(frames, i), NULL);
+    g_mutex_lock(&run->lock);
+    while (run->remaining > 0)
+        g_cond_wait(&run->cond, &run->lock);
+    g_mutex_unlock(&run->lock);
+}
+
+static void gif_frame_free(gpointer data) {
+    GifFrame *f = data;
+    g_free(f->pixels);
+    g_free(f->index);
+    if (f->own_palette)
+        g_free(f->palette);
+    if (f->block)
+        g_byte_array_unref(f->block);
+    g_free(f);
+}
+
+static guint slot_cs(GifRun *run, guint slot) {
+    return (guint)llround(slot * 100.0 / run->fps);
+}
+
+// Grava o bloco pendente agora que se sabe quando o próximo aparece
+static void flush_pending(GifRun *run, guint until_slot) {
+    if (!run->pending)
+        return;
+    // Navegadores tratam menos de 2 centésimos como 10
+    guint delay = MAX(slot_cs(run, until_slot) - slot_cs(run, run->pending_slot), 2);
+    run->pending->data[4] = delay & 0xff;
+    run->pending->data[5] = (delay >> 8) & 0xff;
+    fwrite(run->pending->data, 1, run->pending->len, run->fp);
+    g_clear_pointer(&run->pending, g_byte_array_unref);
+}
+
+// Processa e grava um lote em ordem. O último quadro continua vivo: é o
+// "anterior" do primeiro quadro do próximo lote.
+static void process_batch(GifRun *run, GPtrArray *frames, GifFrame **prev, gboolean local) {
+    if (frames->len == 0)
+        return;
+    if (local)
+        run_phase(run, frames, PHASE_PALETTE);
+    else
+        for (guint i = 0; i < frames->len; i++)
+            ((GifFrame *)g_ptr_array_index(frames, i))->palette = run->global;
+    run_phase(run, frames, PHASE_DITHER);
+    for (guint i = 0; i < frames->len; i++)
+        ((GifFrame *)g_ptr_array_index(frames, i))->prev = i > 0 ? g_ptr_array_index(frames, i - 1) : *prev;
+    run_phase(run, frames, PHASE_ENCODE);
+
+    for (guint i = 0; i < frames->len; i++) {
+        GifFrame *f = g_ptr_array_index(frames, i);
+        // Quadro igual ao anterior não é gravado: o anterior só dura mais
+        if (f->block) {
+            flush_pending(run, f->slot);
+            run->pending = g_steal_pointer(&f->block);
+            run->pending_slot = f->slot;
+        }
+    }
+    if (*prev)
+        gif_frame_free(*prev);
+    *prev = g_ptr_array_steal_index(frames, frames->len - 1);
+    g_ptr_array_set_size(frames, 0);
+}
+
+static void write_header(GifRun *run, gboolean global) {
+    GByteArray *b = g_byte_array_new();
+    g_byte_array_append(b, (const guint8 *)"GIF89a", 6);
+    append_u16(b, (guint)run->width);
+    append_u16(b, (guint)run->height);
+    guint8 lsd[3] = { global ? 0xF7 : 0x70, 0, 0 };
+    g_byte_array_append(b, lsd, 3);
+    if (global) {
+        guint8 table[256 * 3] = { 0 };
+        memcpy(table, run->global->rgb, sizeof run->global->rgb);
+        g_byte_array_append(b, table, sizeof table);
+    }
+    // Repete para sempre
+    static const guint8 loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+                                   0x03, 0x01, 0x00, 0x00, 0x00 };
+    g_byte_array_append(b, loop, sizeof loop);
+    fwrite(b->data, 1, b->len, run->fp);
+    g_byte_array_unref(b);
+}
+
+gboolean export_gif(const ExportJob *job, const GifOptions *opts, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error) {
+    if (job->end_us <= job->start_us) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "O fim do corte precisa vir depois do início");
+        return FALSE;
+    }
+
+    gint64 t = trace_begin();
+    AVFormatContext *in = media_open_input(job->input, error);
+    if (!in)
+        return FALSE;
+    const AVCodec *codec = NULL;
+    int vin = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (vin < 0 || !codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", job->input);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+    AVStream *vst = in->streams[vin];
+    for (unsigned i = 0; i < in->nb_streams; i++)
+        in->streams[i]->discard = (int)i == vin ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    GifRun run = { 0 };
+    run.fps = opts->fps > 0 ? opts->fps : GIF_DEFAULT_FPS;
+    run.cancellable = cancellable;
+    AVRational sar = vst->codecpar->sample_aspect_ratio;
+    double src_w = vst->codecpar->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+    int src_h = vst->codecpar->height;
+    run.height = MAX(1, opts->max_height > 0 ? MIN(opts->max_height, src_h) : src_h);
+    run.width = MAX(1, (int)(src_w * run.height / src_h + 0.5));
+
+    guint total_slots = (guint)ceil((job->end_us - job->start_us) * run.fps / G_USEC_PER_SEC);
+    gboolean local = opts->local_palettes ||
+        (guint64)total_slots * run.width * run.height * 4 > GIF_GLOBAL_BUDGET;
+    guint threads = opts->threads ? opts->threads : export_get_thread_budget();
+    // Paleta única: o lote é o clipe inteiro; por quadro: alguns quadros por worker
+    guint batch_size = local ? threads * 4 : G_MAXUINT;
+
+    AVCodecContext *dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(dec, vst->codecpar);
+    dec->pkt_timebase = vst->time_base;
+    dec->thread_count = 0;
+    dec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    int ret = avcodec_open2(dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&dec);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    run.fp = g_fopen(job->output, "wb");
+    if (!run.fp) {
+        int errsv = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errsv), "%s: %s", job->output, g_strerror(errsv));
+        avcodec_free_context(&dec);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    g_mutex_init(&run.lock);
+    g_cond_init(&run.cond);
+    run.pool = g_thread_pool_new(gif_worker, &run, (gint)threads, FALSE, NULL);
+    if (local)
+        write_header(&run, FALSE);
+
+    gint64 origin = media_stream_start_us(vst);
+    gint64 start_ts = media_us_to_ts(origin + job->start_us, vst->time_base);
+    gint64 end_ts = media_us_to_ts(origin + job->end_us, vst->time_base);
+    av_seek_frame(in, vin, start_ts, AVSEEK_FLAG_BACKWARD);
+
+    struct SwsContext *sws = NULL;
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    GPtrArray *batch = g_ptr_array_new_with_free_func(gif_frame_free);
+    GifFrame *prev = NULL;
+    guint next_slot = 0;
+    gboolean draining = FALSE, done = FALSE, ok = TRUE;
+    double reported = -1.0;
+    // Com paleta única a decodificação é metade do trabalho; o resto vem depois
+    double decode_share = local ? 1.0 : 0.5;
+
+    while (ok && !done) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        if (!draining) {
+            ret = av_read_frame(in, pkt);
+            if (ret >= 0 && pkt->stream_index != vin) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            if (ret < 0)
+                draining = TRUE;
+            avcodec_send_packet(dec, draining ? NULL : pkt);
+            av_packet_unref(pkt);
+        }
+
+        int got = 0;
+        while (!done && avcodec_receive_frame(dec, frame) >= 0) {
+            got++;
+            gint64 pts = frame->best_effort_timestamp;
+            if (pts == AV_NOPTS_VALUE || pts < start_ts) {
+                av_frame_unref(frame);
+                continue;
+            }
+            if (pts >= end_ts) {
+                av_frame_unref(frame);
+                done = TRUE;
+                break;
+            }
+            // Um quadro por slot de 1/fps; o primeiro abre o GIF
+            gint64 rel_us = media_ts_to_us(pts, vst->time_base) - origin - job->start_us;
+            guint slot = next_slot == 0 ? 0 : (guint)(rel_us * run.fps / G_USEC_PER_SEC);
+            if (slot < next_slot) {
+                av_frame_unref(frame);
+                continue;
+            }
+
+            GifFrame *f = g_new0(GifFrame, 1);
+            f->slot = slot;
+            f->pixels = g_malloc((gsize)run.width * run.height * 4);
+            sws = sws_getCachedContext(sws, frame->width, frame->height, frame->format,
+                                       run.width, run.height, AV_PIX_FMT_RGB0, SWS_AREA, NULL, NULL, NULL);
+            uint8_t *dst[4] = { f->pixels };
+            int dst_stride[4] = { run.width * 4 };
+            sws_scale(sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+            av_frame_unref(frame);
+            g_ptr_array_add(batch, f);
+            next_slot = slot + 1;
+
+            if (batch->len >= batch_size)
+                process_batch(&run, batch, &prev, local);
+            double fr = decode_share * MIN((double)next_slot / MAX(total_slots, 1), 1.0);
+            if (progress && fr - reported >= 0.02) {
+                reported = fr;
+                progress(fr, user_data);
+            }
+        }
+        if (draining && got == 0)
+            break;
+    }
+
+    if (ok && g_cancellable_set_error_if_cancelled(cancellable, error))
+        ok = FALSE;
+    if (ok && !local && batch->len > 0) {
+        run.hist = g_new0(guint32, GIF_KEYS);
+        run_phase(&run, batch, PHASE_HISTOGRAM);
+        run.global = g_new(Palette, 1);
+        build_palette(run.hist, run.global);
+        fill_lut(run.global);
+        write_header(&run, TRUE);
+        if (progress)
+            progress(0.6, user_data);
+    }
+    if (ok)
+        process_batch(&run, batch, &prev, local);
+    if (ok && g_cancellable_set_error_if_cancelled(cancellable, error))
+        ok = FALSE;
+    if (ok && !prev) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Nenhum quadro no trecho");
+        ok = FALSE;
+    }
+    if (ok) {
+        flush_pending(&run, MAX(total_slots, run.pending_slot + 1));
+        fputc(0x3B, run.fp);
+    }
+
+    g_thread_pool_free(run.pool, FALSE, TRUE);
+    g_ptr_array_unref(batch);
+    if (prev)
+        gif_frame_free(prev);
+    g_clear_pointer(&run.pending, g_byte_array_unref);
+    g_free(run.hist);
+    g_free(run.global);
+    g_mutex_clear(&run.lock);
+    g_cond_clear(&run.cond);
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&dec);
+    avformat_close_input(&in);
+
+    gboolean write_failed = ferror(run.fp) != 0;
+    if (fclose(run.fp) != 0)
+        write_failed = TRUE;
+    if (ok && write_failed) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "%s: falha ao gravar", job->output);
+        ok = FALSE;
+    }
+    if (!ok)
+        g_remove(job->output);
+    else if (progress)
+        progress(1.0, user_data);
+    trace_end("export gif", "export", t);
+    return ok;
+}
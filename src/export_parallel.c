@@ -0,0 +1,875 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+#include <string.h>
+#include "export.h"
+#include "media_util.h"
+#include "seek_index.h"
+#include "stage_queue.h"
+#include "trace.h"
+#include "perf_counters.h"
+
+// Trechos mais curtos que isso não compensam um encoder próprio
+#define MIN_CHUNK_US (2 * G_USEC_PER_SEC)
+
+static guint thread_budget = 0;
+
+void export_set_thread_budget(guint threads) {
+    thread_budget = threads;
+}
+
+guint export_get_thread_budget(void) {
+    return thread_budget ? thread_budget : g_get_num_processors();
+}
+
+typedef struct {
+    guint index;
+    gint64 start_us, end_us;    // absolutos; end exclusivo
+    gint64 seek_ts;             // keyframe onde a decodificação começa
+    gchar *tmp_path;
+    AVCodecParameters *par;     // parâmetros do encoder (iguais em todos os trechos)
+    AVRational time_base;
+    gboolean ok;
+    GError *error;
+} Chunk;
+
+typedef struct {
+    const ExportJob *job;
+    const TranscodeOptions *opts;
+    int vin;
+    AVRational vtb;
+    gint64 origin_us;           // início do corte (absoluto): vira zero na saída
+    int out_w, out_h;
+    GCancellable *cancellable;
+    ExportChunkFunc progress;
+    gpointer user_data;
+
+    guint n_chunks;
+
+    ExportPipelineStats *stats; // de quem chamou, ou local_stats
+    ExportPipelineStats local_stats;
+
+    GMutex lock;
+    GCond cond;
+    guint remaining;
+    gboolean failed;            // algum trecho falhou: os outros são cancelados
+} ParallelExport;
+
+static const AVCodec *find_encoder(const TranscodeOptions *opts) {
+    if (opts->encoder)
+        return avcodec_find_encoder_by_name(opts->encoder);
+    const AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+    return codec ? codec : avcodec_find_encoder(AV_CODEC_ID_H264);
+}
+
+static AVCodecContext *open_encoder(ParallelExport *pe, AVStream *vst, GError **error) {
+    const AVCodec *codec = find_encoder(pe->opts);
+    if (!codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Encoder %s não disponível",
+                    pe->opts->encoder ? pe->opts->encoder : "H.264");
+        return NULL;
+    }
+    AVCodecContext *enc = avcodec_alloc_context3(codec);
+    enc->width = pe->out_w;
+    enc->height = pe->out_h;
+    enc->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc->sample_aspect_ratio = (AVRational){ 1, 1 };
+    enc->time_base = vst->time_base;
+    enc->framerate = vst->avg_frame_rate;
+    enc->thread_count = 1;  // o paralelismo vem dos trechos e dos estágios
+    // Cabeçalho global: todos os trechos têm o mesmo, e ele vai uma vez só na saída
+    enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary *opts = NULL;
+    av_dict_set_int(&opts, "crf", pe->opts->crf > 0 ? pe->opts->crf : 20, 0);
+    int ret = avcodec_open2(enc, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&enc);
+    }
+    return enc;
+}
+
+// Itens em trânsito em cada ligação do pipeline. As cascas (AVPacket/AVFrame) são
+// criadas uma vez por trecho: vão cheias pela fila de ida e voltam vazias pela de
+// volta, o que também limita quantos itens cada estágio pode adiantar.
+#define PIPE_PACKETS        32      // demux → decode
+#define PIPE_FRAMES         8       // decode → escala → encode
+#define PIPE_OUT_PACKETS    16      // encode → mux
+#define PIPE_ALIGN          32
+
+typedef struct {
+    ParallelExport *pe;
+    Chunk *c;
+    AVFormatContext *in;
+    AVFormatContext *out;
+    AVCodecContext *dec;
+    AVCodecContext *enc;
+    struct SwsContext *sws;
+    AVBufferPool *pictures;     // quadros escalados: o buffer volta quando o encoder o solta
+    gint64 start_ts, end_ts, origin_ts;
+
+    StageQueue demuxed, packet_free;    // demux → decode
+    StageQueue decoded, decoded_free;   // decode → escala
+    StageQueue scaled, scaled_free;     // escala → encode
+    StageQueue encoded, encoded_free;   // encode → mux
+    AVPacket *packets[PIPE_PACKETS];
+    AVFrame *frames[PIPE_FRAMES];
+    AVFrame *pictures_out[PIPE_FRAMES];
+    AVPacket *out_packets[PIPE_OUT_PACKETS];
+
+    GMutex lock;
+    GError *error;              // primeiro erro de qualquer estágio
+} ChunkPipeline;
+
+#define PIPE_QUEUES 8
+
+static void pipeline_queues(ChunkPipeline *cp, StageQueue *all[PIPE_QUEUES]) {
+    StageQueue *list[PIPE_QUEUES] = {
+        &cp->demuxed, &cp->packet_free, &cp->decoded, &cp->decoded_free,
+        &cp->scaled, &cp->scaled_free, &cp->encoded, &cp->encoded_free,
+    };
+    memcpy(all, list, sizeof list);
+}
+
+// Guarda o primeiro erro e derruba todas as filas: cada estágio sai no próximo push/pop
+static void pipeline_fail(ChunkPipeline *cp, GError *error) {
+    g_mutex_lock(&cp->lock);
+    if (!cp->error)
+        cp->error = error;
+    else
+        g_error_free(error);
+    g_mutex_unlock(&cp->lock);
+    StageQueue *all[PIPE_QUEUES];
+    pipeline_queues(cp, all);
+    for (guint i = 0; i < PIPE_QUEUES; i++)
+        stage_queue_abort(all[i]);
+}
+
+static void pipeline_fail_av(ChunkPipeline *cp, MediaError code, int averr, const char *what) {
+    GError *error = NULL;
+    media_set_av_error(&error, code, averr, what);
+    pipeline_fail(cp, error);
+}
+
+// Casca vazia marcada assim é o fim do stream
+static void mark_packet_eof(AVPacket *pkt) {
+    av_packet_unref(pkt);
+    pkt->stream_index = -1;
+}
+
+// Espelho dos contadores no HUD: itens por estágio e ocupação da fila de entrada
+static PerfCounter *perf_done[EXPORT_N_STAGES];
+static PerfCounter *perf_queued[EXPORT_N_STAGES];
+
+static void perf_init(void) {
+    static gsize once = 0;
+    static const char *names[EXPORT_N_STAGES] = { "demux", "decode", "escala", "encode", "mux" };
+    if (g_once_init_enter(&once)) {
+        for (guint i = 0; i < EXPORT_N_STAGES; i++) {
+            gchar *name = g_strdup_printf("export.%s", names[i]);
+            perf_done[i] = perf_counter_register(name, PERF_COUNT);
+            g_free(name);
+            name = g_strdup_printf("export.fila.%s", names[i]);
+            perf_queued[i] = perf_counter_register(name, PERF_GAUGE);
+            g_free(name);
+        }
+        g_once_init_leave(&once, 1);
+    }
+}
+
+static void perf_publish_queues(const ExportPipelineStats *stats) {
+    for (guint i = 0; i < EXPORT_N_STAGES; i++)
+        perf_counter_set(perf_queued[i], g_atomic_int_get(&stats->queued[i]));
+}
+
+static void count_done(ChunkPipeline *cp, ExportStage stage) {
+    ExportPipelineStats *stats = cp->pe->stats;
+    g_atomic_int_inc(&stats->done[stage]);
+    perf_counter_add(perf_done[stage], 1);
+    perf_counter_set(perf_queued[stage], g_atomic_int_get(&stats->queued[stage]));
+}
+
+// Lê os pacotes de vídeo do trecho. Pacotes com pts antes do fim sempre entram,
+// e quadros depois do fim também seguem para o decoder (o filtro por pts fica em
+// receive_decoded), porque B-frames do trecho ainda podem vir depois deles: os de
+// GOP aberto logo após o keyframe seguinte, ou os que seguem o P-frame quando o
+// fim não cai num keyframe (último trecho). A leitura para no primeiro pacote
+// depois do fim cujo dts também já passou, ou depois dos B-frames iniciais do
+// keyframe seguinte.
+static void demux_stage(ChunkPipeline *cp) {
+    ParallelExport *pe = cp->pe;
+    gboolean past_end_key = FALSE, eof = FALSE;
+    while (!eof) {
+        GError *error = NULL;
+        if (g_cancellable_set_error_if_cancelled(pe->cancellable, &error)) {
+            pipeline_fail(cp, error);
+            return;
+        }
+        AVPacket *pkt;
+        if (!stage_queue_pop(&cp->packet_free, (gpointer *)&pkt))
+            return;
+        int ret;
+        while ((ret = av_read_frame(cp->in, pkt)) >= 0 && pkt->stream_index != pe->vin)
+            av_packet_unref(pkt);
+        gint64 ts = ret >= 0 ? (pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts) : AV_NOPTS_VALUE;
+        if (ret >= 0 && ts != AV_NOPTS_VALUE && ts >= cp->end_ts) {
+            gboolean dts_past = pkt->dts == AV_NOPTS_VALUE || pkt->dts >= cp->end_ts;
+            if ((pkt->flags & AV_PKT_FLAG_KEY) && !past_end_key)
+                past_end_key = TRUE;
+            else if (past_end_key || dts_past)
+                ret = AVERROR_EOF;
+        }
+        eof = ret < 0;
+        if (eof)
+            mark_packet_eof(pkt);
+        if (!stage_queue_push(&cp->demuxed, pkt))
+            return;
+        if (!eof)
+            count_done(cp, EXPORT_STAGE_DEMUX);
+    }
+}
+
+// Empurra para a escala os quadros prontos que caem dentro do trecho
+static gboolean receive_decoded(ChunkPipeline *cp, AVFrame **held, double *reported) {
+    ParallelExport *pe = cp->pe;
+    for (;;) {
+        if (!*held && !stage_queue_pop(&cp->decoded_free, (gpointer *)held))
+            return FALSE;
+        AVFrame *frame = *held;
+        if (avcodec_receive_frame(cp->dec, frame) < 0)
+            return TRUE;
+        gint64 pts = frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE || pts < cp->start_ts || pts >= cp->end_ts) {
+            av_frame_unref(frame);
+            continue;
+        }
+        if (!stage_queue_push(&cp->decoded, frame))
+            return FALSE;
+        *held = NULL;
+        count_done(cp, EXPORT_STAGE_DECODE);
+
+        double f = (double)(pts - cp->start_ts) / MAX(cp->end_ts - cp->start_ts, 1);
+        if (pe->progress && f - *reported >= 0.02) {
+            *reported = f;
+            pe->progress(cp->c->index, pe->n_chunks, f, pe->user_data);
+        }
+    }
+}
+
+static gpointer decode_stage(gpointer data) {
+    ChunkPipeline *cp = data;
+    AVFrame *held = NULL;       // casca livre ainda não usada
+    double reported = -1.0;
+    AVPacket *pkt;
+    while (stage_queue_pop(&cp->demuxed, (gpointer *)&pkt)) {
+        gboolean eof = pkt->stream_index < 0;
+        // Pacote com erro é só pulado, como numa reprodução
+        avcodec_send_packet(cp->dec, eof ? NULL : pkt);
+        av_packet_unref(pkt);
+        if (!stage_queue_push(&cp->packet_free, pkt) || !receive_decoded(cp, &held, &reported))
+            return NULL;
+        if (eof) {
+            // Fim: uma casca sem buffer segue adiante
+            if (held || stage_queue_pop(&cp->decoded_free, (gpointer *)&held))
+                stage_queue_push(&cp->decoded, held);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Quadro de saída num buffer reaproveitado do pool (um bloco para todos os planos)
+static gboolean take_picture(ChunkPipeline *cp, AVFrame *dst) {
+    AVCodecContext *enc = cp->enc;
+    dst->buf[0] = av_buffer_pool_get(cp->pictures);
+    if (!dst->buf[0])
+        return FALSE;
+    dst->format = enc->pix_fmt;
+    dst->width = enc->width;
+    dst->height = enc->height;
+    av_image_fill_arrays(dst->data, dst->linesize, dst->buf[0]->data, enc->pix_fmt,
+                         enc->width, enc->height, PIPE_ALIGN);
+    return TRUE;
+}
+
+// Escala e conversão de cor (os caminhos SIMD do swscale) para o formato do encoder
+static gpointer scale_stage(gpointer data) {
+    ChunkPipeline *cp = data;
+    AVCodecContext *enc = cp->enc;
+    AVFrame *src, *dst;
+    while (stage_queue_pop(&cp->decoded, (gpointer *)&src)) {
+        gboolean eof = src->buf[0] == NULL;
+        if (!stage_queue_pop(&cp->scaled_free, (gpointer *)&dst))
+            return NULL;
+        if (!eof) {
+            if (!take_picture(cp, dst)) {
+                pipeline_fail(cp, g_error_new(MEDIA_ERROR, MEDIA_ERROR_IO, "Sem memória para o quadro"));
+                return NULL;
+            }
+            cp->sws = sws_getCachedContext(cp->sws, src->width, src->height, src->format,
+                                           enc->width, enc->height, enc->pix_fmt,
+                                           SWS_BICUBIC, NULL, NULL, NULL);
+            sws_scale(cp->sws, (const uint8_t * const *)src->data, src->linesize, 0, src->height,
+                      dst->data, dst->linesize);
+            dst->pts = src->best_effort_timestamp - cp->origin_ts;
+            av_frame_unref(src);
+        }
+        if (!stage_queue_push(&cp->decoded_free, src) || !stage_queue_push(&cp->scaled, dst))
+            return NULL;
+        if (eof)
+            return NULL;
+        count_done(cp, EXPORT_STAGE_SCALE);
+    }
+    return NULL;
+}
+
+// Passa adiante os pacotes que o encoder tiver prontos
+static gboolean receive_encoded(ChunkPipeline *cp, AVPacket **held) {
+    for (;;) {
+        if (!*held && !stage_queue_pop(&cp->encoded_free, (gpointer *)held))
+            return FALSE;
+        int ret = avcodec_receive_packet(cp->enc, *held);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return TRUE;
+        if (ret < 0) {
+            pipeline_fail_av(cp, MEDIA_ERROR_CODEC, ret, cp->enc->codec->name);
+            return FALSE;
+        }
+        if (!stage_queue_push(&cp->encoded, *held))
+            return FALSE;
+        *held = NULL;
+        count_done(cp, EXPORT_STAGE_ENCODE);
+    }
+}
+
+static gpointer encode_stage(gpointer data) {
+    ChunkPipeline *cp = data;
+    AVPacket *held = NULL;
+    AVFrame *frame;
+    while (stage_queue_pop(&cp->scaled, (gpointer *)&frame)) {
+        gboolean eof = frame->buf[0] == NULL;
+        int ret = avcodec_send_frame(cp->enc, eof ? NULL : frame);
+        // O encoder guarda a própria referência; o buffer volta ao pool quando ele soltar
+        av_frame_unref(frame);
+        if (!stage_queue_push(&cp->scaled_free, frame))
+            return NULL;
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            pipeline_fail_av(cp, MEDIA_ERROR_CODEC, ret, cp->enc->codec->name);
+            return NULL;
+        }
+        if (!receive_encoded(cp, &held))
+            return NULL;
+        if (eof) {
+            if (held || stage_queue_pop(&cp->encoded_free, (gpointer *)&held)) {
+                mark_packet_eof(held);
+                stage_queue_push(&cp->encoded, held);
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static gpointer mux_stage(gpointer data) {
+    ChunkPipeline *cp = data;
+    AVStream *ost = cp->out->streams[0];
+    AVPacket *pkt;
+    while (stage_queue_pop(&cp->encoded, (gpointer *)&pkt)) {
+        if (pkt->stream_index < 0)
+            return NULL;
+        av_packet_rescale_ts(pkt, cp->enc->time_base, ost->time_base);
+        pkt->stream_index = 0;
+        int ret = av_write_frame(cp->out, pkt);
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            pipeline_fail_av(cp, MEDIA_ERROR_IO, ret, cp->c->tmp_path);
+            return NULL;
+        }
+        if (!stage_queue_push(&cp->encoded_free, pkt))
+            return NULL;
+        count_done(cp, EXPORT_STAGE_MUX);
+    }
+    return NULL;
+}
+
+static void pipeline_init(ChunkPipeline *cp) {
+    ExportPipelineStats *stats = cp->pe->stats;
+    g_mutex_init(&cp->lock);
+    stage_queue_init(&cp->demuxed, PIPE_PACKETS, &stats->queued[EXPORT_STAGE_DECODE]);
+    stage_queue_init(&cp->packet_free, PIPE_PACKETS, NULL);
+    stage_queue_init(&cp->decoded, PIPE_FRAMES, &stats->queued[EXPORT_STAGE_SCALE]);
+    stage_queue_init(&cp->decoded_free, PIPE_FRAMES, NULL);
+    stage_queue_init(&cp->scaled, PIPE_FRAMES, &stats->queued[EXPORT_STAGE_ENCODE]);
+    stage_queue_init(&cp->scaled_free, PIPE_FRAMES, NULL);
+    stage_queue_init(&cp->encoded, PIPE_OUT_PACKETS, &stats->queued[EXPORT_STAGE_MUX]);
+    stage_queue_init(&cp->encoded_free, PIPE_OUT_PACKETS, NULL);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_DECODE], PIPE_PACKETS);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_SCALE], PIPE_FRAMES);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_ENCODE], PIPE_FRAMES);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_MUX], PIPE_OUT_PACKETS);
+
+    // Todas as cascas começam nas filas de volta
+    for (guint i = 0; i < PIPE_PACKETS; i++) {
+        cp->packets[i] = av_packet_alloc();
+        stage_queue_push(&cp->packet_free, cp->packets[i]);
+    }
+    for (guint i = 0; i < PIPE_FRAMES; i++) {
+        cp->frames[i] = av_frame_alloc();
+        cp->pictures_out[i] = av_frame_alloc();
+        stage_queue_push(&cp->decoded_free, cp->frames[i]);
+        stage_queue_push(&cp->scaled_free, cp->pictures_out[i]);
+    }
+    for (guint i = 0; i < PIPE_OUT_PACKETS; i++) {
+        cp->out_packets[i] = av_packet_alloc();
+        stage_queue_push(&cp->encoded_free, cp->out_packets[i]);
+    }
+}
+
+static void pipeline_clear(ChunkPipeline *cp) {
+    ExportPipelineStats *stats = cp->pe->stats;
+    StageQueue *all[PIPE_QUEUES];
+    pipeline_queues(cp, all);
+    for (guint i = 0; i < PIPE_QUEUES; i++)
+        stage_queue_clear(all[i]);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_DECODE], -PIPE_PACKETS);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_SCALE], -PIPE_FRAMES);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_ENCODE], -PIPE_FRAMES);
+    g_atomic_int_add(&stats->capacity[EXPORT_STAGE_MUX], -PIPE_OUT_PACKETS);
+
+    // As cascas podem ter ficado em qualquer fila ou na mão de um estágio abortado
+    for (guint i = 0; i < PIPE_PACKETS; i++)
+        av_packet_free(&cp->packets[i]);
+    for (guint i = 0; i < PIPE_FRAMES; i++) {
+        av_frame_free(&cp->frames[i]);
+        av_frame_free(&cp->pictures_out[i]);
+    }
+    for (guint i = 0; i < PIPE_OUT_PACKETS; i++)
+        av_packet_free(&cp->out_packets[i]);
+    g_mutex_clear(&cp->lock);
+}
+
+// Decodifica [start, end) de um trecho, escala e codifica num arquivo temporário (NUT,
+// que preserva o time base). Cada trecho tem seu próprio demux, decoder e encoder,
+// cada estágio na sua thread; esta thread faz o demux.
+static gboolean encode_chunk(ParallelExport *pe, Chunk *c, GError **error) {
+    gint64 t = trace_begin();
+    ChunkPipeline cp = { .pe = pe, .c = c };
+    cp.in = media_open_input(pe->job->input, error);
+    if (!cp.in)
+        return FALSE;
+    gboolean ok = FALSE;
+
+    AVStream *vst = cp.in->streams[pe->vin];
+    for (unsigned i = 0; i < cp.in->nb_streams; i++)
+        cp.in->streams[i]->discard = (int)i == pe->vin ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    const AVCodec *codec = avcodec_find_decoder(vst->codecpar->codec_id);
+    cp.dec = codec ? avcodec_alloc_context3(codec) : NULL;
+    if (!cp.dec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Codec de vídeo sem suporte");
+        goto out;
+    }
+    avcodec_parameters_to_context(cp.dec, vst->codecpar);
+    cp.dec->pkt_timebase = vst->time_base;
+    cp.dec->thread_count = 1;
+    int ret = avcodec_open2(cp.dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        goto out;
+    }
+
+    cp.enc = open_encoder(pe, vst, error);
+    if (!cp.enc)
+        goto out;
+    c->par = avcodec_parameters_alloc();
+    avcodec_parameters_from_context(c->par, cp.enc);
+    c->time_base = cp.enc->time_base;
+
+    avformat_alloc_output_context2(&cp.out, NULL, "nut", c->tmp_path);
+    AVStream *ost = cp.out ? avformat_new_stream(cp.out, NULL) : NULL;
+    if (!ost) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Não foi possível criar %s", c->tmp_path);
+        goto out;
+    }
+    avcodec_parameters_copy(ost->codecpar, c->par);
+    ost->time_base = cp.enc->time_base;
+    if ((ret = avio_open(&cp.out->pb, c->tmp_path, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(cp.out, NULL)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, c->tmp_path);
+        goto out;
+    }
+    cp.pictures = av_buffer_pool_init(av_image_get_buffer_size(cp.enc->pix_fmt, cp.enc->width, cp.enc->height,
+                                                               PIPE_ALIGN), NULL);
+
+    cp.start_ts = media_us_to_ts(c->start_us, vst->time_base);
+    cp.end_ts = media_us_to_ts(c->end_us, vst->time_base);
+    cp.origin_ts = media_us_to_ts(pe->origin_us, vst->time_base);
+    av_seek_frame(cp.in, pe->vin, c->seek_ts, AVSEEK_FLAG_BACKWARD);
+
+    pipeline_init(&cp);
+    GThread *stages[] = {
+        g_thread_new("export-decode", decode_stage, &cp),
+        g_thread_new("export-scale", scale_stage, &cp),
+        g_thread_new("export-encode", encode_stage, &cp),
+        g_thread_new("export-mux", mux_stage, &cp),
+    };
+    demux_stage(&cp);
+    for (guint i = 0; i < G_N_ELEMENTS(stages); i++)
+        g_thread_join(stages[i]);
+
+    ok = cp.error == NULL;
+    if (!ok)
+        g_propagate_error(error, g_steal_pointer(&cp.error));
+    pipeline_clear(&cp);
+    if (ok && (ret = av_write_trailer(cp.out)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, c->tmp_path);
+        ok = FALSE;
+    }
+    if (ok && pe->progress)
+        pe->progress(c->index, pe->n_chunks, 1.0, pe->user_data);
+
+out:
+    if (cp.out) {
+        avio_closep(&cp.out->pb);
+        avformat_free_context(cp.out);
+    }
+    sws_freeContext(cp.sws);
+    avcodec_free_context(&cp.dec);
+    avcodec_free_context(&cp.enc);
+    av_buffer_pool_uninit(&cp.pictures);
+    avformat_close_input(&cp.in);
+    trace_end("export chunk", "export", t);
+    return ok;
+}
+
+static void chunk_worker(gpointer data, gpointer user_data) {
+    Chunk *c = data;
+    ParallelExport *pe = user_data;
+    c->ok = encode_chunk(pe, c, &c->error);
+
+    g_mutex_lock(&pe->lock);
+    if (!c->ok && c->error && !g_error_matches(c->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        pe->failed = TRUE;
+    pe->remaining--;
+    g_cond_signal(&pe->cond);
+    g_mutex_unlock(&pe->lock);
+}
+
+// Divide [start, end) em trechos que começam em keyframes, para que nenhum worker
+// decodifique quadros só para descartá-los
+static GPtrArray *plan_chunks(ParallelExport *pe, SeekIndex *idx, gint64 start_us, gint64 end_us, guint threads) {
+    GPtrArray *chunks = g_ptr_array_new();
+    guint n = (guint)CLAMP((end_us - start_us) / MIN_CHUNK_US, 1, MIN(threads * 2, EXPORT_MAX_CHUNKS));
+    GArray *keyframes = seek_index_get_keyframes(idx);
+
+    gint64 bounds[EXPORT_MAX_CHUNKS + 1];
+    guint nb = 0, k = 0;
+    bounds[nb++] = start_us;
+    for (guint i = 1; i < n; i++) {
+        gint64 target = start_us + (end_us - start_us) * i / n;
+        while (k < keyframes->len && g_array_index(keyframes, SeekEntry, k).pts_us < target)
+            k++;
+        gint64 b = k < keyframes->len ? g_array_index(keyframes, SeekEntry, k).pts_us : target;
+        if (b > bounds[nb - 1] && b < end_us)
+            bounds[nb++] = b;
+    }
+    bounds[nb] = end_us;
+    g_array_unref(keyframes);
+
+    for (guint i = 0; i < nb; i++) {
+        Chunk *c = g_new0(Chunk, 1);
+        c->index = i;
+        c->start_us = bounds[i];
+        c->end_us = bounds[i + 1];
+        SeekEntry kf;
+        c->seek_ts = seek_index_lookup(idx, c->start_us, &kf) ? kf.ts : media_us_to_ts(c->start_us, pe->vtb);
+        c->tmp_path = g_strdup_printf("%s.part%u.nut", pe->job->output, i);
+        g_ptr_array_add(chunks, c);
+    }
+    return chunks;
+}
+
+static void chunk_free(gpointer data) {
+    Chunk *c = data;
+    g_remove(c->tmp_path);
+    g_free(c->tmp_path);
+    avcodec_parameters_free(&c->par);
+    g_clear_error(&c->error);
+    g_free(c);
+}
+
+typedef struct {
+    AVFormatContext *fmt;
+    AVPacket *pkt;
+    gboolean has;       // pkt contém o próximo pacote
+    int out_index;      // stream correspondente na saída (-1 enquanto não há pacote)
+} MergeSource;
+
+// Próximo pacote de vídeo: lê os temporários em sequência
+static gboolean next_video(MergeSource *src, GPtrArray *chunks, guint *current) {
+    while (*current < chunks->len) {
+        if (!src->fmt) {
+            Chunk *c = g_ptr_array_index(chunks, *current);
+            if (avformat_open_input(&src->fmt, c->tmp_path, NULL, NULL) < 0)
+                return FALSE;
+        }
+        if (av_read_frame(src->fmt, src->pkt) >= 0)
+            return TRUE;
+        avformat_close_input(&src->fmt);
+        (*current)++;
+    }
+    return FALSE;
+}
+
+// Próximo pacote de áudio da fonte dentro do corte
+static gboolean next_audio(MergeSource *src, const int *map, gint64 start_us, gint64 end_us) {
+    while (av_read_frame(src->fmt, src->pkt) >= 0) {
+        AVStream *st = src->fmt->streams[src->pkt->stream_index];
+        gint64 ts = src->pkt->pts != AV_NOPTS_VALUE ? src->pkt->pts : src->pkt->dts;
+        gint64 us = media_ts_to_us(ts, st->time_base);
+        if (map[src->pkt->stream_index] >= 0 && us != G_MININT64 && us >= start_us && us < end_us) {
+            src->out_index = map[src->pkt->stream_index];
+            return TRUE;
+        }
+        av_packet_unref(src->pkt);
+        if (us != G_MININT64 && us >= end_us + G_USEC_PER_SEC)
+            break;
+    }
+    return FALSE;
+}
+
+// Junta os trechos na saída final, intercalando o áudio da fonte (copiado)
+static gboolean concat_chunks(ParallelExport *pe, GPtrArray *chunks, gint64 start_us, gint64 end_us, GError **error) {
+    gint64 t = trace_begin();
+    const char *output = pe->job->output;
+    Chunk *first = g_ptr_array_index(chunks, 0);
+    AVFormatContext *out = NULL;
+    MergeSource video = { NULL, av_packet_alloc(), FALSE, 0 };
+    MergeSource audio = { NULL, av_packet_alloc(), FALSE, -1 };
+    int *map = NULL;
+    gint64 *last_dts = NULL;
+    guint current = 0;
+    gboolean ok = FALSE;
+
+    int ret = avformat_alloc_output_context2(&out, NULL, NULL, output);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_OPEN, ret, output);
+        goto out;
+    }
+    AVStream *vout = avformat_new_stream(out, NULL);
+    avcodec_parameters_copy(vout->codecpar, first->par);
+    vout->time_base = first->time_base;
+
+    audio.fmt = media_open_input(pe->job->input, error);
+    if (!audio.fmt)
+        goto out;
+    map = g_new(int, audio.fmt->nb_streams);
+    for (unsigned i = 0; i < audio.fmt->nb_streams; i++) {
+        AVStream *ist = audio.fmt->streams[i];
+        map[i] = -1;
+        if (ist->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+            ist->discard = AVDISCARD_ALL;
+            continue;
+        }
+        AVStream *ost = avformat_new_stream(out, NULL);
+        avcodec_parameters_copy(ost->codecpar, ist->codecpar);
+        ost->codecpar->codec_tag = 0;
+        ost->time_base = ist->time_base;
+        map[i] = ost->index;
+    }
+    av_seek_frame(audio.fmt, -1, start_us, AVSEEK_FLAG_BACKWARD);
+
+    if (!(out->oformat->flags & AVFMT_NOFILE) && (ret = avio_open(&out->pb, output, AVIO_FLAG_WRITE)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+        goto out;
+    }
+    if ((ret = avformat_write_header(out, NULL)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+        goto out;
+    }
+    last_dts = g_new(gint64, out->nb_streams);
+    for (unsigned i = 0; i < out->nb_streams; i++)
+        last_dts[i] = AV_NOPTS_VALUE;
+
+    video.has = next_video(&video, chunks, &current);
+    audio.has = next_audio(&audio, map, start_us, end_us);
+    ok = TRUE;
+    while (ok && (video.has || audio.has)) {
+        // Escreve o que vem antes no tempo
+        gboolean take_video = video.has;
+        AVRational vtb = video.has ? video.fmt->streams[0]->time_base : (AVRational){ 1, 1 };
+        if (video.has && audio.has) {
+            AVRational atb = audio.fmt->streams[audio.pkt->stream_index]->time_base;
+            gint64 a_rel = audio.pkt->dts - av_rescale_q(start_us, AV_TIME_BASE_Q, atb);
+            take_video = av_compare_ts(video.pkt->dts, vtb, a_rel, atb) <= 0;
+        }
+
+        MergeSource *src = take_video ? &video : &audio;
+        AVPacket *pkt = src->pkt;
+        int o = take_video ? 0 : src->out_index;
+        AVRational itb = take_video ? vtb : audio.fmt->streams[pkt->stream_index]->time_base;
+        if (!take_video) {
+            gint64 offset = av_rescale_q(start_us, AV_TIME_BASE_Q, itb);
+            if (pkt->pts != AV_NOPTS_VALUE)
+                pkt->pts -= offset;
+            if (pkt->dts != AV_NOPTS_VALUE)
+                pkt->dts -= offset;
+        }
+        av_packet_rescale_ts(pkt, itb, out->streams[o]->time_base);
+        if (pkt->dts != AV_NOPTS_VALUE) {
+            if (last_dts[o] != AV_NOPTS_VALUE && pkt->dts <= last_dts[o]) {
+                pkt->dts = last_dts[o] + 1;
+                if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+                    pkt->pts = pkt->dts;
+            }
+            last_dts[o] = pkt->dts;
+        }
+        pkt->stream_index = o;
+        pkt->pos = -1;
+        if ((ret = av_interleaved_write_frame(out, pkt)) < 0) {
+            media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+            ok = FALSE;
+        }
+
+        if (take_video)
+            video.has = next_video(&video, chunks, &current);
+        else
+            audio.has = next_audio(&audio, map, start_us, end_us);
+    }
+    if (ok && (ret = av_write_trailer(out)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, output);
+        ok = FALSE;
+    }
+
+out:
+    if (out) {
+        if (!(out->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&out->pb);
+        avformat_free_context(out);
+    }
+    avformat_close_input(&video.fmt);
+    avformat_close_input(&audio.fmt);
+    av_packet_free(&video.pkt);
+    av_packet_free(&audio.pkt);
+    g_free(map);
+    g_free(last_dts);
+    if (!ok)
+        g_remove(output);
+    trace_end("export concat", "export", t);
+    return ok;
+}
+
+static void on_parent_cancelled(GCancellable *parent, gpointer user_data) {
+    (void)parent;
+    g_cancellable_cancel(user_data);
+}
+
+gboolean export_transcode_parallel(const ExportJob *job, const TranscodeOptions *opts,
+    GCancellable *cancellable, ExportChunkFunc progress, gpointer user_data, GError **error) {
+    if (job->end_us <= job->start_us) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "O fim do corte precisa vir depois do início");
+        return FALSE;
+    }
+
+    gint64 t = trace_begin();
+    AVFormatContext *in = media_open_input(job->input, error);
+    if (!in)
+        return FALSE;
+    int vin = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (vin < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", job->input);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    ParallelExport pe = { 0 };
+    pe.job = job;
+    pe.opts = opts;
+    pe.vin = vin;
+    AVStream *vst = in->streams[vin];
+    pe.vtb = vst->time_base;
+    pe.progress = progress;
+    pe.user_data = user_data;
+    pe.stats = opts->stats ? opts->stats : &pe.local_stats;
+    perf_init();
+
+    // Tamanho de saída: limita a altura mantendo o aspecto (dimensões pares)
+    AVRational sar = vst->codecpar->sample_aspect_ratio;
+    double src_w = vst->codecpar->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+    int src_h = vst->codecpar->height;
+    int h = opts->max_height > 0 ? MIN(opts->max_height, src_h) : src_h;
+    pe.out_h = MAX(2, h & ~1);
+    pe.out_w = MAX(2, (int)(src_w * pe.out_h / src_h + 0.5) & ~1);
+
+    gint64 origin = media_stream_start_us(vst);
+    gint64 start_us = origin + job->start_us, end_us = origin + job->end_us;
+    pe.origin_us = start_us;
+    avformat_close_input(&in);
+
+    // Os trechos precisam dos keyframes: MP4 é instantâneo, outros formatos exigem a
+    // varredura, mas só até o fim do intervalo exportado
+    SeekIndex *idx = seek_index_new(job->input);
+    seek_index_wait_until(idx, end_us, cancellable);
+    guint threads = opts->threads ? opts->threads : export_get_thread_budget();
+    GPtrArray *chunks = plan_chunks(&pe, idx, start_us, end_us, threads);
+    seek_index_cancel(idx);
+    seek_index_unref(idx);
+    g_ptr_array_set_free_func(chunks, chunk_free);
+    pe.n_chunks = chunks->len;
+
+    if (progress) {
+        for (guint i = 0; i < chunks->len; i++)
+            progress(i, chunks->len, 0.0, user_data);
+    }
+
+    // Cancelamento próprio (um trecho com erro para os outros) ligado ao de quem chamou
+    pe.cancellable = g_cancellable_new();
+    gulong handler = cancellable
+        ? g_cancellable_connect(cancellable, G_CALLBACK(on_parent_cancelled), pe.cancellable, NULL) : 0;
+
+    g_mutex_init(&pe.lock);
+    g_cond_init(&pe.cond);
+    pe.remaining = chunks->len;
+    // Um trecho por núcleo, como antes dos estágios: o encoder (thread única) é
+    // quase todo o custo e precisa de todos os núcleos; decode e escala passam a
+    // maior parte do tempo dormindo na fila cheia do encode
+    GThreadPool *pool = g_thread_pool_new(chunk_worker, &pe, (gint)MIN(MAX(threads, 1), chunks->len), FALSE, NULL);
+    for (guint i = 0; i < chunks->len; i++)
+        g_thread_pool_push(pool, g_ptr_array_index(chunks, i), NULL);
+
+    g_mutex_lock(&pe.lock);
+    while (pe.remaining > 0) {
+        g_cond_wait(&pe.cond, &pe.lock);
+        if (pe.failed)
+            g_cancellable_cancel(pe.cancellable);
+    }
+    g_mutex_unlock(&pe.lock);
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_cancellable_disconnect(cancellable, handler);
+    perf_publish_queues(pe.stats);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < chunks->len; i++) {
+        Chunk *c = g_ptr_array_index(chunks, i);
+        if (!c->ok && c->error && !g_error_matches(c->error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_propagate_error(error, g_steal_pointer(&c->error));
+            ok = FALSE;
+        }
+    }
+    if (ok && g_cancellable_set_error_if_cancelled(cancellable, error))
+        ok = FALSE;
+    if (ok)
+        ok = concat_chunks(&pe, chunks, start_us, end_us, error);
+
+    g_ptr_array_unref(chunks);
+    g_object_unref(pe.cancellable);
+    g_mutex_clear(&pe.lock);
+    g_cond_clear(&pe.cond);
+    trace_end("export transcode", "export", t);
+    return ok;
+}
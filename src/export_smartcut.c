@@ -0,0 +1,81 @@
+#include <glib.h>
+#include <libavformat/avformat.h>
+#include "export.h"
+#include "cut_writer.h"
+#include "media_util.h"
+#include "trace.h"
+
+gboolean export_smart_cut(const ExportJob *job, GCancellable *cancellable,
+    ExportProgressFunc progress, gpointer user_data, GError **error) {
+    if (job->end_us <= job->start_us) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "O fim do corte precisa vir depois do início");
+        return FALSE;
+    }
+
+    gint64 t = trace_begin();
+    AVFormatContext *in = media_open_input(job->input, error);
+    if (!in)
+        return FALSE;
+    int vin = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (vin < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", job->input);
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    AVStream *vst = in->streams[vin];
+    gint64 origin = media_stream_start_us(vst);
+    gint64 start_us = origin + job->start_us, end_us = origin + job->end_us;
+    CutWriter *w = cut_writer_new(in, vin, job->output, start_us, end_us, error);
+    if (!w) {
+        avformat_close_input(&in);
+        return FALSE;
+    }
+
+    // Começa no keyframe que precede o início do corte
+    av_seek_frame(in, vin, media_us_to_ts(start_us, vst->time_base), AVSEEK_FLAG_BACKWARD);
+
+    AVPacket *pkt = av_packet_alloc();
+    gboolean ok = TRUE;
+    double reported = -1.0;
+    while (ok && !cut_writer_is_done(w)) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        int ret = av_read_frame(in, pkt);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0) {
+            media_set_av_error(error, MEDIA_ERROR_IO, ret, job->input);
+            ok = FALSE;
+            break;
+        }
+
+        if (progress && pkt->stream_index == vin && pkt->pts != AV_NOPTS_VALUE) {
+            double f = (double)(media_ts_to_us(pkt->pts, vst->time_base) - start_us) / (end_us - start_us);
+            f = CLAMP(f, 0.0, 1.0);
+            if (f - reported >= 0.01) {
+                reported = f;
+                progress(f, user_data);
+            }
+        }
+        ok = cut_writer_feed(w, pkt, error);
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+
+    if (ok)
+        ok = cut_writer_finish(w, error);
+    if (ok) {
+        guint copied, encoded;
+        cut_writer_get_counts(w, &copied, &encoded);
+        g_debug("Corte exportado: %u GOPs copiados, %u recodificados", copied, encoded);
+        if (progress)
+            progress(1.0, user_data);
+    }
+    cut_writer_free(w, !ok);
+    avformat_close_input(&in);
+    trace_end("export smart cut", "export", t);
+    return ok;
+}
@@ -0,0 +1,38 @@
+#include <glib.h>
+#include <string.h>
+#include "gif_scan.h"
+
+guint gif_count_frames(const guchar *d, gsize len) {
+    if (len < 13 || memcmp(d, "GIF", 3) != 0)
+        return 0;
+
+    gsize pos = 13;
+    if (d[10] & 0x80)
+        pos += 3u << ((d[10] & 0x07) + 1);
+
+    guint frames = 0;
+    while (pos < len) {
+        guchar block = d[pos++];
+        if (block == 0x3B) {
+            break;
+        } else if (block == 0x21) {
+            pos++;  // rótulo da extensão
+        } else if (block == 0x2C) {
+            if (pos + 9 > len)
+                break;
+            guchar flags = d[pos + 8];
+            pos += 9;
+            if (flags & 0x80)
+                pos += 3u << ((flags & 0x07) + 1);
+            pos++;  // tamanho mínimo do código LZW
+            frames++;
+        } else {
+            break;
+        }
+        // Pula os sub-blocos de dados até o terminador
+        while (pos < len && d[pos] != 0)
+            pos += d[pos] + 1;
+        pos++;
+    }
+    return frames;
+}
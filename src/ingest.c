@@ -0,0 +1,686 @@
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include "ingest.h"
+#include "media_util.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+// Cada pedaço custa um pedido HTTP novo, então não pode ser pequeno; arquivos
+// enormes usam pedaços maiores para o mapa de bits não passar de INGEST_MAX_CHUNKS
+#define CHUNK_MIN_SIZE          (8 * 1024 * 1024)
+#define INGEST_MAX_CHUNKS       65536
+#define READ_SIZE               (256 * 1024)
+#define CHUNK_RETRIES           3
+#define RETRY_DELAY_US          500000
+#define IO_TIMEOUT_US           15000000
+#define PROGRESS_INTERVAL_US    250000
+#define STATE_SAVE_INTERVAL_US  1000000
+#define MAX_REDIRECTS           5
+// Peso de cada medida nova na média da velocidade
+#define SPEED_WEIGHT            0.3
+
+// Arquivo de retomada (ordem de bytes da máquina)
+typedef struct {
+    char magic[4];          // "ZDL2"
+    guint32 chunk_size;
+    guint64 total_size;
+    guint32 n_chunks;
+    guint32 url_len;        // seguido da URL (sem '\0'), do validador e do mapa de bits
+    guint32 validator_len;
+    guint32 reserved;       // 0
+} StateHeader;
+
+G_STATIC_ASSERT(sizeof(StateHeader) == 32);
+
+// Registro ao lado do arquivo pronto: de qual URL ele veio
+#define RECORD_SUFFIX  ".source"
+#define RECORD_GROUP   "download"
+
+typedef struct {
+    const char *url;
+    const char *validator;  // ETag e Last-Modified do remoto ("" se não vieram)
+    gchar *part_path;
+    gchar *state_path;
+    GFile *part;
+    guint64 total;          // 0 = desconhecido (download de uma conexão só)
+    guint64 chunk_size;
+    guint n_chunks;
+    guint8 *done;           // mapa de bits dos pedaços já gravados
+    GCancellable *cancellable;  // próprio: um pedaço que falha de vez para os outros
+
+    GMutex lock;
+    guint cursor;           // pedaços antes dele já foram distribuídos
+    guint64 done_bytes;
+    guint active;
+    gboolean resumed;
+    gint64 state_saved_time;
+    GError *error;          // primeiro erro de qualquer conexão
+
+    IngestProgressFunc progress;
+    gpointer user_data;
+    guint64 reported_bytes;
+    gint64 reported_time;
+    double speed;
+    guint64 perf_kib;
+} Ingest;
+
+static guint connections = INGEST_DEFAULT_CONNECTIONS;
+
+void ingest_set_connections(guint n) {
+    connections = n ? MIN(n, INGEST_MAX_CONNECTIONS) : INGEST_DEFAULT_CONNECTIONS;
+}
+
+guint ingest_get_connections(void) {
+    return connections;
+}
+
+// HUD: bytes recebidos (a taxa é a vazão) e conexões abertas
+static struct {
+    PerfCounter *kib;
+    PerfCounter *connections;
+} perf;
+
+static void ingest_init(void) {
+    static gsize once = 0;
+    if (g_once_init_enter(&once)) {
+        avformat_network_init();
+        perf.kib = perf_counter_register("download.kib", PERF_COUNT);
+        perf.connections = perf_counter_register("download.conexoes", PERF_GAUGE);
+        g_once_init_leave(&once, 1);
+    }
+}
+
+static int check_interrupt(void *opaque) {
+    return g_cancellable_is_cancelled(opaque);
+}
+
+// Pedido de [offset, end) (end = 0: até o fim); o FFmpeg manda o Range
+static AVIOContext *open_range(const char *url, guint64 offset, guint64 end, GCancellable *cancellable,
+    GError **error) {
+    AVDictionary *opts = NULL;
+    av_dict_set_int(&opts, "rw_timeout", IO_TIMEOUT_US, 0);
+    if (offset > 0)
+        av_dict_set_int(&opts, "offset", (int64_t)offset, 0);
+    if (end > 0)
+        av_dict_set_int(&opts, "end_offset", (int64_t)end, 0);
+    AVIOInterruptCB cb = { check_interrupt, cancellable };
+    AVIOContext *io = NULL;
+    int ret = avio_open2(&io, url, AVIO_FLAG_READ, &cb, &opts);
+    av_dict_free(&opts);
+    if (ret < 0 && !g_cancellable_set_error_if_cancelled(cancellable, error))
+        media_set_av_error(error, MEDIA_ERROR_OPEN, ret, url);
+    return ret < 0 ? NULL : io;
+}
+
+// Lê os cabeçalhos da resposta até a linha vazia: o código de status e os que interessam
+static int read_response_head(GInputStream *stream, GCancellable *cancellable, gchar **location, gchar **etag,
+    gchar **last_modified) {
+    GDataInputStream *data = g_data_input_stream_new(stream);
+    g_filter_input_stream_set_close_base_stream(G_FILTER_INPUT_STREAM(data), FALSE);
+    int status = 0;
+    gchar *line;
+    for (guint n = 0; (line = g_data_input_stream_read_line(data, NULL, cancellable, NULL)); n++) {
+        g_strchomp(line);
+        gboolean end = *line == '\0';
+        const char *colon = strchr(line, ':');
+        if (n == 0) {
+            const char *code = strchr(line, ' ');
+            status = g_str_has_prefix(line, "HTTP/") && code ? atoi(code + 1) : 0;
+        } else if (!end && colon) {
+            gchar *name = g_strndup(line, (gsize)(colon - line));
+            gchar *value = g_strstrip(g_strdup(colon + 1));
+            gchar **slot = g_ascii_strcasecmp(name, "Location") == 0 ? location
+                         : g_ascii_strcasecmp(name, "ETag") == 0 ? etag
+                         : g_ascii_strcasecmp(name, "Last-Modified") == 0 ? last_modified : NULL;
+            if (slot) {
+                g_free(*slot);
+                *slot = g_steal_pointer(&value);
+            }
+            g_free(value);
+            g_free(name);
+        }
+        g_free(line);
+        if (end || status == 0)
+            break;
+    }
+    g_object_unref(data);
+    return status;
+}
+
+// ETag e Last-Modified do remoto, juntos numa string para comparar ("" se o
+// servidor não manda nenhum). O HTTP do FFmpeg não expõe os cabeçalhos da
+// resposta, então é um pedido à parte pelo GIO, de um byte só. Qualquer falha
+// aqui só faz a retomada conferir menos coisa.
+static gchar *fetch_validator(const char *url, GCancellable *cancellable) {
+    GSocketClient *client = g_socket_client_new();
+    g_socket_client_set_timeout(client, IO_TIMEOUT_US / G_USEC_PER_SEC);
+    gchar *current = g_strdup(url);
+    gchar *etag = NULL, *last_modified = NULL;
+    for (guint hop = 0; current && hop <= MAX_REDIRECTS; hop++) {
+        GUri *uri = g_uri_parse(current, G_URI_FLAGS_ENCODED, NULL);
+        gboolean https = uri && g_ascii_strcasecmp(g_uri_get_scheme(uri), "https") == 0;
+        gboolean http = uri && g_ascii_strcasecmp(g_uri_get_scheme(uri), "http") == 0;
+        GSocketConnection *conn = NULL;
+        if (https || http) {
+            g_socket_client_set_tls(client, https);
+            conn = g_socket_client_connect_to_uri(client, current, https ? 443 : 80, cancellable, NULL);
+        }
+        gchar *location = NULL;
+        if (conn) {
+            const char *path = g_uri_get_path(uri), *query = g_uri_get_query(uri);
+            gchar *host = g_uri_get_port(uri) > 0
+                ? g_strdup_printf("%s:%d", g_uri_get_host(uri), g_uri_get_port(uri)) : g_strdup(g_uri_get_host(uri));
+            gchar *request = g_strdup_printf(
+                "GET %s%s%s HTTP/1.1\r\nHost: %s\r\nRange: bytes=0-0\r\nUser-Agent: Zenoka\r\n"
+                "Connection: close\r\n\r\n",
+                *path ? path : "/", query ? "?" : "", query ? query : "", host);
+            GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+            if (g_output_stream_write_all(out, request, strlen(request), NULL, cancellable, NULL)) {
+                int status = read_response_head(g_io_stream_get_input_stream(G_IO_STREAM(conn)), cancellable,
+                                                &location, &etag, &last_modified);
+                if (status < 300 || status >= 400)
+                    g_clear_pointer(&location, g_free);
+                // Página de erro não diz nada sobre o arquivo
+                if (status < 200 || status >= 300) {
+                    g_clear_pointer(&etag, g_free);
+                    g_clear_pointer(&last_modified, g_free);
+                }
+            }
+            g_free(request);
+            g_free(host);
+            g_io_stream_close(G_IO_STREAM(conn), NULL, NULL);
+            g_object_unref(conn);
+        }
+        // Redirecionamento: os validadores que valem são os do destino final
+        gchar *next = location ? g_uri_resolve_relative(current, location, G_URI_FLAGS_NONE, NULL) : NULL;
+        g_free(location);
+        g_free(current);
+        current = next;
+        if (uri)
+            g_uri_unref(uri);
+    }
+    g_free(current);
+    g_object_unref(client);
+    gchar *validator = etag || last_modified
+        ? g_strdup_printf("%s\n%s", etag ? etag : "", last_modified ? last_modified : "") : g_strdup("");
+    g_free(etag);
+    g_free(last_modified);
+    return validator;
+}
+
+// Tamanho do remoto e se ele aceita intervalos (respondeu 206 ao "Range: bytes=0-")
+static gboolean probe(const char *url, GCancellable *cancellable, guint64 *total, gboolean *ranges,
+    GError **error) {
+    AVIOContext *io = open_range(url, 0, 0, cancellable, error);
+    if (!io)
+        return FALSE;
+    int64_t size = avio_size(io);
+    *total = size > 0 ? (guint64)size : 0;
+    *ranges = size > 0 && (io->seekable & AVIO_SEEKABLE_NORMAL);
+    avio_closep(&io);
+    return TRUE;
+}
+
+static guint64 chunk_length(const Ingest *in, guint index) {
+    guint64 start = (guint64)index * in->chunk_size;
+    return MIN(in->chunk_size, in->total - start);
+}
+
+static gboolean chunk_is_done(const Ingest *in, guint index) {
+    return (in->done[index / 8] >> (index % 8)) & 1;
+}
+
+static gsize bitmap_size(const Ingest *in) {
+    return (in->n_chunks + 7) / 8;
+}
+
+// Com "lock" (ou antes das conexões começarem). Falhar aqui só custa baixar de novo.
+static void state_save(Ingest *in) {
+    gsize url_len = strlen(in->url), validator_len = strlen(in->validator);
+    StateHeader h = {
+        .magic = { 'Z', 'D', 'L', '2' },
+        .chunk_size = (guint32)in->chunk_size,
+        .total_size = in->total,
+        .n_chunks = in->n_chunks,
+        .url_len = (guint32)url_len,
+        .validator_len = (guint32)validator_len,
+    };
+    gsize size = sizeof h + url_len + validator_len + bitmap_size(in);
+    guint8 *buf = g_malloc(size);
+    memcpy(buf, &h, sizeof h);
+    memcpy(buf + sizeof h, in->url, url_len);
+    memcpy(buf + sizeof h + url_len, in->validator, validator_len);
+    memcpy(buf + sizeof h + url_len + validator_len, in->done, bitmap_size(in));
+    g_file_set_contents(in->state_path, (const gchar *)buf, (gssize)size, NULL);
+    g_free(buf);
+    in->state_saved_time = g_get_monotonic_time();
+}
+
+// Vale só se for da mesma URL, com o mesmo tamanho, o mesmo ETag/Last-Modified
+// (o remoto não mudou desde então) e os mesmos pedaços, e se o .part ainda
+// estiver lá com o tamanho pré-alocado
+static gboolean state_load(Ingest *in) {
+    gchar *data = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(in->state_path, &data, &len, NULL))
+        return FALSE;
+    gsize url_len = strlen(in->url), validator_len = strlen(in->validator);
+    StateHeader h;
+    gboolean ok = len == sizeof h + url_len + validator_len + bitmap_size(in);
+    if (ok)
+        memcpy(&h, data, sizeof h);
+    ok = ok && memcmp(h.magic, "ZDL2", 4) == 0 && h.total_size == in->total &&
+         h.chunk_size == in->chunk_size && h.n_chunks == in->n_chunks && h.url_len == url_len &&
+         h.validator_len == validator_len && memcmp(data + sizeof h, in->url, url_len) == 0 &&
+         memcmp(data + sizeof h + url_len, in->validator, validator_len) == 0;
+    GStatBuf st;
+    ok = ok && g_stat(in->part_path, &st) == 0 && (guint64)st.st_size == in->total;
+    if (ok) {
+        memcpy(in->done, data + sizeof h + url_len + validator_len, bitmap_size(in));
+        for (guint i = 0; i < in->n_chunks; i++) {
+            if (chunk_is_done(in, i))
+                in->done_bytes += chunk_length(in, i);
+        }
+    }
+    g_free(data);
+    return ok;
+}
+
+// Com "lock"
+static void report(Ingest *in, gboolean force) {
+    gint64 now = g_get_monotonic_time();
+    if (!force && now - in->reported_time < PROGRESS_INTERVAL_US)
+        return;
+    double dt = (now - in->reported_time) / (double)G_USEC_PER_SEC;
+    if (dt > 0) {
+        double rate = ((gint64)in->done_bytes - (gint64)in->reported_bytes) / dt;
+        in->speed = in->speed > 0 ? in->speed + SPEED_WEIGHT * (rate - in->speed) : rate;
+    }
+    in->reported_bytes = in->done_bytes;
+    in->reported_time = now;
+    perf_counter_add(perf.kib, (gint)((gint64)(in->done_bytes / 1024) - (gint64)in->perf_kib));
+    in->perf_kib = in->done_bytes / 1024;
+    perf_counter_set(perf.connections, (gint)in->active);
+
+    if (in->progress) {
+        IngestProgress p = {
+            .total_bytes = in->total,
+            .done_bytes = in->done_bytes,
+            .bytes_per_sec = MAX(in->speed, 0.0),
+            .connections = in->active,
+            .resumed = in->resumed,
+        };
+        in->progress(&p, in->user_data);
+    }
+}
+
+// Bytes gravados (negativo: pedaço que falhou no meio e vai recomeçar)
+static void account(Ingest *in, gint64 delta) {
+    g_mutex_lock(&in->lock);
+    in->done_bytes += delta;
+    report(in, FALSE);
+    g_mutex_unlock(&in->lock);
+}
+
+static void set_active(Ingest *in, gint delta) {
+    g_mutex_lock(&in->lock);
+    in->active += delta;
+    report(in, TRUE);
+    g_mutex_unlock(&in->lock);
+}
+
+// Guarda o primeiro erro e derruba as outras conexões
+static void ingest_fail(Ingest *in, GError *error) {
+    g_mutex_lock(&in->lock);
+    if (!in->error)
+        in->error = error;
+    else
+        g_error_free(error);
+    g_mutex_unlock(&in->lock);
+    g_cancellable_cancel(in->cancellable);
+}
+
+static gboolean claim_chunk(Ingest *in, guint *index) {
+    g_mutex_lock(&in->lock);
+    while (in->cursor < in->n_chunks && chunk_is_done(in, in->cursor))
+        in->cursor++;
+    gboolean ok = in->cursor < in->n_chunks && !in->error;
+    if (ok)
+        *index = in->cursor++;
+    g_mutex_unlock(&in->lock);
+    return ok;
+}
+
+static void chunk_finished(Ingest *in, guint index) {
+    g_mutex_lock(&in->lock);
+    in->done[index / 8] |= (guint8)(1u << (index % 8));
+    if (g_get_monotonic_time() - in->state_saved_time >= STATE_SAVE_INTERVAL_US)
+        state_save(in);
+    g_mutex_unlock(&in->lock);
+}
+
+// Copia a resposta para "out" até "end" (0: até o remoto fechar)
+static gboolean copy_body(Ingest *in, AVIOContext *io, GOutputStream *out, guint64 pos, guint64 end,
+    guint8 *buf, guint64 *copied, GError **error) {
+    *copied = 0;
+    while (end == 0 || pos < end) {
+        int want = end ? (int)MIN((guint64)READ_SIZE, end - pos) : READ_SIZE;
+        int n = avio_read(io, buf, want);
+        if (n == AVERROR_EOF && end == 0)
+            return TRUE;
+        if (n <= 0) {
+            if (g_cancellable_set_error_if_cancelled(in->cancellable, error))
+                return FALSE;
+            if (n == 0 || n == AVERROR_EOF)
+                g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "%s: conexão encerrada antes do fim", in->url);
+            else
+                media_set_av_error(error, MEDIA_ERROR_IO, n, in->url);
+            return FALSE;
+        }
+        if (!g_output_stream_write_all(out, buf, (gsize)n, NULL, in->cancellable, error))
+            return FALSE;
+        pos += (guint64)n;
+        *copied += (guint64)n;
+        account(in, n);
+    }
+    return TRUE;
+}
+
+static gboolean fetch_chunk(Ingest *in, GFileIOStream *stream, guint index, guint8 *buf, GError **error) {
+    guint64 start = (guint64)index * in->chunk_size;
+    guint64 end = start + chunk_length(in, index);
+    if (!g_seekable_seek(G_SEEKABLE(stream), (goffset)start, G_SEEK_SET, in->cancellable, error))
+        return FALSE;
+    AVIOContext *io = open_range(in->url, start, end, in->cancellable, error);
+    if (!io)
+        return FALSE;
+    guint64 copied;
+    gboolean ok = copy_body(in, io, g_io_stream_get_output_stream(G_IO_STREAM(stream)), start, end, buf,
+                            &copied, error);
+    avio_closep(&io);
+    if (!ok)
+        account(in, -(gint64)copied);
+    return ok;
+}
+
+// Uma conexão: pega o próximo pedaço que falta até não sobrar nenhum
+static gpointer range_worker(gpointer data) {
+    Ingest *in = data;
+    GError *error = NULL;
+    set_active(in, 1);
+    GFileIOStream *stream = g_file_open_readwrite(in->part, in->cancellable, &error);
+    guint8 *buf = g_malloc(READ_SIZE);
+    guint index;
+    while (stream && claim_chunk(in, &index)) {
+        gboolean ok = FALSE;
+        // Rede instável: o mesmo pedaço tem mais algumas chances antes de desistir
+        for (guint attempt = 0; !ok && attempt < CHUNK_RETRIES; attempt++) {
+            if (attempt > 0) {
+                g_clear_error(&error);
+                g_usleep(RETRY_DELAY_US * attempt);
+            }
+            ok = fetch_chunk(in, stream, index, buf, &error);
+            if (g_cancellable_is_cancelled(in->cancellable))
+                break;
+        }
+        if (!ok)
+            break;
+        chunk_finished(in, index);
+    }
+    if (error)
+        ingest_fail(in, error);
+    g_free(buf);
+    if (stream) {
+        g_io_stream_close(G_IO_STREAM(stream), NULL, NULL);
+        g_object_unref(stream);
+    }
+    set_active(in, -1);
+    return NULL;
+}
+
+static gboolean download_ranges(Ingest *in, GError **error) {
+    in->chunk_size = MAX((guint64)CHUNK_MIN_SIZE, (in->total + INGEST_MAX_CHUNKS - 1) / INGEST_MAX_CHUNKS);
+    in->n_chunks = (guint)((in->total + in->chunk_size - 1) / in->chunk_size);
+    in->done = g_malloc0(bitmap_size(in));
+    in->resumed = state_load(in);
+
+    if (!in->resumed) {
+        // Já com o tamanho final: cada conexão grava direto na sua posição
+        GFileIOStream *s = g_file_replace_readwrite(in->part, NULL, FALSE, G_FILE_CREATE_NONE,
+                                                    in->cancellable, error);
+        if (!s)
+            return FALSE;
+        gboolean ok = g_seekable_truncate(G_SEEKABLE(s), (goffset)in->total, in->cancellable, error);
+        g_io_stream_close(G_IO_STREAM(s), NULL, NULL);
+        g_object_unref(s);
+        if (!ok)
+            return FALSE;
+        state_save(in);
+    }
+    in->reported_bytes = in->done_bytes;
+    in->perf_kib = in->done_bytes / 1024;
+
+    guint missing = 0;
+    for (guint i = 0; i < in->n_chunks; i++)
+        missing += !chunk_is_done(in, i);
+    guint n = MIN(connections, missing);
+    GThread **threads = g_new(GThread *, MAX(n, 1));
+    for (guint i = 0; i < n; i++)
+        threads[i] = g_thread_new("ingest", range_worker, in);
+    for (guint i = 0; i < n; i++)
+        g_thread_join(threads[i]);
+    g_free(threads);
+
+    g_mutex_lock(&in->lock);
+    state_save(in);
+    report(in, TRUE);
+    g_mutex_unlock(&in->lock);
+    if (in->error) {
+        g_propagate_error(error, g_steal_pointer(&in->error));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Servidor sem Range (ou sem tamanho): uma conexão, do começo, sem retomada
+static gboolean download_stream(Ingest *in, GError **error) {
+    g_remove(in->state_path);
+    GFileOutputStream *out = g_file_replace(in->part, NULL, FALSE, G_FILE_CREATE_NONE, in->cancellable, error);
+    if (!out)
+        return FALSE;
+    AVIOContext *io = open_range(in->url, 0, 0, in->cancellable, error);
+    gboolean ok = io != NULL;
+    if (ok) {
+        set_active(in, 1);
+        guint8 *buf = g_malloc(READ_SIZE);
+        guint64 copied;
+        ok = copy_body(in, io, G_OUTPUT_STREAM(out), 0, in->total, buf, &copied, error);
+        g_free(buf);
+        avio_closep(&io);
+        set_active(in, -1);
+    }
+    ok = g_output_stream_close(G_OUTPUT_STREAM(out), NULL, ok ? error : NULL) && ok;
+    g_object_unref(out);
+    return ok;
+}
+
+// Registro de "dest": de qual URL veio, com que tamanho e validador
+static void record_save(const char *dest, const Ingest *in) {
+    GKeyFile *kf = g_key_file_new();
+    g_key_file_set_string(kf, RECORD_GROUP, "url", in->url);
+    g_key_file_set_uint64(kf, RECORD_GROUP, "size", in->total);
+    g_key_file_set_string(kf, RECORD_GROUP, "validator", in->validator);
+    gchar *path = g_strconcat(dest, RECORD_SUFFIX, NULL);
+    g_key_file_save_to_file(kf, path, NULL);
+    g_free(path);
+    g_key_file_free(kf);
+}
+
+typedef enum {
+    RECORD_NONE,        // sem registro ou de outra URL: o arquivo não é deste download
+    RECORD_STALE,       // mesma URL, mas o remoto mudou (ou o registro não diz o tamanho)
+    RECORD_CURRENT,     // mesma URL, mesmo tamanho e validador
+} RecordMatch;
+
+static RecordMatch record_check(const char *dest, const Ingest *in) {
+    GKeyFile *kf = g_key_file_new();
+    gchar *path = g_strconcat(dest, RECORD_SUFFIX, NULL);
+    RecordMatch match = RECORD_NONE;
+    if (g_key_file_load_from_file(kf, path, G_KEY_FILE_NONE, NULL)) {
+        gchar *url = g_key_file_get_string(kf, RECORD_GROUP, "url", NULL);
+        gchar *validator = g_key_file_get_string(kf, RECORD_GROUP, "validator", NULL);
+        guint64 size = g_key_file_get_uint64(kf, RECORD_GROUP, "size", NULL);
+        if (g_strcmp0(url, in->url) == 0) {
+            GStatBuf st;
+            gboolean same = in->total > 0 && size == in->total && g_strcmp0(validator, in->validator) == 0 &&
+                            g_stat(dest, &st) == 0 && (guint64)st.st_size == in->total;
+            match = same ? RECORD_CURRENT : RECORD_STALE;
+        }
+        g_free(validator);
+        g_free(url);
+    }
+    g_free(path);
+    g_key_file_free(kf);
+    return match;
+}
+
+static void on_parent_cancelled(GCancellable *parent, gpointer user_data) {
+    (void)parent;
+    g_cancellable_cancel(user_data);
+}
+
+gboolean ingest_download(const char *url, const char *dest, GCancellable *cancellable,
+    IngestProgressFunc progress, gpointer user_data, GError **error) {
+    ingest_init();
+    gint64 t = trace_begin();
+    guint64 total;
+    gboolean ranges;
+    if (!probe(url, cancellable, &total, &ranges, error))
+        return FALSE;
+
+    gchar *validator = fetch_validator(url, cancellable);
+    if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        g_free(validator);
+        return FALSE;
+    }
+    Ingest in = { 0 };
+    in.url = url;
+    in.validator = validator;
+    in.total = total;
+    in.progress = progress;
+    in.user_data = user_data;
+    in.reported_time = g_get_monotonic_time();
+
+    // Baixado antes, inteiro e da mesma versão do remoto. Um arquivo que não é
+    // deste download (outra URL, ou sem registro) nunca é substituído.
+    RecordMatch match = record_check(dest, &in);
+    if (match == RECORD_CURRENT) {
+        in.done_bytes = in.reported_bytes = total;
+        in.perf_kib = total / 1024;
+        report(&in, TRUE);
+        g_free(validator);
+        return TRUE;
+    }
+    if (match == RECORD_NONE && g_file_test(dest, G_FILE_TEST_EXISTS)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS, "%s já existe e não veio de %s", dest, url);
+        g_free(validator);
+        return FALSE;
+    }
+
+    gchar *dir = g_path_get_dirname(dest);
+    int made = g_mkdir_with_parents(dir, 0755);
+    if (made != 0)
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "%s: %s", dir, g_strerror(errno));
+    g_free(dir);
+    if (made != 0) {
+        g_free(validator);
+        return FALSE;
+    }
+
+    in.part_path = g_strconcat(dest, ".part", NULL);
+    in.state_path = g_strconcat(dest, ".part.state", NULL);
+    in.part = g_file_new_for_path(in.part_path);
+    g_mutex_init(&in.lock);
+    in.cancellable = g_cancellable_new();
+    gulong handler = cancellable
+        ? g_cancellable_connect(cancellable, G_CALLBACK(on_parent_cancelled), in.cancellable, NULL) : 0;
+
+    gboolean ok = total > 0 && ranges ? download_ranges(&in, error) : download_stream(&in, error);
+    g_cancellable_disconnect(cancellable, handler);
+
+    // Só chega aqui com "dest" ausente ou baixado antes da mesma URL
+    if (ok) {
+        GFile *target = g_file_new_for_path(dest);
+        ok = g_file_move(in.part, target, match == RECORD_STALE ? G_FILE_COPY_OVERWRITE : G_FILE_COPY_NONE,
+                         NULL, NULL, NULL, error);
+        g_object_unref(target);
+    }
+    if (ok) {
+        record_save(dest, &in);
+        g_remove(in.state_path);
+    }
+
+    perf_counter_set(perf.connections, 0);
+    g_object_unref(in.cancellable);
+    g_mutex_clear(&in.lock);
+    g_object_unref(in.part);
+    g_free(in.done);
+    g_free(in.part_path);
+    g_free(in.state_path);
+    g_free(validator);
+    trace_end("ingest download", "ingest", t);
+    return ok;
+}
+
+gboolean ingest_is_direct_link(const char *url) {
+    static const char *const extensions[] = {
+        ".mp4", ".m4v", ".mov", ".mkv", ".webm", ".avi", ".ts", ".mts", ".m2ts",
+        ".flv", ".wmv", ".mpg", ".mpeg", ".ogv", ".3gp", NULL
+    };
+    GUri *uri = g_uri_parse(url, G_URI_FLAGS_NONE, NULL);
+    if (!uri)
+        return FALSE;
+    const char *scheme = g_uri_get_scheme(uri);
+    gboolean ok = FALSE;
+    if (g_ascii_strcasecmp(scheme, "http") == 0 || g_ascii_strcasecmp(scheme, "https") == 0) {
+        gchar *path = g_ascii_strdown(g_uri_get_path(uri), -1);
+        for (int i = 0; !ok && extensions[i]; i++)
+            ok = g_str_has_suffix(path, extensions[i]);
+        g_free(path);
+    }
+    g_uri_unref(uri);
+    return ok;
+}
+
+gchar *ingest_default_path(const char *url) {
+    GUri *uri = g_uri_parse(url, G_URI_FLAGS_NONE, NULL);
+    gchar *path = uri ? g_uri_unescape_string(g_uri_get_path(uri), NULL) : NULL;
+    gchar *name = path ? g_path_get_basename(path) : NULL;
+    if (!name || !*name || strcmp(name, "/") == 0 || strcmp(name, ".") == 0) {
+        g_free(name);
+        name = g_strdup("video");
+    }
+    // Nada que o sistema de arquivos não aceite num nome
+    g_strdelimit(name, "\\/:*?\"<>|", '_');
+
+    // URLs diferentes com o mesmo nome de arquivo não se misturam: um trecho do
+    // hash da URL entra antes da extensão
+    gchar *hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+    const char *dot = strrchr(name, '.');
+    gsize stem = dot && dot != name ? (gsize)(dot - name) : strlen(name);
+    gchar *unique = g_strdup_printf("%.*s-%.8s%s", (int)stem, name, hash, name + stem);
+    g_free(hash);
+
+    const char *downloads = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+    gchar *dest = g_build_filename(downloads ? downloads : g_get_home_dir(), "Zenoka", unique, NULL);
+    g_free(unique);
+    g_free(name);
+    g_free(path);
+    if (uri)
+        g_uri_unref(uri);
+    return dest;
+}
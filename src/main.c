@@ -1,23 +1,159 @@
 #include <gtk/gtk.h>
+#include <stdlib.h>
+#include <string.h>
 #include "splash.h"
 #include "main_window.h"
+#include "trace.h"
+#include "export.h"
+#include "render_mode.h"
+#include "media_cache.h"
+#include "cli_clip.h"
+#include "cli_fetch.h"
+#include "ingest.h"
+#include "proxy.h"
+
+static SplashScreen *splash = NULL;
+static GtkWidget *main_window = NULL;
+static gint splash_min_ms = SPLASH_DEFAULT_MIN_MS;
+static gint export_threads = 0;
+static gint download_connections = 0;
+static gint cache_mb = MEDIA_CACHE_DEFAULT_BUDGET / (1024 * 1024);
+static gint proxy_cache_mb = (gint)(MEDIA_CACHE_DEFAULT_FILE_BUDGET / (1024 * 1024));
+static gchar *render_mode_opt = NULL;
+static gboolean use_proxy = FALSE;
+static gboolean quit_after_first_frame = FALSE;
+static gint64 main_start_us = 0;
+
+static const GOptionEntry options[] = {
+    { "splash-min-ms", 0, 0, G_OPTION_ARG_INT, &splash_min_ms, "Tempo mínimo de exibição do splash (ms)", "MS" },
+    { "export-threads", 0, 0, G_OPTION_ARG_INT, &export_threads, "Threads da exportação paralela (0 = uma por núcleo)", "N" },
+    { "download-connections", 0, 0, G_OPTION_ARG_INT, &download_connections, "Conexões simultâneas ao baixar um link (0 = padrão)", "N" },
+    { "cache-mb", 0, 0, G_OPTION_ARG_INT, &cache_mb, "Espaço em disco do cache de análises (MB)", "MB" },
+    { "proxy-cache-mb", 0, 0, G_OPTION_ARG_INT, &proxy_cache_mb, "Espaço em disco dos proxies (MB)", "MB" },
+    { "render-mode", 0, 0, G_OPTION_ARG_STRING, &render_mode_opt, "Renderização: auto, full ou lite", "MODO" },
+    { "proxy", 0, 0, G_OPTION_ARG_NONE, &use_proxy, "Gera proxies leves para a prévia de vídeos pesados", NULL },
+    // Usada pelo "make bench" para medir a partida
+    { "quit-after-first-frame", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &quit_after_first_frame, NULL, NULL },
+    { NULL }
+};
+
+// Primeiro quadro da janela principal desenhado: fim da partida
+static void on_first_frame(GdkFrameClock *clock, gpointer user_data) {
+    (void)user_data;
+    g_signal_handlers_disconnect_by_func(clock, on_first_frame, NULL);
+    trace_end("startup (main -> first frame)", "startup", main_start_us);
+    trace_instant("first-frame", "startup");
+    if (quit_after_first_frame)
+        g_application_quit(g_application_get_default());
+}
 
 // Função callback que será chamada quando o splash terminar
 static void on_splash_finished(GtkApplication *app) {
-    // Cria a janela principal após o splash terminar
-    create_main_window(app);
+    (void)app;
+    // A janela principal já foi construída escondida enquanto o splash rodava
+    splash = NULL;
+    if (G_UNLIKELY(trace_enabled) || quit_after_first_frame)
+        g_signal_connect(gtk_widget_get_frame_clock(main_window), "after-paint", G_CALLBACK(on_first_frame), NULL);
+    gtk_window_present(GTK_WINDOW(main_window));
+}
+
+// Constrói a janela principal (escondida) assim que o splash já foi desenhado
+static gboolean build_main_window(gpointer user_data) {
+    GtkApplication *app = user_data;
+    main_window = create_main_window(app);
+    g_object_add_weak_pointer(G_OBJECT(main_window), (gpointer *)&main_window);
+    splash_screen_set_ready(splash);
+    return G_SOURCE_REMOVE;
 }
 
 // Função de ativação do aplicativo
 static void activate(GtkApplication *app, G_GNUC_UNUSED gpointer user_data) {
+    gint64 t = trace_begin();
+    if (main_window) {
+        gtk_window_present(GTK_WINDOW(main_window));
+        return;
+    }
+    if (splash)
+        return;
+
+    export_set_thread_budget((guint)MAX(export_threads, 0));
+    media_cache_set_budget((guint64)MAX(cache_mb, 0) * 1024 * 1024);
+    media_cache_set_file_budget((guint64)MAX(proxy_cache_mb, 0) * 1024 * 1024);
+    ingest_set_connections((guint)MAX(download_connections, 0));
+    proxy_set_enabled(use_proxy);
+    const char *mode_text = render_mode_opt ? render_mode_opt : g_getenv("ZENOKA_RENDER_MODE");
+    RenderMode mode;
+    if (mode_text && render_mode_parse(mode_text, &mode))
+        render_mode_set(mode);
+    else if (mode_text)
+        g_print("Modo de renderização desconhecido: %s\n", mode_text);
+
     // Inicia o splash screen, passando o callback para quando terminar
-    create_splash_screen(app, on_splash_finished);
+    splash = create_splash_screen(app, (guint)MAX(splash_min_ms, 0), on_splash_finished);
+    g_idle_add(build_main_window, app);
+    trace_end("activate", "startup", t);
+}
+
+// Remove --trace=ARQUIVO / --trace ARQUIVO do argv (precisa valer antes do GTK iniciar)
+static const char *take_trace_option(int *argc, char **argv) {
+    const char *path = NULL;
+    int out = 1;
+    for (int i = 1; i < *argc; i++) {
+        if (g_str_has_prefix(argv[i], "--trace="))
+            path = argv[i] + strlen("--trace=");
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < *argc)
+            path = argv[++i];
+        else
+            argv[out++] = argv[i];
+    }
+    *argc = out;
+    argv[out] = NULL;
+    return path;
 }
 
 int main(int argc, char **argv) {
+    const char *trace_path = take_trace_option(&argc, argv);
+    trace_init(trace_path ? trace_path : g_getenv("ZENOKA_TRACE"));
+    main_start_us = trace_begin();
+
+    // Modo sem interface: nada de GTK nem splash
+    if (argc > 1 && strcmp(argv[1], "clip") == 0) {
+        int status = cli_clip_main(argc - 1, argv + 1);
+        trace_shutdown();
+        return status;
+    }
+    if (argc > 1 && strcmp(argv[1], "fetch") == 0) {
+        int status = cli_fetch_main(argc - 1, argv + 1);
+        trace_shutdown();
+        return status;
+    }
+
+    const char *env_min = g_getenv("ZENOKA_SPLASH_MIN_MS");
+    if (env_min)
+        splash_min_ms = atoi(env_min);
+    const char *env_threads = g_getenv("ZENOKA_EXPORT_THREADS");
+    if (env_threads)
+        export_threads = atoi(env_threads);
+    const char *env_connections = g_getenv("ZENOKA_DOWNLOAD_CONNECTIONS");
+    if (env_connections)
+        download_connections = atoi(env_connections);
+    const char *env_cache = g_getenv("ZENOKA_CACHE_MB");
+    if (env_cache)
+        cache_mb = atoi(env_cache);
+    const char *env_proxy_cache = g_getenv("ZENOKA_PROXY_CACHE_MB");
+    if (env_proxy_cache)
+        proxy_cache_mb = atoi(env_proxy_cache);
+    const char *env_proxy = g_getenv("ZENOKA_PROXY");
+    if (env_proxy)
+        use_proxy = atoi(env_proxy) != 0;
+
     GtkApplication *app = gtk_application_new("com.example.videoeditor", G_APPLICATION_DEFAULT_FLAGS);
+    g_application_add_main_option_entries(G_APPLICATION(app), options);
     g_signal_connect(app, "activate", G_CALLBACK(activate), NULL);
     int status = g_application_run(G_APPLICATION(app), argc, argv);
     g_object_unref(app);
+
+    trace_end("main", "startup", main_start_us);
+    trace_shutdown();
     return status;
-}
\ No newline at end of file
+}
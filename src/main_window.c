@@ -1,8 +1,23 @@
 #include <gtk/gtk.h>
-#include <gdk/win32/gdkwin32.h>
-#include <windows.h>
 #include <string.h>
+#include <math.h>
 #include "main_window.h"
+#include "window_platform.h"
+#include "render_mode.h"
+#include "anim_cache.h"
+#include "anim_scheduler.h"
+#include "trace.h"
+#include "video_engine.h"
+#include "timecode.h"
+#include "export.h"
+#include "clip_list.h"
+#include "waveform.h"
+#include "video_filmstrip.h"
+#include "scene_detect.h"
+#include "proxy.h"
+#include "perf_hud.h"
+#include "ingest.h"
+#include "media_util.h"
 #include <regex.h>
 
 typedef struct {
@@ -11,6 +26,7 @@ typedef struct {
     GtkWidget *flip_button;
     GtkWidget *flip_button_container;
     GtkWidget *title_bar;
+    GtkWidget *title_handle;    // envolve a titlebar: arrasto e duplo clique pelo GTK
     GtkWidget *minimize_button;
     GtkWidget *maximize_button;
     GtkWidget *close_button;
@@ -21,12 +37,47 @@ typedef struct {
     GtkWidget *title_section;
     GtkWidget *link_bar;
     GtkWidget *link_entry;
+    GtkWidget *download_label;  // progresso e vazão do download do link
+    GCancellable *download_cancellable;
     GtkWidget *player_container;
     GtkWidget *player_frame;
     GtkWidget *time_start_entry;
     GtkWidget *time_end_entry;
     GtkWidget *export_button;
+    GtkWidget *export_progress;
+    GtkWidget *export_preset;
+    GtkWidget *chunk_strip;
+    GtkWidget *stage_label;     // vazão e filas dos estágios da recodificação
+    guint stage_stats_id;
+    struct _ExportTask *export_task;
+    GCancellable *export_cancellable;
+    gchar *video_path;
+    ClipList *clips;
+    GtkWidget *add_clip_button;
+    GtkWidget *clip_count_label;
+    GtkWidget *video_picture;
+    GtkWidget *waveform_area;
+    Waveform *waveform;
+    GCancellable *source_cancellable;   // trabalho em segundo plano da fonte atual
+    GCancellable *dialog_cancellable;   // diálogos de arquivo abertos; cancelados ao fechar a janela
+    GtkWidget *filmstrip;
+    GtkWidget *scene_strip;
+    GArray *scene_cuts;         // SceneCut em ordem; cresce enquanto a detecção roda
+    double scene_progress;
+    gint64 scene_start_us;      // cena escolhida na faixa (fim exclusivo)
+    gint64 scene_end_us;
+    gint64 timeline_start_us;   // trecho visível nas faixas de miniaturas e de forma de onda
+    gint64 timeline_end_us;
+    double timeline_pointer_x;
+    double scrub_start_x;
+    GtkWidget *play_button;
+    GtkWidget *play_image;
+    GtkWidget *mute_button;
+    GtkWidget *mute_image;
+    GtkWidget *volume_scale;
     gboolean player_view_active;
+    VideoEngine *engine;
+    GtkWidget *perf_hud;        // painel de desempenho (Ctrl+Shift+P)
 
     GtkWidget *flip_gif;
     GtkWidget *minimize_gif;
@@ -35,43 +86,6 @@ typedef struct {
     GtkWidget *unflip_gif;
 } MainWindow;
 
-typedef struct {
-    GdkPixbufAnimationIter *iter;
-    GtkWidget *image;
-    GdkPaintable *paintable;
-} AnimationData;
-
-static gboolean window_dragging = FALSE;
-static int drag_start_x = 0;
-static int drag_start_y = 0;
-static POINT initial_cursor_pos = {0, 0};
-
-
-static gboolean animation_timeout(AnimationData *data) {
-    if (!data || !data->iter || !data->image)
-        return G_SOURCE_REMOVE;
-
-    if (gdk_pixbuf_animation_iter_advance(data->iter, NULL)) {
-        GdkPixbuf *frame = gdk_pixbuf_animation_iter_get_pixbuf(data->iter);
-        if (data->paintable)
-            g_object_unref(data->paintable);
-        data->paintable = GDK_PAINTABLE(gdk_texture_new_for_pixbuf(frame));
-        gtk_image_set_from_paintable(GTK_IMAGE(data->image), data->paintable);
-    }
-
-    return G_SOURCE_CONTINUE;
-}
-
-static void free_animation_data(gpointer user_data) {
-    AnimationData *data = (AnimationData *)user_data;
-    if (data) {
-        if (data->iter)
-            g_object_unref(data->iter);
-        if (data->paintable)
-            g_object_unref(data->paintable);
-        g_free(data);
-    }
-}
 
 static gboolean on_unflip_done(gpointer data) {
     MainWindow *m = data;
@@ -102,11 +116,11 @@ static void on_flip_button_clicked(GtkButton *button, MainWindow *m) {
 
 static void on_unflip_button_clicked(GtkButton *button, MainWindow *m) {
     (void)button;
-    window_dragging = FALSE;
     flip_titlebar(m, FALSE);
 }
 
 static void setup_glassmorphism() {
+    gint64 t = trace_begin();
     GtkCssProvider *p = gtk_css_provider_new();
     gtk_css_provider_load_from_string(p,
         "#glass-background { background-color: rgba(0, 0, 0, 0.93); }"
@@ -130,6 +144,7 @@ static void setup_glassmorphism() {
         ".link-entry { background-color:rgb(140, 82, 255); color: black; border-radius: 12px; padding: 6px 10px; border: none; }"
         "entry.link-entry placeholder { color: white; opacity: 0.7; }"
         "#player-frame { background-color: #8c52ff; border-radius: 10px; }"
+        "#player-frame picture { background-color: black; border-radius: 10px; }"
     );
     gtk_style_context_add_provider_for_display(
         gdk_display_get_default(),
@@ -137,77 +152,73 @@ static void setup_glassmorphism() {
         GTK_STYLE_PROVIDER_PRIORITY_APPLICATION
     );
     g_object_unref(p);
+    trace_end("setup_glassmorphism", "startup", t);
 }
-static void center_window_on_monitor(GtkWidget *widget) {
-    const int win_w = 1200, win_h = 800;
-    GdkSurface *surface = gtk_native_get_surface(GTK_NATIVE(widget));
-    HWND hwnd = gdk_win32_surface_get_handle(surface);
-    MONITORINFO mi;
-    memset(&mi, 0, sizeof(mi)); mi.cbSize = sizeof(mi);
-    HMONITOR hmon = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
-    GetMonitorInfo(hmon, &mi);
-    int x = mi.rcWork.left + (mi.rcWork.right - mi.rcWork.left - win_w) / 2;
-    int y = mi.rcWork.top  + (mi.rcWork.bottom - mi.rcWork.top - win_h) / 2;
-    SetWindowPos(hwnd, NULL, x, y, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+// Ctrl+Shift+R alterna o modo de renderização: automático -> leve -> completo
+static gboolean on_cycle_render_mode(GtkWidget *widget, GVariant *args, gpointer user_data) {
+    (void)widget; (void)args; (void)user_data;
+    static const RenderMode next_mode[] = {
+        [RENDER_MODE_AUTO] = RENDER_MODE_LITE,
+        [RENDER_MODE_LITE] = RENDER_MODE_FULL,
+        [RENDER_MODE_FULL] = RENDER_MODE_AUTO,
+    };
+    RenderMode next = next_mode[render_mode_get()];
+    render_mode_set(next);
+    g_print("Modo de renderização: %s\n", render_mode_to_string(next));
+    return TRUE;
+}
+
+// Ctrl+Shift+P mostra ou esconde o painel de desempenho
+static gboolean on_toggle_perf_hud(GtkWidget *widget, GVariant *args, gpointer user_data) {
+    (void)widget; (void)args;
+    MainWindow *m = user_data;
+    perf_hud_toggle(m->perf_hud);
+    return TRUE;
 }
 
 static void on_window_map(GtkWidget *widget, gpointer data) {
     (void)data;
-    center_window_on_monitor(widget);
+    window_platform_center(widget, 1200, 800);
 }
 
 static void on_window_closed(GtkWindow *window, gpointer user_data) {
     (void)window;
     MainWindow *m = user_data;
-    g_free(m);
-}
-
-static gboolean on_drag_handle_button_press(GtkGestureClick *gesture, int n_press,
-    double x, double y, GtkWidget *window) {
-    (void)gesture; (void)x; (void)y;
-    if (n_press == 1) {
-        window_dragging = TRUE;
-        GetCursorPos(&initial_cursor_pos);
-        GdkSurface *s = gtk_native_get_surface(GTK_NATIVE(window));
-        HWND hwnd = gdk_win32_surface_get_handle(s);
-        RECT r; GetWindowRect(hwnd, &r);
-        drag_start_x = initial_cursor_pos.x - r.left;
-        drag_start_y = initial_cursor_pos.y - r.top;
-        return TRUE;
+    video_engine_set_state_func(m->engine, NULL, NULL);
+    video_engine_free(m->engine);
+    // Exportação em andamento é cancelada e não volta a mexer na janela
+    if (m->stage_stats_id)
+        g_source_remove(m->stage_stats_id);
+    if (m->export_cancellable) {
+        g_cancellable_cancel(m->export_cancellable);
+        g_object_unref(m->export_cancellable);
     }
-return FALSE;
-}
-
-static gboolean on_drag_handle_button_release(GtkGestureClick *gesture, int n_press,
-    double x, double y, GtkWidget *window) {
-    (void)gesture; (void)n_press; (void)x; (void)y; (void)window;
-    window_dragging = FALSE;
-    return TRUE;
-}
-
-static gboolean on_window_motion_notify(GtkEventControllerMotion *controller,
-    double x, double y, GtkWidget *window) {
-    (void)controller; (void)x; (void)y;
-    if (window_dragging) {
-        POINT p; GetCursorPos(&p);
-        GdkSurface *s = gtk_native_get_surface(GTK_NATIVE(window));
-        HWND hwnd = gdk_win32_surface_get_handle(s);
-        SetWindowPos(hwnd, NULL, p.x - drag_start_x, p.y - drag_start_y,
-        0, 0, SWP_NOSIZE | SWP_NOZORDER);
-        return TRUE;
+    if (m->source_cancellable) {
+        g_cancellable_cancel(m->source_cancellable);
+        g_object_unref(m->source_cancellable);
+    }
+    // Um diálogo ainda aberto volta cancelado e não chega a usar a janela
+    g_cancellable_cancel(m->dialog_cancellable);
+    g_object_unref(m->dialog_cancellable);
+    // O que já veio fica no .part para a próxima vez
+    if (m->download_cancellable) {
+        g_cancellable_cancel(m->download_cancellable);
+        g_object_unref(m->download_cancellable);
     }
-return FALSE;
+    waveform_free(m->waveform);
+    g_clear_pointer(&m->scene_cuts, g_array_unref);
+    g_free(m->video_path);
+    clip_list_free(m->clips);
+    g_free(m);
 }
 
 static void on_minimize_clicked(GtkButton *button, GtkWindow *window) {
     (void)button;
-    window_dragging = FALSE;
     gtk_window_minimize(window);
 }
 
 static void on_maximize_clicked(GtkButton *button, GtkWindow *window) {
     (void)button;
-    window_dragging = FALSE;
     if (gtk_window_is_maximized(window)) gtk_window_unmaximize(window);
     else gtk_window_maximize(window);
 }
@@ -229,7 +240,7 @@ static GtkWidget *create_styled_button(const char *icon_name, const char *css_cl
 }
 
 static GtkWidget *create_button_with_image(const char *icon_name, const char *css_class,
-    const char *image_path, int width, int height) {
+    const char *image_name, int width, int height) {
     GtkWidget *button = gtk_button_new();
     gtk_widget_add_css_class(button, "control-button");
     if (css_class)
@@ -241,76 +252,89 @@ static GtkWidget *create_button_with_image(const char *icon_name, const char *cs
     gtk_widget_set_size_request(invisible_icon, width, height);
     gtk_overlay_set_child(GTK_OVERLAY(overlay), invisible_icon);
 
-    if (image_path && g_file_test(image_path, G_FILE_TEST_EXISTS)) {
-        const char *ext = strrchr(image_path, '.');
-
-    if (ext && g_ascii_strcasecmp(ext, ".gif") == 0) {
-        GdkPixbufAnimation *animation = gdk_pixbuf_animation_new_from_file(image_path, NULL);
-        if (animation) {
-            GdkPixbufAnimationIter *iter = gdk_pixbuf_animation_get_iter(animation, NULL);
-            GdkPixbuf *frame = gdk_pixbuf_animation_iter_get_pixbuf(iter);
-            GdkPaintable *paintable = GDK_PAINTABLE(gdk_texture_new_for_pixbuf(frame));
-            GtkWidget *gif_image = gtk_image_new_from_paintable(paintable);
-            gtk_widget_set_size_request(gif_image, width, height);
-            gtk_overlay_add_overlay(GTK_OVERLAY(overlay), gif_image);
-            gtk_widget_set_halign(gif_image, GTK_ALIGN_CENTER);
-            gtk_widget_set_valign(gif_image, GTK_ALIGN_CENTER);
-
-            AnimationData *data = g_new0(AnimationData, 1);
-            data->iter = iter;
-            data->image = gif_image;
-            data->paintable = paintable;
-
-            g_timeout_add_full(G_PRIORITY_DEFAULT,
-            gdk_pixbuf_animation_iter_get_delay_time(iter),
-            (GSourceFunc)animation_timeout,
-            data,
-            free_animation_data);
-            g_object_unref(animation);
+    AnimFrames *anim = NULL;
+    if (image_name) {
+        GError *error = NULL;
+        gint64 t = trace_begin();
+        anim = anim_cache_get_asset(image_name, width, height, &error);
+        trace_end(image_name, "asset", t);
+        if (!anim) {
+            g_print("Imagem não encontrada: %s (%s)\n", image_name, error->message);
+            g_clear_error(&error);
         }
-    } else {
-        GtkWidget *static_image = gtk_image_new_from_file(image_path);
-        gtk_widget_set_size_request(static_image, width, height);
-        gtk_overlay_add_overlay(GTK_OVERLAY(overlay), static_image);
-        gtk_widget_set_halign(static_image, GTK_ALIGN_CENTER);
-        gtk_widget_set_valign(static_image, GTK_ALIGN_CENTER);
     }
+
+    if (anim) {
+        GtkWidget *gif_image = gtk_image_new_from_paintable(GDK_PAINTABLE(anim->frames[0]));
+        gtk_widget_set_size_request(gif_image, width, height);
+        gtk_overlay_add_overlay(GTK_OVERLAY(overlay), gif_image);
+        gtk_widget_set_halign(gif_image, GTK_ALIGN_CENTER);
+        gtk_widget_set_valign(gif_image, GTK_ALIGN_CENTER);
+
+        if (anim_frames_is_animated(anim))
+            anim_scheduler_add(gif_image, anim);
+        anim_frames_unref(anim);
     } else {
         GtkWidget *fallback_icon = gtk_image_new_from_icon_name(icon_name);
         gtk_widget_set_size_request(fallback_icon, width, height);
         gtk_overlay_add_overlay(GTK_OVERLAY(overlay), fallback_icon);
         gtk_widget_set_halign(fallback_icon, GTK_ALIGN_CENTER);
         gtk_widget_set_valign(fallback_icon, GTK_ALIGN_CENTER);
-        if (image_path)
-            g_print("Imagem não encontrada: %s\n", image_path);
     }
 
     gtk_button_set_child(GTK_BUTTON(button), overlay);
     return button;
 }
 
+static GtkWidget *create_image_from_asset(const char *image_name, int width, int height) {
+    GError *error = NULL;
+    AnimFrames *anim = anim_cache_get_asset(image_name, width, height, &error);
+    if (!anim) {
+        g_print("Imagem não encontrada: %s (%s)\n", image_name, error->message);
+        g_clear_error(&error);
+        return gtk_image_new_from_icon_name("image-missing");
+    }
+    GtkWidget *image = gtk_image_new_from_paintable(GDK_PAINTABLE(anim->frames[0]));
+    anim_frames_unref(anim);
+    return image;
+}
+
+static void set_image_asset(GtkWidget *image, const char *image_name, int width, int height) {
+    AnimFrames *anim = anim_cache_get_asset(image_name, width, height, NULL);
+    if (anim) {
+        gtk_image_set_from_paintable(GTK_IMAGE(image), GDK_PAINTABLE(anim->frames[0]));
+        anim_frames_unref(anim);
+    }
+}
+
 static void setup_titlebar(MainWindow *m) {
+    gint64 t = trace_begin();
     m->flip_button_container = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
     gtk_widget_set_halign(m->flip_button_container, GTK_ALIGN_CENTER);
     gtk_widget_set_valign(m->flip_button_container, GTK_ALIGN_START);
     gtk_widget_set_margin_top(m->flip_button_container, 5);
 
-    m->flip_button = create_button_with_image("view-more-symbolic", "flip-button", "G:/video_clipper/icons/flip_icon.gif", 10, 10);
+    m->flip_button = create_button_with_image("view-more-symbolic", "flip-button", "flip_icon.gif", 10, 10);
     gtk_box_append(GTK_BOX(m->flip_button_container), m->flip_button);
 
     m->title_bar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
     gtk_widget_add_css_class(m->title_bar, "titlebar-container");
     gtk_widget_set_visible(m->title_bar, FALSE);
     gtk_widget_set_size_request(m->title_bar, 250, 36);
-    gtk_widget_set_halign(m->title_bar, GTK_ALIGN_CENTER);
-    gtk_widget_set_valign(m->title_bar, GTK_ALIGN_START);
-    gtk_widget_set_margin_top(m->title_bar, 5);
-    gtk_widget_set_margin_bottom(m->title_bar, 10);
 
-    m->minimize_button = create_button_with_image("window-minimize-symbolic", "minimize-button", "G:/video_clipper/icons/minimize_icon.gif", 20, 20);
-    m->maximize_button = create_button_with_image("window-maximize-symbolic", "maximize-button", "G:/video_clipper/icons/maximize_icon.gif", 20, 20);
-    m->close_button = create_button_with_image("window-close-symbolic", "close-button", "G:/video_clipper/icons/close_icon.gif", 25, 25);
-    m->unflip_button = create_button_with_image("go-up-symbolic", "unflip-button", "G:/video_clipper/icons/unflip_icon.gif", 10, 10);
+    // O GtkWindowHandle só começa o arrasto (pelo compositor) depois do limiar de
+    // movimento e deixa os cliques nos botões passarem; duplo clique maximiza
+    m->title_handle = gtk_window_handle_new();
+    gtk_window_handle_set_child(GTK_WINDOW_HANDLE(m->title_handle), m->title_bar);
+    gtk_widget_set_halign(m->title_handle, GTK_ALIGN_CENTER);
+    gtk_widget_set_valign(m->title_handle, GTK_ALIGN_START);
+    gtk_widget_set_margin_top(m->title_handle, 5);
+    gtk_widget_set_margin_bottom(m->title_handle, 10);
+
+    m->minimize_button = create_button_with_image("window-minimize-symbolic", "minimize-button", "minimize_icon.gif", 20, 20);
+    m->maximize_button = create_button_with_image("window-maximize-symbolic", "maximize-button", "maximize_icon.gif", 20, 20);
+    m->close_button = create_button_with_image("window-close-symbolic", "close-button", "close_icon.gif", 25, 25);
+    m->unflip_button = create_button_with_image("go-up-symbolic", "unflip-button", "unflip_icon.gif", 10, 10);
 
     // Criamos três seções (esquerda, centro, direita)
     GtkWidget *left_section = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
@@ -345,17 +369,6 @@ static void setup_titlebar(MainWindow *m) {
     gtk_box_append(GTK_BOX(m->title_bar), center_section);
     gtk_box_append(GTK_BOX(m->title_bar), right_section);
 
-    // Configuramos o controle de movimento para a janela
-    GtkEventController *motion = gtk_event_controller_motion_new();
-    g_signal_connect(motion, "motion", G_CALLBACK(on_window_motion_notify), m->window);
-    gtk_widget_add_controller(m->window, motion);
-
-    // Adicionamos o gesto de clique para a titlebar inteira
-    GtkGesture *drag = gtk_gesture_click_new();
-    g_signal_connect(drag, "pressed", G_CALLBACK(on_drag_handle_button_press), m->window);
-    g_signal_connect(drag, "released", G_CALLBACK(on_drag_handle_button_release), m->window);
-    gtk_widget_add_controller(m->title_bar, GTK_EVENT_CONTROLLER(drag));
-
     // Conectamos os sinais dos botões
     g_signal_connect(m->flip_button, "clicked", G_CALLBACK(on_flip_button_clicked), m);
     g_signal_connect(m->unflip_button, "clicked", G_CALLBACK(on_unflip_button_clicked), m);
@@ -364,6 +377,7 @@ static void setup_titlebar(MainWindow *m) {
     g_signal_connect(m->close_button, "clicked", G_CALLBACK(on_close_clicked), m->window);
 
     m->titlebar_flipped = FALSE;
+    trace_end("setup_titlebar", "startup", t);
 }
 
 static void open_link(GtkGestureClick *gesture, int n_press, double x, double y, gpointer user_data) {
@@ -385,14 +399,849 @@ static gboolean is_valid_link(const char *url) {
             strstr(url, "x.com"));
 }
 
-static void on_link_submitted(GtkWidget *widget, gpointer user_data) {
-    MainWindow *m = (MainWindow *)user_data;
-    const char *url = gtk_editable_get_text(GTK_EDITABLE(m->link_entry));
+static void on_engine_state(VideoEngine *e, gpointer user_data) {
+    MainWindow *m = user_data;
+    set_image_asset(m->play_image, video_engine_is_playing(e) ? "Pause.png" : "Play.png", 30, 30);
+    render_mode_set_playing(video_engine_is_playing(e));
+}
 
-    if (!is_valid_link(url)) {
-        g_print("Link inválido: %s\n", url);
+static void on_play_clicked(GtkButton *button, MainWindow *m) {
+    (void)button;
+    if (video_engine_is_playing(m->engine))
+        video_engine_pause(m->engine);
+    else
+        video_engine_play(m->engine);
+}
+
+static void update_mute_image(MainWindow *m) {
+    set_image_asset(m->mute_image, video_engine_is_muted(m->engine) ? "Sound_mute.gif" : "Sound.gif", 30, 30);
+}
+
+static void on_mute_clicked(GtkButton *button, MainWindow *m) {
+    (void)button;
+    video_engine_set_muted(m->engine, !video_engine_is_muted(m->engine));
+    update_mute_image(m);
+}
+
+static void on_volume_changed(GtkRange *range, MainWindow *m) {
+    video_engine_set_volume(m->engine, gtk_range_get_value(range));
+    // Mexer no volume tira do mudo
+    if (video_engine_is_muted(m->engine)) {
+        video_engine_set_muted(m->engine, FALSE);
+        update_mute_image(m);
+    }
+}
+
+// Leva o player ao timecode digitado (ponto de entrada ou de saída do corte)
+static void seek_to_entry(MainWindow *m, GtkWidget *entry) {
+    if (!video_engine_is_open(m->engine))
+        return;
+    const char *text = gtk_editable_get_text(GTK_EDITABLE(entry));
+    double fps = video_engine_get_frame_rate(m->engine);
+    gint64 us;
+    if (*text == '\0' || !timecode_parse(text, fps, &us)) {
+        if (*text)
+            g_print("Timecode inválido: %s\n", text);
+        return;
+    }
+
+    gint64 t = trace_begin();
+    video_engine_seek(m->engine, us);
+    char normalized[32];
+    timecode_format(us, fps, normalized, sizeof(normalized));
+    if (strcmp(normalized, text) != 0)
+        gtk_editable_set_text(GTK_EDITABLE(entry), normalized);
+    trace_end("seek to timecode", "ui", t);
+}
+
+static void on_time_entry_activate(GtkEntry *entry, MainWindow *m) {
+    seek_to_entry(m, GTK_WIDGET(entry));
+}
+
+static void on_time_entry_focus(GtkEventControllerFocus *controller, MainWindow *m) {
+    seek_to_entry(m, gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(controller)));
+}
+
+static void connect_time_entry(MainWindow *m, GtkWidget *entry) {
+    g_signal_connect(entry, "activate", G_CALLBACK(on_time_entry_activate), m);
+    // Voltar ao campo também mostra o quadro daquele ponto
+    GtkEventController *focus = gtk_event_controller_focus_new();
+    g_signal_connect(focus, "enter", G_CALLBACK(on_time_entry_focus), m);
+    gtk_widget_add_controller(entry, focus);
+}
+
+// Lê o trecho dos campos de tempo: início vazio = começo do vídeo, fim vazio = final
+static gboolean read_clip_range(MainWindow *m, gint64 *start_us, gint64 *end_us) {
+    double fps = video_engine_get_frame_rate(m->engine);
+    const char *start = gtk_editable_get_text(GTK_EDITABLE(m->time_start_entry));
+    const char *end = gtk_editable_get_text(GTK_EDITABLE(m->time_end_entry));
+
+    *start_us = 0;
+    *end_us = video_engine_get_duration_us(m->engine);
+    if ((*start && !timecode_parse(start, fps, start_us)) || (*end && !timecode_parse(end, fps, end_us))) {
+        g_print("Timecode inválido\n");
+        return FALSE;
+    }
+    if (*end_us <= *start_us) {
+        g_print("O fim do corte precisa vir depois do início\n");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Predefinições do seletor ao lado do botão de exportar; "Original" usa smart cut
+static const char *const export_presets[] = { "Original", "1080p", "720p", "480p", "GIF", NULL };
+static const int export_preset_heights[] = { 0, 1080, 720, 480, 320 };
+#define EXPORT_PRESET_GIF 4
+
+typedef struct _ExportTask {
+    gchar *input;
+    gchar *output;
+    gint64 start_us;
+    gint64 end_us;
+    int max_height;             // 0 = smart cut, senão recodifica em paralelo
+    gboolean gif;               // GIF animado com altura max_height
+    GArray *batch;              // ClipRange; lote de cortes (NULL = só start/end)
+    gchar **batch_outputs;
+    guint batch_done;           // lote de GIFs: cortes já gravados
+    GtkWidget *progress_bar;
+    GtkWidget *chunk_strip;
+    ExportPipelineStats stats;  // preenchido pelos estágios da recodificação
+    gint stats_done[EXPORT_N_STAGES];   // leitura anterior, para a vazão
+    gint64 stats_time;
+    gint permille;
+    gint n_chunks;
+    gint chunk_permille[EXPORT_MAX_CHUNKS];
+    gint update_pending;
+} ExportTask;
+
+static void export_task_clear(gpointer data) {
+    ExportTask *et = data;
+    g_free(et->input);
+    g_free(et->output);
+    if (et->batch)
+        g_array_unref(et->batch);
+    g_strfreev(et->batch_outputs);
+    g_object_unref(et->progress_bar);
+    g_object_unref(et->chunk_strip);
+}
+
+static void export_task_release(gpointer data) {
+    g_rc_box_release_full(data, export_task_clear);
+}
+
+static gboolean on_export_progress_idle(gpointer data) {
+    ExportTask *et = data;
+    g_atomic_int_set(&et->update_pending, 0);
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(et->progress_bar), g_atomic_int_get(&et->permille) / 1000.0);
+    if (g_atomic_int_get(&et->n_chunks) > 0) {
+        gtk_widget_set_visible(et->chunk_strip, TRUE);
+        gtk_widget_queue_draw(et->chunk_strip);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+// Thread de exportação: guarda o valor e agenda no máximo uma atualização por vez
+static void schedule_progress_update(ExportTask *et) {
+    if (g_atomic_int_compare_and_exchange(&et->update_pending, 0, 1))
+        g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_export_progress_idle, g_rc_box_acquire(et), export_task_release);
+}
+
+static void on_export_progress(double fraction, gpointer user_data) {
+    ExportTask *et = user_data;
+    // Lote de GIFs: um arquivo de cada vez, a barra cobre o lote inteiro
+    if (et->batch && et->gif)
+        fraction = (et->batch_done + fraction) / et->batch->len;
+    g_atomic_int_set(&et->permille, (int)(fraction * 1000));
+    schedule_progress_update(et);
+}
+
+// Exportação paralela: cada trecho tem sua barra; a barra geral mostra a média
+static void on_export_chunk_progress(guint chunk, guint n_chunks, double fraction, gpointer user_data) {
+    ExportTask *et = user_data;
+    n_chunks = MIN(n_chunks, EXPORT_MAX_CHUNKS);
+    if (chunk >= n_chunks)
+        return;
+    g_atomic_int_set(&et->n_chunks, (gint)n_chunks);
+    g_atomic_int_set(&et->chunk_permille[chunk], (int)(fraction * 1000));
+
+    gint total = 0;
+    for (guint i = 0; i < n_chunks; i++)
+        total += g_atomic_int_get(&et->chunk_permille[i]);
+    g_atomic_int_set(&et->permille, total / (gint)n_chunks);
+    schedule_progress_update(et);
+}
+
+static void draw_chunk_strip(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer user_data) {
+    (void)area;
+    MainWindow *m = user_data;
+    ExportTask *et = m->export_task;
+    guint n = et ? (guint)g_atomic_int_get(&et->n_chunks) : 0;
+    if (n == 0)
+        return;
+
+    double w = (double)width / n;
+    for (guint i = 0; i < n; i++) {
+        double f = g_atomic_int_get(&et->chunk_permille[i]) / 1000.0;
+        cairo_set_source_rgba(cr, 1, 1, 1, 0.15);
+        cairo_rectangle(cr, i * w + 1, 0, MAX(w - 2, 1), height);
+        cairo_fill(cr);
+        cairo_set_source_rgb(cr, 140 / 255.0, 82 / 255.0, 1.0);
+        cairo_rectangle(cr, i * w + 1, height * (1 - f), MAX(w - 2, 1), height * f);
+        cairo_fill(cr);
+    }
+}
+
+static const char *const stage_names[EXPORT_N_STAGES] = { "demux", "decode", "escala", "encode", "mux" };
+
+// A cada meio segundo: vazão de cada estágio e ocupação da fila de entrada. O
+// gargalo é o estágio mais adiante no pipeline cuja fila de entrada está cheia
+// (tudo antes dele também enche); sem fila cheia, quem limita é a leitura.
+static gboolean on_stage_stats_tick(gpointer data) {
+    MainWindow *m = data;
+    ExportTask *et = m->export_task;
+    if (!et)
+        return G_SOURCE_CONTINUE;
+    ExportPipelineStats *st = &et->stats;
+    gint64 now = g_get_monotonic_time();
+    double dt = MAX(now - et->stats_time, 1) / (double)G_USEC_PER_SEC;
+    et->stats_time = now;
+
+    double rate[EXPORT_N_STAGES];
+    GString *tip = g_string_new(NULL);
+    ExportStage bottleneck = EXPORT_STAGE_DEMUX;
+    for (int i = 0; i < EXPORT_N_STAGES; i++) {
+        gint done = g_atomic_int_get(&st->done[i]);
+        gint queued = MAX(g_atomic_int_get(&st->queued[i]), 0);
+        gint capacity = g_atomic_int_get(&st->capacity[i]);
+        rate[i] = (done - et->stats_done[i]) / dt;
+        et->stats_done[i] = done;
+        g_string_append_printf(tip, "%s%-7s %6.0f/s", i ? "\n" : "", stage_names[i], rate[i]);
+        if (capacity > 0) {
+            g_string_append_printf(tip, "  fila %d/%d", queued, capacity);
+            if (queued * 4 >= capacity * 3)
+                bottleneck = (ExportStage)i;
+        }
+    }
+    gchar *text = g_strdup_printf("Gargalo: %s (%.0f q/s)", stage_names[bottleneck], rate[EXPORT_STAGE_ENCODE]);
+    gtk_label_set_text(GTK_LABEL(m->stage_label), text);
+    gtk_widget_set_tooltip_text(m->stage_label, tip->str);
+    gtk_widget_set_visible(m->stage_label, TRUE);
+    g_free(text);
+    g_string_free(tip, TRUE);
+    return G_SOURCE_CONTINUE;
+}
+
+static void export_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)source;
+    ExportTask *et = task_data;
+    ExportJob job = { et->input, et->output, et->start_us, et->end_us };
+    GError *error = NULL;
+    gboolean ok;
+    if (et->batch && et->gif) {
+        // GIF não passa pelo lote de smart cut: um export_gif por corte, na ordem
+        GifOptions opts = { .max_height = et->max_height };
+        ok = TRUE;
+        for (et->batch_done = 0; ok && et->batch_done < et->batch->len; et->batch_done++) {
+            const ClipRange *c = &g_array_index(et->batch, ClipRange, et->batch_done);
+            ExportJob clip = { et->input, et->batch_outputs[et->batch_done], c->start_us, c->end_us };
+            ok = export_gif(&clip, &opts, cancellable, on_export_progress, et, &error);
+        }
+    } else if (et->batch) {
+        ExportJob *jobs = g_new0(ExportJob, et->batch->len);
+        for (guint i = 0; i < et->batch->len; i++) {
+            const ClipRange *c = &g_array_index(et->batch, ClipRange, i);
+            jobs[i] = (ExportJob){ et->input, et->batch_outputs[i], c->start_us, c->end_us };
+        }
+        ok = export_batch(jobs, et->batch->len, cancellable, on_export_progress, et, &error);
+        g_free(jobs);
+    } else if (et->gif) {
+        GifOptions opts = { .max_height = et->max_height };
+        ok = export_gif(&job, &opts, cancellable, on_export_progress, et, &error);
+    } else if (et->max_height == 0) {
+        ok = export_smart_cut(&job, cancellable, on_export_progress, et, &error);
+    } else {
+        TranscodeOptions opts = { .max_height = et->max_height, .stats = &et->stats };
+        ok = export_transcode_parallel(&job, &opts, cancellable, on_export_chunk_progress, et, &error);
+    }
+    if (ok)
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, error);
+}
+
+static void on_export_done(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)source;
+    GTask *task = G_TASK(result);
+    // Cancelada ao fechar a janela: MainWindow já não existe
+    if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+        return;
+
+    MainWindow *m = user_data;
+    ExportTask *et = g_task_get_task_data(task);
+    GError *error = NULL;
+    if (g_task_propagate_boolean(task, &error) && et->batch) {
+        g_print("Exportados %u cortes\n", et->batch->len);
+        // Outra fonte aberta durante o lote: a lista atual é dela, fica como está
+        if (g_strcmp0(et->input, m->video_path) == 0) {
+            clip_list_clear(m->clips);
+            gtk_label_set_text(GTK_LABEL(m->clip_count_label), "");
+        }
+    } else if (!error)
+        g_print("Exportado: %s\n", et->output);
+    else
+        g_print("Falha ao exportar: %s\n", error->message);
+    g_clear_error(&error);
+
+    g_clear_object(&m->export_cancellable);
+    m->export_task = NULL;
+    if (m->stage_stats_id) {
+        g_source_remove(m->stage_stats_id);
+        m->stage_stats_id = 0;
+    }
+    gtk_widget_set_visible(m->export_progress, FALSE);
+    gtk_widget_set_visible(m->chunk_strip, FALSE);
+    gtk_widget_set_visible(m->stage_label, FALSE);
+    gtk_widget_set_sensitive(m->export_button, TRUE);
+}
+
+static void start_export(MainWindow *m, ExportTask *et) {
+    et->input = g_strdup(m->video_path);
+    et->progress_bar = g_object_ref(m->export_progress);
+    et->chunk_strip = g_object_ref(m->chunk_strip);
+    m->export_task = et;
+
+    m->export_cancellable = g_cancellable_new();
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(m->export_progress), 0.0);
+    gtk_widget_set_visible(m->export_progress, TRUE);
+    gtk_widget_set_sensitive(m->export_button, FALSE);
+
+    // Só a recodificação passa pelo pipeline de estágios
+    if (!et->batch && !et->gif && et->max_height > 0) {
+        et->stats_time = g_get_monotonic_time();
+        m->stage_stats_id = g_timeout_add(500, on_stage_stats_tick, m);
+    }
+
+    GTask *task = g_task_new(m->export_button, m->export_cancellable, on_export_done, m);
+    g_task_set_task_data(task, et, export_task_release);
+    g_task_run_in_thread(task, export_thread);
+    g_object_unref(task);
+}
+
+static void on_export_target_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GFile *file = gtk_file_dialog_save_finish(GTK_FILE_DIALOG(source), result, NULL);
+    if (!file)
+        return;  // cancelado pelo usuário ou pela janela fechando
+
+    MainWindow *m = user_data;
+    gint64 start_us, end_us;
+    gchar *output = g_file_get_path(file);
+    g_object_unref(file);
+    if (!output || !m->video_path || m->export_cancellable || !read_clip_range(m, &start_us, &end_us)) {
+        g_free(output);
+        return;
+    }
+    if (media_same_file(output, m->video_path)) {
+        g_print("Não é possível exportar por cima do próprio vídeo: %s\n", output);
+        g_free(output);
+        return;
+    }
+
+    ExportTask *et = g_rc_box_new0(ExportTask);
+    et->output = output;
+    et->start_us = start_us;
+    et->end_us = end_us;
+    guint preset = gtk_drop_down_get_selected(GTK_DROP_DOWN(m->export_preset));
+    et->max_height = export_preset_heights[preset];
+    et->gif = preset == EXPORT_PRESET_GIF;
+    start_export(m, et);
+}
+
+// Lote: um arquivo por corte da lista, todos na pasta escolhida
+static void on_batch_folder_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GFile *folder = gtk_file_dialog_select_folder_finish(GTK_FILE_DIALOG(source), result, NULL);
+    if (!folder)
+        return;  // cancelado pelo usuário ou pela janela fechando
+
+    MainWindow *m = user_data;
+    gchar *dir = g_file_get_path(folder);
+    g_object_unref(folder);
+    guint n = m->clips ? clip_list_get_n_clips(m->clips) : 0;
+    if (!dir || !m->video_path || m->export_cancellable || n == 0) {
+        g_free(dir);
+        return;
+    }
+
+    gboolean gif = gtk_drop_down_get_selected(GTK_DROP_DOWN(m->export_preset)) == EXPORT_PRESET_GIF;
+    gchar **outputs = clip_list_build_outputs(m->clips, dir, gif ? ".gif" : NULL);
+    for (guint i = 0; i < n; i++) {
+        if (media_same_file(outputs[i], m->video_path)) {
+            g_print("Não é possível exportar por cima do próprio vídeo: %s\n", outputs[i]);
+            g_strfreev(outputs);
+            g_free(dir);
+            return;
+        }
+    }
+
+    ExportTask *et = g_rc_box_new0(ExportTask);
+    et->output = g_strdup(dir);
+    et->batch = g_array_sized_new(FALSE, FALSE, sizeof(ClipRange), n);
+    for (guint i = 0; i < n; i++)
+        g_array_append_val(et->batch, *clip_list_get(m->clips, i));
+    et->batch_outputs = outputs;
+    et->gif = gif;
+    if (gif)
+        et->max_height = export_preset_heights[EXPORT_PRESET_GIF];
+    g_free(dir);
+    start_export(m, et);
+}
+
+static void on_export_clicked(GtkButton *button, MainWindow *m) {
+    (void)button;
+    gint64 start_us, end_us;
+    if (!m->video_path || m->export_cancellable)
+        return;
+
+    // Com cortes na lista, exporta o lote inteiro numa leitura só da fonte (no
+    // preset GIF, um GIF por corte)
+    if (m->clips && clip_list_get_n_clips(m->clips) > 0) {
+        GtkFileDialog *dialog = gtk_file_dialog_new();
+        gtk_file_dialog_set_title(dialog, "Pasta para os cortes");
+        gchar *dir = g_path_get_dirname(m->video_path);
+        GFile *folder = g_file_new_for_path(dir);
+        gtk_file_dialog_set_initial_folder(dialog, folder);
+        gtk_file_dialog_select_folder(dialog, GTK_WINDOW(m->window), m->dialog_cancellable, on_batch_folder_chosen, m);
+        g_object_unref(folder);
+        g_object_unref(dialog);
+        g_free(dir);
+        return;
+    }
+    if (!read_clip_range(m, &start_us, &end_us))
+        return;
+
+    // Sugere <nome>_corte.<ext> na pasta do vídeo (.gif no preset GIF)
+    gchar *dir = g_path_get_dirname(m->video_path);
+    gchar *base = g_path_get_basename(m->video_path);
+    const char *dot = strrchr(base, '.');
+    gchar *stem = dot ? g_strndup(base, dot - base) : g_strdup(base);
+    gboolean gif = gtk_drop_down_get_selected(GTK_DROP_DOWN(m->export_preset)) == EXPORT_PRESET_GIF;
+    gchar *name = g_strdup_printf("%s_corte%s", stem, gif ? ".gif" : dot ? dot : ".mp4");
+
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Exportar corte");
+    gtk_file_dialog_set_initial_name(dialog, name);
+    GFile *folder = g_file_new_for_path(dir);
+    gtk_file_dialog_set_initial_folder(dialog, folder);
+    gtk_file_dialog_save(dialog, GTK_WINDOW(m->window), m->dialog_cancellable, on_export_target_chosen, m);
+
+    g_object_unref(folder);
+    g_object_unref(dialog);
+    g_free(name);
+    g_free(stem);
+    g_free(base);
+    g_free(dir);
+}
+
+// Faixa da forma de onda: uma coluna por pixel, do nível da pirâmide adequado ao zoom
+static void draw_waveform(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer user_data) {
+    (void)area;
+    MainWindow *m = user_data;
+    if (!m->waveform || width <= 0)
+        return;
+
+    WaveformPeak *peaks = g_new(WaveformPeak, width);
+    waveform_get_peaks(m->waveform, m->timeline_start_us, m->timeline_end_us, (guint)width, peaks);
+    double mid = height / 2.0;
+    cairo_set_source_rgba(cr, 140 / 255.0, 82 / 255.0, 1.0, 0.45);
+    for (int x = 0; x < width; x++)
+        cairo_rectangle(cr, x, mid - peaks[x].max * mid, 1, MAX((peaks[x].max - peaks[x].min) * mid, 1));
+    cairo_fill(cr);
+    cairo_set_source_rgb(cr, 140 / 255.0, 82 / 255.0, 1.0);
+    for (int x = 0; x < width; x++)
+        cairo_rectangle(cr, x, mid - peaks[x].rms * mid, 1, MAX(2 * peaks[x].rms * mid, 1));
+    cairo_fill(cr);
+    g_free(peaks);
+}
+
+// As duas faixas (miniaturas e forma de onda) mostram o mesmo trecho da linha do tempo
+static void set_timeline_range(MainWindow *m, gint64 start_us, gint64 end_us) {
+    m->timeline_start_us = start_us;
+    m->timeline_end_us = end_us;
+    video_filmstrip_set_range(VIDEO_FILMSTRIP(m->filmstrip), start_us, end_us);
+    gtk_widget_queue_draw(m->waveform_area);
+    gtk_widget_queue_draw(m->scene_strip);
+}
+
+static gint64 timeline_x_to_us(MainWindow *m, GtkWidget *strip, double x) {
+    int width = MAX(gtk_widget_get_width(strip), 1);
+    gint64 us = m->timeline_start_us + (gint64)(x / width * (m->timeline_end_us - m->timeline_start_us));
+    return CLAMP(us, m->timeline_start_us, m->timeline_end_us);
+}
+
+static void on_timeline_motion(GtkEventControllerMotion *controller, double x, double y, MainWindow *m) {
+    (void)controller; (void)y;
+    m->timeline_pointer_x = x;
+}
+
+// Roda do mouse: zoom em torno do ponteiro, até o vídeo inteiro
+static gboolean on_timeline_scroll(GtkEventControllerScroll *controller, double dx, double dy, MainWindow *m) {
+    (void)dx;
+    gint64 duration = video_engine_get_duration_us(m->engine);
+    if (duration <= 0)
+        return FALSE;
+    GtkWidget *strip = gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(controller));
+    gint64 anchor = timeline_x_to_us(m, strip, m->timeline_pointer_x);
+    double scale = pow(1.25, dy);
+    gint64 start = anchor - (gint64)((anchor - m->timeline_start_us) * scale);
+    gint64 end = anchor + (gint64)((m->timeline_end_us - anchor) * scale);
+    if (end - start < 100000)   // no máximo ~0,1 s na largura da faixa
+        return TRUE;
+    set_timeline_range(m, MAX(start, 0), MIN(end, duration));
+    return TRUE;
+}
+
+// Arrastar sobre as faixas percorre o vídeo (o engine fica só com o último seek)
+static void on_scrub_begin(GtkGestureDrag *gesture, double x, double y, MainWindow *m) {
+    (void)y;
+    m->scrub_start_x = x;
+    if (video_engine_is_open(m->engine))
+        video_engine_seek(m->engine, timeline_x_to_us(m, gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(gesture)), x));
+}
+
+static void on_scrub_update(GtkGestureDrag *gesture, double dx, double dy, MainWindow *m) {
+    (void)dy;
+    if (video_engine_is_open(m->engine))
+        video_engine_seek(m->engine, timeline_x_to_us(m, gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(gesture)),
+                                                      m->scrub_start_x + dx));
+}
+
+static void connect_timeline_zoom(MainWindow *m, GtkWidget *strip) {
+    GtkEventController *motion = gtk_event_controller_motion_new();
+    g_signal_connect(motion, "motion", G_CALLBACK(on_timeline_motion), m);
+    gtk_widget_add_controller(strip, motion);
+    GtkEventController *scroll = gtk_event_controller_scroll_new(GTK_EVENT_CONTROLLER_SCROLL_VERTICAL);
+    g_signal_connect(scroll, "scroll", G_CALLBACK(on_timeline_scroll), m);
+    gtk_widget_add_controller(strip, scroll);
+}
+
+static void connect_timeline_strip(MainWindow *m, GtkWidget *strip) {
+    connect_timeline_zoom(m, strip);
+    GtkGesture *drag = gtk_gesture_drag_new();
+    g_signal_connect(drag, "drag-begin", G_CALLBACK(on_scrub_begin), m);
+    g_signal_connect(drag, "drag-update", G_CALLBACK(on_scrub_update), m);
+    gtk_widget_add_controller(strip, GTK_EVENT_CONTROLLER(drag));
+}
+
+static void waveform_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)source;
+    GError *error = NULL;
+    Waveform *wf = waveform_load(task_data, cancellable, &error);
+    if (wf)
+        g_task_return_pointer(task, wf, (GDestroyNotify)waveform_free);
+    else
+        g_task_return_error(task, error);
+}
+
+static void on_waveform_loaded(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)source;
+    GTask *task = G_TASK(result);
+    // Cancelada: outra fonte foi aberta ou a janela fechou
+    if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+        return;
+
+    MainWindow *m = user_data;
+    GError *error = NULL;
+    Waveform *wf = g_task_propagate_pointer(task, &error);
+    if (!wf) {
+        if (!g_error_matches(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM))
+            g_print("Forma de onda indisponível: %s\n", error->message);
+        g_clear_error(&error);
+        return;
+    }
+    m->waveform = wf;
+    gtk_widget_set_visible(m->waveform_area, TRUE);
+    gtk_widget_queue_draw(m->waveform_area);
+}
+
+// Troca a forma de onda pela do vídeo recém-aberto (do cache ou analisada em segundo plano)
+static void load_waveform(MainWindow *m, const char *path) {
+    waveform_free(m->waveform);
+    m->waveform = NULL;
+    gtk_widget_set_visible(m->waveform_area, FALSE);
+    if (!path)
+        return;
+
+    GTask *task = g_task_new(m->waveform_area, m->source_cancellable, on_waveform_loaded, m);
+    g_task_set_task_data(task, g_strdup(path), g_free);
+    g_task_run_in_thread(task, waveform_thread);
+    g_object_unref(task);
+}
+
+// Quantos cortes da lista ficam em ou antes de "us"
+static guint scene_cuts_upto(GArray *cuts, gint64 us) {
+    guint lo = 0, hi = cuts->len;
+    while (lo < hi) {
+        guint mid = (lo + hi) / 2;
+        if (g_array_index(cuts, SceneCut, mid).time_us <= us)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Faixa de cenas: um traço por corte (mais forte, mais claro) e a cena escolhida
+static void draw_scene_strip(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer user_data) {
+    (void)area;
+    MainWindow *m = user_data;
+    gint64 span = m->timeline_end_us - m->timeline_start_us;
+    if (span <= 0 || width <= 0)
+        return;
+    double px = (double)width / span;
+
+    cairo_set_source_rgba(cr, 1, 1, 1, 0.08);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_fill(cr);
+    if (m->scene_end_us > m->scene_start_us) {
+        double x0 = (m->scene_start_us - m->timeline_start_us) * px;
+        double x1 = (m->scene_end_us - m->timeline_start_us) * px;
+        cairo_set_source_rgba(cr, 140 / 255.0, 82 / 255.0, 1.0, 0.5);
+        cairo_rectangle(cr, x0, 0, x1 - x0, height);
+        cairo_fill(cr);
+    }
+    for (guint i = scene_cuts_upto(m->scene_cuts, m->timeline_start_us - 1); i < m->scene_cuts->len; i++) {
+        const SceneCut *c = &g_array_index(m->scene_cuts, SceneCut, i);
+        if (c->time_us > m->timeline_end_us)
+            break;
+        cairo_set_source_rgba(cr, 1, 1, 1, 0.4 + 0.6 * c->score);
+        cairo_rectangle(cr, floor((c->time_us - m->timeline_start_us) * px), 0, 2, height);
+        cairo_fill(cr);
+    }
+    // Quanto do vídeo já foi analisado
+    if (m->scene_progress < 1.0) {
+        cairo_set_source_rgb(cr, 140 / 255.0, 82 / 255.0, 1.0);
+        cairo_rectangle(cr, 0, height - 2, width * m->scene_progress, 2);
+        cairo_fill(cr);
+    }
+}
+
+// Clique numa cena: o trecho até o próximo corte vai para os campos de tempo
+static void on_scene_pressed(GtkGestureClick *gesture, int n_press, double x, double y, MainWindow *m) {
+    (void)n_press; (void)y;
+    if (!video_engine_is_open(m->engine))
         return;
+    GtkWidget *strip = gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(gesture));
+    guint i = scene_cuts_upto(m->scene_cuts, timeline_x_to_us(m, strip, x));
+    m->scene_start_us = i > 0 ? g_array_index(m->scene_cuts, SceneCut, i - 1).time_us : 0;
+    m->scene_end_us = i < m->scene_cuts->len ? g_array_index(m->scene_cuts, SceneCut, i).time_us
+                                             : video_engine_get_duration_us(m->engine);
+
+    double fps = video_engine_get_frame_rate(m->engine);
+    char text[32];
+    timecode_format(m->scene_start_us, fps, text, sizeof(text));
+    gtk_editable_set_text(GTK_EDITABLE(m->time_start_entry), text);
+    timecode_format(m->scene_end_us, fps, text, sizeof(text));
+    gtk_editable_set_text(GTK_EDITABLE(m->time_end_entry), text);
+    video_engine_seek(m->engine, m->scene_start_us);
+    gtk_widget_queue_draw(strip);
+}
+
+// Detecção de cenas de uma fonte. Os workers entregam cortes aqui; a thread
+// principal os leva para a faixa, no máximo uma atualização agendada por vez.
+typedef struct {
+    MainWindow *m;
+    gchar *path;
+    SeekIndex *index;           // o do player, para não varrer o arquivo duas vezes
+    GCancellable *cancellable;
+    GMutex lock;
+    GArray *pending;            // SceneCut ainda fora da faixa
+    gint permille;
+    gint update_pending;
+    gboolean finished;          // o resultado final já substituiu os parciais
+} SceneTask;
+
+static void scene_task_clear(gpointer data) {
+    SceneTask *st = data;
+    g_free(st->path);
+    seek_index_unref(st->index);
+    g_object_unref(st->cancellable);
+    g_array_unref(st->pending);
+    g_mutex_clear(&st->lock);
+}
+
+static void scene_task_release(gpointer data) {
+    g_rc_box_release_full(data, scene_task_clear);
+}
+
+static gboolean on_scene_cuts_idle(gpointer data) {
+    SceneTask *st = data;
+    g_atomic_int_set(&st->update_pending, 0);
+    // Cancelada: outra fonte foi aberta ou a janela fechou (MainWindow pode não existir)
+    if (g_cancellable_is_cancelled(st->cancellable) || st->finished)
+        return G_SOURCE_REMOVE;
+
+    MainWindow *m = st->m;
+    g_mutex_lock(&st->lock);
+    for (guint i = 0; i < st->pending->len; i++) {
+        const SceneCut *c = &g_array_index(st->pending, SceneCut, i);
+        g_array_insert_val(m->scene_cuts, scene_cuts_upto(m->scene_cuts, c->time_us), *c);
     }
+    g_array_set_size(st->pending, 0);
+    g_mutex_unlock(&st->lock);
+    m->scene_progress = g_atomic_int_get(&st->permille) / 1000.0;
+    gtk_widget_queue_draw(m->scene_strip);
+    return G_SOURCE_REMOVE;
+}
+
+static void on_scene_cuts(const SceneCut *cuts, guint n, double fraction, gpointer user_data) {
+    SceneTask *st = user_data;
+    g_mutex_lock(&st->lock);
+    g_array_append_vals(st->pending, cuts, n);
+    g_mutex_unlock(&st->lock);
+    g_atomic_int_set(&st->permille, (int)(fraction * 1000));
+    if (g_atomic_int_compare_and_exchange(&st->update_pending, 0, 1))
+        g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_scene_cuts_idle, g_rc_box_acquire(st), scene_task_release);
+}
+
+static void scene_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)source;
+    SceneTask *st = task_data;
+    GError *error = NULL;
+    // Um núcleo fica livre para o player
+    guint threads = MAX(g_get_num_processors(), 2) - 1;
+    GArray *cuts = scene_detect_run(st->path, st->index, threads, cancellable, on_scene_cuts, st, &error);
+    if (cuts)
+        g_task_return_pointer(task, cuts, (GDestroyNotify)g_array_unref);
+    else
+        g_task_return_error(task, error);
+}
+
+static void on_scenes_detected(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)source;
+    GTask *task = G_TASK(result);
+    if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+        return;
+
+    MainWindow *m = user_data;
+    SceneTask *st = g_task_get_task_data(task);
+    GError *error = NULL;
+    GArray *cuts = g_task_propagate_pointer(task, &error);
+    st->finished = TRUE;
+    if (!cuts) {
+        g_print("Detecção de cenas falhou: %s\n", error->message);
+        g_clear_error(&error);
+        return;
+    }
+    // A lista final já tem a duração mínima de cena aplicada também entre trechos
+    g_array_unref(m->scene_cuts);
+    m->scene_cuts = cuts;
+    m->scene_progress = 1.0;
+    gtk_widget_queue_draw(m->scene_strip);
+}
+
+// Sugere pontos de corte para a fonte recém-aberta (do cache ou analisando em segundo plano)
+static void detect_scenes(MainWindow *m, const char *path) {
+    g_array_set_size(m->scene_cuts, 0);
+    m->scene_start_us = m->scene_end_us = 0;
+    m->scene_progress = 0.0;
+    gtk_widget_set_visible(m->scene_strip, path != NULL);
+    if (!path)
+        return;
+
+    SceneTask *st = g_rc_box_new0(SceneTask);
+    st->m = m;
+    st->path = g_strdup(path);
+    // detect_scenes roda logo depois de o player abrir "path"
+    SeekIndex *index = video_engine_get_seek_index(m->engine);
+    st->index = index ? seek_index_ref(index) : NULL;
+    st->cancellable = g_object_ref(m->source_cancellable);
+    g_mutex_init(&st->lock);
+    st->pending = g_array_new(FALSE, FALSE, sizeof(SceneCut));
+
+    GTask *task = g_task_new(m->scene_strip, m->source_cancellable, on_scenes_detected, m);
+    g_task_set_task_data(task, st, scene_task_release);
+    g_task_run_in_thread(task, scene_thread);
+    g_object_unref(task);
+}
+
+typedef struct {
+    gchar *path;
+    int max_width, max_height;
+} ProxyTask;
+
+static void proxy_task_free(gpointer data) {
+    ProxyTask *pt = data;
+    g_free(pt->path);
+    g_free(pt);
+}
+
+static void proxy_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)source;
+    ProxyTask *pt = task_data;
+    GError *error = NULL;
+    gchar *proxy = proxy_build(pt->path, pt->max_width, pt->max_height, cancellable, &error);
+    if (error)
+        g_task_return_error(task, error);
+    else
+        g_task_return_pointer(task, proxy, g_free);
+}
+
+static void on_proxy_ready(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)source;
+    GTask *task = G_TASK(result);
+    if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+        return;
+
+    MainWindow *m = user_data;
+    GError *error = NULL;
+    gchar *proxy = g_task_propagate_pointer(task, &error);
+    if (error) {
+        g_print("Proxy indisponível: %s\n", error->message);
+        g_clear_error(&error);
+        return;
+    }
+    // NULL: o original já é leve o bastante para o player
+    if (proxy && !video_engine_use_proxy(m->engine, proxy, &error)) {
+        g_print("Não foi possível abrir o proxy: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    g_free(proxy);
+}
+
+// Gera (ou pega do cache) o proxy da fonte recém-aberta; a prévia passa para
+// ele quando fica pronto, e a exportação continua usando m->video_path
+static void build_proxy(MainWindow *m, const char *path, int max_width, int max_height) {
+    if (!path || !proxy_get_enabled())
+        return;
+    ProxyTask *pt = g_new(ProxyTask, 1);
+    pt->path = g_strdup(path);
+    pt->max_width = max_width;
+    pt->max_height = max_height;
+
+    GTask *task = g_task_new(m->video_picture, m->source_cancellable, on_proxy_ready, m);
+    g_task_set_task_data(task, pt, proxy_task_free);
+    g_task_run_in_thread(task, proxy_thread);
+    g_object_unref(task);
+}
+
+// Guarda o trecho atual dos campos de tempo na lista de cortes
+static void on_add_clip_clicked(GtkButton *button, MainWindow *m) {
+    (void)button;
+    gint64 start_us, end_us;
+    if (!m->clips || !read_clip_range(m, &start_us, &end_us))
+        return;
+    clip_list_add(m->clips, start_us, end_us);
+
+    guint n = clip_list_get_n_clips(m->clips);
+    gchar *text = g_strdup_printf(n == 1 ? "%u corte" : "%u cortes", n);
+    gtk_label_set_text(GTK_LABEL(m->clip_count_label), text);
+    g_free(text);
+}
+
+// Monta (uma vez) a área do player: vídeo, tempos de corte e botões
+static void show_player_view(MainWindow *m) {
+    if (m->player_view_active)
+        return;
 
     // Oculta título e subtítulo
     gtk_widget_set_visible(m->title_section, FALSE);
@@ -409,6 +1258,42 @@ static void on_link_submitted(GtkWidget *widget, gpointer user_data) {
     gtk_widget_set_margin_top(m->player_frame, 20);
     gtk_widget_set_name(m->player_frame, "player-frame");
 
+    // O vídeo é desenhado direto do paintable do engine
+    m->video_picture = gtk_picture_new_for_paintable(video_engine_get_paintable(m->engine));
+    gtk_picture_set_content_fit(GTK_PICTURE(m->video_picture), GTK_CONTENT_FIT_CONTAIN);
+    gtk_frame_set_child(GTK_FRAME(m->player_frame), m->video_picture);
+    video_engine_attach(m->engine, m->video_picture);
+
+    // Forma de onda do áudio, logo abaixo do player
+    m->waveform_area = gtk_drawing_area_new();
+    gtk_widget_set_size_request(m->waveform_area, 580, 48);
+    gtk_widget_set_halign(m->waveform_area, GTK_ALIGN_START);
+    gtk_widget_set_margin_start(m->waveform_area, 20);
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(m->waveform_area), draw_waveform, m, NULL);
+    connect_timeline_strip(m, m->waveform_area);
+    gtk_widget_set_visible(m->waveform_area, FALSE);
+
+    // Miniaturas para achar o ponto de corte sem digitar timecodes às cegas
+    m->filmstrip = video_filmstrip_new();
+    gtk_widget_set_size_request(m->filmstrip, 580, -1);
+    gtk_widget_set_halign(m->filmstrip, GTK_ALIGN_START);
+    gtk_widget_set_margin_start(m->filmstrip, 20);
+    connect_timeline_strip(m, m->filmstrip);
+
+    // Cortes de cena sugeridos; clicar numa cena preenche início e fim
+    m->scene_cuts = g_array_new(FALSE, FALSE, sizeof(SceneCut));
+    m->scene_strip = gtk_drawing_area_new();
+    gtk_widget_set_size_request(m->scene_strip, 580, 14);
+    gtk_widget_set_halign(m->scene_strip, GTK_ALIGN_START);
+    gtk_widget_set_margin_start(m->scene_strip, 20);
+    gtk_widget_set_tooltip_text(m->scene_strip, "Clique numa cena para usá-la como corte");
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(m->scene_strip), draw_scene_strip, m, NULL);
+    connect_timeline_zoom(m, m->scene_strip);
+    GtkGesture *scene_click = gtk_gesture_click_new();
+    g_signal_connect(scene_click, "pressed", G_CALLBACK(on_scene_pressed), m);
+    gtk_widget_add_controller(m->scene_strip, GTK_EVENT_CONTROLLER(scene_click));
+    gtk_widget_set_visible(m->scene_strip, FALSE);
+
     // Entradas de tempo
     m->time_start_entry = gtk_entry_new();
     m->time_end_entry = gtk_entry_new();
@@ -416,36 +1301,334 @@ static void on_link_submitted(GtkWidget *widget, gpointer user_data) {
     gtk_entry_set_placeholder_text(GTK_ENTRY(m->time_end_entry), "00:00:00:00");
     gtk_widget_set_size_request(m->time_start_entry, 100, 30);
     gtk_widget_set_size_request(m->time_end_entry, 100, 30);
+    connect_time_entry(m, m->time_start_entry);
+    connect_time_entry(m, m->time_end_entry);
+
+    // Play/pause
+    m->play_button = gtk_button_new();
+    gtk_widget_add_css_class(m->play_button, "control-button");
+    m->play_image = gtk_image_new();
+    gtk_widget_set_size_request(m->play_image, 30, 30);
+    set_image_asset(m->play_image, "Play.png", 30, 30);
+    gtk_button_set_child(GTK_BUTTON(m->play_button), m->play_image);
+    g_signal_connect(m->play_button, "clicked", G_CALLBACK(on_play_clicked), m);
+    video_engine_set_state_func(m->engine, on_engine_state, m);
+
+    // Mudo e volume
+    m->mute_button = gtk_button_new();
+    gtk_widget_add_css_class(m->mute_button, "control-button");
+    gtk_widget_set_tooltip_text(m->mute_button, "Mudo");
+    m->mute_image = gtk_image_new();
+    gtk_widget_set_size_request(m->mute_image, 30, 30);
+    update_mute_image(m);
+    gtk_button_set_child(GTK_BUTTON(m->mute_button), m->mute_image);
+    g_signal_connect(m->mute_button, "clicked", G_CALLBACK(on_mute_clicked), m);
+
+    m->volume_scale = gtk_scale_new_with_range(GTK_ORIENTATION_HORIZONTAL, 0.0, 1.0, 0.05);
+    gtk_scale_set_draw_value(GTK_SCALE(m->volume_scale), FALSE);
+    gtk_range_set_value(GTK_RANGE(m->volume_scale), video_engine_get_volume(m->engine));
+    gtk_widget_set_size_request(m->volume_scale, 80, -1);
+    gtk_widget_set_valign(m->volume_scale, GTK_ALIGN_CENTER);
+    g_signal_connect(m->volume_scale, "value-changed", G_CALLBACK(on_volume_changed), m);
 
     GtkWidget *time_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    gtk_box_append(GTK_BOX(time_box), m->play_button);
+    gtk_box_append(GTK_BOX(time_box), m->mute_button);
+    gtk_box_append(GTK_BOX(time_box), m->volume_scale);
     gtk_box_append(GTK_BOX(time_box), m->time_start_entry);
     gtk_box_append(GTK_BOX(time_box), m->time_end_entry);
+
+    // Lista de cortes para exportação em lote
+    m->add_clip_button = gtk_button_new_from_icon_name("list-add-symbolic");
+    gtk_widget_set_tooltip_text(m->add_clip_button, "Adicionar trecho à lista de cortes");
+    g_signal_connect(m->add_clip_button, "clicked", G_CALLBACK(on_add_clip_clicked), m);
+    m->clip_count_label = gtk_label_new("");
+    gtk_box_append(GTK_BOX(time_box), m->add_clip_button);
+    gtk_box_append(GTK_BOX(time_box), m->clip_count_label);
     gtk_widget_set_halign(time_box, GTK_ALIGN_START);
 
     // Botão de exportação (com gif)
     m->export_button = create_button_with_image("media-playback-start-symbolic", NULL,
-                                                "G:/video_clipper/icons/export_icon.gif", 40, 40);
+                                                "export_icon.gif", 40, 40);
     gtk_widget_set_halign(m->export_button, GTK_ALIGN_END);
+    g_signal_connect(m->export_button, "clicked", G_CALLBACK(on_export_clicked), m);
+
+    m->export_progress = gtk_progress_bar_new();
+    gtk_widget_set_valign(m->export_progress, GTK_ALIGN_CENTER);
+    gtk_widget_set_size_request(m->export_progress, 150, -1);
+    gtk_widget_set_visible(m->export_progress, FALSE);
+
+    // Progresso por trecho da exportação paralela
+    m->chunk_strip = gtk_drawing_area_new();
+    gtk_widget_set_size_request(m->chunk_strip, 150, 20);
+    gtk_widget_set_valign(m->chunk_strip, GTK_ALIGN_CENTER);
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(m->chunk_strip), draw_chunk_strip, m, NULL);
+    gtk_widget_set_visible(m->chunk_strip, FALSE);
+
+    // Estágios da recodificação: o gargalo no texto, vazão e filas no tooltip
+    m->stage_label = gtk_label_new("");
+    gtk_widget_add_css_class(m->stage_label, "caption");
+    gtk_widget_set_valign(m->stage_label, GTK_ALIGN_CENTER);
+    gtk_widget_set_visible(m->stage_label, FALSE);
+
+    m->export_preset = gtk_drop_down_new_from_strings(export_presets);
+    gtk_widget_set_valign(m->export_preset, GTK_ALIGN_CENTER);
 
     GtkWidget *bottom_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 20);
     gtk_widget_set_halign(bottom_box, GTK_ALIGN_FILL);
     gtk_widget_set_margin_top(bottom_box, 10);
     gtk_box_append(GTK_BOX(bottom_box), time_box);
+    gtk_box_append(GTK_BOX(bottom_box), m->export_progress);
+    gtk_box_append(GTK_BOX(bottom_box), m->chunk_strip);
+    gtk_box_append(GTK_BOX(bottom_box), m->stage_label);
+    gtk_box_append(GTK_BOX(bottom_box), m->export_preset);
     gtk_box_append(GTK_BOX(bottom_box), m->export_button);
 
     m->player_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
     gtk_box_append(GTK_BOX(m->player_container), m->player_frame);
+    gtk_box_append(GTK_BOX(m->player_container), m->filmstrip);
+    gtk_box_append(GTK_BOX(m->player_container), m->scene_strip);
+    gtk_box_append(GTK_BOX(m->player_container), m->waveform_area);
     gtk_box_append(GTK_BOX(m->player_container), bottom_box);
 
     gtk_box_append(GTK_BOX(m->main_box), m->player_container);
-    gtk_widget_show_all(m->player_container);
 
     m->player_view_active = TRUE;
 }
 
-void create_main_window(GtkApplication *app) {
+// Troca a fonte do player, que é montado uma vez só. O que ainda roda para a
+// fonte anterior (forma de onda, índice de keyframes, miniaturas, decodificação)
+// é cancelado antes de a nova começar; NULL deixa o player vazio. A exportação em
+// andamento continua: ela tem a própria cópia do caminho.
+static void set_source(MainWindow *m, const char *path) {
+    if (m->source_cancellable) {
+        g_cancellable_cancel(m->source_cancellable);
+        g_clear_object(&m->source_cancellable);
+    }
+
+    GError *error = NULL;
+    gchar *opened = NULL;
+    int scale = gtk_widget_get_scale_factor(m->window);
+    if (!path)
+        video_engine_close(m->engine);
+    else if (video_engine_open(m->engine, path, 580 * scale, 330 * scale, &error))
+        opened = g_strdup(path);
+    else {
+        g_print("Não foi possível abrir o vídeo: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    if (opened)
+        m->source_cancellable = g_cancellable_new();
+
+    g_free(m->video_path);
+    m->video_path = opened;
+    gboolean has_audio = opened && video_engine_has_audio(m->engine);
+    gtk_widget_set_sensitive(m->mute_button, has_audio);
+    gtk_widget_set_sensitive(m->volume_scale, has_audio);
+    // Cortes e pontos marcados valem só para a fonte em que foram marcados
+    clip_list_free(m->clips);
+    m->clips = opened ? clip_list_new(opened) : NULL;
+    gtk_label_set_text(GTK_LABEL(m->clip_count_label), "");
+    gtk_editable_set_text(GTK_EDITABLE(m->time_start_entry), "");
+    gtk_editable_set_text(GTK_EDITABLE(m->time_end_entry), "");
+    load_waveform(m, opened);
+    detect_scenes(m, opened);
+    build_proxy(m, opened, 580 * scale, 330 * scale);
+    video_filmstrip_set_source(VIDEO_FILMSTRIP(m->filmstrip), opened);
+    set_timeline_range(m, 0, opened ? video_engine_get_duration_us(m->engine) : 0);
+}
+
+typedef struct {
+    gchar *url;
+    gchar *dest;
+    GtkWidget *entry;
+    GtkWidget *label;
+    GCancellable *cancellable;
+    gint permille;          // -1 = o servidor não informou o tamanho
+    gint kib_per_sec;
+    gint connections;
+    gint resumed;
+    gint update_pending;
+} DownloadTask;
+
+static void download_task_clear(gpointer data) {
+    DownloadTask *dt = data;
+    g_free(dt->url);
+    g_free(dt->dest);
+    g_object_unref(dt->entry);
+    g_object_unref(dt->label);
+    g_object_unref(dt->cancellable);
+}
+
+static void download_task_release(gpointer data) {
+    g_rc_box_release_full(data, download_task_clear);
+}
+
+static gboolean on_download_progress_idle(gpointer data) {
+    DownloadTask *dt = data;
+    g_atomic_int_set(&dt->update_pending, 0);
+    if (g_cancellable_is_cancelled(dt->cancellable))
+        return G_SOURCE_REMOVE;
+
+    gint permille = g_atomic_int_get(&dt->permille);
+    GString *text = g_string_new(g_atomic_int_get(&dt->resumed) ? "Retomando" : "Baixando");
+    if (permille >= 0) {
+        gtk_entry_set_progress_fraction(GTK_ENTRY(dt->entry), permille / 1000.0);
+        g_string_append_printf(text, " %d%%", permille / 10);
+    } else {
+        gtk_entry_progress_pulse(GTK_ENTRY(dt->entry));
+    }
+    g_string_append_printf(text, " · %.1f MB/s · %d %s", g_atomic_int_get(&dt->kib_per_sec) / 1024.0,
+                           g_atomic_int_get(&dt->connections),
+                           g_atomic_int_get(&dt->connections) == 1 ? "conexão" : "conexões");
+    gtk_label_set_text(GTK_LABEL(dt->label), text->str);
+    gtk_widget_set_visible(dt->label, TRUE);
+    g_string_free(text, TRUE);
+    return G_SOURCE_REMOVE;
+}
+
+// Threads do download: guarda os números e agenda no máximo uma atualização por vez
+static void on_download_progress(const IngestProgress *p, gpointer user_data) {
+    DownloadTask *dt = user_data;
+    gint permille = p->total_bytes ? (gint)(p->done_bytes * 1000 / p->total_bytes) : -1;
+    g_atomic_int_set(&dt->permille, permille);
+    g_atomic_int_set(&dt->kib_per_sec, (gint)(p->bytes_per_sec / 1024));
+    g_atomic_int_set(&dt->connections, (gint)p->connections);
+    g_atomic_int_set(&dt->resumed, p->resumed);
+    if (g_atomic_int_compare_and_exchange(&dt->update_pending, 0, 1))
+        g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_download_progress_idle, g_rc_box_acquire(dt),
+                        download_task_release);
+}
+
+static void download_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)source;
+    DownloadTask *dt = task_data;
+    GError *error = NULL;
+    if (ingest_download(dt->url, dt->dest, cancellable, on_download_progress, dt, &error))
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, error);
+}
+
+static void reset_download_view(MainWindow *m) {
+    gtk_entry_set_progress_fraction(GTK_ENTRY(m->link_entry), 0.0);
+    gtk_widget_set_visible(m->download_label, FALSE);
+}
+
+// Outra fonte escolhida: o download para, e o que já veio fica para retomar
+static void cancel_download(MainWindow *m) {
+    if (!m->download_cancellable)
+        return;
+    g_cancellable_cancel(m->download_cancellable);
+    g_clear_object(&m->download_cancellable);
+    reset_download_view(m);
+}
+
+static void on_download_done(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)source;
+    GTask *task = G_TASK(result);
+    // Cancelado por outra fonte ou ao fechar a janela
+    if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+        return;
+
+    MainWindow *m = user_data;
+    DownloadTask *dt = g_task_get_task_data(task);
+    GError *error = NULL;
+    g_clear_object(&m->download_cancellable);
+    reset_download_view(m);
+    if (g_task_propagate_boolean(task, &error))
+        set_source(m, dt->dest);
+    else {
+        g_print("Falha ao baixar %s: %s\n", dt->url, error->message);
+        g_clear_error(&error);
+    }
+}
+
+static void start_download(MainWindow *m, const char *url) {
+    DownloadTask *dt = g_rc_box_new0(DownloadTask);
+    dt->url = g_strdup(url);
+    dt->dest = ingest_default_path(url);
+    dt->entry = g_object_ref(m->link_entry);
+    dt->label = g_object_ref(m->download_label);
+    m->download_cancellable = g_cancellable_new();
+    dt->cancellable = g_object_ref(m->download_cancellable);
+    g_print("Baixando %s para %s\n", url, dt->dest);
+
+    GTask *task = g_task_new(m->link_entry, m->download_cancellable, on_download_done, m);
+    g_task_set_task_data(task, dt, download_task_release);
+    g_task_run_in_thread(task, download_thread);
+    g_object_unref(task);
+}
+
+static void on_link_submitted(GtkWidget *widget, gpointer user_data) {
+    (void)widget;
+    gint64 t = trace_begin();
+    MainWindow *m = (MainWindow *)user_data;
+    const char *url = gtk_editable_get_text(GTK_EDITABLE(m->link_entry));
+
+    gboolean direct = ingest_is_direct_link(url);
+    if (!direct && !is_valid_link(url)) {
+        g_print("Link inválido: %s\n", url);
+        trace_end("on_link_submitted", "ui", t);
+        return;
+    }
+
+    // O link é a nova fonte: a anterior sai do player enquanto ele baixa
+    cancel_download(m);
+    show_player_view(m);
+    set_source(m, NULL);
+    if (direct)
+        start_download(m, url);
+    else
+        g_print("Download de links de plataformas ainda não disponível: %s\n", url);
+    trace_end("on_link_submitted", "ui", t);
+}
+
+static void on_file_chosen(GObject *source, GAsyncResult *result, gpointer user_data) {
+    GError *error = NULL;
+    GFile *file = gtk_file_dialog_open_finish(GTK_FILE_DIALOG(source), result, &error);
+    if (!file) {
+        g_clear_error(&error);  // cancelado pelo usuário ou pela janela fechando
+        return;
+    }
+
+    MainWindow *m = user_data;
+    gint64 t = trace_begin();
+    cancel_download(m);
+    show_player_view(m);
+    gchar *path = g_file_get_path(file);
+    if (!path)
+        g_print("Não foi possível abrir o vídeo: arquivo não local\n");
+    set_source(m, path);
+    g_free(path);
+    g_object_unref(file);
+    trace_end("open video", "ui", t);
+}
+
+static void on_select_file_clicked(GtkButton *button, MainWindow *m) {
+    (void)button;
+    GtkFileDialog *dialog = gtk_file_dialog_new();
+    gtk_file_dialog_set_title(dialog, "Abrir vídeo");
+
+    GtkFileFilter *filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(filter, "Vídeos");
+    gtk_file_filter_add_mime_type(filter, "video/*");
+    GListStore *filters = g_list_store_new(GTK_TYPE_FILE_FILTER);
+    g_list_store_append(filters, filter);
+    gtk_file_dialog_set_filters(dialog, G_LIST_MODEL(filters));
+    g_object_unref(filters);
+    g_object_unref(filter);
+
+    gtk_file_dialog_open(dialog, GTK_WINDOW(m->window), m->dialog_cancellable, on_file_chosen, m);
+    g_object_unref(dialog);
+}
+
+GtkWidget *create_main_window(GtkApplication *app) {
+    gint64 t = trace_begin();
     MainWindow *m = g_new0(MainWindow, 1);
     const int win_w = 1200, win_h = 800;
+    m->engine = video_engine_new();
+    m->dialog_cancellable = g_cancellable_new();
 
     m->window = gtk_application_window_new(app);
     gtk_window_set_title(GTK_WINDOW(m->window), "Zenoka");
@@ -455,6 +1638,16 @@ void create_main_window(GtkApplication *app) {
 
     setup_glassmorphism();
     setup_titlebar(m);
+    render_mode_attach(m->window);
+
+    GtkEventController *shortcuts = gtk_shortcut_controller_new();
+    gtk_shortcut_controller_add_shortcut(GTK_SHORTCUT_CONTROLLER(shortcuts),
+        gtk_shortcut_new(gtk_keyval_trigger_new(GDK_KEY_R, GDK_CONTROL_MASK | GDK_SHIFT_MASK),
+                         gtk_callback_action_new(on_cycle_render_mode, NULL, NULL)));
+    gtk_shortcut_controller_add_shortcut(GTK_SHORTCUT_CONTROLLER(shortcuts),
+        gtk_shortcut_new(gtk_keyval_trigger_new(GDK_KEY_P, GDK_CONTROL_MASK | GDK_SHIFT_MASK),
+                         gtk_callback_action_new(on_toggle_perf_hud, m, NULL)));
+    gtk_widget_add_controller(m->window, shortcuts);
 
     g_signal_connect(m->window, "map", G_CALLBACK(on_window_map), NULL);
     g_signal_connect(m->window, "destroy", G_CALLBACK(on_window_closed), m);
@@ -468,7 +1661,7 @@ void create_main_window(GtkApplication *app) {
     gtk_widget_set_size_request(base, 10, 40);
     gtk_overlay_set_child(GTK_OVERLAY(overlay), base);
     gtk_overlay_add_overlay(GTK_OVERLAY(overlay), m->flip_button_container);
-    gtk_overlay_add_overlay(GTK_OVERLAY(overlay), m->title_bar);
+    gtk_overlay_add_overlay(GTK_OVERLAY(overlay), m->title_handle);
     gtk_box_append(GTK_BOX(top_container), overlay);
 
     GtkWidget *content_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 10);
@@ -479,7 +1672,7 @@ void create_main_window(GtkApplication *app) {
     gtk_widget_set_vexpand(content_box, TRUE);
 
     GtkWidget *logo_container = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-    GtkWidget *logo = gtk_image_new_from_file("G:/video_clipper/icons/logo.png");
+    GtkWidget *logo = create_image_from_asset("logo.png", 100, 80);
     gtk_widget_set_size_request(logo, 100, 80);
     gtk_box_append(GTK_BOX(logo_container), logo);
     GtkWidget *logo_spacer = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
@@ -502,6 +1695,7 @@ void create_main_window(GtkApplication *app) {
     gtk_box_append(GTK_BOX(title_section), title_label);
     gtk_box_append(GTK_BOX(title_section), subtitle_label);
     gtk_box_append(GTK_BOX(middle_box), title_section);
+    m->title_section = title_section;
 
     GtkWidget *link_bar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
     gtk_widget_set_halign(link_bar, GTK_ALIGN_CENTER);
@@ -513,10 +1707,13 @@ void create_main_window(GtkApplication *app) {
     gtk_widget_set_size_request(link_entry, 400, 40);
     gtk_widget_add_css_class(link_entry, "link-entry");
     gtk_entry_set_placeholder_text(GTK_ENTRY(link_entry), "Cole um link do YouTube, Twitch, Instagram, TikTok, Spotify etc...");
+    m->link_bar = link_bar;
+    m->link_entry = link_entry;
 
-    GtkWidget *link_button1 = create_button_with_image("face-smile-symbolic", NULL, "G:/video_clipper/icons/link_icon.gif", 22, 22);
+    GtkWidget *link_button1 = create_button_with_image("face-smile-symbolic", NULL, "link_icon.gif", 22, 22);
     g_signal_connect(link_button1, "clicked", G_CALLBACK(on_link_submitted), m);
-    GtkWidget *link_button2 = create_button_with_image("face-smile-symbolic", NULL, "G:/video_clipper/icons/select_file.gif", 22, 22);
+    GtkWidget *link_button2 = create_button_with_image("face-smile-symbolic", NULL, "select_file.gif", 22, 22);
+    g_signal_connect(link_button2, "clicked", G_CALLBACK(on_select_file_clicked), m);
 
     gtk_widget_add_css_class(link_button1, "link-button");
     gtk_widget_add_css_class(link_button2, "link-button");
@@ -524,6 +1721,12 @@ void create_main_window(GtkApplication *app) {
     gtk_box_append(GTK_BOX(link_bar), link_entry);
     gtk_box_append(GTK_BOX(link_bar), link_button1);
     gtk_box_append(GTK_BOX(link_bar), link_button2);
+
+    m->download_label = gtk_label_new("");
+    gtk_widget_add_css_class(m->download_label, "caption");
+    gtk_widget_set_valign(m->download_label, GTK_ALIGN_CENTER);
+    gtk_widget_set_visible(m->download_label, FALSE);
+    gtk_box_append(GTK_BOX(link_bar), m->download_label);
     gtk_box_append(GTK_BOX(middle_box), link_bar);
 
     gtk_box_append(GTK_BOX(middle_box), m->main_box);
@@ -548,7 +1751,7 @@ void create_main_window(GtkApplication *app) {
     gtk_widget_set_halign(footer_box, GTK_ALIGN_START);
 
     // GitHub
-    GtkWidget *github_img = gtk_image_new_from_file("G:/video_clipper/icons/Github.png");
+    GtkWidget *github_img = create_image_from_asset("Github.png", 60, 60);
     gtk_widget_set_size_request(github_img, 60, 60);
     GtkGestureClick *click_github = GTK_GESTURE_CLICK(gtk_gesture_click_new());
     g_signal_connect(click_github, "released", G_CALLBACK(open_link), "https://github.com/Luquitoos");
@@ -556,7 +1759,7 @@ void create_main_window(GtkApplication *app) {
     gtk_box_append(GTK_BOX(footer_box), github_img);
 
     // BuyMeACoffee
-    GtkWidget *coffee_img = gtk_image_new_from_file("G:/video_clipper/icons/coffee.png");
+    GtkWidget *coffee_img = create_image_from_asset("coffee.png", 150, 150);
     gtk_widget_set_size_request(coffee_img, 150, 150);
     GtkGestureClick *click_coffee = GTK_GESTURE_CLICK(gtk_gesture_click_new());
     g_signal_connect(click_coffee, "released", G_CALLBACK(open_link), "https://buymeacoffee.com/luquitoos");
@@ -565,6 +1768,12 @@ void create_main_window(GtkApplication *app) {
 
     gtk_overlay_add_overlay(GTK_OVERLAY(overlay_root), footer_box);
 
+    m->perf_hud = perf_hud_new();
+    gtk_overlay_add_overlay(GTK_OVERLAY(overlay_root), m->perf_hud);
+
     gtk_window_set_child(GTK_WINDOW(m->window), overlay_root);
-    gtk_window_present(GTK_WINDOW(m->window));
+    // Realiza já a superfície para a apresentação ser imediata quando o splash fechar
+    gtk_widget_realize(m->window);
+    trace_end("create_main_window", "startup", t);
+    return m->window;
 }
\ No newline at end of file
@@ -0,0 +1,329 @@
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include "media_cache.h"
+
+#define HASH_EDGE_BYTES   (256 * 1024)  // começo e fim do arquivo (cabeçalhos, moov)
+#define HASH_SAMPLE_BYTES (64 * 1024)
+#define HASH_SAMPLES      8             // blocos espalhados pelo meio
+// Temporário esquecido por um processo que morreu no meio da gravação
+#define STALE_TEMP_SECONDS (24 * 60 * 60)
+
+// Cabeçalho comum dos arquivos do cache (ordem de bytes da máquina)
+typedef struct {
+    char magic[4];          // "ZNC1"
+    char kind[4];
+    guint32 version;        // versão do formato do conteúdo, dada por quem grava
+    guint32 reserved;
+    guint64 payload_size;
+    guint64 reserved2;
+} CacheHeader;
+
+G_STATIC_ASSERT(sizeof(CacheHeader) == 32);
+
+typedef struct {
+    goffset size;
+    gint64 mtime;
+    MediaCacheKey key;
+} KeyMemo;
+
+typedef struct {
+    gchar *path;
+    goffset size;
+    gint64 mtime;
+} CacheFile;
+
+static guint64 budget = MEDIA_CACHE_DEFAULT_BUDGET;  // definido na partida
+static guint64 file_budget = MEDIA_CACHE_DEFAULT_FILE_BUDGET;
+static GMutex memo_lock;
+static GHashTable *memo;    // caminho -> KeyMemo*
+static GMutex evict_lock;
+
+static const char *cache_dir(void) {
+    static gchar *dir = NULL;
+    if (g_once_init_enter(&dir)) {
+        const char *env = g_getenv("ZENOKA_CACHE_DIR");
+        gchar *d = env && *env ? g_strdup(env) : g_build_filename(g_get_user_cache_dir(), "zenoka", NULL);
+        g_once_init_leave(&dir, d);
+    }
+    return dir;
+}
+
+// Arquivos grandes (proxies) numa subpasta com orçamento próprio
+static const char *files_dir(void) {
+    static gchar *dir = NULL;
+    if (g_once_init_enter(&dir))
+        g_once_init_leave(&dir, g_build_filename(cache_dir(), "files", NULL));
+    return dir;
+}
+
+static gchar *cache_path_in(const char *dir, const MediaCacheKey *key, const char *kind) {
+    gchar *name = g_strdup_printf("%s-%.4s.zc", key->hex, kind);
+    gchar *path = g_build_filename(dir, name, NULL);
+    g_free(name);
+    return path;
+}
+
+static gchar *cache_path(const MediaCacheKey *key, const char *kind) {
+    return cache_path_in(cache_dir(), key, kind);
+}
+
+void media_cache_set_budget(guint64 bytes) {
+    budget = bytes;
+}
+
+guint64 media_cache_get_budget(void) {
+    return budget;
+}
+
+void media_cache_set_file_budget(guint64 bytes) {
+    file_budget = bytes;
+}
+
+guint64 media_cache_get_file_budget(void) {
+    return file_budget;
+}
+
+static gboolean hash_range(GInputStream *in, GChecksum *sum, goffset offset, gsize len, guint8 *buf) {
+    gsize got;
+    if (!g_seekable_seek(G_SEEKABLE(in), offset, G_SEEK_SET, NULL, NULL))
+        return FALSE;
+    if (!g_input_stream_read_all(in, buf, len, &got, NULL, NULL))
+        return FALSE;
+    g_checksum_update(sum, buf, got);
+    return TRUE;
+}
+
+// Tamanho + começo + fim + amostras do meio. Arquivos pequenos entram inteiros.
+static gboolean compute_key(GFile *file, goffset size, MediaCacheKey *key) {
+    GFileInputStream *in = g_file_read(file, NULL, NULL);
+    if (!in)
+        return FALSE;
+    GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+    guint64 size_le = GUINT64_TO_LE((guint64)size);
+    g_checksum_update(sum, (const guchar *)&size_le, sizeof size_le);
+
+    guint8 *buf = g_malloc(HASH_EDGE_BYTES);
+    gboolean ok;
+    GInputStream *s = G_INPUT_STREAM(in);
+    if (size <= 2 * HASH_EDGE_BYTES + HASH_SAMPLES * HASH_SAMPLE_BYTES) {
+        ok = TRUE;
+        for (goffset at = 0; ok && at < size; at += HASH_EDGE_BYTES)
+            ok = hash_range(s, sum, at, HASH_EDGE_BYTES, buf);
+    } else {
+        ok = hash_range(s, sum, 0, HASH_EDGE_BYTES, buf);
+        goffset middle = size - 2 * HASH_EDGE_BYTES;
+        for (int i = 0; ok && i < HASH_SAMPLES; i++)
+            ok = hash_range(s, sum, HASH_EDGE_BYTES + middle * i / HASH_SAMPLES, HASH_SAMPLE_BYTES, buf);
+        if (ok)
+            ok = hash_range(s, sum, size - HASH_EDGE_BYTES, HASH_EDGE_BYTES, buf);
+    }
+    if (ok)
+        g_strlcpy(key->hex, g_checksum_get_string(sum), sizeof key->hex);
+
+    g_free(buf);
+    g_checksum_free(sum);
+    g_object_unref(in);
+    return ok;
+}
+
+gboolean media_cache_key(const char *path, MediaCacheKey *key) {
+    GFile *file = g_file_new_for_path(path);
+    GFileInfo *info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                        G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if (!info) {
+        g_object_unref(file);
+        return FALSE;
+    }
+    goffset size = g_file_info_get_size(info);
+    gint64 mtime = (gint64)g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    g_object_unref(info);
+
+    // O mesmo arquivo é aberto pelo player, pelo índice, pela forma de onda e
+    // pelas miniaturas quase ao mesmo tempo: o hash é feito uma vez só
+    g_mutex_lock(&memo_lock);
+    if (!memo)
+        memo = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    KeyMemo *m = g_hash_table_lookup(memo, path);
+    gboolean hit = m && m->size == size && m->mtime == mtime;
+    if (hit)
+        *key = m->key;
+    g_mutex_unlock(&memo_lock);
+    if (hit) {
+        g_object_unref(file);
+        return TRUE;
+    }
+
+    gboolean ok = compute_key(file, size, key);
+    g_object_unref(file);
+    if (ok) {
+        KeyMemo *entry = g_new(KeyMemo, 1);
+        entry->size = size;
+        entry->mtime = mtime;
+        entry->key = *key;
+        g_mutex_lock(&memo_lock);
+        g_hash_table_replace(memo, g_strdup(path), entry);
+        g_mutex_unlock(&memo_lock);
+    }
+    return ok;
+}
+
+GBytes *media_cache_load(const MediaCacheKey *key, const char *kind, guint32 version) {
+    gchar *path = cache_path(key, kind);
+    GMappedFile *mf = g_mapped_file_new(path, FALSE, NULL);
+    if (!mf) {
+        g_free(path);
+        return NULL;
+    }
+    GBytes *all = g_mapped_file_get_bytes(mf);
+    g_mapped_file_unref(mf);
+
+    GBytes *payload = NULL;
+    gsize size;
+    const guint8 *p = g_bytes_get_data(all, &size);
+    CacheHeader h;
+    if (size >= sizeof h) {
+        memcpy(&h, p, sizeof h);
+        if (memcmp(h.magic, "ZNC1", 4) == 0 && memcmp(h.kind, kind, 4) == 0 && h.version == version &&
+            h.payload_size == size - sizeof h)
+            payload = g_bytes_new_from_bytes(all, sizeof h, (gsize)h.payload_size);
+    }
+    g_bytes_unref(all);
+
+    // A data de modificação é a do último uso: é por ela que o LRU despeja
+    if (payload)
+        g_utime(path, NULL);
+    g_free(path);
+    return payload;
+}
+
+static gint compare_mtime(gconstpointer a, gconstpointer b) {
+    const CacheFile *fa = a, *fb = b;
+    return fa->mtime < fb->mtime ? -1 : fa->mtime > fb->mtime;
+}
+
+static void cache_file_clear(gpointer data) {
+    g_free(((CacheFile *)data)->path);
+}
+
+// Apaga os arquivos usados há mais tempo até a pasta "dir_path" caber em "limit"
+static void evict(const char *dir_path, guint64 limit, const char *keep) {
+    g_mutex_lock(&evict_lock);
+    GDir *dir = g_dir_open(dir_path, 0, NULL);
+    if (!dir) {
+        g_mutex_unlock(&evict_lock);
+        return;
+    }
+    GArray *files = g_array_new(FALSE, FALSE, sizeof(CacheFile));
+    g_array_set_clear_func(files, cache_file_clear);
+    guint64 total = 0;
+    const char *name;
+    gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+    while ((name = g_dir_read_name(dir))) {
+        gboolean temp = g_str_has_suffix(name, ".part");
+        if (!temp && !g_str_has_suffix(name, ".zc"))
+            continue;
+        GStatBuf st;
+        gchar *path = g_build_filename(dir_path, name, NULL);
+        gboolean found = g_stat(path, &st) == 0;
+        // Temporários não contam no orçamento: só saem se ficaram abandonados
+        if (!found || temp) {
+            if (found && now - (gint64)st.st_mtime > STALE_TEMP_SECONDS)
+                g_remove(path);
+            g_free(path);
+            continue;
+        }
+        CacheFile f = { path, (goffset)st.st_size, (gint64)st.st_mtime };
+        g_array_append_val(files, f);
+        total += (guint64)st.st_size;
+    }
+    g_dir_close(dir);
+
+    if (total > limit) {
+        g_array_sort(files, compare_mtime);
+        for (guint i = 0; i < files->len && total > limit; i++) {
+            CacheFile *f = &g_array_index(files, CacheFile, i);
+            // Arquivo mapeado por outro processo pode não sair (Windows): fica para a próxima
+            if (g_strcmp0(f->path, keep) != 0 && g_remove(f->path) == 0)
+                total -= (guint64)f->size;
+        }
+    }
+    g_array_unref(files);
+    g_mutex_unlock(&evict_lock);
+}
+
+static gboolean ensure_dir(const char *dir, GError **error) {
+    if (g_mkdir_with_parents(dir, 0700) != 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "%s: %s", dir, g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean media_cache_store(const MediaCacheKey *key, const char *kind, guint32 version,
+    const void *data, gsize size, GError **error) {
+    if (!ensure_dir(cache_dir(), error))
+        return FALSE;
+    CacheHeader h = { .magic = { 'Z', 'N', 'C', '1' }, .version = version, .payload_size = size };
+    memcpy(h.kind, kind, 4);
+
+    guint8 *buf = g_malloc(sizeof h + size);
+    memcpy(buf, &h, sizeof h);
+    memcpy(buf + sizeof h, data, size);
+    gchar *path = cache_path(key, kind);
+    gboolean ok = g_file_set_contents(path, (const gchar *)buf, (gssize)(sizeof h + size), error);
+    g_free(buf);
+    if (ok)
+        evict(cache_dir(), budget, path);
+    g_free(path);
+    return ok;
+}
+
+gchar *media_cache_lookup_file(const MediaCacheKey *key, const char *kind) {
+    gchar *path = cache_path_in(files_dir(), key, kind);
+    if (!g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+        g_free(path);
+        return NULL;
+    }
+    g_utime(path, NULL);
+    return path;
+}
+
+gchar *media_cache_create_temp(const MediaCacheKey *key, const char *kind, GError **error) {
+    if (!ensure_dir(files_dir(), error))
+        return NULL;
+    // Nome único: a mesma fonte reaberta pode ter outra gravação ainda terminando
+    gchar *name = g_strdup_printf("%s-%.4s-XXXXXX.part", key->hex, kind);
+    gchar *path = g_build_filename(files_dir(), name, NULL);
+    g_free(name);
+    int fd = g_mkstemp_full(path, O_RDWR, 0600);
+    if (fd < 0) {
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "%s: %s", path, g_strerror(errno));
+        g_free(path);
+        return NULL;
+    }
+    g_close(fd, NULL);
+    return path;
+}
+
+gboolean media_cache_commit_file(const MediaCacheKey *key, const char *kind, const char *temp_path,
+    GError **error) {
+    // Sozinho já maior que o orçamento: entrar só para despejar todos os outros não vale
+    GStatBuf st;
+    if (g_stat(temp_path, &st) == 0 && (guint64)st.st_size > file_budget) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_NOSPC,
+                    "%s: maior que o orçamento do cache (%" G_GUINT64_FORMAT " MB)",
+                    temp_path, file_budget / (1024 * 1024));
+        return FALSE;
+    }
+    gchar *path = cache_path_in(files_dir(), key, kind);
+    gboolean ok = g_rename(temp_path, path) == 0;
+    if (ok)
+        evict(files_dir(), file_budget, path);
+    else
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "%s: %s", path, g_strerror(errno));
+    g_free(path);
+    return ok;
+}
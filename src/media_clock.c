@@ -0,0 +1,55 @@
+#include <glib.h>
+#include "media_clock.h"
+
+void media_clock_init(MediaClock *c) {
+    g_mutex_init(&c->lock);
+    c->base_pts_us = 0;
+    c->base_time_us = g_get_monotonic_time();
+    c->running = FALSE;
+}
+
+void media_clock_clear(MediaClock *c) {
+    g_mutex_clear(&c->lock);
+}
+
+static gint64 current_locked(MediaClock *c) {
+    if (!c->running)
+        return c->base_pts_us;
+    return c->base_pts_us + (g_get_monotonic_time() - c->base_time_us);
+}
+
+void media_clock_start(MediaClock *c, gint64 pts_us) {
+    g_mutex_lock(&c->lock);
+    c->base_pts_us = pts_us;
+    c->base_time_us = g_get_monotonic_time();
+    c->running = TRUE;
+    g_mutex_unlock(&c->lock);
+}
+
+void media_clock_pause(MediaClock *c) {
+    g_mutex_lock(&c->lock);
+    c->base_pts_us = current_locked(c);
+    c->running = FALSE;
+    g_mutex_unlock(&c->lock);
+}
+
+void media_clock_set(MediaClock *c, gint64 pts_us) {
+    g_mutex_lock(&c->lock);
+    c->base_pts_us = pts_us;
+    c->base_time_us = g_get_monotonic_time();
+    g_mutex_unlock(&c->lock);
+}
+
+gint64 media_clock_get(MediaClock *c) {
+    g_mutex_lock(&c->lock);
+    gint64 now = current_locked(c);
+    g_mutex_unlock(&c->lock);
+    return now;
+}
+
+gboolean media_clock_is_running(MediaClock *c) {
+    g_mutex_lock(&c->lock);
+    gboolean running = c->running;
+    g_mutex_unlock(&c->lock);
+    return running;
+}
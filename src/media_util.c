@@ -0,0 +1,59 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include "media_util.h"
+
+G_DEFINE_QUARK(zenoka-media-error-quark, media_error)
+
+void media_set_av_error(GError **error, MediaError code, int averr, const char *what) {
+    char buf[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+    av_strerror(averr, buf, sizeof(buf));
+    g_set_error(error, MEDIA_ERROR, code, "%s: %s", what, buf);
+}
+
+AVFormatContext *media_open_input(const char *path, GError **error) {
+    AVFormatContext *fmt = NULL;
+    int ret = avformat_open_input(&fmt, path, NULL, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_OPEN, ret, path);
+        return NULL;
+    }
+    ret = avformat_find_stream_info(fmt, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_OPEN, ret, path);
+        avformat_close_input(&fmt);
+        return NULL;
+    }
+    return fmt;
+}
+
+gint64 media_ts_to_us(gint64 ts, AVRational time_base) {
+    if (ts == AV_NOPTS_VALUE)
+        return G_MININT64;
+    return av_rescale_q(ts, time_base, AV_TIME_BASE_Q);
+}
+
+gint64 media_us_to_ts(gint64 us, AVRational time_base) {
+    return av_rescale_q(us, AV_TIME_BASE_Q, time_base);
+}
+
+gint64 media_stream_start_us(AVStream *st) {
+    return st->start_time != AV_NOPTS_VALUE ? media_ts_to_us(st->start_time, st->time_base) : 0;
+}
+
+gboolean media_same_file(const char *a, const char *b) {
+    gchar *ca = g_canonicalize_filename(a, NULL);
+    gchar *cb = g_canonicalize_filename(b, NULL);
+#ifdef G_OS_WIN32
+    gboolean same = g_ascii_strcasecmp(ca, cb) == 0;
+#else
+    gboolean same = strcmp(ca, cb) == 0;
+    GStatBuf sa, sb;
+    if (!same && g_stat(a, &sa) == 0 && g_stat(b, &sb) == 0)
+        same = sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+#endif
+    g_free(ca);
+    g_free(cb);
+    return same;
+}
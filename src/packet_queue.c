@@ -0,0 +1,87 @@
+#include <glib.h>
+#include <libavcodec/avcodec.h>
+#include "packet_queue.h"
+
+void packet_queue_init(PacketQueue *q, guint max_packets) {
+    g_queue_init(&q->packets);
+    q->max_packets = max_packets;
+    q->serial = 0;
+    q->interrupts = 0;
+    q->aborted = FALSE;
+    g_mutex_init(&q->lock);
+    g_cond_init(&q->cond);
+}
+
+static void drop_all(PacketQueue *q) {
+    while (!g_queue_is_empty(&q->packets)) {
+        AVPacket *pkt = g_queue_pop_head(&q->packets);
+        av_packet_free(&pkt);
+    }
+}
+
+void packet_queue_clear(PacketQueue *q) {
+    drop_all(q);
+    g_mutex_clear(&q->lock);
+    g_cond_clear(&q->cond);
+}
+
+gboolean packet_queue_put(PacketQueue *q, AVPacket *pkt) {
+    g_mutex_lock(&q->lock);
+    guint interrupts = q->interrupts;
+    while (!q->aborted && q->interrupts == interrupts && g_queue_get_length(&q->packets) >= q->max_packets)
+        g_cond_wait(&q->cond, &q->lock);
+    if (q->aborted || q->interrupts != interrupts) {
+        g_mutex_unlock(&q->lock);
+        av_packet_free(&pkt);
+        return FALSE;
+    }
+    g_queue_push_tail(&q->packets, pkt);
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+    return TRUE;
+}
+
+gboolean packet_queue_get(PacketQueue *q, AVPacket **pkt, guint *serial) {
+    g_mutex_lock(&q->lock);
+    while (!q->aborted && g_queue_is_empty(&q->packets))
+        g_cond_wait(&q->cond, &q->lock);
+    if (q->aborted) {
+        g_mutex_unlock(&q->lock);
+        return FALSE;
+    }
+    *pkt = g_queue_pop_head(&q->packets);
+    if (serial)
+        *serial = q->serial;
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+    return TRUE;
+}
+
+void packet_queue_flush(PacketQueue *q, guint serial) {
+    g_mutex_lock(&q->lock);
+    drop_all(q);
+    q->serial = serial;
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+}
+
+void packet_queue_interrupt(PacketQueue *q) {
+    g_mutex_lock(&q->lock);
+    q->interrupts++;
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+}
+
+void packet_queue_abort(PacketQueue *q) {
+    g_mutex_lock(&q->lock);
+    q->aborted = TRUE;
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+}
+
+guint packet_queue_length(PacketQueue *q) {
+    g_mutex_lock(&q->lock);
+    guint len = g_queue_get_length(&q->packets);
+    g_mutex_unlock(&q->lock);
+    return len;
+}
@@ -0,0 +1,76 @@
+#include <glib.h>
+#include <string.h>
+#include <stdio.h>
+#include "perf_counters.h"
+#ifdef G_OS_WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+struct _PerfCounter {
+    const char *name;       // interned
+    PerfKind kind;
+    gint value;
+};
+
+static PerfCounter counters[PERF_MAX_COUNTERS];
+static gint n_counters;     // publicado só depois que o slot está preenchido
+static PerfCounter overflow;
+static GMutex register_lock;
+
+PerfCounter *perf_counter_register(const char *name, PerfKind kind) {
+    g_mutex_lock(&register_lock);
+    guint n = (guint)g_atomic_int_get(&n_counters);
+    PerfCounter *c = NULL;
+    for (guint i = 0; i < n && !c; i++) {
+        if (strcmp(counters[i].name, name) == 0)
+            c = &counters[i];
+    }
+    if (!c && n < PERF_MAX_COUNTERS) {
+        c = &counters[n];
+        c->name = g_intern_string(name);
+        c->kind = kind;
+        c->value = 0;
+        g_atomic_int_set(&n_counters, (gint)n + 1);
+    }
+    g_mutex_unlock(&register_lock);
+    return c ? c : &overflow;
+}
+
+void perf_counter_add(PerfCounter *c, gint delta) {
+    g_atomic_int_add(&c->value, delta);
+}
+
+void perf_counter_set(PerfCounter *c, gint value) {
+    g_atomic_int_set(&c->value, value);
+}
+
+guint perf_counters_snapshot(PerfSample *out, guint max) {
+    guint n = MIN((guint)g_atomic_int_get(&n_counters), max);
+    for (guint i = 0; i < n; i++) {
+        out[i].name = counters[i].name;
+        out[i].kind = counters[i].kind;
+        out[i].value = g_atomic_int_get(&counters[i].value);
+    }
+    return n;
+}
+
+gint perf_resident_kib(void) {
+#ifdef G_OS_WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof pmc))
+        return (gint)(pmc.WorkingSetSize / 1024);
+    return -1;
+#else
+    // Linux: segunda coluna de /proc/self/statm, em páginas
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+    long size = 0, resident = 0;
+    int got = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    return got == 2 ? (gint)(resident * (sysconf(_SC_PAGESIZE) / 1024)) : -1;
+#endif
+}
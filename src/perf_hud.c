@@ -0,0 +1,224 @@
+#include <gtk/gtk.h>
+#include <string.h>
+#include "perf_hud.h"
+#include "perf_counters.h"
+
+#define HUD_REFRESH_MS  250
+#define HUD_WIDTH       300
+#define HUD_PADDING     8
+#define HUD_BAR_HEIGHT  12
+#define HUD_LABEL_WIDTH 44
+#define HUD_FONT        "Monospace 9"
+
+// Faixas do histograma do tempo de desenho (a última não tem limite)
+#define HIST_BUCKETS 6
+static const gint64 bucket_limit_us[HIST_BUCKETS - 1] = { 2000, 4000, 8000, 16667, 33333 };
+static const char *const bucket_names[HIST_BUCKETS] = { "<2", "<4", "<8", "<16", "<33", "33+" };
+
+typedef struct {
+    GtkWidget *area;
+    GdkFrameClock *clock;
+    gulong before_id, after_id;
+    guint refresh_id;
+
+    // Quadros da UI: histograma desde que o painel apareceu, o resto por intervalo
+    gint64 paint_start_us;
+    guint hist[HIST_BUCKETS];
+    guint frames;
+    gint64 paint_total_us, paint_max_us;
+
+    // Amostra anterior, para a taxa dos contadores acumulados
+    gint prev[PERF_MAX_COUNTERS];
+    guint n_prev;
+    gint64 prev_time_us;
+
+    gchar *text;
+} PerfHud;
+
+static void on_before_paint(GdkFrameClock *clock, PerfHud *h) {
+    (void)clock;
+    h->paint_start_us = g_get_monotonic_time();
+}
+
+static void on_after_paint(GdkFrameClock *clock, PerfHud *h) {
+    (void)clock;
+    if (h->paint_start_us == 0)
+        return;
+    gint64 spent = g_get_monotonic_time() - h->paint_start_us;
+    guint b = 0;
+    while (b < HIST_BUCKETS - 1 && spent >= bucket_limit_us[b])
+        b++;
+    h->hist[b]++;
+    h->frames++;
+    h->paint_total_us += spent;
+    h->paint_max_us = MAX(h->paint_max_us, spent);
+}
+
+static void append_kib(GString *s, gint kib) {
+    if (kib < 0)
+        g_string_append(s, "?");
+    else if (kib >= 1024)
+        g_string_append_printf(s, "%.1f MiB", kib / 1024.0);
+    else
+        g_string_append_printf(s, "%d KiB", kib);
+}
+
+static PangoLayout *create_layout(PerfHud *h) {
+    PangoLayout *layout = gtk_widget_create_pango_layout(h->area, h->text);
+    PangoFontDescription *font = pango_font_description_from_string(HUD_FONT);
+    pango_layout_set_font_description(layout, font);
+    pango_font_description_free(font);
+    return layout;
+}
+
+static gboolean on_refresh(gpointer user_data) {
+    PerfHud *h = user_data;
+    gint64 now = g_get_monotonic_time();
+    double dt = MAX(now - h->prev_time_us, 1) / (double)G_USEC_PER_SEC;
+
+    GString *s = g_string_new(NULL);
+    g_string_append_printf(s, "UI  %.0f q/s  desenho %.1f ms (máx %.1f)\n",
+                           h->frames / dt,
+                           h->frames ? h->paint_total_us / 1000.0 / h->frames : 0.0,
+                           h->paint_max_us / 1000.0);
+    g_string_append(s, "memória residente  ");
+    append_kib(s, perf_resident_kib());
+
+    PerfSample samples[PERF_MAX_COUNTERS];
+    guint n = perf_counters_snapshot(samples, PERF_MAX_COUNTERS);
+    for (guint i = 0; i < n; i++) {
+        g_string_append_printf(s, "\n%-22s ", samples[i].name);
+        switch (samples[i].kind) {
+        case PERF_KIB:
+            append_kib(s, samples[i].value);
+            break;
+        case PERF_COUNT:
+            g_string_append_printf(s, "%d", samples[i].value);
+            // Contador que acabou de aparecer ainda não tem taxa
+            if (i < h->n_prev)
+                g_string_append_printf(s, " (%.0f/s)", (samples[i].value - h->prev[i]) / dt);
+            break;
+        default:
+            g_string_append_printf(s, "%d", samples[i].value);
+            break;
+        }
+        h->prev[i] = samples[i].value;
+    }
+    h->n_prev = n;
+    h->prev_time_us = now;
+    h->frames = 0;
+    h->paint_total_us = 0;
+    h->paint_max_us = 0;
+
+    g_free(h->text);
+    h->text = g_string_free(s, FALSE);
+
+    PangoLayout *layout = create_layout(h);
+    int text_h;
+    pango_layout_get_pixel_size(layout, NULL, &text_h);
+    g_object_unref(layout);
+    gtk_drawing_area_set_content_height(GTK_DRAWING_AREA(h->area),
+                                        2 * HUD_PADDING + text_h + HUD_PADDING + HIST_BUCKETS * HUD_BAR_HEIGHT);
+    gtk_widget_queue_draw(h->area);
+    return G_SOURCE_CONTINUE;
+}
+
+static void draw(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer user_data) {
+    (void)area;
+    PerfHud *h = user_data;
+    if (!h->text)
+        return;
+
+    cairo_set_source_rgba(cr, 0, 0, 0, 0.72);
+    cairo_rectangle(cr, 0, 0, width, height);
+    cairo_fill(cr);
+
+    PangoLayout *layout = create_layout(h);
+    int text_h;
+    pango_layout_get_pixel_size(layout, NULL, &text_h);
+    cairo_set_source_rgb(cr, 0.9, 0.9, 0.9);
+    cairo_move_to(cr, HUD_PADDING, HUD_PADDING);
+    pango_cairo_show_layout(cr, layout);
+
+    // Histograma: uma barra por faixa, proporcional à faixa mais cheia
+    guint max = 1;
+    for (guint b = 0; b < HIST_BUCKETS; b++)
+        max = MAX(max, h->hist[b]);
+    double y = 2 * HUD_PADDING + text_h;
+    double bar_w = width - 2 * HUD_PADDING - HUD_LABEL_WIDTH;
+    for (guint b = 0; b < HIST_BUCKETS; b++, y += HUD_BAR_HEIGHT) {
+        gchar *label = g_strdup_printf("%s ms", bucket_names[b]);
+        pango_layout_set_text(layout, label, -1);
+        g_free(label);
+        cairo_set_source_rgb(cr, 0.9, 0.9, 0.9);
+        cairo_move_to(cr, HUD_PADDING, y);
+        pango_cairo_show_layout(cr, layout);
+
+        // Verde dentro de um quadro a 60 Hz, amarelo até 30 Hz, vermelho depois
+        if (b < 4)
+            cairo_set_source_rgb(cr, 0.35, 0.8, 0.45);
+        else if (b == 4)
+            cairo_set_source_rgb(cr, 0.9, 0.75, 0.3);
+        else
+            cairo_set_source_rgb(cr, 0.9, 0.35, 0.3);
+        cairo_rectangle(cr, HUD_PADDING + HUD_LABEL_WIDTH, y + 2,
+                        MAX(1.0, bar_w * h->hist[b] / max), HUD_BAR_HEIGHT - 4);
+        cairo_fill(cr);
+    }
+    g_object_unref(layout);
+}
+
+// Só mede e redesenha enquanto está na tela
+static void on_map(GtkWidget *widget, PerfHud *h) {
+    h->clock = gtk_widget_get_frame_clock(widget);
+    if (h->clock) {
+        h->before_id = g_signal_connect(h->clock, "before-paint", G_CALLBACK(on_before_paint), h);
+        h->after_id = g_signal_connect(h->clock, "after-paint", G_CALLBACK(on_after_paint), h);
+    }
+    memset(h->hist, 0, sizeof h->hist);
+    h->paint_start_us = 0;
+    h->n_prev = 0;
+    h->prev_time_us = g_get_monotonic_time();
+    h->refresh_id = g_timeout_add(HUD_REFRESH_MS, on_refresh, h);
+    on_refresh(h);
+}
+
+static void on_unmap(GtkWidget *widget, PerfHud *h) {
+    (void)widget;
+    if (h->clock) {
+        g_signal_handler_disconnect(h->clock, h->before_id);
+        g_signal_handler_disconnect(h->clock, h->after_id);
+        h->clock = NULL;
+    }
+    if (h->refresh_id) {
+        g_source_remove(h->refresh_id);
+        h->refresh_id = 0;
+    }
+}
+
+static void perf_hud_free(gpointer data) {
+    PerfHud *h = data;
+    g_free(h->text);
+    g_free(h);
+}
+
+GtkWidget *perf_hud_new(void) {
+    PerfHud *h = g_new0(PerfHud, 1);
+    h->area = gtk_drawing_area_new();
+    gtk_drawing_area_set_content_width(GTK_DRAWING_AREA(h->area), HUD_WIDTH);
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(h->area), draw, h, NULL);
+    gtk_widget_set_halign(h->area, GTK_ALIGN_END);
+    gtk_widget_set_valign(h->area, GTK_ALIGN_START);
+    gtk_widget_set_margin_top(h->area, 48);
+    gtk_widget_set_margin_end(h->area, 12);
+    gtk_widget_set_can_target(h->area, FALSE);
+    gtk_widget_set_visible(h->area, FALSE);
+    g_signal_connect(h->area, "map", G_CALLBACK(on_map), h);
+    g_signal_connect(h->area, "unmap", G_CALLBACK(on_unmap), h);
+    g_object_set_data_full(G_OBJECT(h->area), "perf-hud", h, perf_hud_free);
+    return h->area;
+}
+
+void perf_hud_toggle(GtkWidget *hud) {
+    gtk_widget_set_visible(hud, !gtk_widget_get_visible(hud));
+}
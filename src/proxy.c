@@ -0,0 +1,487 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libswresample/swresample.h>
+#include "proxy.h"
+#include "media_util.h"
+#include "media_cache.h"
+#include "trace.h"
+
+// A versão do formato vai no tipo: arquivos do cache sem cabeçalho (ver media_cache.h)
+#define PROXY_KIND          "prx1"
+#define PROXY_CRF           23
+#define PROXY_MJPEG_QSCALE  4
+#define PROXY_AUDIO_BITRATE 128000
+// Quadro de áudio para encoders sem tamanho fixo (PCM)
+#define PROXY_AUDIO_FRAME   1024
+
+static gboolean enabled = FALSE;
+
+void proxy_set_enabled(gboolean on) {
+    enabled = on;
+}
+
+gboolean proxy_get_enabled(void) {
+    return enabled;
+}
+
+typedef struct {
+    const char *path;
+    AVFormatContext *in;
+    AVFormatContext *out;
+    AVCodecContext *dec;
+    AVCodecContext *enc;
+    int vin, ain;           // streams do original (ain = -1: sem áudio)
+    int vout, aout;
+    struct SwsContext *sws;
+    AVFrame *frame;
+    AVFrame *scaled;
+    AVPacket *pkt;
+    gint64 last_pts;        // o proxy só aceita pts crescentes
+
+    // Áudio recodificado, quando o do original não cabe no NUT como está
+    AVCodecContext *adec;
+    AVCodecContext *aenc;
+    SwrContext *swr;
+    AVFrame *aframe;
+    gint64 next_apts;       // no time base do encoder de áudio (1/taxa)
+} ProxyRun;
+
+// O proxy divide a CPU com o player: metade dos núcleos
+static int worker_threads(void) {
+    return MAX(1, (int)g_get_num_processors() / 2);
+}
+
+// Mesmo enquadramento do player: aspecto do pixel aplicado, nunca amplia
+static void fit_size(AVCodecContext *dec, int max_w, int max_h, int *w, int *h) {
+    AVRational sar = dec->sample_aspect_ratio;
+    double dw = dec->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+    double s = MIN(1.0, MIN(max_w / dw, max_h / (double)dec->height));
+    *w = MAX(2, (int)(dw * s) & ~1);
+    *h = MAX(2, (int)(dec->height * s) & ~1);
+}
+
+static gboolean open_decoder(ProxyRun *run, GError **error) {
+    const AVCodec *codec = NULL;
+    run->vin = av_find_best_stream(run->in, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (run->vin < 0 || !codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", run->path);
+        return FALSE;
+    }
+    // O mesmo áudio que o player escolheria no original
+    run->ain = av_find_best_stream(run->in, AVMEDIA_TYPE_AUDIO, -1, run->vin, NULL, 0);
+    if (run->ain < 0)
+        run->ain = -1;
+    for (unsigned i = 0; i < run->in->nb_streams; i++)
+        run->in->streams[i]->discard = (int)i == run->vin || (int)i == run->ain ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    AVStream *st = run->in->streams[run->vin];
+    run->dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(run->dec, st->codecpar);
+    run->dec->pkt_timebase = st->time_base;
+    run->dec->thread_count = worker_threads();
+    run->dec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    int ret = avcodec_open2(run->dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// H.264 só com quadros intra (todo quadro é keyframe) ajustado para decodificar
+// rápido; sem libx264, MJPEG, que é intra por natureza
+static gboolean open_encoder(ProxyRun *run, int width, int height, GError **error) {
+    AVStream *st = run->in->streams[run->vin];
+    const AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+    gboolean x264 = codec != NULL;
+    if (!codec)
+        codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    if (!codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Nenhum encoder intra disponível para o proxy");
+        return FALSE;
+    }
+
+    AVCodecContext *enc = run->enc = avcodec_alloc_context3(codec);
+    enc->width = width;
+    enc->height = height;
+    enc->sample_aspect_ratio = (AVRational){ 1, 1 };
+    // Os pts do original passam sem conversão: é isso que mantém o mapeamento exato
+    enc->time_base = st->time_base;
+    enc->framerate = st->avg_frame_rate;
+    enc->gop_size = 1;
+    enc->max_b_frames = 0;
+    enc->thread_count = worker_threads();
+    if (run->out->oformat->flags & AVFMT_GLOBALHEADER)
+        enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary *opts = NULL;
+    if (x264) {
+        enc->pix_fmt = AV_PIX_FMT_YUV420P;
+        av_dict_set(&opts, "preset", "veryfast", 0);
+        av_dict_set(&opts, "tune", "fastdecode", 0);
+        av_dict_set_int(&opts, "crf", PROXY_CRF, 0);
+    } else {
+        enc->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        enc->flags |= AV_CODEC_FLAG_QSCALE;
+        enc->global_quality = FF_QP2LAMBDA * PROXY_MJPEG_QSCALE;
+    }
+    int ret = avcodec_open2(enc, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        return FALSE;
+    }
+
+    run->scaled->format = enc->pix_fmt;
+    run->scaled->width = width;
+    run->scaled->height = height;
+    if (av_frame_get_buffer(run->scaled, 0) < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Sem memória para o quadro");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Encoder para o áudio que o NUT não carrega: AAC, ou PCM se o FFmpeg não
+// tiver o AAC. Até dois canais, que é o que o player toca.
+static gboolean open_audio_transcode(ProxyRun *run, GError **error) {
+    static const struct {
+        enum AVCodecID id;
+        enum AVSampleFormat sample_fmt;
+    } targets[] = {
+        { AV_CODEC_ID_AAC, AV_SAMPLE_FMT_FLTP },
+        { AV_CODEC_ID_PCM_S16LE, AV_SAMPLE_FMT_S16 },
+    };
+    AVStream *ast = run->in->streams[run->ain];
+    const AVCodec *dec_codec = avcodec_find_decoder(ast->codecpar->codec_id);
+    const AVCodec *enc_codec = NULL;
+    enum AVSampleFormat sample_fmt = AV_SAMPLE_FMT_NONE;
+    for (guint i = 0; i < G_N_ELEMENTS(targets) && !enc_codec; i++) {
+        if (avformat_query_codec(run->out->oformat, targets[i].id, FF_COMPLIANCE_NORMAL) != 1)
+            continue;
+        enc_codec = avcodec_find_encoder(targets[i].id);
+        sample_fmt = targets[i].sample_fmt;
+    }
+    if (!dec_codec || !enc_codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Áudio %s não cabe no proxy",
+                    avcodec_get_name(ast->codecpar->codec_id));
+        return FALSE;
+    }
+
+    run->adec = avcodec_alloc_context3(dec_codec);
+    int ret = avcodec_parameters_to_context(run->adec, ast->codecpar);
+    run->adec->pkt_timebase = ast->time_base;
+    if (ret >= 0)
+        ret = avcodec_open2(run->adec, dec_codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, dec_codec->name);
+        return FALSE;
+    }
+
+    AVCodecContext *enc = run->aenc = avcodec_alloc_context3(enc_codec);
+    enc->sample_fmt = sample_fmt;
+    enc->sample_rate = run->adec->sample_rate;
+    av_channel_layout_default(&enc->ch_layout, MIN(MAX(run->adec->ch_layout.nb_channels, 1), 2));
+    enc->time_base = (AVRational){ 1, enc->sample_rate };
+    enc->bit_rate = PROXY_AUDIO_BITRATE;
+    if (run->out->oformat->flags & AVFMT_GLOBALHEADER)
+        enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    ret = avcodec_open2(enc, enc_codec, NULL);
+    if (ret >= 0)
+        ret = swr_alloc_set_opts2(&run->swr, &enc->ch_layout, enc->sample_fmt, enc->sample_rate,
+                                  &run->adec->ch_layout, run->adec->sample_fmt, run->adec->sample_rate, 0, NULL);
+    if (ret >= 0)
+        ret = swr_init(run->swr);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, enc_codec->name);
+        return FALSE;
+    }
+    run->aframe = av_frame_alloc();
+    run->next_apts = AV_NOPTS_VALUE;
+    return TRUE;
+}
+
+static gboolean open_output(ProxyRun *run, const char *tmp_path, GError **error) {
+    AVStream *vst = run->in->streams[run->vin];
+    AVStream *ost = avformat_new_stream(run->out, NULL);
+    if (!ost) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Não foi possível criar %s", tmp_path);
+        return FALSE;
+    }
+    avcodec_parameters_from_context(ost->codecpar, run->enc);
+    ost->time_base = run->enc->time_base;
+    ost->avg_frame_rate = vst->avg_frame_rate;
+    run->vout = ost->index;
+
+    // O áudio é copiado como está quando o NUT o carrega; senão é recodificado
+    run->aout = -1;
+    if (run->ain >= 0) {
+        AVStream *ast = run->in->streams[run->ain];
+        gboolean copy = avformat_query_codec(run->out->oformat, ast->codecpar->codec_id, FF_COMPLIANCE_NORMAL) == 1;
+        if (!copy && !open_audio_transcode(run, error))
+            return FALSE;
+        AVStream *aost = avformat_new_stream(run->out, NULL);
+        if (!aost) {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Não foi possível criar %s", tmp_path);
+            return FALSE;
+        }
+        if (copy) {
+            avcodec_parameters_copy(aost->codecpar, ast->codecpar);
+            aost->codecpar->codec_tag = 0;
+            aost->time_base = ast->time_base;
+        } else {
+            avcodec_parameters_from_context(aost->codecpar, run->aenc);
+            aost->time_base = run->aenc->time_base;
+        }
+        run->aout = aost->index;
+    }
+
+    int ret;
+    if ((ret = avio_open(&run->out->pb, tmp_path, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(run->out, NULL)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, tmp_path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean encode_and_write(ProxyRun *run, AVCodecContext *enc, int stream, AVFrame *frame, GError **error) {
+    AVPacket *pkt = run->pkt;
+    int ret = avcodec_send_frame(enc, frame);
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(enc, pkt);
+        if (ret < 0)
+            break;
+        av_packet_rescale_ts(pkt, enc->time_base, run->out->streams[stream]->time_base);
+        pkt->stream_index = stream;
+        ret = av_interleaved_write_frame(run->out, pkt);
+    }
+    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, enc->codec->name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Passa ao encoder de áudio o que o resampler acumulou, em quadros do tamanho
+// que ele pede; no fim ("flush") vai também o resto
+static gboolean write_audio(ProxyRun *run, gboolean flush, GError **error) {
+    AVCodecContext *enc = run->aenc;
+    int frame_size = enc->frame_size > 0 ? enc->frame_size : PROXY_AUDIO_FRAME;
+    while (flush || swr_get_delay(run->swr, enc->sample_rate) >= frame_size) {
+        AVFrame *f = run->aframe;
+        av_frame_unref(f);
+        f->format = enc->sample_fmt;
+        f->sample_rate = enc->sample_rate;
+        f->nb_samples = frame_size;
+        av_channel_layout_copy(&f->ch_layout, &enc->ch_layout);
+        if (av_frame_get_buffer(f, 0) < 0) {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Sem memória para o quadro");
+            return FALSE;
+        }
+        int n = swr_convert(run->swr, f->data, frame_size, NULL, 0);
+        if (n < 0) {
+            media_set_av_error(error, MEDIA_ERROR_CODEC, n, "resample");
+            return FALSE;
+        }
+        if (n == 0)
+            break;
+        f->nb_samples = n;
+        f->pts = run->next_apts;
+        run->next_apts += n;
+        if (!encode_and_write(run, enc, run->aout, f, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Decodifica o pacote de áudio ("pkt" NULL: fim) e recodifica o que sair
+static gboolean transcode_audio(ProxyRun *run, AVPacket *pkt, GError **error) {
+    AVStream *ast = run->in->streams[run->ain];
+    avcodec_send_packet(run->adec, pkt);
+    AVFrame *frame = run->frame;
+    while (avcodec_receive_frame(run->adec, frame) >= 0) {
+        // O primeiro quadro fixa a origem: daí em diante conta amostras, e o
+        // áudio do proxy fica nos mesmos instantes do original
+        if (run->next_apts == AV_NOPTS_VALUE) {
+            gint64 pts = frame->best_effort_timestamp;
+            run->next_apts = pts != AV_NOPTS_VALUE
+                ? av_rescale_q(pts, ast->time_base, run->aenc->time_base) : 0;
+        }
+        int ret = swr_convert(run->swr, NULL, 0, (const uint8_t **)frame->extended_data, frame->nb_samples);
+        av_frame_unref(frame);
+        if (ret < 0) {
+            media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "resample");
+            return FALSE;
+        }
+        if (!write_audio(run, FALSE, error))
+            return FALSE;
+    }
+    if (!pkt && run->next_apts != AV_NOPTS_VALUE &&
+        (!write_audio(run, TRUE, error) || !encode_and_write(run, run->aenc, run->aout, NULL, error)))
+        return FALSE;
+    return TRUE;
+}
+
+// Escala e codifica todos os quadros que o decodificador tiver prontos
+static gboolean drain_decoder(ProxyRun *run, int *got, GError **error) {
+    AVCodecContext *enc = run->enc;
+    AVFrame *frame = run->frame;
+    while (avcodec_receive_frame(run->dec, frame) >= 0) {
+        (*got)++;
+        gint64 pts = frame->best_effort_timestamp;
+        // Sem pts não há como mapear de volta ao original; repetido, o NUT recusa
+        if (pts == AV_NOPTS_VALUE || pts <= run->last_pts) {
+            av_frame_unref(frame);
+            continue;
+        }
+        run->last_pts = pts;
+        run->sws = sws_getCachedContext(run->sws, frame->width, frame->height, frame->format,
+                                        enc->width, enc->height, enc->pix_fmt,
+                                        SWS_BICUBIC, NULL, NULL, NULL);
+        // O encoder pode ainda guardar o quadro anterior
+        if (av_frame_make_writable(run->scaled) < 0) {
+            av_frame_unref(frame);
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Sem memória para o quadro");
+            return FALSE;
+        }
+        sws_scale(run->sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height,
+                  run->scaled->data, run->scaled->linesize);
+        av_frame_unref(frame);
+        run->scaled->pts = pts;
+        if (!encode_and_write(run, enc, run->vout, run->scaled, error))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean transcode(ProxyRun *run, GCancellable *cancellable, GError **error) {
+    AVPacket *pkt = av_packet_alloc();
+    gboolean draining = FALSE, ok = TRUE;
+    guint64 budget = media_cache_get_file_budget();
+    while (ok) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        // Um proxy que sozinho passa do orçamento seria recusado pelo cache no
+        // fim: melhor parar já do que gastar minutos de CPU e disco
+        if ((guint64)MAX(avio_tell(run->out->pb), 0) > budget) {
+            g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "%s: o proxy passaria do orçamento do cache (%"
+                        G_GUINT64_FORMAT " MB)", run->path, budget / (1024 * 1024));
+            ok = FALSE;
+            break;
+        }
+        if (!draining) {
+            int ret = av_read_frame(run->in, pkt);
+            if (ret >= 0 && pkt->stream_index == run->ain && run->adec) {
+                ok = transcode_audio(run, pkt, error);
+                av_packet_unref(pkt);
+                continue;
+            }
+            if (ret >= 0 && pkt->stream_index == run->ain) {
+                AVStream *ast = run->in->streams[run->ain];
+                av_packet_rescale_ts(pkt, ast->time_base, run->out->streams[run->aout]->time_base);
+                pkt->stream_index = run->aout;
+                pkt->pos = -1;
+                if ((ret = av_interleaved_write_frame(run->out, pkt)) < 0) {
+                    media_set_av_error(error, MEDIA_ERROR_IO, ret, run->path);
+                    ok = FALSE;
+                }
+                continue;
+            }
+            if (ret >= 0 && pkt->stream_index != run->vin) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            if (ret < 0)
+                draining = TRUE;
+            avcodec_send_packet(run->dec, draining ? NULL : pkt);
+            av_packet_unref(pkt);
+        }
+        int got = 0;
+        ok = drain_decoder(run, &got, error);
+        if (draining && got == 0)
+            break;
+    }
+    if (ok)
+        ok = encode_and_write(run, run->enc, run->vout, NULL, error);
+    if (ok && run->adec)
+        ok = transcode_audio(run, NULL, error);
+    int ret;
+    if (ok && (ret = av_write_trailer(run->out)) < 0) {
+        media_set_av_error(error, MEDIA_ERROR_IO, ret, run->path);
+        ok = FALSE;
+    }
+    av_packet_free(&pkt);
+    return ok;
+}
+
+static void proxy_run_clear(ProxyRun *run) {
+    if (run->out) {
+        avio_closep(&run->out->pb);
+        avformat_free_context(run->out);
+    }
+    sws_freeContext(run->sws);
+    swr_free(&run->swr);
+    avcodec_free_context(&run->dec);
+    avcodec_free_context(&run->enc);
+    avcodec_free_context(&run->adec);
+    avcodec_free_context(&run->aenc);
+    av_frame_free(&run->aframe);
+    av_frame_free(&run->frame);
+    av_frame_free(&run->scaled);
+    av_packet_free(&run->pkt);
+    avformat_close_input(&run->in);
+}
+
+gchar *proxy_build(const char *path, int max_width, int max_height, GCancellable *cancellable, GError **error) {
+    MediaCacheKey key;
+    if (!media_cache_key(path, &key)) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_OPEN, "%s: não foi possível ler o arquivo", path);
+        return NULL;
+    }
+    gchar *cached = media_cache_lookup_file(&key, PROXY_KIND);
+    if (cached)
+        return cached;
+
+    gint64 t = trace_begin();
+    ProxyRun run = { .path = path, .vin = -1, .ain = -1, .vout = -1, .aout = -1, .last_pts = G_MININT64 };
+    run.in = media_open_input(path, error);
+    if (!run.in)
+        return NULL;
+    run.frame = av_frame_alloc();
+    run.scaled = av_frame_alloc();
+    run.pkt = av_packet_alloc();
+
+    gchar *tmp_path = NULL;
+    gboolean ok = open_decoder(&run, error);
+    int width = 0, height = 0;
+    if (ok) {
+        fit_size(run.dec, max_width, max_height, &width, &height);
+        if (run.dec->width <= max_width && run.dec->height <= max_height) {
+            proxy_run_clear(&run);
+            return NULL;
+        }
+        tmp_path = media_cache_create_temp(&key, PROXY_KIND, error);
+        ok = tmp_path != NULL;
+    }
+    if (ok && avformat_alloc_output_context2(&run.out, NULL, "nut", tmp_path) < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_IO, "Não foi possível criar %s", tmp_path);
+        ok = FALSE;
+    }
+    ok = ok && open_encoder(&run, width, height, error) && open_output(&run, tmp_path, error) &&
+         transcode(&run, cancellable, error);
+    proxy_run_clear(&run);
+
+    if (ok)
+        ok = media_cache_commit_file(&key, PROXY_KIND, tmp_path, error);
+    if (!ok && tmp_path)
+        g_remove(tmp_path);
+    g_free(tmp_path);
+    trace_end("proxy build", "media", t);
+    return ok ? media_cache_lookup_file(&key, PROXY_KIND) : NULL;
+}
@@ -0,0 +1,128 @@
+#include <gtk/gtk.h>
+#include "render_mode.h"
+#include "anim_scheduler.h"
+#include "trace.h"
+
+// Orçamento de CPU por quadro (desenho + layout) antes de cair para o modo leve
+#define FRAME_BUDGET_US 8000
+// Quadros ignorados no começo (o primeiro layout é sempre caro)
+#define WARMUP_FRAMES 30
+// Peso de cada quadro novo na média móvel
+#define EMA_WEIGHT 0.05
+
+static RenderMode mode = RENDER_MODE_AUTO;
+static gboolean playing = FALSE;
+static gboolean too_slow = FALSE;   // depois de medido lento, o automático fica leve
+static gboolean lite = FALSE;
+static GtkCssProvider *lite_provider = NULL;
+
+static gint64 paint_start_us = 0;
+static guint frames_seen = 0;
+static double frame_ema_us = 0;
+
+static const char *const mode_names[] = { "auto", "full", "lite" };
+
+gboolean render_mode_parse(const char *text, RenderMode *out) {
+    for (guint i = 0; i < G_N_ELEMENTS(mode_names); i++) {
+        if (g_ascii_strcasecmp(text, mode_names[i]) == 0) {
+            *out = (RenderMode)i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+const char *render_mode_to_string(RenderMode m) {
+    return mode_names[m];
+}
+
+// Por cima do estilo normal: tudo opaco e sem transformações
+static GtkCssProvider *create_lite_provider(void) {
+    GtkCssProvider *p = gtk_css_provider_new();
+    gtk_css_provider_load_from_string(p,
+        "#glass-background { background-color: rgb(18, 18, 18); }"
+        "window { background-color: rgb(18, 18, 18); border-radius: 0; }"
+        "box    { border-radius: 0; }"
+        ".flip-in, .flip-out { animation: none; transform: none; }"
+        "* { transition: none; }"
+    );
+    return p;
+}
+
+static void apply(void) {
+    gboolean want = mode == RENDER_MODE_LITE || (mode == RENDER_MODE_AUTO && (playing || too_slow));
+    GdkDisplay *display = gdk_display_get_default();
+    if (want == lite || !display)
+        return;
+    lite = want;
+
+    if (!lite_provider)
+        lite_provider = create_lite_provider();
+    if (lite)
+        gtk_style_context_add_provider_for_display(display, GTK_STYLE_PROVIDER(lite_provider),
+                                                   GTK_STYLE_PROVIDER_PRIORITY_APPLICATION + 1);
+    else
+        gtk_style_context_remove_provider_for_display(display, GTK_STYLE_PROVIDER(lite_provider));
+    anim_scheduler_set_paused(lite);
+    trace_instant(lite ? "render mode: lite" : "render mode: full", "ui");
+}
+
+void render_mode_set(RenderMode m) {
+    mode = m;
+    if (m != RENDER_MODE_AUTO)
+        too_slow = FALSE;
+    apply();
+}
+
+RenderMode render_mode_get(void) {
+    return mode;
+}
+
+void render_mode_set_playing(gboolean is_playing) {
+    playing = is_playing;
+    apply();
+}
+
+gboolean render_mode_is_lite(void) {
+    return lite;
+}
+
+static void on_before_paint(GdkFrameClock *clock, gpointer user_data) {
+    (void)clock; (void)user_data;
+    paint_start_us = g_get_monotonic_time();
+}
+
+// Só mede enquanto a decoração completa está ligada: é ela que se quer avaliar
+static void on_after_paint(GdkFrameClock *clock, gpointer user_data) {
+    (void)clock; (void)user_data;
+    if (lite || mode != RENDER_MODE_AUTO || paint_start_us == 0)
+        return;
+    double spent = (double)(g_get_monotonic_time() - paint_start_us);
+    if (++frames_seen <= WARMUP_FRAMES) {
+        frame_ema_us = spent;
+        return;
+    }
+    frame_ema_us += EMA_WEIGHT * (spent - frame_ema_us);
+    if (frame_ema_us > FRAME_BUDGET_US) {
+        g_print("Quadros levando %.1f ms: usando o modo de renderização leve\n", frame_ema_us / 1000.0);
+        too_slow = TRUE;
+        apply();
+    }
+}
+
+static void on_window_map(GtkWidget *window, gpointer user_data) {
+    (void)user_data;
+    GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+    if (!clock || g_object_get_data(G_OBJECT(clock), "render-mode"))
+        return;
+    g_signal_connect(clock, "before-paint", G_CALLBACK(on_before_paint), NULL);
+    g_signal_connect(clock, "after-paint", G_CALLBACK(on_after_paint), NULL);
+    g_object_set_data(G_OBJECT(clock), "render-mode", GINT_TO_POINTER(1));
+}
+
+void render_mode_attach(GtkWidget *window) {
+    g_signal_connect(window, "map", G_CALLBACK(on_window_map), NULL);
+    if (gtk_widget_get_mapped(window))
+        on_window_map(window, NULL);
+    apply();
+}
@@ -0,0 +1,489 @@
+#include <glib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "scene_detect.h"
+#include "media_util.h"
+#include "media_cache.h"
+#include "seek_index.h"
+#include "trace.h"
+
+#define SCENE_VERSION 1
+#define SCENE_W 128                 // miniatura de luma comparada entre quadros
+#define SCENE_H 72
+#define SCENE_PIXELS (SCENE_W * SCENE_H)
+#define SCENE_BINS 64
+#define MIN_SEGMENT_US (30 * G_USEC_PER_SEC)
+#define MAX_SEGMENTS 256
+#define CUT_THRESHOLD 0.35f         // pontuação mínima de um corte
+#define ADAPTIVE_RATIO 3.0f         // ... e tantas vezes a média dos quadros anteriores
+#define SCORE_WINDOW 8
+#define MIN_SCENE_US (G_USEC_PER_SEC * 2 / 5)   // cortes mais próximos: fica o mais forte
+
+// Miniatura e histograma de um quadro (alocado com av_malloc: luma alinhada)
+typedef struct {
+    guint8 luma[SCENE_PIXELS];
+    guint32 hist[SCENE_BINS];
+    gint64 time_us;
+} Feature;
+
+typedef struct {
+    guint index;
+    gint64 start_us, end_us;    // absolutos; end exclusivo
+    gint64 seek_ts;             // keyframe onde a decodificação começa
+    GArray *cuts;               // SceneCut achados dentro do trecho
+    Feature *first, *last;      // quadros das pontas, para comparar com os vizinhos
+    gboolean done;
+    GError *error;
+} Segment;
+
+typedef struct {
+    const char *path;
+    int vin;
+    AVRational vtb;
+    gint64 origin_us;           // início do vídeo (absoluto): os cortes contam daqui
+    gint64 total_us;
+    GCancellable *cancellable;
+    SceneCutsFunc func;
+    gpointer user_data;
+    GPtrArray *segments;
+
+    GMutex lock;
+    GCond cond;
+    guint remaining;
+    gint64 done_us;
+    gboolean failed;            // algum trecho falhou: os outros são cancelados
+    GArray *seams;              // cortes bem na emenda entre dois trechos
+} SceneRun;
+
+// Soma das diferenças absolutas, 16 pixels por instrução
+static guint32 luma_sad(const guint8 *a, const guint8 *b, guint n) {
+    guint i = 0;
+    guint32 sum = 0;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_load_si128((const __m128i *)(a + i)),
+                                              _mm_load_si128((const __m128i *)(b + i))));
+    sum = (guint32)_mm_cvtsi128_si32(acc) + (guint32)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#elif defined(__ARM_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= n; i += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i))));
+    sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#endif
+    for (; i < n; i++)
+        sum += (guint32)abs(a[i] - b[i]);
+    return sum;
+}
+
+// Quatro histogramas parciais: pixels vizinhos iguais não disputam o mesmo contador
+static void luma_histogram(const guint8 *p, guint n, guint32 *hist) {
+    guint32 h[4][SCENE_BINS] = { { 0 } };
+    guint i = 0;
+    for (; i + 4 <= n; i += 4) {
+        h[0][p[i] >> 2]++;
+        h[1][p[i + 1] >> 2]++;
+        h[2][p[i + 2] >> 2]++;
+        h[3][p[i + 3] >> 2]++;
+    }
+    for (; i < n; i++)
+        h[0][p[i] >> 2]++;
+    for (int k = 0; k < SCENE_BINS; k++)
+        hist[k] = h[0][k] + h[1][k] + h[2][k] + h[3][k];
+}
+
+// 0 = quadros iguais. O histograma pega troca de conteúdo mesmo com movimento
+// parecido; a SAD pega troca de enquadramento com as mesmas cores.
+static float frame_score(const Feature *a, const Feature *b) {
+    guint32 hd = 0;
+    for (int k = 0; k < SCENE_BINS; k++)
+        hd += a->hist[k] > b->hist[k] ? a->hist[k] - b->hist[k] : b->hist[k] - a->hist[k];
+    double hist = hd / (2.0 * SCENE_PIXELS);
+    double sad = luma_sad(a->luma, b->luma, SCENE_PIXELS) / (255.0 * SCENE_PIXELS);
+    return (float)(0.6 * hist + 0.4 * MIN(sad * 4.0, 1.0));
+}
+
+// Acrescenta em ordem de tempo; perto demais do último, fica o mais forte
+static void push_cut(GArray *cuts, gint64 time_us, float score) {
+    SceneCut *last = cuts->len ? &g_array_index(cuts, SceneCut, cuts->len - 1) : NULL;
+    if (last && time_us - last->time_us < MIN_SCENE_US) {
+        if (score > last->score) {
+            last->time_us = time_us;
+            last->score = score;
+        }
+        return;
+    }
+    SceneCut c = { time_us, score };
+    g_array_append_val(cuts, c);
+}
+
+static gboolean analyze_segment(SceneRun *run, Segment *s, GError **error) {
+    AVFormatContext *in = media_open_input(run->path, error);
+    if (!in)
+        return FALSE;
+
+    AVCodecContext *dec = NULL;
+    struct SwsContext *sws = NULL;
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    Feature *prev = av_malloc(sizeof(Feature)), *cur = av_malloc(sizeof(Feature));
+    gboolean ok = FALSE, have_prev = FALSE;
+    float recent[SCORE_WINDOW];
+    guint n_recent = 0;
+
+    AVStream *vst = in->streams[run->vin];
+    for (unsigned i = 0; i < in->nb_streams; i++)
+        in->streams[i]->discard = (int)i == run->vin ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    const AVCodec *codec = avcodec_find_decoder(vst->codecpar->codec_id);
+    dec = codec ? avcodec_alloc_context3(codec) : NULL;
+    if (!dec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Codec de vídeo sem suporte");
+        goto out;
+    }
+    avcodec_parameters_to_context(dec, vst->codecpar);
+    dec->pkt_timebase = vst->time_base;
+    dec->thread_count = 1;  // o paralelismo vem dos trechos
+    // A miniatura não mostra a diferença e a decodificação fica bem mais leve
+    dec->skip_loop_filter = AVDISCARD_ALL;
+    dec->flags2 |= AV_CODEC_FLAG2_FAST;
+    int ret = avcodec_open2(dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        goto out;
+    }
+
+    gint64 start_ts = media_us_to_ts(s->start_us, vst->time_base);
+    gint64 end_ts = s->end_us == G_MAXINT64 ? G_MAXINT64 : media_us_to_ts(s->end_us, vst->time_base);
+    av_seek_frame(in, run->vin, s->seek_ts, AVSEEK_FLAG_BACKWARD);
+
+    gboolean past_end_key = FALSE, draining = FALSE;
+    ok = TRUE;
+    while (ok) {
+        if (g_cancellable_set_error_if_cancelled(run->cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        if (!draining) {
+            ret = av_read_frame(in, pkt);
+            if (ret >= 0 && pkt->stream_index != run->vin) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            gint64 ts = ret >= 0 ? (pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts) : AV_NOPTS_VALUE;
+            // Como na exportação: pacotes com pts antes do fim sempre entram, então
+            // o keyframe seguinte entra e os B-frames iniciais dele (GOP aberto, pts
+            // ainda deste trecho) também. Antes desse keyframe, um pacote depois do
+            // fim só encerra se o dts também já passou (B-frames do trecho ainda
+            // seguem o P-frame quando o fim não cai num keyframe). Depois dele, o
+            // primeiro pacote com pts do próximo trecho encerra.
+            if (ret >= 0 && ts != AV_NOPTS_VALUE && ts >= end_ts) {
+                gboolean dts_past = pkt->dts == AV_NOPTS_VALUE || pkt->dts >= end_ts;
+                if ((pkt->flags & AV_PKT_FLAG_KEY) && !past_end_key) {
+                    past_end_key = TRUE;
+                } else if (past_end_key || dts_past) {
+                    av_packet_unref(pkt);
+                    ret = AVERROR_EOF;
+                }
+            }
+            if (ret < 0)
+                draining = TRUE;
+            avcodec_send_packet(dec, draining ? NULL : pkt);
+            av_packet_unref(pkt);
+        }
+
+        int got = 0;
+        while (avcodec_receive_frame(dec, frame) >= 0) {
+            got++;
+            gint64 pts = frame->best_effort_timestamp;
+            if (pts == AV_NOPTS_VALUE || pts < start_ts || pts >= end_ts) {
+                av_frame_unref(frame);
+                continue;
+            }
+            sws = sws_getCachedContext(sws, frame->width, frame->height, frame->format,
+                                       SCENE_W, SCENE_H, AV_PIX_FMT_GRAY8, SWS_AREA, NULL, NULL, NULL);
+            uint8_t *dst[4] = { cur->luma };
+            int dst_stride[4] = { SCENE_W };
+            sws_scale(sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+            luma_histogram(cur->luma, SCENE_PIXELS, cur->hist);
+            cur->time_us = media_ts_to_us(pts, vst->time_base) - run->origin_us;
+            av_frame_unref(frame);
+
+            if (!have_prev) {
+                s->first = av_malloc(sizeof(Feature));
+                memcpy(s->first, cur, sizeof(Feature));
+            } else {
+                // Corte: bem acima do limite e das diferenças dos quadros anteriores
+                // (movimento de câmera sobe a média e não vira corte)
+                float score = frame_score(prev, cur), mean = 0.0f;
+                for (guint i = 0; i < n_recent; i++)
+                    mean += recent[i];
+                mean = n_recent ? mean / n_recent : 0.0f;
+                if (score >= CUT_THRESHOLD && score >= ADAPTIVE_RATIO * mean)
+                    push_cut(s->cuts, cur->time_us, score);
+                if (n_recent < SCORE_WINDOW)
+                    recent[n_recent++] = score;
+                else {
+                    memmove(recent, recent + 1, (SCORE_WINDOW - 1) * sizeof(float));
+                    recent[SCORE_WINDOW - 1] = score;
+                }
+            }
+            Feature *tmp = prev;
+            prev = cur;
+            cur = tmp;
+            have_prev = TRUE;
+        }
+        if (draining && got == 0)
+            break;
+    }
+    if (ok && have_prev) {
+        s->last = prev;
+        prev = NULL;
+    }
+
+out:
+    sws_freeContext(sws);
+    avcodec_free_context(&dec);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    av_free(prev);
+    av_free(cur);
+    avformat_close_input(&in);
+    return ok;
+}
+
+// Compara as pontas de dois trechos vizinhos quando os dois já terminaram
+static void check_seam(SceneRun *run, Segment *a, Segment *b, GArray *found) {
+    if (!a->done || !b->done || !a->last || !b->first)
+        return;
+    float score = frame_score(a->last, b->first);
+    if (score < CUT_THRESHOLD)
+        return;
+    SceneCut c = { b->first->time_us, score };
+    g_array_append_val(run->seams, c);
+    g_array_append_val(found, c);
+}
+
+static void segment_worker(gpointer data, gpointer user_data) {
+    Segment *s = data;
+    SceneRun *run = user_data;
+    gint64 t = trace_begin();
+    gboolean ok = analyze_segment(run, s, &s->error);
+    trace_end("scene segment", "media", t);
+
+    g_mutex_lock(&run->lock);
+    s->done = TRUE;
+    if (!ok && s->error && !g_error_matches(s->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        run->failed = TRUE;
+    if (ok) {
+        GArray *found = g_array_copy(s->cuts);
+        if (s->index > 0)
+            check_seam(run, g_ptr_array_index(run->segments, s->index - 1), s, found);
+        if (s->index + 1 < run->segments->len)
+            check_seam(run, s, g_ptr_array_index(run->segments, s->index + 1), found);
+        run->done_us += s->end_us - s->start_us;
+        double fraction = run->total_us > 0 ? (double)run->done_us / run->total_us : 0.0;
+        // Chamada com o lock: as entregas nunca se cruzam
+        if (run->func)
+            run->func((const SceneCut *)found->data, found->len, MIN(fraction, 1.0), run->user_data);
+        g_array_unref(found);
+    }
+    run->remaining--;
+    g_cond_signal(&run->cond);
+    g_mutex_unlock(&run->lock);
+}
+
+// Trechos que começam em keyframes, para nenhum worker decodificar quadros só
+// para descartá-los. Mais trechos que workers: os resultados chegam aos poucos
+// e um trecho difícil não deixa os outros núcleos parados no final.
+static void plan_segments(SceneRun *run, SeekIndex *idx, gint64 end_us, guint threads) {
+    gint64 start_us = run->origin_us;
+    guint n = end_us == G_MAXINT64 ? 1
+        : (guint)CLAMP((end_us - start_us) / MIN_SEGMENT_US, 1, MIN(threads * 4, MAX_SEGMENTS));
+    GArray *keyframes = seek_index_get_keyframes(idx);
+
+    gint64 bounds[MAX_SEGMENTS + 1];
+    guint nb = 0, k = 0;
+    bounds[nb++] = start_us;
+    for (guint i = 1; i < n; i++) {
+        gint64 target = start_us + (end_us - start_us) * i / n;
+        while (k < keyframes->len && g_array_index(keyframes, SeekEntry, k).pts_us < target)
+            k++;
+        gint64 b = k < keyframes->len ? g_array_index(keyframes, SeekEntry, k).pts_us : target;
+        if (b > bounds[nb - 1] && b < end_us)
+            bounds[nb++] = b;
+    }
+    bounds[nb] = end_us;
+    g_array_unref(keyframes);
+
+    for (guint i = 0; i < nb; i++) {
+        Segment *s = g_new0(Segment, 1);
+        s->index = i;
+        s->start_us = bounds[i];
+        s->end_us = bounds[i + 1];
+        s->cuts = g_array_new(FALSE, FALSE, sizeof(SceneCut));
+        SeekEntry kf;
+        s->seek_ts = seek_index_lookup(idx, s->start_us, &kf) ? kf.ts : media_us_to_ts(s->start_us, run->vtb);
+        if (s->end_us != G_MAXINT64)
+            run->total_us += s->end_us - s->start_us;
+        g_ptr_array_add(run->segments, s);
+    }
+}
+
+static void segment_free(gpointer data) {
+    Segment *s = data;
+    g_array_unref(s->cuts);
+    av_free(s->first);
+    av_free(s->last);
+    g_clear_error(&s->error);
+    g_free(s);
+}
+
+static gint compare_cut_time(gconstpointer a, gconstpointer b) {
+    const SceneCut *ca = a, *cb = b;
+    return ca->time_us < cb->time_us ? -1 : ca->time_us > cb->time_us;
+}
+
+// Junta trechos e emendas em ordem, aplicando a duração mínima de cena entre eles
+static GArray *collect_cuts(SceneRun *run) {
+    GArray *all = g_array_copy(run->seams);
+    for (guint i = 0; i < run->segments->len; i++) {
+        Segment *s = g_ptr_array_index(run->segments, i);
+        g_array_append_vals(all, s->cuts->data, s->cuts->len);
+    }
+    g_array_sort(all, compare_cut_time);
+
+    GArray *cuts = g_array_sized_new(FALSE, FALSE, sizeof(SceneCut), all->len);
+    for (guint i = 0; i < all->len; i++) {
+        const SceneCut *c = &g_array_index(all, SceneCut, i);
+        // Um corte no primeiro quadro não separa nada
+        if (c->time_us > 0)
+            push_cut(cuts, c->time_us, c->score);
+    }
+    g_array_unref(all);
+    return cuts;
+}
+
+static void on_parent_cancelled(GCancellable *parent, gpointer user_data) {
+    (void)parent;
+    g_cancellable_cancel(user_data);
+}
+
+GArray *scene_detect_run(const char *path, SeekIndex *index, guint threads, GCancellable *cancellable,
+    SceneCutsFunc func, gpointer user_data, GError **error) {
+    gint64 t = trace_begin();
+    MediaCacheKey key;
+    gboolean have_key = media_cache_key(path, &key);
+    GBytes *cached = have_key ? media_cache_load(&key, "scen", SCENE_VERSION) : NULL;
+    if (cached) {
+        gsize size;
+        const SceneCut *data = g_bytes_get_data(cached, &size);
+        GArray *cuts = g_array_sized_new(FALSE, FALSE, sizeof(SceneCut), (guint)(size / sizeof(SceneCut)));
+        g_array_append_vals(cuts, data, (guint)(size / sizeof(SceneCut)));
+        g_bytes_unref(cached);
+        if (func)
+            func((const SceneCut *)cuts->data, cuts->len, 1.0, user_data);
+        trace_end("scene detect (cache)", "media", t);
+        return cuts;
+    }
+
+    AVFormatContext *in = media_open_input(path, error);
+    if (!in)
+        return NULL;
+    int vin = av_find_best_stream(in, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (vin < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", path);
+        avformat_close_input(&in);
+        return NULL;
+    }
+
+    SceneRun run = { 0 };
+    run.path = path;
+    run.vin = vin;
+    run.vtb = in->streams[vin]->time_base;
+    run.origin_us = media_stream_start_us(in->streams[vin]);
+    run.func = func;
+    run.user_data = user_data;
+    gint64 end_us = in->duration != AV_NOPTS_VALUE ? run.origin_us + in->duration : G_MAXINT64;
+    avformat_close_input(&in);
+
+    if (threads == 0)
+        threads = g_get_num_processors();
+    // O índice de quem chamou é só consultado: parar a varredura cabe ao dono. Se
+    // ele parar antes do fim (o player trocou de arquivo), o índice é refeito aqui.
+    SeekIndex *idx = index ? seek_index_ref(index) : seek_index_new(path);
+    gboolean own_index = index == NULL;
+    if (!seek_index_wait(idx, cancellable) && !own_index && !g_cancellable_is_cancelled(cancellable)) {
+        seek_index_unref(idx);
+        idx = seek_index_new(path);
+        own_index = TRUE;
+        seek_index_wait(idx, cancellable);
+    }
+    run.segments = g_ptr_array_new_with_free_func(segment_free);
+    plan_segments(&run, idx, end_us, threads);
+    if (own_index)
+        seek_index_cancel(idx);
+    seek_index_unref(idx);
+    run.seams = g_array_new(FALSE, FALSE, sizeof(SceneCut));
+
+    // Cancelamento próprio (um trecho com erro para os outros) ligado ao de quem chamou
+    run.cancellable = g_cancellable_new();
+    gulong handler = cancellable
+        ? g_cancellable_connect(cancellable, G_CALLBACK(on_parent_cancelled), run.cancellable, NULL) : 0;
+
+    g_mutex_init(&run.lock);
+    g_cond_init(&run.cond);
+    run.remaining = run.segments->len;
+    GThreadPool *pool = g_thread_pool_new(segment_worker, &run, (gint)MIN(threads, run.segments->len), FALSE, NULL);
+    for (guint i = 0; i < run.segments->len; i++)
+        g_thread_pool_push(pool, g_ptr_array_index(run.segments, i), NULL);
+
+    g_mutex_lock(&run.lock);
+    while (run.remaining > 0) {
+        g_cond_wait(&run.cond, &run.lock);
+        if (run.failed)
+            g_cancellable_cancel(run.cancellable);
+    }
+    g_mutex_unlock(&run.lock);
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_cancellable_disconnect(cancellable, handler);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < run.segments->len; i++) {
+        Segment *s = g_ptr_array_index(run.segments, i);
+        if (s->error && !g_error_matches(s->error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_propagate_error(error, g_steal_pointer(&s->error));
+            ok = FALSE;
+        }
+    }
+    if (ok && g_cancellable_set_error_if_cancelled(cancellable, error))
+        ok = FALSE;
+
+    GArray *cuts = NULL;
+    if (ok) {
+        cuts = collect_cuts(&run);
+        GError *save_error = NULL;
+        if (have_key && !media_cache_store(&key, "scen", SCENE_VERSION, cuts->data,
+                                           cuts->len * sizeof(SceneCut), &save_error)) {
+            g_print("Cache das cenas não foi gravado: %s\n", save_error->message);
+            g_clear_error(&save_error);
+        }
+    }
+
+    g_ptr_array_unref(run.segments);
+    g_array_unref(run.seams);
+    g_object_unref(run.cancellable);
+    g_mutex_clear(&run.lock);
+    g_cond_clear(&run.cond);
+    trace_end("scene detect (decode)", "media", t);
+    return cuts;
+}
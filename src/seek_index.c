@@ -0,0 +1,261 @@
+#include <glib.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include "seek_index.h"
+#include "media_util.h"
+#include "media_cache.h"
+#include "trace.h"
+
+// Formato da tabela de keyframes no cache de mídia: SeekEntry em sequência
+#define SEEK_CACHE_VERSION 1
+
+struct _SeekIndex {
+    gint ref_count;
+    gchar *path;
+    gint cancelled;
+
+    GMutex lock;
+    GCond cond;
+    GArray *keyframes;      // SeekEntry, ordenado por pts_us
+    gint64 scanned_us;      // tudo até aqui já foi varrido
+    gboolean complete;
+    gboolean finished;      // a thread terminou (completa, cancelada ou com erro)
+};
+
+static int interrupt_cb(void *data) {
+    SeekIndex *idx = data;
+    return g_atomic_int_get(&idx->cancelled);
+}
+
+// Primeira posição com pts_us > "pts_us"
+static guint upper_bound(GArray *a, gint64 pts_us) {
+    guint lo = 0, hi = a->len;
+    while (lo < hi) {
+        guint mid = (lo + hi) / 2;
+        if (g_array_index(a, SeekEntry, mid).pts_us <= pts_us)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void add_keyframe(SeekIndex *idx, const SeekEntry *e) {
+    g_mutex_lock(&idx->lock);
+    guint at = upper_bound(idx->keyframes, e->pts_us);
+    // Na varredura os keyframes chegam em ordem; os que já vieram do índice do
+    // container são ignorados
+    if (at == 0 || g_array_index(idx->keyframes, SeekEntry, at - 1).ts != e->ts)
+        g_array_insert_val(idx->keyframes, at, *e);
+    g_mutex_unlock(&idx->lock);
+}
+
+static void set_scanned(SeekIndex *idx, gint64 us, gboolean complete) {
+    g_mutex_lock(&idx->lock);
+    idx->scanned_us = MAX(idx->scanned_us, us);
+    idx->complete = complete;
+    g_cond_broadcast(&idx->cond);
+    g_mutex_unlock(&idx->lock);
+}
+
+// Maior distância entre o dts e o pts de um keyframe, no time base do stream:
+// a do primeiro pacote de vídeo ou a profundidade de reordenação declarada
+static gint64 reorder_delay(AVFormatContext *fmt, AVStream *st) {
+    AVRational rate = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+    gint64 frame = rate.num > 0 && rate.den > 0 ? av_rescale_q(1, av_inv_q(rate), st->time_base) : 0;
+    gint64 delay = st->codecpar->video_delay * frame;
+
+    AVPacket *pkt = av_packet_alloc();
+    int ret;
+    while ((ret = av_read_frame(fmt, pkt)) >= 0 && pkt->stream_index != st->index)
+        av_packet_unref(pkt);
+    if (ret >= 0 && pkt->pts != AV_NOPTS_VALUE && pkt->dts != AV_NOPTS_VALUE)
+        delay = MAX(delay, pkt->pts - pkt->dts);
+    av_packet_free(&pkt);
+    return MAX(delay, 0);
+}
+
+// Containers como MP4 já trazem a tabela de keyframes completa no cabeçalho. No
+// MP4 o timestamp da tabela é o dts, que com B-frames vem antes do pts: o pts_us
+// guardado soma o atraso de reordenação, para a busca nunca devolver um keyframe
+// que aparece depois do destino (no pior caso, devolve o anterior)
+static gboolean seed_from_container(SeekIndex *idx, AVFormatContext *fmt, AVStream *st) {
+    int n = avformat_index_get_entries_count(st);
+    gboolean mp4 = strstr(fmt->iformat->name, "mp4") != NULL;
+    gint64 delay = mp4 && n > 0 ? reorder_delay(fmt, st) : 0;
+    for (int i = 0; i < n; i++) {
+        const AVIndexEntry *ie = avformat_index_get_entry(st, i);
+        if (!(ie->flags & AVINDEX_KEYFRAME))
+            continue;
+        SeekEntry e = { media_ts_to_us(ie->timestamp + delay, st->time_base), ie->timestamp, ie->pos };
+        add_keyframe(idx, &e);
+    }
+    return n > 0 && mp4;
+}
+
+// Índice de uma varredura anterior do mesmo conteúdo
+static gboolean load_cached(SeekIndex *idx, const MediaCacheKey *key) {
+    GBytes *data = media_cache_load(key, "sidx", SEEK_CACHE_VERSION);
+    if (!data)
+        return FALSE;
+    gsize size;
+    const SeekEntry *entries = g_bytes_get_data(data, &size);
+    gboolean ok = size > 0 && size % sizeof(SeekEntry) == 0;
+    if (ok) {
+        g_mutex_lock(&idx->lock);
+        g_array_append_vals(idx->keyframes, entries, (guint)(size / sizeof(SeekEntry)));
+        g_mutex_unlock(&idx->lock);
+    }
+    g_bytes_unref(data);
+    return ok;
+}
+
+static void store_cached(SeekIndex *idx, const MediaCacheKey *key) {
+    GArray *keyframes = seek_index_get_keyframes(idx);
+    GError *error = NULL;
+    if (keyframes->len > 0 &&
+        !media_cache_store(key, "sidx", SEEK_CACHE_VERSION, keyframes->data, keyframes->len * sizeof(SeekEntry), &error)) {
+        g_warning("Cache do índice não foi gravado: %s", error->message);
+        g_clear_error(&error);
+    }
+    g_array_unref(keyframes);
+}
+
+static gpointer scan_thread(gpointer data) {
+    SeekIndex *idx = data;
+    gint64 t = trace_begin();
+    // Conteúdo já varrido antes: nem abre o arquivo
+    MediaCacheKey key;
+    gboolean have_key = media_cache_key(idx->path, &key);
+    gboolean cached = have_key && load_cached(idx, &key);
+    if (cached)
+        set_scanned(idx, G_MAXINT64, TRUE);
+
+    AVFormatContext *fmt = cached ? NULL : media_open_input(idx->path, NULL);
+    int stream = fmt ? av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0) : -1;
+
+    if (stream >= 0) {
+        AVStream *st = fmt->streams[stream];
+        fmt->interrupt_callback.callback = interrupt_cb;
+        fmt->interrupt_callback.opaque = idx;
+
+        if (seed_from_container(idx, fmt, st)) {
+            set_scanned(idx, G_MAXINT64, TRUE);
+        } else {
+            for (unsigned i = 0; i < fmt->nb_streams; i++)
+                fmt->streams[i]->discard = (int)i == stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+            AVPacket *pkt = av_packet_alloc();
+            while (!g_atomic_int_get(&idx->cancelled) && av_read_frame(fmt, pkt) >= 0) {
+                if (pkt->stream_index == stream) {
+                    gint64 ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+                    gint64 pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : ts;
+                    if (ts != AV_NOPTS_VALUE) {
+                        if (pkt->flags & AV_PKT_FLAG_KEY) {
+                            SeekEntry e = { media_ts_to_us(pts, st->time_base), ts, pkt->pos };
+                            add_keyframe(idx, &e);
+                        }
+                        set_scanned(idx, media_ts_to_us(ts, st->time_base), FALSE);
+                    }
+                }
+                av_packet_unref(pkt);
+            }
+            av_packet_free(&pkt);
+            // Só a varredura completa vai para o cache (MP4 já traz a tabela pronta)
+            if (!g_atomic_int_get(&idx->cancelled)) {
+                set_scanned(idx, G_MAXINT64, TRUE);
+                if (have_key)
+                    store_cached(idx, &key);
+            }
+        }
+    }
+
+    if (fmt)
+        avformat_close_input(&fmt);
+    g_mutex_lock(&idx->lock);
+    idx->finished = TRUE;
+    g_cond_broadcast(&idx->cond);
+    g_mutex_unlock(&idx->lock);
+    trace_end(cached ? "seek index (cache)" : "seek index scan", "media", t);
+    seek_index_unref(idx);
+    return NULL;
+}
+
+SeekIndex *seek_index_new(const char *path) {
+    SeekIndex *idx = g_new0(SeekIndex, 1);
+    idx->ref_count = 2;  // uma referência é da thread de varredura
+    idx->path = g_strdup(path);
+    idx->scanned_us = G_MININT64;
+    idx->keyframes = g_array_new(FALSE, FALSE, sizeof(SeekEntry));
+    g_mutex_init(&idx->lock);
+    g_cond_init(&idx->cond);
+    g_thread_unref(g_thread_new("seek-index", scan_thread, idx));
+    return idx;
+}
+
+SeekIndex *seek_index_ref(SeekIndex *idx) {
+    g_atomic_int_inc(&idx->ref_count);
+    return idx;
+}
+
+void seek_index_unref(SeekIndex *idx) {
+    if (!idx || !g_atomic_int_dec_and_test(&idx->ref_count))
+        return;
+    g_array_unref(idx->keyframes);
+    g_mutex_clear(&idx->lock);
+    g_cond_clear(&idx->cond);
+    g_free(idx->path);
+    g_free(idx);
+}
+
+void seek_index_cancel(SeekIndex *idx) {
+    g_atomic_int_set(&idx->cancelled, 1);
+}
+
+gboolean seek_index_lookup(SeekIndex *idx, gint64 pts_us, SeekEntry *entry) {
+    gboolean found = FALSE;
+    g_mutex_lock(&idx->lock);
+    if (idx->complete || pts_us <= idx->scanned_us) {
+        guint at = upper_bound(idx->keyframes, pts_us);
+        if (at > 0) {
+            *entry = g_array_index(idx->keyframes, SeekEntry, at - 1);
+            found = TRUE;
+        }
+    }
+    g_mutex_unlock(&idx->lock);
+    return found;
+}
+
+gboolean seek_index_is_complete(SeekIndex *idx) {
+    g_mutex_lock(&idx->lock);
+    gboolean complete = idx->complete;
+    g_mutex_unlock(&idx->lock);
+    return complete;
+}
+
+GArray *seek_index_get_keyframes(SeekIndex *idx) {
+    g_mutex_lock(&idx->lock);
+    GArray *copy = g_array_sized_new(FALSE, FALSE, sizeof(SeekEntry), idx->keyframes->len);
+    g_array_append_vals(copy, idx->keyframes->data, idx->keyframes->len);
+    g_mutex_unlock(&idx->lock);
+    return copy;
+}
+
+gboolean seek_index_wait(SeekIndex *idx, GCancellable *cancellable) {
+    g_mutex_lock(&idx->lock);
+    while (!idx->finished && !g_cancellable_is_cancelled(cancellable))
+        g_cond_wait_until(&idx->cond, &idx->lock, g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND);
+    gboolean complete = idx->complete;
+    g_mutex_unlock(&idx->lock);
+    return complete;
+}
+
+gboolean seek_index_wait_until(SeekIndex *idx, gint64 pts_us, GCancellable *cancellable) {
+    g_mutex_lock(&idx->lock);
+    while (!idx->complete && idx->scanned_us < pts_us && !idx->finished &&
+           !g_cancellable_is_cancelled(cancellable))
+        g_cond_wait_until(&idx->cond, &idx->lock, g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND);
+    gboolean covered = idx->complete || idx->scanned_us >= pts_us;
+    g_mutex_unlock(&idx->lock);
+    return covered;
+}
@@ -1,45 +1,112 @@
 #include <gtk/gtk.h>
-#include <gdk/win32/gdkwin32.h>
-#include <windows.h>
 #include "splash.h"
+#include "window_platform.h"
+#include "anim_cache.h"
+#include "anim_scheduler.h"
+#include "trace.h"
 
-typedef struct {
+#define SPLASH_LOGO "Logo_splash.gif"
+#define SPLASH_LOGO_SIZE 128
+
+struct _SplashScreen {
     GtkWidget *window;
     guint timeout_id;
-    GdkPixbufAnimationIter *anim_iter;
     GtkWidget *picture;
-    guint anim_id;
+    GCancellable *cancellable;
+    gboolean min_elapsed;   // tempo mínimo de exibição já passou
+    gboolean ready;         // janela principal já foi construída
     GtkApplication *app;
     void (*callback)(GtkApplication*);
-} SplashScreen;
+};
+
+typedef struct {
+    GtkWidget *picture;
+    GdkTexture *frame;
+} ArrivedFrame;
 
 static void close_splash_screen(SplashScreen *splash) {
-    if (splash->anim_id > 0)  g_source_remove(splash->anim_id);
     if (splash->timeout_id > 0) g_source_remove(splash->timeout_id);
-    if (splash->anim_iter)      g_object_unref(splash->anim_iter);
+    g_cancellable_cancel(splash->cancellable);
+    g_object_unref(splash->cancellable);
     gtk_window_destroy(GTK_WINDOW(splash->window));
     if (splash->callback) splash->callback(splash->app);
     g_free(splash);
 }
 
+// Fecha só quando a janela principal estiver pronta e o tempo mínimo tiver passado
+static void maybe_close(SplashScreen *splash) {
+    if (splash->ready && splash->min_elapsed)
+        close_splash_screen(splash);
+}
+
 static gboolean auto_close(gpointer data) {
-    close_splash_screen((SplashScreen*)data);
+    SplashScreen *splash = data;
+    splash->timeout_id = 0;
+    splash->min_elapsed = TRUE;
+    maybe_close(splash);
     return G_SOURCE_REMOVE;
 }
 
-static gboolean animate_gif(gpointer data) {
-    SplashScreen *s = data;
-    if (s->anim_iter) {
-        GdkPixbuf *frame = gdk_pixbuf_animation_iter_get_pixbuf(s->anim_iter);
-        GdkTexture *tex  = gdk_texture_new_for_pixbuf(frame);
-        gtk_picture_set_paintable(GTK_PICTURE(s->picture), GDK_PAINTABLE(tex));
-        g_object_unref(tex);
-        int delay = gdk_pixbuf_animation_iter_get_delay_time(s->anim_iter);
-        gdk_pixbuf_animation_iter_advance(s->anim_iter, NULL);
-        s->anim_id = g_timeout_add(delay, animate_gif, s);
-        return G_SOURCE_REMOVE;
+void splash_screen_set_ready(SplashScreen *splash) {
+    splash->ready = TRUE;
+    maybe_close(splash);
+}
+
+static gboolean show_arrived_frame(gpointer data) {
+    ArrivedFrame *f = data;
+    // Depois que a animação completa chega, quem troca os quadros é o agendador
+    if (!g_object_get_data(G_OBJECT(f->picture), "animation-data"))
+        gtk_picture_set_paintable(GTK_PICTURE(f->picture), GDK_PAINTABLE(f->frame));
+    g_object_unref(f->picture);
+    g_object_unref(f->frame);
+    g_free(f);
+    return G_SOURCE_REMOVE;
+}
+
+// Roda na thread de decodificação: cada quadro pronto já vai para a tela
+static void on_logo_frame(GdkTexture *frame, int delay, guint index, gpointer user_data) {
+    (void)delay; (void)index;
+    ArrivedFrame *f = g_new(ArrivedFrame, 1);
+    f->picture = g_object_ref(user_data);
+    f->frame = g_object_ref(frame);
+    g_idle_add(show_arrived_frame, f);
+}
+
+static void load_logo_thread(GTask *task, gpointer source, gpointer task_data, GCancellable *cancellable) {
+    (void)task_data;
+    gint64 t = trace_begin();
+    GError *error = NULL;
+    AnimFrames *anim = anim_cache_get_asset_progressive(SPLASH_LOGO, SPLASH_LOGO_SIZE, SPLASH_LOGO_SIZE,
+                                                        cancellable, on_logo_frame, source, &error);
+    trace_end("splash logo decode", "asset", t);
+    if (anim)
+        g_task_return_pointer(task, anim, (GDestroyNotify)anim_frames_unref);
+    else
+        g_task_return_error(task, error);
+}
+
+static void on_logo_loaded(GObject *source, GAsyncResult *result, gpointer user_data) {
+    (void)user_data;
+    GtkWidget *picture = GTK_WIDGET(source);
+    GError *error = NULL;
+    AnimFrames *anim = g_task_propagate_pointer(G_TASK(result), &error);
+
+    if (!anim) {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_warning("Erro ao carregar GIF: %s", error->message);
+            GtkWidget *img = gtk_image_new_from_icon_name("image-missing");
+            gtk_image_set_pixel_size(GTK_IMAGE(img), SPLASH_LOGO_SIZE);
+            gtk_widget_set_visible(picture, FALSE);
+            gtk_box_append(GTK_BOX(gtk_widget_get_parent(picture)), img);
+        }
+        g_clear_error(&error);
+        return;
     }
-    return G_SOURCE_CONTINUE;
+
+    gtk_picture_set_paintable(GTK_PICTURE(picture), GDK_PAINTABLE(anim->frames[0]));
+    if (anim_frames_is_animated(anim))
+        anim_scheduler_add(picture, anim);
+    anim_frames_unref(anim);
 }
 
 static void setup_glassmorphism_splash() {
@@ -58,28 +125,17 @@ static void setup_glassmorphism_splash() {
 }
 
 static void on_window_map(GtkWidget *widget, G_GNUC_UNUSED gpointer data) {
-    const int win_w = 400, win_h = 300;
-    GdkSurface *surface = gtk_native_get_surface(GTK_NATIVE(widget));
-    HWND hwnd = gdk_win32_surface_get_handle(surface);
-
-    MONITORINFO mi;
-    memset(&mi, 0, sizeof(mi));
-    mi.cbSize = sizeof(mi);
-    HMONITOR hmon = MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST);
-    GetMonitorInfo(hmon, &mi);
-
-    int x = mi.rcWork.left + (mi.rcWork.right - mi.rcWork.left - win_w) / 2;
-    int y = mi.rcWork.top  + (mi.rcWork.bottom - mi.rcWork.top - win_h) / 2;
-
-    SetWindowPos(hwnd, NULL, x, y, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+    window_platform_center(widget, 400, 300);
 }
 
-void create_splash_screen(GtkApplication *app, void (*callback)(GtkApplication*)) {
+SplashScreen *create_splash_screen(GtkApplication *app, guint min_display_ms, void (*callback)(GtkApplication*)) {
+    gint64 t = trace_begin();
     SplashScreen *splash = g_new0(SplashScreen, 1);
     const int win_w = 400, win_h = 300;
 
     splash->app = app;
     splash->callback = callback;
+    splash->cancellable = g_cancellable_new();
 
     splash->window = gtk_application_window_new(app);
     gtk_window_set_title(GTK_WINDOW(splash->window), "Splash Screen");
@@ -105,29 +161,14 @@ void create_splash_screen(GtkApplication *app, void (*callback)(GtkApplication*)
     gtk_widget_set_halign(box, GTK_ALIGN_CENTER);
     gtk_widget_set_valign(box, GTK_ALIGN_CENTER);
 
-    GError *error = NULL;
-    GdkPixbufAnimation *anim = gdk_pixbuf_animation_new_from_file("icons/Logo_splash.gif", &error);
-    if (error) {
-        g_warning("Erro ao carregar GIF: %s", error->message);
-        g_clear_error(&error);
-        GtkWidget *img = gtk_image_new_from_icon_name("image-missing");
-        gtk_image_set_pixel_size(GTK_IMAGE(img), 128);
-        gtk_box_append(GTK_BOX(box), img);
-    } else {
-        splash->picture = gtk_picture_new();
-        gtk_widget_set_size_request(splash->picture, 128, 128);
-
-        GdkPixbuf *first = gdk_pixbuf_animation_get_static_image(anim);
-        GdkTexture *tex  = gdk_texture_new_for_pixbuf(first);
-        gtk_picture_set_paintable(GTK_PICTURE(splash->picture), GDK_PAINTABLE(tex));
-        g_object_unref(tex);
-
-        splash->anim_iter = gdk_pixbuf_animation_get_iter(anim, NULL);
-        gtk_box_append(GTK_BOX(box), splash->picture);
-        splash->anim_id = g_timeout_add(100, animate_gif, splash);
-
-        g_object_unref(anim);
-    }
+    // O GIF é decodificado numa thread; os quadros aparecem conforme ficam prontos
+    splash->picture = gtk_picture_new();
+    gtk_widget_set_size_request(splash->picture, SPLASH_LOGO_SIZE, SPLASH_LOGO_SIZE);
+    gtk_box_append(GTK_BOX(box), splash->picture);
+
+    GTask *task = g_task_new(splash->picture, splash->cancellable, on_logo_loaded, NULL);
+    g_task_run_in_thread(task, load_logo_thread);
+    g_object_unref(task);
 
     // Usando GtkOverlay para fundo transparente + conteúdo sólido por cima
     GtkWidget *overlay = gtk_overlay_new();
@@ -140,5 +181,7 @@ void create_splash_screen(GtkApplication *app, void (*callback)(GtkApplication*)
     gtk_window_set_child(GTK_WINDOW(splash->window), overlay);
     gtk_window_present(GTK_WINDOW(splash->window));
 
-    splash->timeout_id = g_timeout_add(2400, auto_close, splash);
+    splash->timeout_id = g_timeout_add(min_display_ms, auto_close, splash);
+    trace_end("create_splash_screen", "startup", t);
+    return splash;
 }
@@ -0,0 +1,64 @@
+#include <glib.h>
+#include <string.h>
+#include "spsc_ring.h"
+
+void spsc_ring_init(SpscRing *r, guint capacity) {
+    guint cap = 1;
+    while (cap < capacity)
+        cap <<= 1;
+    r->data = g_malloc(cap);
+    r->capacity = cap;
+    r->mask = cap - 1;
+    r->head = r->tail = 0;
+}
+
+void spsc_ring_clear(SpscRing *r) {
+    g_free(r->data);
+    r->data = NULL;
+    r->capacity = r->mask = 0;
+}
+
+// Os índices só crescem (com volta natural em 32 bits); a diferença é o ocupado
+guint spsc_ring_readable(SpscRing *r) {
+    return (guint)g_atomic_int_get(&r->head) - (guint)g_atomic_int_get(&r->tail);
+}
+
+guint spsc_ring_writable(SpscRing *r) {
+    return r->capacity - spsc_ring_readable(r);
+}
+
+guint spsc_ring_write(SpscRing *r, const void *src, guint n) {
+    guint head = r->head;   // só este lado escreve head
+    guint tail = (guint)g_atomic_int_get(&r->tail);
+    n = MIN(n, r->capacity - (head - tail));
+    if (n == 0)
+        return 0;
+
+    guint at = head & r->mask;
+    guint first = MIN(n, r->capacity - at);
+    memcpy(r->data + at, src, first);
+    memcpy(r->data, (const guint8 *)src + first, n - first);
+    // Publica os bytes só depois de copiados
+    g_atomic_int_set(&r->head, head + n);
+    return n;
+}
+
+guint spsc_ring_read(SpscRing *r, void *dst, guint n) {
+    guint tail = r->tail;   // só este lado escreve tail
+    guint head = (guint)g_atomic_int_get(&r->head);
+    n = MIN(n, head - tail);
+    if (n == 0)
+        return 0;
+
+    guint at = tail & r->mask;
+    guint first = MIN(n, r->capacity - at);
+    memcpy(dst, r->data + at, first);
+    memcpy((guint8 *)dst + first, r->data, n - first);
+    g_atomic_int_set(&r->tail, tail + n);
+    return n;
+}
+
+void spsc_ring_reset(SpscRing *r) {
+    g_atomic_int_set(&r->head, 0);
+    g_atomic_int_set(&r->tail, 0);
+}
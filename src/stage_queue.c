@@ -0,0 +1,85 @@
+#include <glib.h>
+#include "stage_queue.h"
+
+void stage_queue_init(StageQueue *q, guint capacity, gint *depth) {
+    // Todo acesso ao anel é de um ponteiro inteiro: o espaço livre é sempre múltiplo dele
+    spsc_ring_init(&q->ring, MAX(capacity, 1) * sizeof(gpointer));
+    g_mutex_init(&q->lock);
+    g_cond_init(&q->cond);
+    q->waiting = 0;
+    q->aborted = 0;
+    q->depth = depth;
+}
+
+void stage_queue_clear(StageQueue *q) {
+    if (q->depth)
+        g_atomic_int_add(q->depth, -(gint)stage_queue_length(q));
+    spsc_ring_clear(&q->ring);
+    g_mutex_clear(&q->lock);
+    g_cond_clear(&q->cond);
+}
+
+// O contador "waiting" é publicado antes de conferir a fila de novo, e quem
+// avisa publica o índice antes de ler "waiting": um dos dois vê o outro. Como a
+// conferência e o sono acontecem com o mutex, que quem avisa também pega, o
+// aviso não se perde e o sono não precisa de prazo.
+static void park(StageQueue *q, gboolean want_space) {
+    g_mutex_lock(&q->lock);
+    g_atomic_int_inc(&q->waiting);
+    gboolean ready = want_space ? spsc_ring_writable(&q->ring) > 0 : spsc_ring_readable(&q->ring) > 0;
+    if (!ready && !g_atomic_int_get(&q->aborted))
+        g_cond_wait(&q->cond, &q->lock);
+    g_atomic_int_add(&q->waiting, -1);
+    g_mutex_unlock(&q->lock);
+}
+
+static void wake(StageQueue *q) {
+    if (g_atomic_int_get(&q->waiting) == 0)
+        return;
+    g_mutex_lock(&q->lock);
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+}
+
+gboolean stage_queue_push(StageQueue *q, gpointer item) {
+    for (;;) {
+        if (g_atomic_int_get(&q->aborted))
+            return FALSE;
+        if (spsc_ring_write(&q->ring, &item, sizeof item) == sizeof item)
+            break;
+        park(q, TRUE);
+    }
+    if (q->depth)
+        g_atomic_int_inc(q->depth);
+    wake(q);
+    return TRUE;
+}
+
+gboolean stage_queue_pop(StageQueue *q, gpointer *item) {
+    for (;;) {
+        if (g_atomic_int_get(&q->aborted))
+            return FALSE;
+        if (spsc_ring_read(&q->ring, item, sizeof *item) == sizeof *item)
+            break;
+        park(q, FALSE);
+    }
+    if (q->depth)
+        g_atomic_int_add(q->depth, -1);
+    wake(q);
+    return TRUE;
+}
+
+void stage_queue_abort(StageQueue *q) {
+    g_atomic_int_set(&q->aborted, 1);
+    g_mutex_lock(&q->lock);
+    g_cond_broadcast(&q->cond);
+    g_mutex_unlock(&q->lock);
+}
+
+guint stage_queue_length(StageQueue *q) {
+    return spsc_ring_readable(&q->ring) / sizeof(gpointer);
+}
+
+guint stage_queue_capacity(StageQueue *q) {
+    return q->ring.capacity / sizeof(gpointer);
+}
@@ -0,0 +1,528 @@
+#include <gtk/gtk.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include "thumbnailer.h"
+#include "media_util.h"
+#include "media_cache.h"
+#include "trace.h"
+#include "perf_counters.h"
+
+// Limite de pacotes lidos atrás de um keyframe antes de desistir do instante
+#define MAX_PACKETS_PER_THUMB 600
+#define THUMB_CACHE_VERSION 1
+// Tamanho máximo da faixa no cache de mídia; as miniaturas vistas nesta sessão
+// entram primeiro, e as de sessões anteriores ocupam o que sobrar
+#define STRIP_MAX_BYTES (32 * 1024 * 1024)
+
+typedef struct {
+    gint64 time_us;         // chave no hash
+    GdkTexture *texture;
+    gsize bytes;
+} CacheEntry;
+
+struct _Thumbnailer {
+    gint ref_count;
+    gchar *path;
+    int max_w, max_h;
+    ThumbnailReadyFunc ready;
+    gpointer user_data;
+    gint closed;
+    GThread *thread;
+
+    GMutex lock;
+    GCond cond;
+    GArray *pending;        // gint64, em ordem de prioridade
+    guint next;             // próximo de "pending" a decodificar
+    gint64 current;         // instante sendo decodificado (G_MININT64 = nenhum)
+    gint generation;        // muda quando o instante atual deixa de interessar
+    gboolean quit;
+
+    // Só na thread principal
+    GHashTable *cache;      // gint64* -> GList* em "lru"
+    GQueue lru;             // CacheEntry*, mais recente na cabeça
+    gsize cache_bytes;
+    gsize cache_limit;
+};
+
+typedef struct {
+    AVFormatContext *fmt;
+    AVCodecContext *dec;
+    struct SwsContext *sws;
+    AVPacket *pkt;
+    AVFrame *frame;
+    int stream;
+    AVRational time_base;
+    gint64 origin_us;
+} ThumbDecoder;
+
+typedef struct {
+    Thumbnailer *th;
+    gint64 time_us;
+    GdkTexture *texture;
+} ThumbResult;
+
+// Faixa de miniaturas no cache de mídia: cabeçalho, entradas e depois os
+// pixels RGBA de cada uma (offset contado do começo do conteúdo)
+typedef struct {
+    guint32 max_w;
+    guint32 max_h;
+    guint32 count;
+    guint32 reserved;
+} StripHeader;
+
+typedef struct {
+    gint64 time_us;
+    guint32 width;
+    guint32 height;
+    guint64 offset;
+} StripEntry;
+
+G_STATIC_ASSERT(sizeof(StripHeader) == 16);
+G_STATIC_ASSERT(sizeof(StripEntry) == 24);
+
+typedef struct {
+    gint64 time_us;
+    int width;
+    int height;
+    GBytes *pixels;
+} FreshThumb;
+
+// Só na thread de decodificação
+typedef struct {
+    MediaCacheKey key;
+    gboolean have_key;
+    GBytes *strip;          // faixa mapeada de uma sessão anterior
+    GHashTable *entries;    // gint64* -> const StripEntry* dentro de "strip"
+    // Decodificadas nesta sessão, com o mesmo orçamento em bytes do LRU de
+    // texturas: passou dele, as usadas há mais tempo saem (e não vão para a faixa)
+    GQueue fresh;           // FreshThumb*, mais recente na cabeça
+    GHashTable *fresh_index;    // gint64* -> GList* em "fresh"
+    gsize fresh_bytes;
+    gsize fresh_limit;
+} ThumbStore;
+
+static Thumbnailer *thumbnailer_ref(Thumbnailer *th) {
+    g_atomic_int_inc(&th->ref_count);
+    return th;
+}
+
+static void thumbnailer_unref(Thumbnailer *th) {
+    if (!g_atomic_int_dec_and_test(&th->ref_count))
+        return;
+    g_array_unref(th->pending);
+    g_mutex_clear(&th->lock);
+    g_cond_clear(&th->cond);
+    g_free(th->path);
+    g_free(th);
+}
+
+static gboolean is_stale(Thumbnailer *th, gint generation) {
+    return g_atomic_int_get(&th->generation) != generation;
+}
+
+// Texturas de todos os caches de miniaturas abertos, para o HUD
+static PerfCounter *perf_cache(void) {
+    static PerfCounter *counter = NULL;
+    if (g_once_init_enter(&counter))
+        g_once_init_leave(&counter, perf_counter_register("miniaturas.cache", PERF_KIB));
+    return counter;
+}
+
+static void cache_entry_free(gpointer data) {
+    CacheEntry *entry = data;
+    perf_counter_add(perf_cache(), -(gint)(entry->bytes / 1024));
+    g_object_unref(entry->texture);
+    g_free(entry);
+}
+
+static void cache_insert(Thumbnailer *th, gint64 time_us, GdkTexture *texture) {
+    if (g_hash_table_contains(th->cache, &time_us))
+        return;
+    CacheEntry *entry = g_new(CacheEntry, 1);
+    entry->time_us = time_us;
+    entry->texture = g_object_ref(texture);
+    entry->bytes = (gsize)gdk_texture_get_width(texture) * gdk_texture_get_height(texture) * 4;
+    g_queue_push_head(&th->lru, entry);
+    g_hash_table_insert(th->cache, &entry->time_us, th->lru.head);
+    th->cache_bytes += entry->bytes;
+    perf_counter_add(perf_cache(), (gint)(entry->bytes / 1024));
+
+    // Sai o que foi visto há mais tempo
+    while (th->cache_bytes > th->cache_limit && th->lru.length > 1) {
+        CacheEntry *old = g_queue_pop_tail(&th->lru);
+        g_hash_table_remove(th->cache, &old->time_us);
+        th->cache_bytes -= old->bytes;
+        cache_entry_free(old);
+    }
+}
+
+static gboolean on_result_idle(gpointer data) {
+    ThumbResult *r = data;
+    if (!g_atomic_int_get(&r->th->closed)) {
+        cache_insert(r->th, r->time_us, r->texture);
+        if (r->th->ready)
+            r->th->ready(r->th->user_data);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void thumb_result_free(gpointer data) {
+    ThumbResult *r = data;
+    g_object_unref(r->texture);
+    thumbnailer_unref(r->th);
+    g_free(r);
+}
+
+static gboolean decoder_open(ThumbDecoder *d, const char *path) {
+    d->fmt = media_open_input(path, NULL);
+    if (!d->fmt)
+        return FALSE;
+    const AVCodec *codec = NULL;
+    d->stream = av_find_best_stream(d->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (d->stream < 0 || !codec)
+        return FALSE;
+
+    AVStream *st = d->fmt->streams[d->stream];
+    for (unsigned i = 0; i < d->fmt->nb_streams; i++)
+        d->fmt->streams[i]->discard = (int)i == d->stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    d->time_base = st->time_base;
+    d->origin_us = media_stream_start_us(st);
+
+    // Só keyframes, sem filtro de bloco: basta para uma miniatura e é bem mais leve
+    d->dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(d->dec, st->codecpar);
+    d->dec->pkt_timebase = st->time_base;
+    d->dec->skip_frame = AVDISCARD_NONKEY;
+    d->dec->skip_loop_filter = AVDISCARD_ALL;
+    d->dec->thread_count = 0;
+    d->dec->thread_type = FF_THREAD_SLICE;
+    if (avcodec_open2(d->dec, codec, NULL) < 0)
+        return FALSE;
+
+    d->pkt = av_packet_alloc();
+    d->frame = av_frame_alloc();
+    return TRUE;
+}
+
+static void decoder_close(ThumbDecoder *d) {
+    sws_freeContext(d->sws);
+    av_frame_free(&d->frame);
+    av_packet_free(&d->pkt);
+    avcodec_free_context(&d->dec);
+    if (d->fmt)
+        avformat_close_input(&d->fmt);
+}
+
+static GdkTexture *scale_frame(Thumbnailer *th, ThumbDecoder *d, const AVFrame *frame, GBytes **pixels_out) {
+    AVRational sar = frame->sample_aspect_ratio;
+    double dw = frame->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+    double s = MIN(1.0, MIN(th->max_w / dw, th->max_h / (double)frame->height));
+    int w = MAX(2, (int)(dw * s)), h = MAX(2, (int)(frame->height * s));
+
+    d->sws = sws_getCachedContext(d->sws, frame->width, frame->height, frame->format,
+                                  w, h, AV_PIX_FMT_RGBA, SWS_AREA, NULL, NULL, NULL);
+    if (!d->sws)
+        return NULL;
+    int stride = w * 4;
+    guint8 *pixels = g_malloc((gsize)stride * h);
+    uint8_t *dst[4] = { pixels, NULL, NULL, NULL };
+    int dst_stride[4] = { stride, 0, 0, 0 };
+    sws_scale(d->sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+
+    GBytes *bytes = g_bytes_new_take(pixels, (gsize)stride * h);
+    GdkTexture *texture = gdk_memory_texture_new(w, h, GDK_MEMORY_R8G8B8A8, bytes, stride);
+    *pixels_out = bytes;
+    return texture;
+}
+
+// Primeiro keyframe em ou antes de "time_us"; NULL se o pedido ficou velho
+static GdkTexture *decode_at(Thumbnailer *th, ThumbDecoder *d, gint64 time_us, gint generation, GBytes **pixels) {
+    gint64 target = media_us_to_ts(d->origin_us + time_us, d->time_base);
+    if (av_seek_frame(d->fmt, d->stream, target, AVSEEK_FLAG_BACKWARD) < 0)
+        return NULL;
+    avcodec_flush_buffers(d->dec);
+
+    GdkTexture *texture = NULL;
+    gboolean draining = FALSE;
+    for (int n = 0; !texture && n < MAX_PACKETS_PER_THUMB && !is_stale(th, generation); n++) {
+        if (!draining) {
+            int ret = av_read_frame(d->fmt, d->pkt);
+            if (ret < 0) {
+                avcodec_send_packet(d->dec, NULL);  // fim do arquivo: tira o que ficou no decoder
+                draining = TRUE;
+            } else {
+                if (d->pkt->stream_index == d->stream)
+                    avcodec_send_packet(d->dec, d->pkt);
+                av_packet_unref(d->pkt);
+            }
+        }
+        int ret = avcodec_receive_frame(d->dec, d->frame);
+        if (ret >= 0) {
+            texture = scale_frame(th, d, d->frame, pixels);
+            av_frame_unref(d->frame);
+        } else if (draining) {
+            break;
+        }
+    }
+    return texture;
+}
+
+static void fresh_thumb_free(gpointer data) {
+    FreshThumb *f = data;
+    g_bytes_unref(f->pixels);
+    g_free(f);
+}
+
+static void store_open(ThumbStore *store, Thumbnailer *th) {
+    store->entries = g_hash_table_new(g_int64_hash, g_int64_equal);
+    g_queue_init(&store->fresh);
+    store->fresh_index = g_hash_table_new(g_int64_hash, g_int64_equal);
+    store->fresh_limit = th->cache_limit;
+    store->have_key = media_cache_key(th->path, &store->key);
+    if (store->have_key)
+        store->strip = media_cache_load(&store->key, "thmb", THUMB_CACHE_VERSION);
+    if (!store->strip)
+        return;
+
+    gsize size;
+    const guint8 *p = g_bytes_get_data(store->strip, &size);
+    StripHeader h;
+    if (size < sizeof h)
+        return;
+    memcpy(&h, p, sizeof h);
+    // Miniaturas de outro tamanho não servem; a faixa é reescrita no fim
+    if (h.max_w != (guint32)th->max_w || h.max_h != (guint32)th->max_h ||
+        size < sizeof h + (gsize)h.count * sizeof(StripEntry))
+        return;
+    const StripEntry *e = (const StripEntry *)(p + sizeof h);
+    for (guint32 i = 0; i < h.count; i++) {
+        if (e[i].offset + (guint64)e[i].width * e[i].height * 4 <= size)
+            g_hash_table_insert(store->entries, (gpointer)&e[i].time_us, (gpointer)&e[i]);
+    }
+}
+
+static void store_add(ThumbStore *store, gint64 time_us, GdkTexture *texture, GBytes *pixels) {
+    if (g_hash_table_contains(store->fresh_index, &time_us)) {
+        g_bytes_unref(pixels);
+        return;
+    }
+    FreshThumb *f = g_new(FreshThumb, 1);
+    *f = (FreshThumb){ time_us, gdk_texture_get_width(texture), gdk_texture_get_height(texture), pixels };
+    g_queue_push_head(&store->fresh, f);
+    g_hash_table_insert(store->fresh_index, &f->time_us, store->fresh.head);
+    store->fresh_bytes += g_bytes_get_size(pixels);
+
+    while (store->fresh_bytes > store->fresh_limit && store->fresh.length > 1) {
+        FreshThumb *old = g_queue_pop_tail(&store->fresh);
+        g_hash_table_remove(store->fresh_index, &old->time_us);
+        store->fresh_bytes -= g_bytes_get_size(old->pixels);
+        fresh_thumb_free(old);
+    }
+}
+
+// Textura direto sobre a faixa mapeada (ou sobre os pixels decodificados
+// nesta sessão, se saiu do LRU e voltou a ser pedida), sem copiar nada
+static GdkTexture *store_lookup(ThumbStore *store, gint64 time_us) {
+    GList *link = g_hash_table_lookup(store->fresh_index, &time_us);
+    if (link) {
+        g_queue_unlink(&store->fresh, link);
+        g_queue_push_head_link(&store->fresh, link);
+        FreshThumb *f = link->data;
+        return gdk_memory_texture_new(f->width, f->height, GDK_MEMORY_R8G8B8A8, f->pixels, (gsize)f->width * 4);
+    }
+    const StripEntry *e = g_hash_table_lookup(store->entries, &time_us);
+    if (!e)
+        return NULL;
+    gsize stride = (gsize)e->width * 4;
+    GBytes *bytes = g_bytes_new_from_bytes(store->strip, (gsize)e->offset, stride * e->height);
+    GdkTexture *texture = gdk_memory_texture_new((int)e->width, (int)e->height, GDK_MEMORY_R8G8B8A8, bytes, stride);
+    g_bytes_unref(bytes);
+    return texture;
+}
+
+// Regrava a faixa com o que foi decodificado agora (das mais recentes para as
+// mais antigas) mais o que já havia, até STRIP_MAX_BYTES
+static void store_close(ThumbStore *store, Thumbnailer *th) {
+    if (store->have_key && store->fresh.length > 0) {
+        GArray *entries = g_array_new(FALSE, FALSE, sizeof(StripEntry));
+        GPtrArray *sources = g_ptr_array_new();     // pixels de cada entrada
+        gsize used = sizeof(StripHeader);
+
+        for (GList *l = store->fresh.head; l; l = l->next) {
+            FreshThumb *f = l->data;
+            gsize n = g_bytes_get_size(f->pixels);
+            if (used + sizeof(StripEntry) + n > STRIP_MAX_BYTES)
+                break;
+            StripEntry e = { f->time_us, (guint32)f->width, (guint32)f->height, 0 };
+            g_array_append_val(entries, e);
+            g_ptr_array_add(sources, (gpointer)g_bytes_get_data(f->pixels, NULL));
+            used += sizeof(StripEntry) + n;
+        }
+        GHashTableIter iter;
+        gpointer value;
+        g_hash_table_iter_init(&iter, store->entries);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            const StripEntry *old = value;
+            gsize n = (gsize)old->width * old->height * 4;
+            if (used + sizeof(StripEntry) + n > STRIP_MAX_BYTES)
+                continue;
+            StripEntry e = *old;
+            g_array_append_val(entries, e);
+            g_ptr_array_add(sources, (gpointer)((const guint8 *)g_bytes_get_data(store->strip, NULL) + old->offset));
+            used += sizeof(StripEntry) + n;
+        }
+
+        StripHeader h = { (guint32)th->max_w, (guint32)th->max_h, entries->len, 0 };
+        GByteArray *out = g_byte_array_sized_new((guint)used);
+        g_byte_array_append(out, (const guint8 *)&h, sizeof h);
+        gsize offset = sizeof h + (gsize)entries->len * sizeof(StripEntry);
+        for (guint i = 0; i < entries->len; i++) {
+            StripEntry *e = &g_array_index(entries, StripEntry, i);
+            e->offset = offset;
+            offset += (gsize)e->width * e->height * 4;
+            g_byte_array_append(out, (const guint8 *)e, sizeof *e);
+        }
+        for (guint i = 0; i < entries->len; i++) {
+            const StripEntry *e = &g_array_index(entries, StripEntry, i);
+            g_byte_array_append(out, g_ptr_array_index(sources, i), (guint)((gsize)e->width * e->height * 4));
+        }
+
+        GError *error = NULL;
+        if (!media_cache_store(&store->key, "thmb", THUMB_CACHE_VERSION, out->data, out->len, &error)) {
+            g_print("Cache das miniaturas não foi gravado: %s\n", error->message);
+            g_clear_error(&error);
+        }
+        g_byte_array_unref(out);
+        g_ptr_array_unref(sources);
+        g_array_unref(entries);
+    }
+
+    g_queue_clear_full(&store->fresh, fresh_thumb_free);
+    g_hash_table_destroy(store->fresh_index);
+    g_hash_table_destroy(store->entries);
+    if (store->strip)
+        g_bytes_unref(store->strip);
+}
+
+static gpointer thumb_thread(gpointer data) {
+    Thumbnailer *th = data;
+    ThumbDecoder d = { 0 };
+    ThumbStore store = { 0 };
+    store_open(&store, th);
+    // O arquivo só é aberto na primeira miniatura que não está no cache
+    gboolean opened = FALSE, ok = TRUE;
+
+    for (;;) {
+        g_mutex_lock(&th->lock);
+        while (!th->quit && th->next >= th->pending->len)
+            g_cond_wait(&th->cond, &th->lock);
+        if (th->quit) {
+            g_mutex_unlock(&th->lock);
+            break;
+        }
+        gint64 time_us = g_array_index(th->pending, gint64, th->next++);
+        th->current = time_us;
+        gint generation = g_atomic_int_get(&th->generation);
+        g_mutex_unlock(&th->lock);
+
+        gint64 t = trace_begin();
+        GdkTexture *texture = store_lookup(&store, time_us);
+        if (!texture && !opened) {
+            opened = TRUE;
+            ok = decoder_open(&d, th->path);
+            if (!ok)
+                g_print("Miniaturas indisponíveis: %s\n", th->path);
+        }
+        if (!texture && ok) {
+            GBytes *pixels = NULL;
+            texture = decode_at(th, &d, time_us, generation, &pixels);
+            if (texture)
+                store_add(&store, time_us, texture, pixels);
+        }
+        trace_end("thumbnail", "media", t);
+
+        g_mutex_lock(&th->lock);
+        th->current = G_MININT64;
+        g_mutex_unlock(&th->lock);
+
+        if (texture) {
+            ThumbResult *r = g_new(ThumbResult, 1);
+            r->th = thumbnailer_ref(th);
+            r->time_us = time_us;
+            r->texture = texture;
+            g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, on_result_idle, r, thumb_result_free);
+        }
+    }
+
+    decoder_close(&d);
+    store_close(&store, th);
+    thumbnailer_unref(th);
+    return NULL;
+}
+
+Thumbnailer *thumbnailer_new(const char *path, int max_width, int max_height, gsize cache_bytes,
+    ThumbnailReadyFunc ready, gpointer user_data) {
+    Thumbnailer *th = g_new0(Thumbnailer, 1);
+    th->ref_count = 2;  // uma referência é da thread de decodificação
+    th->path = g_strdup(path);
+    th->max_w = max_width;
+    th->max_h = max_height;
+    th->ready = ready;
+    th->user_data = user_data;
+    th->pending = g_array_new(FALSE, FALSE, sizeof(gint64));
+    th->current = G_MININT64;
+    g_mutex_init(&th->lock);
+    g_cond_init(&th->cond);
+    th->cache = g_hash_table_new(g_int64_hash, g_int64_equal);
+    g_queue_init(&th->lru);
+    th->cache_limit = cache_bytes;
+    th->thread = g_thread_new("thumbnails", thumb_thread, th);
+    return th;
+}
+
+void thumbnailer_free(Thumbnailer *th) {
+    if (!th)
+        return;
+    g_atomic_int_set(&th->closed, 1);
+    g_mutex_lock(&th->lock);
+    th->quit = TRUE;
+    g_atomic_int_inc(&th->generation);
+    g_cond_signal(&th->cond);
+    g_mutex_unlock(&th->lock);
+    // A thread termina sozinha (gravando as miniaturas novas no cache) sem
+    // segurar a thread principal
+    g_thread_unref(th->thread);
+
+    g_hash_table_destroy(th->cache);
+    g_queue_clear_full(&th->lru, cache_entry_free);
+    thumbnailer_unref(th);
+}
+
+void thumbnailer_request(Thumbnailer *th, const gint64 *times_us, guint n) {
+    g_mutex_lock(&th->lock);
+    g_array_set_size(th->pending, 0);
+    th->next = 0;
+    gboolean keep_current = FALSE;
+    for (guint i = 0; i < n; i++) {
+        if (times_us[i] == th->current)
+            keep_current = TRUE;
+        else if (!g_hash_table_contains(th->cache, &times_us[i]))
+            g_array_append_val(th->pending, times_us[i]);
+    }
+    // O que está sendo decodificado e saiu da tela é abandonado no próximo pacote
+    if (!keep_current)
+        g_atomic_int_inc(&th->generation);
+    g_cond_signal(&th->cond);
+    g_mutex_unlock(&th->lock);
+}
+
+GdkTexture *thumbnailer_lookup(Thumbnailer *th, gint64 time_us) {
+    GList *link = g_hash_table_lookup(th->cache, &time_us);
+    if (!link)
+        return NULL;
+    g_queue_unlink(&th->lru, link);
+    g_queue_push_head_link(&th->lru, link);
+    return ((CacheEntry *)link->data)->texture;
+}
@@ -0,0 +1,64 @@
+#include <glib.h>
+#include <math.h>
+#include <stdio.h>
+#include "timecode.h"
+
+// Campo só de dígitos (sem sinal, sem espaços), até "max"
+static gboolean parse_field(const char *text, guint64 max, guint64 *value) {
+    if (!*text)
+        return FALSE;
+    guint64 v = 0;
+    for (const char *p = text; *p; p++) {
+        if (!g_ascii_isdigit(*p))
+            return FALSE;
+        v = v * 10 + (guint64)(*p - '0');
+        if (v > max)
+            return FALSE;
+    }
+    *value = v;
+    return TRUE;
+}
+
+// Quadro e tempo se convertem pelo índice do quadro, arredondando nos dois
+// sentidos: formatar o que foi lido devolve o mesmo timecode
+gboolean timecode_parse(const char *text, double fps, gint64 *us) {
+    gchar *copy = g_strstrip(g_strdup(text));
+    gchar **parts = g_strsplit(copy, ":", -1);
+    guint n = g_strv_length(parts);
+    if (fps <= 0)
+        fps = 30.0;
+    // Horas só até onde o total em microssegundos ainda cabe num gint64
+    const guint64 max_secs = G_MAXINT64 / G_USEC_PER_SEC - 1;
+    const guint64 max[4] = { max_secs / 3600, 59, 59, (guint64)ceil(fps) - 1 };
+    guint64 field[4] = { 0, 0, 0, 0 };
+    gboolean ok = n == 3 || n == 4;
+    for (guint i = 0; ok && i < n; i++)
+        ok = parse_field(parts[i], max[i], &field[i]);
+    g_strfreev(parts);
+    g_free(copy);
+    if (!ok)
+        return FALSE;
+    guint64 h = field[0], m = field[1], s = field[2], f = field[3];
+    // O quadro soma menos de um segundo: com os segundos até max_secs, não estoura
+    if (h * 3600 + m * 60 + s > max_secs)
+        return FALSE;
+
+    *us = ((gint64)h * 3600 + (gint64)m * 60 + (gint64)s) * G_USEC_PER_SEC + (gint64)llround(f * G_USEC_PER_SEC / fps);
+    return TRUE;
+}
+
+void timecode_format(gint64 us, double fps, char *buf, gsize size) {
+    if (fps <= 0)
+        fps = 30.0;
+    if (us < 0)
+        us = 0;
+    gint64 secs = us / G_USEC_PER_SEC;
+    // Quadro mais próximo; perto do fim do segundo, ele já é o quadro 0 do seguinte
+    gint64 frame = llround((us % G_USEC_PER_SEC) * fps / G_USEC_PER_SEC);
+    if (frame >= (gint64)ceil(fps)) {
+        secs++;
+        frame = 0;
+    }
+    g_snprintf(buf, size, "%02d:%02d:%02d:%02d",
+               (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60), (int)frame);
+}
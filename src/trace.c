@@ -0,0 +1,110 @@
+#include <glib.h>
+#include <stdio.h>
+#include "trace.h"
+
+gboolean trace_enabled = FALSE;
+
+typedef struct {
+    gchar *name;
+    const char *category;
+    gint64 ts;      // µs desde trace_init
+    gint64 dur;     // -1 para eventos instantâneos
+    guint tid;
+} TraceEvent;
+
+static GMutex trace_lock;
+static GArray *events = NULL;
+static gchar *trace_path = NULL;
+static gint64 trace_origin = 0;
+static gint next_tid = 1;
+static GPrivate thread_id;
+
+// Identificador pequeno e estável por thread (o Chrome agrupa as faixas por tid)
+static guint current_tid(void) {
+    guint tid = GPOINTER_TO_UINT(g_private_get(&thread_id));
+    if (!tid) {
+        tid = (guint)g_atomic_int_add(&next_tid, 1);
+        g_private_set(&thread_id, GUINT_TO_POINTER(tid));
+    }
+    return tid;
+}
+
+void trace_init(const char *path) {
+    if (trace_enabled || !path || !*path)
+        return;
+    trace_path = g_strdup(path);
+    trace_origin = g_get_monotonic_time();
+    events = g_array_sized_new(FALSE, FALSE, sizeof(TraceEvent), 4096);
+    current_tid();  // a thread principal fica com tid 1
+    trace_enabled = TRUE;
+}
+
+static void append_event(const char *name, const char *category, gint64 ts, gint64 dur) {
+    TraceEvent ev = { g_strdup(name), category, ts - trace_origin, dur, current_tid() };
+    g_mutex_lock(&trace_lock);
+    if (events)
+        g_array_append_val(events, ev);
+    else
+        g_free(ev.name);  // chegou depois do trace_shutdown
+    g_mutex_unlock(&trace_lock);
+}
+
+void trace_record(const char *name, const char *category, gint64 start_us, gint64 end_us) {
+    if (trace_enabled)
+        append_event(name, category, start_us, MAX(end_us - start_us, 0));
+}
+
+void trace_record_instant(const char *name, const char *category) {
+    if (trace_enabled)
+        append_event(name, category, g_get_monotonic_time(), -1);
+}
+
+static void write_json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((guchar)*s < 0x20)
+            fprintf(f, "\\u%04x", (guchar)*s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+void trace_shutdown(void) {
+    if (!trace_enabled)
+        return;
+    trace_enabled = FALSE;
+
+    g_mutex_lock(&trace_lock);
+    GArray *recorded = events;
+    events = NULL;
+    g_mutex_unlock(&trace_lock);
+
+    FILE *f = fopen(trace_path, "w");
+    if (!f) {
+        g_warning("Não foi possível gravar o trace em %s", trace_path);
+    } else {
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+        for (guint i = 0; i < recorded->len; i++) {
+            TraceEvent *ev = &g_array_index(recorded, TraceEvent, i);
+            fputs("{\"name\":", f);
+            write_json_string(f, ev->name);
+            fprintf(f, ",\"cat\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT,
+                    ev->category ? ev->category : "zenoka", ev->tid, ev->ts);
+            if (ev->dur >= 0)
+                fprintf(f, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT "}", ev->dur);
+            else
+                fputs(",\"ph\":\"i\",\"s\":\"p\"}", f);
+            fputs(i + 1 < recorded->len ? ",\n" : "\n", f);
+        }
+        fputs("]}\n", f);
+        fclose(f);
+    }
+
+    for (guint i = 0; i < recorded->len; i++)
+        g_free(g_array_index(recorded, TraceEvent, i).name);
+    g_array_free(recorded, TRUE);
+    g_clear_pointer(&trace_path, g_free);
+}
@@ -0,0 +1,830 @@
+#include <gtk/gtk.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include "video_engine.h"
+#include "video_paintable.h"
+#include "packet_queue.h"
+#include "media_clock.h"
+#include "media_util.h"
+#include "seek_index.h"
+#include "audio_engine.h"
+#include "trace.h"
+#include "perf_counters.h"
+
+#define VIDEO_RING_SIZE     8
+#define VIDEO_PACKET_QUEUE  96
+#define AUDIO_PACKET_QUEUE  256
+// Quadro que chega ao decodificador mais atrasado que isso nem é convertido
+#define LATE_FRAME_US       40000
+
+// Anel de buffers RGBA. Cada buffer volta para a lista livre quando a GdkTexture
+// que o embrulha é liberada (o que pode acontecer depois do engine fechar, por
+// isso o pool tem contagem de referências própria).
+typedef struct _FramePool FramePool;
+
+typedef struct {
+    FramePool *pool;
+    guint8 *pixels;
+} FrameSlot;
+
+struct _FramePool {
+    gint ref_count;
+    GMutex lock;
+    GCond cond;
+    GQueue free_slots;
+    FrameSlot slots[VIDEO_RING_SIZE];
+    int width;
+    int height;
+    int stride;
+    gsize size;
+    gboolean aborted;
+};
+
+typedef struct {
+    gint64 pts_us;
+    GdkTexture *texture;
+} DecodedFrame;
+
+// Ações do demux, que é o único dono do AVFormatContext
+typedef struct {
+    gboolean pending;
+    gint64 target_us;       // pts absoluto pedido
+    guint serial;
+} SeekRequest;
+
+struct _VideoEngine {
+    gchar *path;
+    int max_width, max_height;
+    AVFormatContext *fmt;
+    AVCodecContext *dec;
+    int stream_index;
+    AVRational time_base;
+    gint64 start_us;
+    gint64 duration_us;
+    double frame_rate;
+
+    PacketQueue packets;
+    int audio_index;        // -1 = sem áudio
+    PacketQueue audio_packets;
+    AudioEngine *audio;
+    double volume;
+    gboolean muted;
+    GThread *demux_thread;
+    GThread *decode_thread;
+    gint abort_request;
+
+    SeekIndex *index;
+    GMutex seek_lock;
+    GCond seek_cond;
+    SeekRequest seek;
+    gint64 seek_target_us;  // destino do último seek aplicado pelo demux
+    gint serial;            // seek atual; quadros de outro serial são descartados
+
+    FramePool *pool;
+
+    GMutex ready_lock;
+    GCond ready_cond;       // sinalizado a cada quadro pronto e no fim do stream
+    GQueue ready;           // DecodedFrame*, em ordem de apresentação
+    gboolean decode_eof;
+
+    MediaClock clock;
+    VideoPaintable *paintable;
+    GtkWidget *widget;
+    guint tick_id;
+    gboolean playing;
+    gboolean have_frame;
+    gint64 position_us;
+    VideoStateFunc state_func;
+    gpointer state_data;
+
+    gint presented;
+    gint dropped;
+};
+
+// Contadores do HUD, somados entre todos os engines abertos
+static struct {
+    PerfCounter *presented;
+    PerfCounter *dropped;
+    PerfCounter *packets;
+    PerfCounter *ready;
+    PerfCounter *buffers;
+} perf;
+
+static void perf_init(void) {
+    static gsize once = 0;
+    if (g_once_init_enter(&once)) {
+        perf.presented = perf_counter_register("video.apresentados", PERF_COUNT);
+        perf.dropped = perf_counter_register("video.descartados", PERF_COUNT);
+        perf.packets = perf_counter_register("video.pacotes", PERF_GAUGE);
+        perf.ready = perf_counter_register("video.prontos", PERF_GAUGE);
+        perf.buffers = perf_counter_register("video.buffers", PERF_KIB);
+        g_once_init_leave(&once, 1);
+    }
+}
+
+static FramePool *frame_pool_new(int width, int height) {
+    FramePool *p = g_new0(FramePool, 1);
+    p->ref_count = 1;
+    g_mutex_init(&p->lock);
+    g_cond_init(&p->cond);
+    g_queue_init(&p->free_slots);
+    p->width = width;
+    p->height = height;
+    p->stride = width * 4;
+    p->size = (gsize)p->stride * height;
+    for (int i = 0; i < VIDEO_RING_SIZE; i++) {
+        p->slots[i].pool = p;
+        p->slots[i].pixels = g_malloc(p->size);
+        g_queue_push_tail(&p->free_slots, &p->slots[i]);
+    }
+    perf_counter_add(perf.buffers, (gint)(p->size * VIDEO_RING_SIZE / 1024));
+    return p;
+}
+
+static void frame_pool_unref(FramePool *p) {
+    if (!g_atomic_int_dec_and_test(&p->ref_count))
+        return;
+    for (int i = 0; i < VIDEO_RING_SIZE; i++)
+        g_free(p->slots[i].pixels);
+    perf_counter_add(perf.buffers, -(gint)(p->size * VIDEO_RING_SIZE / 1024));
+    g_queue_clear(&p->free_slots);
+    g_mutex_clear(&p->lock);
+    g_cond_clear(&p->cond);
+    g_free(p);
+}
+
+// Bloqueia até haver um buffer livre; NULL se o pool foi abortado
+static FrameSlot *frame_pool_acquire(FramePool *p) {
+    g_mutex_lock(&p->lock);
+    while (!p->aborted && g_queue_is_empty(&p->free_slots))
+        g_cond_wait(&p->cond, &p->lock);
+    FrameSlot *slot = p->aborted ? NULL : g_queue_pop_head(&p->free_slots);
+    if (slot)
+        g_atomic_int_inc(&p->ref_count);
+    g_mutex_unlock(&p->lock);
+    return slot;
+}
+
+// Chamada quando a textura que usa o buffer é finalizada (qualquer thread)
+static void frame_pool_release(gpointer data) {
+    FrameSlot *slot = data;
+    FramePool *p = slot->pool;
+    g_mutex_lock(&p->lock);
+    g_queue_push_tail(&p->free_slots, slot);
+    g_cond_signal(&p->cond);
+    g_mutex_unlock(&p->lock);
+    frame_pool_unref(p);
+}
+
+static void frame_pool_abort(FramePool *p) {
+    g_mutex_lock(&p->lock);
+    p->aborted = TRUE;
+    g_cond_broadcast(&p->cond);
+    g_mutex_unlock(&p->lock);
+}
+
+static void decoded_frame_free(DecodedFrame *f) {
+    g_object_unref(f->texture);
+    g_free(f);
+}
+
+static int interrupt_cb(void *data) {
+    VideoEngine *e = data;
+    return g_atomic_int_get(&e->abort_request);
+}
+
+// Espera (se chegou ao fim do arquivo) e retira o pedido de seek pendente
+static gboolean take_seek_request(VideoEngine *e, gboolean at_eof, SeekRequest *req) {
+    g_mutex_lock(&e->seek_lock);
+    while (at_eof && !e->seek.pending && !g_atomic_int_get(&e->abort_request))
+        g_cond_wait(&e->seek_cond, &e->seek_lock);
+    *req = e->seek;
+    e->seek.pending = FALSE;
+    g_mutex_unlock(&e->seek_lock);
+    return req->pending;
+}
+
+// Keyframes que o índice achou e o demuxer ainda não conhece (formatos sem
+// tabela própria), para o av_seek_frame cair exatamente neles
+static void sync_demuxer_index(VideoEngine *e) {
+    if (!(e->fmt->iformat->flags & AVFMT_GENERIC_INDEX))
+        return;
+    AVStream *st = e->fmt->streams[e->stream_index];
+    GArray *keyframes = seek_index_get_keyframes(e->index);
+    for (guint i = 0; i < keyframes->len; i++) {
+        SeekEntry *kf = &g_array_index(keyframes, SeekEntry, i);
+        if (kf->pos >= 0)
+            av_add_index_entry(st, kf->pos, kf->ts, 0, 0, AVINDEX_KEYFRAME);
+    }
+    g_array_unref(keyframes);
+}
+
+static void do_seek(VideoEngine *e, const SeekRequest *req) {
+    gint64 t = trace_begin();
+    SeekEntry kf;
+    gint64 ts;
+    // Com o índice, o demuxer cai no keyframe que precede o destino e só o fim
+    // desse GOP é decodificado; sem ele (região ainda não varrida), seek normal
+    if (seek_index_lookup(e->index, req->target_us, &kf)) {
+        sync_demuxer_index(e);
+        ts = kf.ts;
+    } else {
+        ts = media_us_to_ts(req->target_us, e->time_base);
+    }
+    if (av_seek_frame(e->fmt, e->stream_index, ts, AVSEEK_FLAG_BACKWARD) < 0)
+        av_seek_frame(e->fmt, e->stream_index, ts, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY);
+
+    g_mutex_lock(&e->seek_lock);
+    e->seek_target_us = req->target_us;
+    g_mutex_unlock(&e->seek_lock);
+    packet_queue_flush(&e->packets, req->serial);
+    packet_queue_flush(&e->audio_packets, req->serial);
+    trace_end("seek", "media", t);
+}
+
+static gpointer demux_thread(gpointer data) {
+    VideoEngine *e = data;
+    gboolean eof = FALSE;
+    while (!g_atomic_int_get(&e->abort_request)) {
+        SeekRequest req;
+        if (take_seek_request(e, eof, &req)) {
+            do_seek(e, &req);
+            eof = FALSE;
+            continue;
+        }
+        if (eof)
+            continue;
+
+        AVPacket *pkt = av_packet_alloc();
+        int ret = av_read_frame(e->fmt, pkt);
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            packet_queue_put(&e->packets, NULL);  // fim do stream
+            if (e->audio)
+                packet_queue_put(&e->audio_packets, NULL);
+            eof = TRUE;
+            continue;
+        }
+        // FALSE: abortado, ou interrompido por um seek (o pacote já não serve)
+        if (pkt->stream_index == e->stream_index)
+            packet_queue_put(&e->packets, pkt);
+        else if (pkt->stream_index == e->audio_index)
+            packet_queue_put(&e->audio_packets, pkt);
+        else
+            av_packet_free(&pkt);
+    }
+    return NULL;
+}
+
+// Com áudio tocando, a posição que sai no alto-falante manda; sem ele (ou
+// logo depois de um seek, antes do áudio recomeçar) vale o relógio do sistema
+static gint64 master_clock(VideoEngine *e) {
+    gint64 pts_us;
+    if (audio_engine_get_clock(e->audio, &pts_us))
+        return pts_us;
+    return media_clock_get(&e->clock);
+}
+
+static gboolean is_late(VideoEngine *e, gint64 pts_us) {
+    return media_clock_is_running(&e->clock) && pts_us < master_clock(e) - LATE_FRAME_US;
+}
+
+static gboolean is_stale(VideoEngine *e, guint serial) {
+    return serial != (guint)g_atomic_int_get(&e->serial);
+}
+
+static void push_ready(VideoEngine *e, gint64 pts_us, GdkTexture *texture, guint serial) {
+    g_mutex_lock(&e->ready_lock);
+    if (is_stale(e, serial)) {
+        g_mutex_unlock(&e->ready_lock);
+        g_object_unref(texture);
+        return;
+    }
+    DecodedFrame *f = g_new(DecodedFrame, 1);
+    f->pts_us = pts_us;
+    f->texture = texture;
+    g_queue_push_tail(&e->ready, f);
+    perf_counter_add(perf.ready, 1);
+    g_cond_broadcast(&e->ready_cond);
+    g_mutex_unlock(&e->ready_lock);
+}
+
+static gpointer decode_thread(gpointer data) {
+    VideoEngine *e = data;
+    AVFrame *frame = av_frame_alloc();
+    struct SwsContext *sws = NULL;
+    gint64 last_pts_us = e->start_us;
+    gint64 skip_until_us = G_MININT64;
+    guint cur_serial = 0;
+    AVPacket *pkt = NULL;
+    guint serial;
+
+    while (packet_queue_get(&e->packets, &pkt, &serial)) {
+        perf_counter_set(perf.packets, (gint)packet_queue_length(&e->packets));
+        // Primeiro pacote depois de um seek: recomeça o decodificador e descarta
+        // tudo antes do destino (o resto do GOP serve só de referência)
+        if (serial != cur_serial) {
+            cur_serial = serial;
+            avcodec_flush_buffers(e->dec);
+            g_mutex_lock(&e->seek_lock);
+            skip_until_us = e->seek_target_us;
+            g_mutex_unlock(&e->seek_lock);
+        }
+
+        // Pacote NULL (fim do stream) drena o decodificador
+        int ret = avcodec_send_packet(e->dec, pkt);
+        av_packet_free(&pkt);
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            continue;
+
+        while ((ret = avcodec_receive_frame(e->dec, frame)) >= 0) {
+            gint64 pts_us = media_ts_to_us(frame->best_effort_timestamp, e->time_base);
+            if (pts_us == G_MININT64)
+                pts_us = last_pts_us;
+            last_pts_us = pts_us;
+
+            if (pts_us < skip_until_us || is_stale(e, cur_serial)) {
+                av_frame_unref(frame);
+                continue;
+            }
+            if (is_late(e, pts_us)) {
+                g_atomic_int_inc(&e->dropped);
+                perf_counter_add(perf.dropped, 1);
+                av_frame_unref(frame);
+                continue;
+            }
+
+            FrameSlot *slot = frame_pool_acquire(e->pool);
+            if (!slot) {
+                av_frame_unref(frame);
+                goto out;
+            }
+
+            FramePool *pool = e->pool;
+            sws = sws_getCachedContext(sws, frame->width, frame->height, frame->format,
+                                       pool->width, pool->height, AV_PIX_FMT_RGBA,
+                                       SWS_BILINEAR, NULL, NULL, NULL);
+            uint8_t *dst[4] = { slot->pixels, NULL, NULL, NULL };
+            int dst_stride[4] = { pool->stride, 0, 0, 0 };
+            sws_scale(sws, (const uint8_t * const *)frame->data, frame->linesize, 0, frame->height, dst, dst_stride);
+            av_frame_unref(frame);
+
+            // A textura embrulha o buffer do anel sem copiar
+            GBytes *bytes = g_bytes_new_with_free_func(slot->pixels, pool->size, frame_pool_release, slot);
+            GdkTexture *texture = gdk_memory_texture_new(pool->width, pool->height, GDK_MEMORY_R8G8B8A8,
+                                                         bytes, pool->stride);
+            g_bytes_unref(bytes);
+            push_ready(e, pts_us, texture, cur_serial);
+        }
+
+        if (ret == AVERROR_EOF) {
+            g_mutex_lock(&e->ready_lock);
+            if (!is_stale(e, cur_serial))
+                e->decode_eof = TRUE;
+            g_cond_broadcast(&e->ready_cond);
+            g_mutex_unlock(&e->ready_lock);
+        }
+    }
+
+out:
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    return NULL;
+}
+
+// Conduzido pelo frame clock do widget: mostra o quadro mais recente cuja hora já
+// chegou e descarta os que ficaram para trás
+static gboolean on_tick(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) {
+    (void)widget; (void)frame_clock;
+    VideoEngine *e = user_data;
+    gint64 now = master_clock(e);
+    // Se o áudio acabar antes do vídeo, o relógio do sistema segue de onde ele parou
+    if (e->playing && e->have_frame)
+        media_clock_set(&e->clock, now);
+    DecodedFrame *show = NULL;
+
+    g_mutex_lock(&e->ready_lock);
+    for (;;) {
+        DecodedFrame *f = g_queue_peek_head(&e->ready);
+        if (!f)
+            break;
+        // Parado, ou logo depois de um seek, o primeiro quadro disponível é mostrado
+        if (e->playing && e->have_frame ? f->pts_us > now : (show != NULL || e->have_frame))
+            break;
+        g_queue_pop_head(&e->ready);
+        perf_counter_add(perf.ready, -1);
+        if (show) {
+            g_atomic_int_inc(&e->dropped);
+            perf_counter_add(perf.dropped, 1);
+            decoded_frame_free(show);
+        }
+        show = f;
+    }
+    gboolean finished = e->decode_eof && g_queue_is_empty(&e->ready);
+    g_mutex_unlock(&e->ready_lock);
+
+    if (show) {
+        // O relógio fica parado durante o seek e volta a andar no primeiro quadro
+        if (e->playing && !e->have_frame)
+            media_clock_start(&e->clock, show->pts_us);
+        video_paintable_set_texture(e->paintable, show->texture);
+        e->position_us = show->pts_us;
+        e->have_frame = TRUE;
+        g_atomic_int_inc(&e->presented);
+        perf_counter_add(perf.presented, 1);
+        decoded_frame_free(show);
+    }
+
+    if (finished && e->playing)
+        video_engine_pause(e);
+    if (!e->playing && (e->have_frame || finished)) {
+        e->tick_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void ensure_tick(VideoEngine *e) {
+    if (e->widget && !e->tick_id)
+        e->tick_id = gtk_widget_add_tick_callback(e->widget, on_tick, e, NULL);
+}
+
+static void remove_tick(VideoEngine *e) {
+    if (e->widget && e->tick_id)
+        gtk_widget_remove_tick_callback(e->widget, e->tick_id);
+    e->tick_id = 0;
+}
+
+static void on_widget_finalized(gpointer data, GObject *where_the_object_was) {
+    (void)where_the_object_was;
+    VideoEngine *e = data;
+    e->widget = NULL;
+    e->tick_id = 0;
+}
+
+VideoEngine *video_engine_new(void) {
+    perf_init();
+    VideoEngine *e = g_new0(VideoEngine, 1);
+    e->stream_index = -1;
+    e->audio_index = -1;
+    e->volume = 1.0;
+    g_mutex_init(&e->seek_lock);
+    g_cond_init(&e->seek_cond);
+    g_mutex_init(&e->ready_lock);
+    g_cond_init(&e->ready_cond);
+    g_queue_init(&e->ready);
+    media_clock_init(&e->clock);
+    e->paintable = video_paintable_new();
+    return e;
+}
+
+void video_engine_free(VideoEngine *e) {
+    if (!e)
+        return;
+    video_engine_close(e);
+    if (e->widget)
+        g_object_weak_unref(G_OBJECT(e->widget), on_widget_finalized, e);
+    g_object_unref(e->paintable);
+    media_clock_clear(&e->clock);
+    g_mutex_clear(&e->seek_lock);
+    g_cond_clear(&e->seek_cond);
+    g_mutex_clear(&e->ready_lock);
+    g_cond_clear(&e->ready_cond);
+    g_free(e);
+}
+
+// Escala o vídeo (respeitando o aspecto do pixel) para caber na caixa, sem ampliar
+static void fit_size(AVCodecContext *dec, int max_w, int max_h, int *w, int *h) {
+    AVRational sar = dec->sample_aspect_ratio;
+    double dw = dec->width * (sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.0);
+    double s = MIN(1.0, MIN(max_w / dw, max_h / (double)dec->height));
+    *w = MAX(2, (int)(dw * s) & ~1);
+    *h = MAX(2, (int)(dec->height * s) & ~1);
+}
+
+gboolean video_engine_open(VideoEngine *e, const char *path, int max_width, int max_height, GError **error) {
+    video_engine_close(e);
+
+    e->fmt = media_open_input(path, error);
+    if (!e->fmt)
+        return FALSE;
+
+    const AVCodec *codec = NULL;
+    int idx = av_find_best_stream(e->fmt, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (idx < 0 || !codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de vídeo", path);
+        avformat_close_input(&e->fmt);
+        return FALSE;
+    }
+
+    AVStream *st = e->fmt->streams[idx];
+    e->dec = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(e->dec, st->codecpar);
+    e->dec->pkt_timebase = st->time_base;
+    e->dec->thread_count = 0;  // um por núcleo
+    e->dec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    int ret = avcodec_open2(e->dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, codec->name);
+        avcodec_free_context(&e->dec);
+        avformat_close_input(&e->fmt);
+        return FALSE;
+    }
+
+    // Áudio é opcional: sem decodificador ou sem dispositivo, o vídeo toca mudo
+    packet_queue_init(&e->audio_packets, AUDIO_PACKET_QUEUE);
+    e->audio_index = av_find_best_stream(e->fmt, AVMEDIA_TYPE_AUDIO, -1, idx, NULL, 0);
+    if (e->audio_index >= 0) {
+        GError *audio_error = NULL;
+        e->audio = audio_engine_open(e->fmt->streams[e->audio_index], &e->audio_packets, &audio_error);
+        if (!e->audio) {
+            g_print("Sem áudio: %s\n", audio_error->message);
+            g_error_free(audio_error);
+            e->audio_index = -1;
+        }
+    }
+    audio_engine_set_volume(e->audio, e->volume);
+    audio_engine_set_muted(e->audio, e->muted);
+
+    // O demux só entrega o que vamos usar
+    for (unsigned i = 0; i < e->fmt->nb_streams; i++)
+        e->fmt->streams[i]->discard = (int)i == idx || (int)i == e->audio_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    e->fmt->interrupt_callback.callback = interrupt_cb;
+    e->fmt->interrupt_callback.opaque = e;
+
+    e->path = g_strdup(path);
+    e->max_width = max_width;
+    e->max_height = max_height;
+    e->stream_index = idx;
+    e->time_base = st->time_base;
+    e->start_us = media_stream_start_us(st);
+    e->duration_us = e->fmt->duration != AV_NOPTS_VALUE ? e->fmt->duration : 0;
+    AVRational rate = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+    e->frame_rate = rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 30.0;
+    e->position_us = e->start_us;
+    e->have_frame = FALSE;
+    e->decode_eof = FALSE;
+    g_atomic_int_set(&e->presented, 0);
+    g_atomic_int_set(&e->dropped, 0);
+    media_clock_pause(&e->clock);
+    media_clock_set(&e->clock, e->start_us);
+
+    int out_w, out_h;
+    fit_size(e->dec, max_width, max_height, &out_w, &out_h);
+    e->pool = frame_pool_new(out_w, out_h);
+
+    packet_queue_init(&e->packets, VIDEO_PACKET_QUEUE);
+    g_atomic_int_set(&e->abort_request, 0);
+    g_atomic_int_set(&e->serial, 0);
+    e->seek.pending = FALSE;
+    e->seek_target_us = G_MININT64;
+    e->index = seek_index_new(path);
+    e->demux_thread = g_thread_new("video-demux", demux_thread, e);
+    e->decode_thread = g_thread_new("video-decode", decode_thread, e);
+
+    ensure_tick(e);
+    return TRUE;
+}
+
+void video_engine_close(VideoEngine *e) {
+    if (!e->fmt)
+        return;
+
+    remove_tick(e);
+    video_engine_pause(e);
+
+    g_atomic_int_set(&e->abort_request, 1);
+    g_mutex_lock(&e->seek_lock);
+    g_cond_signal(&e->seek_cond);
+    g_mutex_unlock(&e->seek_lock);
+    packet_queue_abort(&e->packets);
+    packet_queue_abort(&e->audio_packets);
+    frame_pool_abort(e->pool);
+    g_thread_join(e->demux_thread);
+    g_thread_join(e->decode_thread);
+    e->demux_thread = e->decode_thread = NULL;
+    audio_engine_close(e->audio);
+    e->audio = NULL;
+
+    g_mutex_lock(&e->ready_lock);
+    perf_counter_add(perf.ready, -(gint)g_queue_get_length(&e->ready));
+    while (!g_queue_is_empty(&e->ready))
+        decoded_frame_free(g_queue_pop_head(&e->ready));
+    g_mutex_unlock(&e->ready_lock);
+    video_paintable_set_texture(e->paintable, NULL);
+
+    packet_queue_clear(&e->packets);
+    packet_queue_clear(&e->audio_packets);
+    avcodec_free_context(&e->dec);
+    avformat_close_input(&e->fmt);
+    frame_pool_unref(e->pool);
+    e->pool = NULL;
+    seek_index_cancel(e->index);
+    seek_index_unref(e->index);
+    e->index = NULL;
+    e->stream_index = -1;
+    e->audio_index = -1;
+    g_clear_pointer(&e->path, g_free);
+}
+
+gboolean video_engine_use_proxy(VideoEngine *e, const char *proxy_path, GError **error) {
+    if (!e->fmt) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_INVALID, "Nenhum vídeo aberto");
+        return FALSE;
+    }
+    gchar *original = g_strdup(e->path);
+    gint64 start_us = e->start_us;
+    gint64 duration_us = e->duration_us;
+    double frame_rate = e->frame_rate;
+    gint64 position_us = video_engine_get_position_us(e);
+    gboolean playing = e->playing;
+
+    gboolean ok = video_engine_open(e, proxy_path, e->max_width, e->max_height, error);
+    if (ok) {
+        // Os pts do proxy são os do original: origem, duração e taxa continuam as
+        // dele, e as posições que a interface mostra não mudam
+        e->start_us = start_us;
+        e->duration_us = duration_us;
+        e->frame_rate = frame_rate;
+        e->position_us = start_us;
+        media_clock_set(&e->clock, start_us);
+    } else {
+        video_engine_open(e, original, e->max_width, e->max_height, NULL);
+    }
+    g_free(original);
+    video_engine_seek(e, position_us);
+    if (playing)
+        video_engine_play(e);
+    return ok;
+}
+
+gboolean video_engine_is_open(VideoEngine *e) {
+    return e->fmt != NULL;
+}
+
+GdkPaintable *video_engine_get_paintable(VideoEngine *e) {
+    return GDK_PAINTABLE(e->paintable);
+}
+
+void video_engine_attach(VideoEngine *e, GtkWidget *widget) {
+    if (e->widget == widget)
+        return;
+    remove_tick(e);
+    if (e->widget)
+        g_object_weak_unref(G_OBJECT(e->widget), on_widget_finalized, e);
+    e->widget = widget;
+    if (widget)
+        g_object_weak_ref(G_OBJECT(widget), on_widget_finalized, e);
+    if (e->fmt && (e->playing || !e->have_frame))
+        ensure_tick(e);
+}
+
+void video_engine_set_state_func(VideoEngine *e, VideoStateFunc func, gpointer user_data) {
+    e->state_func = func;
+    e->state_data = user_data;
+}
+
+static void notify_state(VideoEngine *e) {
+    if (e->state_func)
+        e->state_func(e, e->state_data);
+}
+
+void video_engine_play(VideoEngine *e) {
+    if (!e->fmt || e->playing)
+        return;
+
+    // No fim do vídeo, play recomeça do início
+    g_mutex_lock(&e->ready_lock);
+    gboolean finished = e->decode_eof && g_queue_is_empty(&e->ready);
+    g_mutex_unlock(&e->ready_lock);
+    if (finished)
+        video_engine_seek(e, 0);
+
+    e->playing = TRUE;
+    if (e->have_frame)
+        media_clock_start(&e->clock, e->position_us);
+    audio_engine_set_playing(e->audio, TRUE);
+    ensure_tick(e);
+    notify_state(e);
+}
+
+void video_engine_pause(VideoEngine *e) {
+    if (!e->playing)
+        return;
+    e->playing = FALSE;
+    media_clock_pause(&e->clock);
+    audio_engine_set_playing(e->audio, FALSE);
+    notify_state(e);
+}
+
+gboolean video_engine_is_playing(VideoEngine *e) {
+    return e->playing;
+}
+
+gint64 video_engine_get_duration_us(VideoEngine *e) {
+    return e->duration_us;
+}
+
+gint64 video_engine_get_position_us(VideoEngine *e) {
+    return e->position_us - e->start_us;
+}
+
+double video_engine_get_frame_rate(VideoEngine *e) {
+    return e->frame_rate > 0 ? e->frame_rate : 30.0;
+}
+
+void video_engine_seek(VideoEngine *e, gint64 position_us) {
+    if (!e->fmt)
+        return;
+    gint64 target = e->start_us + CLAMP(position_us, 0, MAX(e->duration_us, 0));
+
+    // Tudo que já foi decodificado deixa de valer
+    g_mutex_lock(&e->ready_lock);
+    guint serial = (guint)g_atomic_int_add(&e->serial, 1) + 1;
+    perf_counter_add(perf.ready, -(gint)g_queue_get_length(&e->ready));
+    while (!g_queue_is_empty(&e->ready))
+        decoded_frame_free(g_queue_pop_head(&e->ready));
+    e->decode_eof = FALSE;
+    g_mutex_unlock(&e->ready_lock);
+
+    audio_engine_seek(e->audio, target, serial);
+
+    // Vários seeks seguidos: o demux só atende o último
+    g_mutex_lock(&e->seek_lock);
+    e->seek.pending = TRUE;
+    e->seek.target_us = target;
+    e->seek.serial = serial;
+    g_cond_signal(&e->seek_cond);
+    g_mutex_unlock(&e->seek_lock);
+    packet_queue_interrupt(&e->packets);
+    packet_queue_interrupt(&e->audio_packets);
+
+    media_clock_pause(&e->clock);
+    media_clock_set(&e->clock, target);
+    e->position_us = target;
+    e->have_frame = FALSE;
+    ensure_tick(e);
+}
+
+GdkTexture *video_engine_take_frame(VideoEngine *e, gint64 timeout_us, gint64 *position_us) {
+    if (!e->fmt)
+        return NULL;
+    gint64 deadline = g_get_monotonic_time() + timeout_us;
+    g_mutex_lock(&e->ready_lock);
+    while (g_queue_is_empty(&e->ready) && !e->decode_eof) {
+        if (!g_cond_wait_until(&e->ready_cond, &e->ready_lock, deadline))
+            break;
+    }
+    DecodedFrame *f = g_queue_pop_head(&e->ready);
+    if (f)
+        perf_counter_add(perf.ready, -1);
+    g_mutex_unlock(&e->ready_lock);
+    if (!f)
+        return NULL;
+
+    GdkTexture *texture = f->texture;
+    e->position_us = f->pts_us;
+    e->have_frame = TRUE;
+    g_atomic_int_inc(&e->presented);
+    perf_counter_add(perf.presented, 1);
+    g_free(f);
+    if (position_us)
+        *position_us = e->position_us - e->start_us;
+    return texture;
+}
+
+SeekIndex *video_engine_get_seek_index(VideoEngine *e) {
+    return e->index;
+}
+
+void video_engine_get_stats(VideoEngine *e, VideoEngineStats *stats) {
+    stats->presented = (guint)g_atomic_int_get(&e->presented);
+    stats->dropped = (guint)g_atomic_int_get(&e->dropped);
+    stats->queued_packets = e->fmt ? packet_queue_length(&e->packets) : 0;
+    g_mutex_lock(&e->ready_lock);
+    stats->ready_frames = g_queue_get_length(&e->ready);
+    g_mutex_unlock(&e->ready_lock);
+}
+
+gboolean video_engine_has_audio(VideoEngine *e) {
+    return e->audio != NULL;
+}
+
+void video_engine_set_volume(VideoEngine *e, double volume) {
+    e->volume = CLAMP(volume, 0.0, 1.0);
+    audio_engine_set_volume(e->audio, e->volume);
+}
+
+double video_engine_get_volume(VideoEngine *e) {
+    return e->volume;
+}
+
+void video_engine_set_muted(VideoEngine *e, gboolean muted) {
+    e->muted = muted;
+    audio_engine_set_muted(e->audio, muted);
+}
+
+gboolean video_engine_is_muted(VideoEngine *e) {
+    return e->muted;
+}
@@ -0,0 +1,131 @@
+#include <gtk/gtk.h>
+#include "video_filmstrip.h"
+#include "thumbnailer.h"
+
+#define TILE_WIDTH 80
+#define TILE_HEIGHT 45
+#define MIN_STEP_US 40000                   // nunca mais de uma miniatura a cada 40 ms
+#define CACHE_BYTES (64 * 1024 * 1024)
+
+struct _VideoFilmstrip {
+    GtkWidget parent_instance;
+    Thumbnailer *thumbnailer;
+    gint64 start_us;
+    gint64 end_us;
+
+    // Último pedido feito ao thumbnailer (evita refazer a fila a cada redesenho)
+    gint64 req_step;
+    gint64 req_first;
+    gint64 req_last;
+};
+
+G_DEFINE_FINAL_TYPE(VideoFilmstrip, video_filmstrip, GTK_TYPE_WIDGET)
+
+// Passo entre miniaturas: potência de 2 de MIN_STEP_US, para que os mesmos
+// instantes voltem a ser pedidos (e achados no cache) ao rolar e ao dar zoom
+static gint64 tile_step(gint64 span_us, int width) {
+    int tiles = MAX(width / TILE_WIDTH, 1);
+    gint64 step = MIN_STEP_US;
+    while (step * tiles < span_us)
+        step *= 2;
+    return step;
+}
+
+// Primeiro a parte visível, da esquerda para a direita; depois uma tela de
+// cada lado, alternando, para o próximo scroll já achar pronto
+static void request_visible(VideoFilmstrip *self, gint64 step, gint64 first, gint64 last) {
+    if (step == self->req_step && first == self->req_first && last == self->req_last)
+        return;
+    self->req_step = step;
+    self->req_first = first;
+    self->req_last = last;
+
+    gint64 n = last - first + 1;
+    GArray *times = g_array_sized_new(FALSE, FALSE, sizeof(gint64), (guint)(n * 3));
+    for (gint64 k = first; k <= last; k++) {
+        gint64 t = k * step;
+        g_array_append_val(times, t);
+    }
+    for (gint64 i = 1; i <= n; i++) {
+        gint64 after = (last + i) * step, before = (first - i) * step;
+        g_array_append_val(times, after);
+        if (before >= 0)
+            g_array_append_val(times, before);
+    }
+    thumbnailer_request(self->thumbnailer, (const gint64 *)times->data, times->len);
+    g_array_unref(times);
+}
+
+static void video_filmstrip_snapshot(GtkWidget *widget, GtkSnapshot *snapshot) {
+    VideoFilmstrip *self = VIDEO_FILMSTRIP(widget);
+    int width = gtk_widget_get_width(widget), height = gtk_widget_get_height(widget);
+    gint64 span = self->end_us - self->start_us;
+    if (!self->thumbnailer || span <= 0 || width <= 0)
+        return;
+
+    gint64 step = tile_step(span, width);
+    gint64 first = self->start_us / step, last = (self->end_us - 1) / step;
+    request_visible(self, step, first, last);
+
+    gtk_snapshot_push_clip(snapshot, &GRAPHENE_RECT_INIT(0, 0, width, height));
+    GdkRGBA empty = { 1, 1, 1, 0.08 };
+    double px_per_us = (double)width / span;
+    double tile_w = MIN(TILE_WIDTH, step * px_per_us - 2);
+    for (gint64 k = first; k <= last; k++) {
+        double x = (k * step - self->start_us) * px_per_us;
+        GdkTexture *texture = thumbnailer_lookup(self->thumbnailer, k * step);
+        if (!texture) {
+            gtk_snapshot_append_color(snapshot, &empty, &GRAPHENE_RECT_INIT(x, 0, tile_w, height));
+            continue;
+        }
+        // Encaixa mantendo o aspecto
+        double tw = gdk_texture_get_width(texture), th = gdk_texture_get_height(texture);
+        double s = MIN(tile_w / tw, height / th);
+        gtk_snapshot_append_texture(snapshot, texture,
+            &GRAPHENE_RECT_INIT(x + (tile_w - tw * s) / 2, (height - th * s) / 2, tw * s, th * s));
+    }
+    gtk_snapshot_pop(snapshot);
+}
+
+static void on_thumbnail_ready(gpointer user_data) {
+    gtk_widget_queue_draw(GTK_WIDGET(user_data));
+}
+
+static void video_filmstrip_dispose(GObject *object) {
+    VideoFilmstrip *self = VIDEO_FILMSTRIP(object);
+    g_clear_pointer(&self->thumbnailer, thumbnailer_free);
+    G_OBJECT_CLASS(video_filmstrip_parent_class)->dispose(object);
+}
+
+static void video_filmstrip_class_init(VideoFilmstripClass *klass) {
+    G_OBJECT_CLASS(klass)->dispose = video_filmstrip_dispose;
+    GTK_WIDGET_CLASS(klass)->snapshot = video_filmstrip_snapshot;
+}
+
+static void video_filmstrip_init(VideoFilmstrip *self) {
+    gtk_widget_set_size_request(GTK_WIDGET(self), -1, TILE_HEIGHT);
+    self->req_step = -1;
+}
+
+GtkWidget *video_filmstrip_new(void) {
+    return g_object_new(VIDEO_TYPE_FILMSTRIP, NULL);
+}
+
+void video_filmstrip_set_source(VideoFilmstrip *self, const char *path) {
+    g_return_if_fail(VIDEO_IS_FILMSTRIP(self));
+    g_clear_pointer(&self->thumbnailer, thumbnailer_free);
+    self->req_step = -1;
+    if (path) {
+        int scale = gtk_widget_get_scale_factor(GTK_WIDGET(self));
+        self->thumbnailer = thumbnailer_new(path, TILE_WIDTH * scale, TILE_HEIGHT * scale, CACHE_BYTES,
+                                            on_thumbnail_ready, self);
+    }
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
+
+void video_filmstrip_set_range(VideoFilmstrip *self, gint64 start_us, gint64 end_us) {
+    g_return_if_fail(VIDEO_IS_FILMSTRIP(self));
+    self->start_us = start_us;
+    self->end_us = end_us;
+    gtk_widget_queue_draw(GTK_WIDGET(self));
+}
@@ -0,0 +1,71 @@
+#include <gtk/gtk.h>
+#include "video_paintable.h"
+
+struct _VideoPaintable {
+    GObject parent_instance;
+    GdkTexture *texture;
+};
+
+static void video_paintable_iface_init(GdkPaintableInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(VideoPaintable, video_paintable, G_TYPE_OBJECT,
+    G_IMPLEMENT_INTERFACE(GDK_TYPE_PAINTABLE, video_paintable_iface_init))
+
+static void video_paintable_snapshot(GdkPaintable *paintable, GdkSnapshot *snapshot, double width, double height) {
+    VideoPaintable *self = VIDEO_PAINTABLE(paintable);
+    if (self->texture) {
+        gdk_paintable_snapshot(GDK_PAINTABLE(self->texture), snapshot, width, height);
+    } else {
+        GdkRGBA black = { 0, 0, 0, 1 };
+        gtk_snapshot_append_color(GTK_SNAPSHOT(snapshot), &black, &GRAPHENE_RECT_INIT(0, 0, width, height));
+    }
+}
+
+static int video_paintable_get_intrinsic_width(GdkPaintable *paintable) {
+    VideoPaintable *self = VIDEO_PAINTABLE(paintable);
+    return self->texture ? gdk_texture_get_width(self->texture) : 0;
+}
+
+static int video_paintable_get_intrinsic_height(GdkPaintable *paintable) {
+    VideoPaintable *self = VIDEO_PAINTABLE(paintable);
+    return self->texture ? gdk_texture_get_height(self->texture) : 0;
+}
+
+static void video_paintable_iface_init(GdkPaintableInterface *iface) {
+    iface->snapshot = video_paintable_snapshot;
+    iface->get_intrinsic_width = video_paintable_get_intrinsic_width;
+    iface->get_intrinsic_height = video_paintable_get_intrinsic_height;
+}
+
+static void video_paintable_dispose(GObject *object) {
+    VideoPaintable *self = VIDEO_PAINTABLE(object);
+    g_clear_object(&self->texture);
+    G_OBJECT_CLASS(video_paintable_parent_class)->dispose(object);
+}
+
+static void video_paintable_class_init(VideoPaintableClass *klass) {
+    G_OBJECT_CLASS(klass)->dispose = video_paintable_dispose;
+}
+
+static void video_paintable_init(VideoPaintable *self) {
+    (void)self;
+}
+
+VideoPaintable *video_paintable_new(void) {
+    return g_object_new(VIDEO_TYPE_PAINTABLE, NULL);
+}
+
+void video_paintable_set_texture(VideoPaintable *self, GdkTexture *texture) {
+    g_return_if_fail(VIDEO_IS_PAINTABLE(self));
+    if (self->texture == texture)
+        return;
+
+    gboolean size_changed = !self->texture || !texture ||
+        gdk_texture_get_width(self->texture) != gdk_texture_get_width(texture) ||
+        gdk_texture_get_height(self->texture) != gdk_texture_get_height(texture);
+
+    g_set_object(&self->texture, texture);
+    if (size_changed)
+        gdk_paintable_invalidate_size(GDK_PAINTABLE(self));
+    gdk_paintable_invalidate_contents(GDK_PAINTABLE(self));
+}
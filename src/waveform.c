@@ -0,0 +1,421 @@
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "waveform.h"
+#include "media_util.h"
+#include "media_cache.h"
+#include "trace.h"
+
+#define WAVE_LEVELS 3
+#define WAVE_VERSION 2
+#define WAVE_FANOUT 16      // cada nível junta 16 blocos do anterior
+
+static const guint level_bucket[WAVE_LEVELS] = { 256, 4096, 65536 };
+
+// Pico quantizado, como fica no arquivo
+typedef struct {
+    gint16 min;
+    gint16 max;
+    gint16 rms;
+} WavePeak16;
+
+// Cabeçalho dos picos no cache (ordem de bytes da máquina; versão diferente = recalcula)
+typedef struct {
+    char magic[4];          // "ZWF1"
+    guint32 version;
+    guint32 sample_rate;
+    guint32 n_levels;
+    guint64 n_samples;
+    guint64 reserved[2];
+    guint64 count[WAVE_LEVELS];
+} WaveHeader;
+
+G_STATIC_ASSERT(sizeof(WaveHeader) == 64);
+G_STATIC_ASSERT(sizeof(WavePeak16) == 6);
+
+struct _Waveform {
+    GBytes *data;           // arquivo inteiro (mapeado do cache ou recém-calculado)
+    guint sample_rate;
+    guint64 n_samples;
+    const WavePeak16 *level[WAVE_LEVELS];
+    guint64 count[WAVE_LEVELS];
+};
+
+// Bloco do nível 0 em precisão cheia, antes de quantizar
+typedef struct {
+    float min;
+    float max;
+    float sumsq;
+} BlockStats;
+
+typedef struct {
+    GArray *blocks;         // BlockStats
+    float pending[256];
+    guint n_pending;
+    guint64 n_samples;
+} Analysis;
+
+// min/max/soma dos quadrados de um bloco, 4 amostras por instrução
+static void block_stats(const float *x, guint n, BlockStats *out) {
+    guint i = 0;
+    float mn = x[0], mx = x[0], sq = 0.0f;
+#if defined(__SSE2__)
+    if (n >= 4) {
+        __m128 vmin = _mm_loadu_ps(x), vmax = vmin, vsq = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+            vsq = _mm_add_ps(vsq, _mm_mul_ps(v, v));
+        }
+        float a[4], b[4], c[4];
+        _mm_storeu_ps(a, vmin);
+        _mm_storeu_ps(b, vmax);
+        _mm_storeu_ps(c, vsq);
+        for (int k = 0; k < 4; k++) {
+            mn = MIN(mn, a[k]);
+            mx = MAX(mx, b[k]);
+            sq += c[k];
+        }
+    }
+#elif defined(__ARM_NEON)
+    if (n >= 4) {
+        float32x4_t vmin = vld1q_f32(x), vmax = vmin, vsq = vdupq_n_f32(0.0f);
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t v = vld1q_f32(x + i);
+            vmin = vminq_f32(vmin, v);
+            vmax = vmaxq_f32(vmax, v);
+            vsq = vmlaq_f32(vsq, v, v);
+        }
+        float a[4], b[4], c[4];
+        vst1q_f32(a, vmin);
+        vst1q_f32(b, vmax);
+        vst1q_f32(c, vsq);
+        for (int k = 0; k < 4; k++) {
+            mn = MIN(mn, a[k]);
+            mx = MAX(mx, b[k]);
+            sq += c[k];
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        mn = MIN(mn, x[i]);
+        mx = MAX(mx, x[i]);
+        sq += x[i] * x[i];
+    }
+    out->min = mn;
+    out->max = mx;
+    out->sumsq = sq;
+}
+
+static void analysis_push(Analysis *a, const float *x, guint n) {
+    a->n_samples += n;
+    const guint block = level_bucket[0];
+
+    // Completa o bloco que ficou pela metade no quadro anterior
+    if (a->n_pending > 0) {
+        guint take = MIN(n, block - a->n_pending);
+        memcpy(a->pending + a->n_pending, x, take * sizeof(float));
+        a->n_pending += take;
+        x += take;
+        n -= take;
+        if (a->n_pending < block)
+            return;
+        BlockStats s;
+        block_stats(a->pending, block, &s);
+        g_array_append_val(a->blocks, s);
+        a->n_pending = 0;
+    }
+    for (; n >= block; x += block, n -= block) {
+        BlockStats s;
+        block_stats(x, block, &s);
+        g_array_append_val(a->blocks, s);
+    }
+    memcpy(a->pending, x, n * sizeof(float));
+    a->n_pending = n;
+}
+
+static void analysis_finish(Analysis *a) {
+    if (a->n_pending > 0) {
+        BlockStats s;
+        block_stats(a->pending, a->n_pending, &s);
+        g_array_append_val(a->blocks, s);
+        a->n_pending = 0;
+    }
+}
+
+static gint16 quantize(float v) {
+    return (gint16)lrintf(CLAMP(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+// Monta o arquivo (cabeçalho + níveis) a partir dos blocos do nível 0
+static GBytes *build_pyramid(const Analysis *a, guint sample_rate) {
+    WaveHeader h = { .magic = { 'Z', 'W', 'F', '1' }, .version = WAVE_VERSION,
+                     .sample_rate = sample_rate, .n_levels = WAVE_LEVELS, .n_samples = a->n_samples };
+    guint64 n_blocks = a->blocks->len;
+    for (int l = 0; l < WAVE_LEVELS; l++)
+        h.count[l] = (a->n_samples + level_bucket[l] - 1) / level_bucket[l];
+
+    GByteArray *out = g_byte_array_new();
+    g_byte_array_append(out, (const guint8 *)&h, sizeof h);
+    const BlockStats *blocks = (const BlockStats *)a->blocks->data;
+    for (int l = 0; l < WAVE_LEVELS; l++) {
+        guint64 per = level_bucket[l] / level_bucket[0];
+        for (guint64 i = 0; i < h.count[l]; i++) {
+            guint64 first = i * per, last = MIN(first + per, n_blocks);
+            float mn = 0, mx = 0, sq = 0;
+            if (first < last) {
+                mn = blocks[first].min;
+                mx = blocks[first].max;
+            }
+            for (guint64 b = first; b < last; b++) {
+                mn = MIN(mn, blocks[b].min);
+                mx = MAX(mx, blocks[b].max);
+                sq += blocks[b].sumsq;
+            }
+            guint64 samples = MIN((guint64)level_bucket[l], a->n_samples - i * level_bucket[l]);
+            WavePeak16 p = { quantize(mn), quantize(mx), quantize(samples ? sqrtf(sq / samples) : 0) };
+            g_byte_array_append(out, (const guint8 *)&p, sizeof p);
+        }
+    }
+    return g_byte_array_free_to_bytes(out);
+}
+
+// Aponta os níveis para dentro de "data"; FALSE se o conteúdo não é válido
+static gboolean attach_data(Waveform *wf, GBytes *data) {
+    gsize size;
+    const guint8 *p = g_bytes_get_data(data, &size);
+    if (size < sizeof(WaveHeader))
+        return FALSE;
+    WaveHeader h;
+    memcpy(&h, p, sizeof h);
+    if (memcmp(h.magic, "ZWF1", 4) != 0 || h.version != WAVE_VERSION || h.n_levels != WAVE_LEVELS || h.sample_rate == 0)
+        return FALSE;
+
+    gsize offset = sizeof h;
+    for (int l = 0; l < WAVE_LEVELS; l++) {
+        if (h.count[l] != (h.n_samples + level_bucket[l] - 1) / level_bucket[l])
+            return FALSE;
+        wf->level[l] = (const WavePeak16 *)(p + offset);
+        wf->count[l] = h.count[l];
+        offset += h.count[l] * sizeof(WavePeak16);
+    }
+    if (offset != size)
+        return FALSE;
+
+    wf->data = g_bytes_ref(data);
+    wf->sample_rate = h.sample_rate;
+    wf->n_samples = h.n_samples;
+    return TRUE;
+}
+
+static gboolean load_cache(Waveform *wf, const MediaCacheKey *key) {
+    GBytes *data = media_cache_load(key, "wave", WAVE_VERSION);
+    if (!data)
+        return FALSE;
+    gboolean ok = attach_data(wf, data);
+    g_bytes_unref(data);
+    return ok;
+}
+
+static gboolean drain_decoder(AVCodecContext *dec, SwrContext *swr, AVFrame *frame,
+    float **buf, int *buf_cap, Analysis *a, GError **error) {
+    int ret;
+    while ((ret = avcodec_receive_frame(dec, frame)) >= 0) {
+        int want = swr_get_out_samples(swr, frame->nb_samples);
+        if (want > *buf_cap) {
+            *buf_cap = want;
+            *buf = g_renew(float, *buf, want);
+        }
+        uint8_t *out = (uint8_t *)*buf;
+        int n = swr_convert(swr, &out, *buf_cap, (const uint8_t **)frame->extended_data, frame->nb_samples);
+        av_frame_unref(frame);
+        if (n < 0) {
+            media_set_av_error(error, MEDIA_ERROR_CODEC, n, "resample");
+            return FALSE;
+        }
+        analysis_push(a, *buf, (guint)n);
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "decode");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Decodifica o áudio inteiro uma vez, misturado para mono float
+static gboolean analyze(const char *path, GCancellable *cancellable, Analysis *a, guint *sample_rate, GError **error) {
+    AVFormatContext *fmt = media_open_input(path, error);
+    if (!fmt)
+        return FALSE;
+    const AVCodec *codec = NULL;
+    int stream = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+    if (stream < 0 || !codec) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_NO_STREAM, "%s: nenhum stream de áudio", path);
+        avformat_close_input(&fmt);
+        return FALSE;
+    }
+    for (unsigned i = 0; i < fmt->nb_streams; i++)
+        fmt->streams[i]->discard = (int)i == stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    gboolean ok = FALSE;
+    SwrContext *swr = NULL;
+    AVCodecContext *dec = avcodec_alloc_context3(codec);
+    int ret = avcodec_parameters_to_context(dec, fmt->streams[stream]->codecpar);
+    if (ret >= 0)
+        ret = avcodec_open2(dec, codec, NULL);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, path);
+        goto out;
+    }
+
+    AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+    ret = swr_alloc_set_opts2(&swr, &mono, AV_SAMPLE_FMT_FLT, dec->sample_rate,
+                              &dec->ch_layout, dec->sample_fmt, dec->sample_rate, 0, NULL);
+    if (ret >= 0)
+        ret = swr_init(swr);
+    if (ret < 0) {
+        media_set_av_error(error, MEDIA_ERROR_CODEC, ret, "resample");
+        goto out;
+    }
+    *sample_rate = (guint)dec->sample_rate;
+
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    int buf_cap = 0;
+    float *buf = NULL;
+    ok = TRUE;
+    while (ok) {
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            ok = FALSE;
+            break;
+        }
+        ret = av_read_frame(fmt, pkt);
+        if (ret == AVERROR_EOF)
+            break;
+        if (ret < 0) {
+            media_set_av_error(error, MEDIA_ERROR_IO, ret, path);
+            ok = FALSE;
+            break;
+        }
+        if (pkt->stream_index == stream && avcodec_send_packet(dec, pkt) >= 0)
+            ok = drain_decoder(dec, swr, frame, &buf, &buf_cap, a, error);
+        av_packet_unref(pkt);
+    }
+    if (ok) {
+        avcodec_send_packet(dec, NULL);
+        ok = drain_decoder(dec, swr, frame, &buf, &buf_cap, a, error);
+    }
+    if (ok) {
+        // O que sobrou dentro do resampler
+        int want = swr_get_out_samples(swr, 0);
+        if (want > 0) {
+            buf = g_renew(float, buf, want);
+            uint8_t *out = (uint8_t *)buf;
+            int n = swr_convert(swr, &out, want, NULL, 0);
+            if (n > 0)
+                analysis_push(a, buf, (guint)n);
+        }
+        analysis_finish(a);
+    }
+    g_free(buf);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+
+out:
+    swr_free(&swr);
+    avcodec_free_context(&dec);
+    avformat_close_input(&fmt);
+    return ok;
+}
+
+Waveform *waveform_load(const char *path, GCancellable *cancellable, GError **error) {
+    gint64 t = trace_begin();
+    MediaCacheKey key;
+    gboolean have_key = media_cache_key(path, &key);
+    Waveform *wf = g_new0(Waveform, 1);
+
+    if (have_key && load_cache(wf, &key)) {
+        trace_end("waveform (cache)", "media", t);
+        return wf;
+    }
+
+    Analysis a = { .blocks = g_array_new(FALSE, FALSE, sizeof(BlockStats)) };
+    guint sample_rate = 0;
+    if (!analyze(path, cancellable, &a, &sample_rate, error)) {
+        g_array_unref(a.blocks);
+        g_free(wf);
+        return NULL;
+    }
+
+    GBytes *data = build_pyramid(&a, sample_rate);
+    g_array_unref(a.blocks);
+    attach_data(wf, data);
+
+    GError *save_error = NULL;
+    gsize size;
+    const guint8 *bytes = g_bytes_get_data(data, &size);
+    if (have_key && !media_cache_store(&key, "wave", WAVE_VERSION, bytes, size, &save_error)) {
+        g_print("Cache da forma de onda não foi gravado: %s\n", save_error->message);
+        g_clear_error(&save_error);
+    }
+    g_bytes_unref(data);
+    trace_end("waveform (decode)", "media", t);
+    return wf;
+}
+
+void waveform_free(Waveform *wf) {
+    if (!wf)
+        return;
+    g_bytes_unref(wf->data);
+    g_free(wf);
+}
+
+gint64 waveform_get_duration_us(Waveform *wf) {
+    return (gint64)(wf->n_samples * G_USEC_PER_SEC / wf->sample_rate);
+}
+
+void waveform_get_peaks(Waveform *wf, gint64 start_us, gint64 end_us, guint columns, WaveformPeak *out) {
+    if (columns == 0)
+        return;
+    double s0 = (double)start_us * wf->sample_rate / G_USEC_PER_SEC;
+    double spp = MAX((double)(end_us - start_us) * wf->sample_rate / G_USEC_PER_SEC / columns, 0.0);
+
+    // Nível mais grosso cujo bloco ainda cabe numa coluna
+    int l = 0;
+    while (l + 1 < WAVE_LEVELS && level_bucket[l + 1] <= spp)
+        l++;
+    const WavePeak16 *level = wf->level[l];
+    double bucket = level_bucket[l];
+    gint64 count = (gint64)wf->count[l];
+
+    for (guint c = 0; c < columns; c++) {
+        gint64 first = (gint64)floor((s0 + c * spp) / bucket);
+        gint64 last = MAX(first + 1, (gint64)ceil((s0 + (c + 1) * spp) / bucket));
+        first = MAX(first, 0);
+        last = MIN(last, count);
+
+        WaveformPeak p = { 0, 0, 0 };
+        if (first < last) {
+            int mn = level[first].min, mx = level[first].max;
+            double sq = 0;
+            for (gint64 i = first; i < last; i++) {
+                mn = MIN(mn, level[i].min);
+                mx = MAX(mx, level[i].max);
+                sq += (double)level[i].rms * level[i].rms;
+            }
+            p.min = mn / 32767.0f;
+            p.max = mx / 32767.0f;
+            p.rms = (float)(sqrt(sq / (last - first)) / 32767.0);
+        }
+        out[c] = p;
+    }
+}
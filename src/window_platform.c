@@ -0,0 +1,26 @@
+#include <gtk/gtk.h>
+#include "window_platform.h"
+#ifdef GDK_WINDOWING_WIN32
+#include <gdk/win32/gdkwin32.h>
+#include <windows.h>
+#endif
+
+void window_platform_center(GtkWidget *window, int width, int height) {
+    GdkSurface *surface = gtk_native_get_surface(GTK_NATIVE(window));
+    if (!surface)
+        return;
+
+#ifdef GDK_WINDOWING_WIN32
+    // O GDK 4 não posiciona janelas; no Windows isso ainda é com a gente
+    if (GDK_IS_WIN32_SURFACE(surface)) {
+        HWND hwnd = gdk_win32_surface_get_handle(surface);
+        MONITORINFO mi = { .cbSize = sizeof(mi) };
+        GetMonitorInfo(MonitorFromWindow(hwnd, MONITOR_DEFAULTTONEAREST), &mi);
+        int x = mi.rcWork.left + (mi.rcWork.right - mi.rcWork.left - width) / 2;
+        int y = mi.rcWork.top + (mi.rcWork.bottom - mi.rcWork.top - height) / 2;
+        SetWindowPos(hwnd, NULL, x, y, 0, 0, SWP_NOSIZE | SWP_NOZORDER);
+    }
+#else
+    (void)width; (void)height;
+#endif
+}
@@ -0,0 +1,176 @@
+// Gerador de assets usado pelo "make assets".
+// Para cada linha de icons/assets.list decodifica o ícone original, escala todos os
+// quadros para o tamanho que o código realmente usa e grava uma faixa PNG
+// (<nome>-<L>x<A>.png) com a quantidade e as durações dos quadros em chunks tEXt.
+// No fim escreve o XML que o glib-compile-resources transforma em GResource.
+//
+// Uso: zenoka-assets <assets.list> <pasta dos ícones> <pasta de saída>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gif_scan.h"
+
+#define MIN_DELAY_MS 20
+#define MAX_FRAMES   512
+
+typedef struct {
+    GPtrArray *frames;  // GdkPixbuf* já escalados
+    GArray *delays;
+} FrameList;
+
+static void add_frame(FrameList *list, GdkPixbuf *frame, int delay) {
+    // Quadros idênticos depois de escalar viram um só (soma as durações)
+    if (list->frames->len > 0) {
+        GdkPixbuf *prev = g_ptr_array_index(list->frames, list->frames->len - 1);
+        int *prev_delay = &g_array_index(list->delays, int, list->delays->len - 1);
+        gsize len = gdk_pixbuf_get_byte_length(frame);
+        if (*prev_delay >= 0 && len == gdk_pixbuf_get_byte_length(prev) &&
+            memcmp(gdk_pixbuf_read_pixels(frame), gdk_pixbuf_read_pixels(prev), len) == 0) {
+            *prev_delay = delay < 0 ? -1 : *prev_delay + delay;
+            g_object_unref(frame);
+            return;
+        }
+    }
+    g_ptr_array_add(list->frames, frame);
+    g_array_append_val(list->delays, delay);
+}
+
+static GdkPixbuf *scale_to_fit(GdkPixbuf *src, int width, int height) {
+    int sw = gdk_pixbuf_get_width(src), sh = gdk_pixbuf_get_height(src);
+    double s = MIN((double)width / sw, (double)height / sh);
+    int w = MAX(1, (int)(sw * s + 0.5)), h = MAX(1, (int)(sh * s + 0.5));
+    return gdk_pixbuf_scale_simple(src, w, h, GDK_INTERP_HYPER);
+}
+
+static gboolean build_variant(const char *src_path, int width, int height, const char *out_path, GError **error) {
+    gchar *contents = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(src_path, &contents, &len, error))
+        return FALSE;
+    guint expected = gif_count_frames((const guchar *)contents, len);
+    g_free(contents);
+
+    GdkPixbufAnimation *anim = gdk_pixbuf_animation_new_from_file(src_path, error);
+    if (!anim)
+        return FALSE;
+
+    FrameList list = { g_ptr_array_new(), g_array_new(FALSE, FALSE, sizeof(int)) };
+    if (gdk_pixbuf_animation_is_static_image(anim)) {
+        add_frame(&list, scale_to_fit(gdk_pixbuf_animation_get_static_image(anim), width, height), -1);
+    } else {
+        guint limit = expected > 0 ? MIN(expected, MAX_FRAMES) : MAX_FRAMES;
+        G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+        GTimeVal t = { 0, 0 };
+        GdkPixbufAnimationIter *iter = gdk_pixbuf_animation_get_iter(anim, &t);
+        for (guint i = 0; i < limit; i++) {
+            int delay = gdk_pixbuf_animation_iter_get_delay_time(iter);
+            if (delay >= 0)
+                delay = MAX(delay, MIN_DELAY_MS);
+            add_frame(&list, scale_to_fit(gdk_pixbuf_animation_iter_get_pixbuf(iter), width, height), delay);
+            if (delay < 0)
+                break;
+            g_time_val_add(&t, (glong)delay * 1000);
+            gdk_pixbuf_animation_iter_advance(iter, &t);
+        }
+        G_GNUC_END_IGNORE_DEPRECATIONS
+        g_object_unref(iter);
+    }
+    g_object_unref(anim);
+
+    // Monta a faixa: todos os quadros lado a lado, com o mesmo tamanho
+    guint n = list.frames->len;
+    GdkPixbuf *first = g_ptr_array_index(list.frames, 0);
+    int fw = gdk_pixbuf_get_width(first), fh = gdk_pixbuf_get_height(first);
+    GdkPixbuf *strip = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, fw * (int)n, fh);
+    gdk_pixbuf_fill(strip, 0);
+    GString *delays = g_string_new(NULL);
+    for (guint i = 0; i < n; i++) {
+        GdkPixbuf *f = g_ptr_array_index(list.frames, i);
+        gdk_pixbuf_copy_area(f, 0, 0, MIN(fw, gdk_pixbuf_get_width(f)), MIN(fh, gdk_pixbuf_get_height(f)),
+                             strip, (int)i * fw, 0);
+        g_string_append_printf(delays, i ? ",%d" : "%d", g_array_index(list.delays, int, i));
+        g_object_unref(f);
+    }
+
+    gchar *n_str = g_strdup_printf("%u", n);
+    char *keys[] = { "tEXt::zenoka-frames", "tEXt::zenoka-delays", "compression", NULL };
+    char *values[] = { n_str, delays->str, "9", NULL };
+    gboolean ok = gdk_pixbuf_savev(strip, out_path, "png", keys, values, error);
+
+    g_free(n_str);
+    g_string_free(delays, TRUE);
+    g_object_unref(strip);
+    g_ptr_array_free(list.frames, TRUE);
+    g_array_free(list.delays, TRUE);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Uso: %s <assets.list> <pasta dos ícones> <pasta de saída>\n", argv[0]);
+        return 2;
+    }
+
+    gchar *list_text = NULL;
+    GError *error = NULL;
+    if (!g_file_get_contents(argv[1], &list_text, NULL, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return 1;
+    }
+    g_mkdir_with_parents(argv[3], 0755);
+
+    GString *xml = g_string_new(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<gresources>\n"
+        "  <gresource prefix=\"/com/luquitoos/zenoka/icons\">\n");
+
+    int status = 0;
+    gchar **lines = g_strsplit(list_text, "\n", -1);
+    for (gchar **l = lines; *l; l++) {
+        gchar *line = g_strstrip(*l);
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        char name[256];
+        int width = 0, height = 0;
+        if (sscanf(line, "%255s %d %d", name, &width, &height) != 3 || width <= 0 || height <= 0) {
+            fprintf(stderr, "Linha inválida em %s: %s\n", argv[1], line);
+            status = 1;
+            continue;
+        }
+
+        gchar *stem = g_strndup(name, strcspn(name, "."));
+        gchar *out_name = g_strdup_printf("%s-%dx%d.png", stem, width, height);
+        gchar *src_path = g_build_filename(argv[2], name, NULL);
+        gchar *out_path = g_build_filename(argv[3], out_name, NULL);
+
+        if (build_variant(src_path, width, height, out_path, &error)) {
+            // PNG já é comprimido: não adianta comprimir de novo no GResource
+            g_string_append_printf(xml, "    <file>%s</file>\n", out_name);
+            printf("  %s -> %s\n", name, out_name);
+        } else {
+            fprintf(stderr, "Erro em %s: %s\n", src_path, error->message);
+            g_clear_error(&error);
+            status = 1;
+        }
+        g_free(stem);
+        g_free(out_name);
+        g_free(src_path);
+        g_free(out_path);
+    }
+    g_strfreev(lines);
+    g_free(list_text);
+
+    g_string_append(xml, "  </gresource>\n</gresources>\n");
+    gchar *xml_path = g_build_filename(argv[3], "zenoka.gresource.xml", NULL);
+    if (status == 0 && !g_file_set_contents(xml_path, xml->str, -1, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        g_clear_error(&error);
+        status = 1;
+    }
+    g_free(xml_path);
+    g_string_free(xml, TRUE);
+    return status;
+}
@@ -0,0 +1,490 @@
+// Benchmarks usados pelo "make bench". Gera uma mídia de teste determinística,
+// mede decodificação, exportação, seek, o custo por tick das animações e a
+// partida do aplicativo, e grava tudo num JSON para comparar entre builds.
+// Tudo o que depende de display é pulado (e marcado no JSON) sem um.
+//
+// Uso: zenoka-bench [--out ARQ] [--app EXECUTÁVEL] [--frames N] [--seeks N]
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+#include "anim_cache.h"
+#include "anim_scheduler.h"
+#include "export.h"
+#include "media_util.h"
+#include "seek_index.h"
+#include "timecode.h"
+#include "video_engine.h"
+
+#ifndef BENCH_REV
+#define BENCH_REV "desconhecida"
+#endif
+
+#define MEDIA_W         1280
+#define MEDIA_H         720
+#define MEDIA_FPS       30
+#define MEDIA_GOP       60
+#define SEEK_SEED       42
+#define STARTUP_RUNS    5
+#define ANIM_SECONDS    2
+#define FRAME_TIMEOUT_US (5 * G_USEC_PER_SEC)
+
+static gchar *opt_out = NULL;
+static gchar *opt_app = NULL;
+static gint opt_frames = 600;
+static gint opt_seeks = 50;
+
+static const GOptionEntry options[] = {
+    { "out", 0, 0, G_OPTION_ARG_FILENAME, &opt_out, "JSON com os resultados (padrão: stdout)", "ARQ" },
+    { "app", 0, 0, G_OPTION_ARG_FILENAME, &opt_app, "Executável do Zenoka para medir a partida", "EXE" },
+    { "frames", 0, 0, G_OPTION_ARG_INT, &opt_frames, "Quadros da mídia de teste", "N" },
+    { "seeks", 0, 0, G_OPTION_ARG_INT, &opt_seeks, "Seeks aleatórios medidos", "N" },
+    { NULL }
+};
+
+static double now_s(void) {
+    return g_get_monotonic_time() / (double)G_USEC_PER_SEC;
+}
+
+static double cpu_s(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static goffset file_size(const char *path) {
+    GStatBuf st;
+    return g_stat(path, &st) == 0 ? (goffset)st.st_size : 0;
+}
+
+static void append_json_string(GString *json, const char *s) {
+    g_string_append_c(json, '"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            g_string_append_printf(json, "\\%c", *s);
+        else if ((guchar)*s < 0x20)
+            g_string_append_printf(json, "\\u%04x", (guchar)*s);
+        else
+            g_string_append_c(json, *s);
+    }
+    g_string_append_c(json, '"');
+}
+
+static void append_error(GString *json, const char *indent, const char *name, const char *message, gboolean last) {
+    g_string_append_printf(json, "%s\"%s\": {\"error\": ", indent, name);
+    append_json_string(json, message);
+    g_string_append_printf(json, "}%s\n", last ? "" : ",");
+}
+
+// Apaga a pasta temporária (só tem arquivos, e a pasta do cache um nível abaixo)
+static void remove_tree(const char *path) {
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (dir) {
+        const char *name;
+        while ((name = g_dir_read_name(dir))) {
+            gchar *child = g_build_filename(path, name, NULL);
+            if (g_file_test(child, G_FILE_TEST_IS_DIR))
+                remove_tree(child);
+            else
+                g_remove(child);
+            g_free(child);
+        }
+        g_dir_close(dir);
+    }
+    g_rmdir(path);
+}
+
+static int compare_double(gconstpointer a, gconstpointer b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(GArray *sorted, double p) {
+    if (sorted->len == 0)
+        return 0;
+    guint i = (guint)MIN(sorted->len - 1, (guint)(p * (sorted->len - 1) + 0.5));
+    return g_array_index(sorted, double, i);
+}
+
+// Quadro sintético: gradiente que anda e um bloco em movimento (dá trabalho
+// de verdade ao encoder sem depender de nenhum arquivo)
+static void fill_frame(AVFrame *f, int i) {
+    for (int y = 0; y < f->height; y++) {
+        guint8 *row = f->data[0] + (gsize)y * f->linesize[0];
+        for (int x = 0; x < f->width; x++)
+            row[x] = (guint8)(x + y + i * 3);
+    }
+    int bx = (i * 7) % (f->width - 128), by = (i * 5) % (f->height - 128);
+    for (int y = by; y < by + 128; y++)
+        memset(f->data[0] + (gsize)y * f->linesize[0] + bx, 235, 128);
+    for (int y = 0; y < f->height / 2; y++) {
+        memset(f->data[1] + (gsize)y * f->linesize[1], (guint8)(128 + y / 4 + i), f->width / 2);
+        memset(f->data[2] + (gsize)y * f->linesize[2], (guint8)(64 + i * 2), f->width / 2);
+    }
+}
+
+static gboolean write_packets(AVCodecContext *enc, AVFormatContext *out, AVStream *st, AVPacket *pkt) {
+    int ret;
+    while ((ret = avcodec_receive_packet(enc, pkt)) >= 0) {
+        av_packet_rescale_ts(pkt, enc->time_base, st->time_base);
+        pkt->stream_index = st->index;
+        if (av_interleaved_write_frame(out, pkt) < 0)
+            return FALSE;
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
+
+// Mídia de teste H.264 (ou MPEG-4 sem libx264), gerada de novo a cada rodada
+static gboolean generate_media(const char *path, int frames, GError **error) {
+    const AVCodec *codec = avcodec_find_encoder_by_name("libx264");
+    if (!codec)
+        codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    AVFormatContext *out = NULL;
+    if (!codec || avformat_alloc_output_context2(&out, NULL, "mp4", path) < 0) {
+        g_set_error(error, MEDIA_ERROR, MEDIA_ERROR_CODEC, "Sem encoder para a mídia de teste");
+        return FALSE;
+    }
+
+    AVCodecContext *enc = avcodec_alloc_context3(codec);
+    enc->width = MEDIA_W;
+    enc->height = MEDIA_H;
+    enc->pix_fmt = AV_PIX_FMT_YUV420P;
+    enc->time_base = (AVRational){ 1, MEDIA_FPS };
+    enc->framerate = (AVRational){ MEDIA_FPS, 1 };
+    enc->gop_size = MEDIA_GOP;
+    enc->bit_rate = 8000000;
+    if (out->oformat->flags & AVFMT_GLOBALHEADER)
+        enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    av_opt_set(enc->priv_data, "preset", "veryfast", 0);
+
+    AVStream *st = avformat_new_stream(out, NULL);
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    frame->width = MEDIA_W;
+    frame->height = MEDIA_H;
+    frame->format = AV_PIX_FMT_YUV420P;
+
+    int ret = avcodec_open2(enc, codec, NULL);
+    if (ret >= 0)
+        ret = avcodec_parameters_from_context(st->codecpar, enc);
+    st->time_base = enc->time_base;
+    if (ret >= 0)
+        ret = avio_open(&out->pb, path, AVIO_FLAG_WRITE);
+    if (ret >= 0)
+        ret = avformat_write_header(out, NULL);
+    if (ret >= 0)
+        ret = av_frame_get_buffer(frame, 0);
+
+    gboolean ok = ret >= 0;
+    for (int i = 0; ok && i < frames; i++) {
+        ok = av_frame_make_writable(frame) >= 0;
+        fill_frame(frame, i);
+        frame->pts = i;
+        ok = ok && avcodec_send_frame(enc, frame) >= 0 && write_packets(enc, out, st, pkt);
+    }
+    if (ok)
+        ok = avcodec_send_frame(enc, NULL) >= 0 && write_packets(enc, out, st, pkt) && av_write_trailer(out) >= 0;
+    if (!ok)
+        media_set_av_error(error, MEDIA_ERROR_IO, ret < 0 ? ret : AVERROR_UNKNOWN, path);
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&enc);
+    if (out->pb)
+        avio_closep(&out->pb);
+    avformat_free_context(out);
+    if (!ok)
+        g_remove(path);
+    return ok;
+}
+
+// Arquivo inteiro pelo VideoEngine: demux, decodificação e conversão para RGBA,
+// o mesmo caminho da prévia
+static void bench_decode(const char *media, GString *json) {
+    VideoEngine *e = video_engine_new();
+    GError *error = NULL;
+    if (!video_engine_open(e, media, MEDIA_W, MEDIA_H, &error)) {
+        append_error(json, "  ", "decode", error->message, FALSE);
+        g_clear_error(&error);
+        video_engine_free(e);
+        return;
+    }
+    double t = now_s();
+    int frames = 0;
+    GdkTexture *texture;
+    while ((texture = video_engine_take_frame(e, FRAME_TIMEOUT_US, NULL))) {
+        g_object_unref(texture);
+        frames++;
+    }
+    double elapsed = now_s() - t;
+    video_engine_free(e);
+    g_string_append_printf(json, "  \"decode\": {\"frames\": %d, \"seconds\": %.3f, \"fps\": %.1f},\n",
+                           frames, elapsed, elapsed > 0 ? frames / elapsed : 0);
+}
+
+// Seeks do VideoEngine para timecodes sorteados (semente fixa), com o índice de
+// keyframes já completo: do pedido até o quadro do destino sair decodificado.
+// "misses" conta os seeks que não mostraram o quadro do timecode.
+static void bench_seek(const char *media, GString *json) {
+    VideoEngine *e = video_engine_new();
+    GError *error = NULL;
+    if (!video_engine_open(e, media, MEDIA_W, MEDIA_H, &error)) {
+        append_error(json, "  ", "seek", error->message, FALSE);
+        g_clear_error(&error);
+        video_engine_free(e);
+        return;
+    }
+    seek_index_wait(video_engine_get_seek_index(e), NULL);
+
+    gint64 duration = video_engine_get_duration_us(e);
+    GRand *rand = g_rand_new_with_seed(SEEK_SEED);
+    GArray *ms = g_array_new(FALSE, FALSE, sizeof(double));
+    guint misses = 0;
+    for (int i = 0; i < opt_seeks; i++) {
+        char tc[32];
+        gint64 target, position;
+        timecode_format((gint64)(g_rand_double(rand) * duration), MEDIA_FPS, tc, sizeof tc);
+        if (!timecode_parse(tc, MEDIA_FPS, &target))
+            continue;
+        double t = now_s();
+        video_engine_seek(e, target);
+        GdkTexture *texture = video_engine_take_frame(e, FRAME_TIMEOUT_US, &position);
+        double v = (now_s() - t) * 1000.0;
+        if (!texture) {
+            misses++;
+            continue;
+        }
+        g_object_unref(texture);
+        // A posição do engine já desconta a origem do stream, como o timecode
+        if (ABS(position - target) > G_USEC_PER_SEC / MEDIA_FPS / 2)
+            misses++;
+        g_array_append_val(ms, v);
+    }
+    g_array_sort(ms, compare_double);
+    g_string_append_printf(json, "  \"seek\": {\"count\": %u, \"misses\": %u, \"p50_ms\": %.2f, \"p95_ms\": %.2f, \"max_ms\": %.2f},\n",
+                           ms->len, misses, percentile(ms, 0.5), percentile(ms, 0.95), percentile(ms, 1.0));
+    g_array_unref(ms);
+    g_rand_free(rand);
+    video_engine_free(e);
+}
+
+static void append_export(GString *json, const char *name, gboolean ok, const GError *error,
+    const char *output, double elapsed, gint64 media_us, gboolean last) {
+    if (ok) {
+        double mb = file_size(output) / (1024.0 * 1024.0);
+        g_string_append_printf(json, "    \"%s\": {\"seconds\": %.3f, \"mb_per_s\": %.2f, \"speed\": %.2f}%s\n",
+                               name, elapsed, elapsed > 0 ? mb / elapsed : 0,
+                               elapsed > 0 ? media_us / (double)G_USEC_PER_SEC / elapsed : 0, last ? "" : ",");
+    } else {
+        append_error(json, "    ", name, error ? error->message : "?", last);
+    }
+}
+
+// O miolo do vídeo, pelos dois caminhos do botão de exportar
+static void bench_export(const char *media, const char *dir, GString *json) {
+    gint64 duration = (gint64)opt_frames * G_USEC_PER_SEC / MEDIA_FPS;
+    gchar *cut = g_build_filename(dir, "export-cut.mp4", NULL);
+    gchar *transcode = g_build_filename(dir, "export-480p.mp4", NULL);
+    ExportJob job = { media, cut, duration / 10, duration * 9 / 10 };
+    GError *error = NULL;
+
+    g_string_append(json, "  \"export\": {\n");
+    double t = now_s();
+    gboolean ok = export_smart_cut(&job, NULL, NULL, NULL, &error);
+    append_export(json, "smart_cut", ok, error, cut, now_s() - t, job.end_us - job.start_us, FALSE);
+    g_clear_error(&error);
+
+    job.output = transcode;
+    TranscodeOptions opts = { .max_height = 480 };
+    t = now_s();
+    ok = export_transcode_parallel(&job, &opts, NULL, NULL, NULL, &error);
+    append_export(json, "transcode_480p", ok, error, transcode, now_s() - t, job.end_us - job.start_us, TRUE);
+    g_clear_error(&error);
+    g_string_append(json, "  },\n");
+
+    g_remove(cut);
+    g_remove(transcode);
+    g_free(cut);
+    g_free(transcode);
+}
+
+typedef struct {
+    GMainLoop *loop;
+    guint ticks;
+} TickCount;
+
+static void on_after_paint(GdkFrameClock *clock, TickCount *tc) {
+    (void)clock;
+    tc->ticks++;
+}
+
+static gboolean on_anim_done(gpointer data) {
+    g_main_loop_quit(((TickCount *)data)->loop);
+    return G_SOURCE_REMOVE;
+}
+
+// CPU do processo por quadro com N ícones animados na mesma janela
+static void bench_anim(int n, GString *json, gboolean last) {
+    AnimFrames *anim = anim_cache_get_asset("Spinner.gif", 30, 30, NULL);
+    if (!anim) {
+        g_string_append_printf(json, "    {\"animations\": %d, \"error\": \"Spinner.gif não encontrado\"}%s\n", n, last ? "" : ",");
+        return;
+    }
+    GtkWidget *window = gtk_window_new();
+    GtkWidget *flow = gtk_flow_box_new();
+    gtk_window_set_default_size(GTK_WINDOW(window), 640, 480);
+    gtk_window_set_child(GTK_WINDOW(window), flow);
+    for (int i = 0; i < n; i++) {
+        GtkWidget *image = gtk_image_new();
+        gtk_widget_set_size_request(image, 30, 30);
+        gtk_flow_box_append(GTK_FLOW_BOX(flow), image);
+        anim_scheduler_add(image, anim);
+    }
+    anim_frames_unref(anim);
+    gtk_window_present(GTK_WINDOW(window));
+
+    TickCount tc = { g_main_loop_new(NULL, FALSE), 0 };
+    // Meio segundo para a janela aparecer antes de medir
+    g_timeout_add(500, on_anim_done, &tc);
+    g_main_loop_run(tc.loop);
+
+    GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+    gulong id = g_signal_connect(clock, "after-paint", G_CALLBACK(on_after_paint), &tc);
+    double cpu = cpu_s(), wall = now_s();
+    g_timeout_add(ANIM_SECONDS * 1000, on_anim_done, &tc);
+    g_main_loop_run(tc.loop);
+    cpu = cpu_s() - cpu;
+    wall = now_s() - wall;
+    g_signal_handler_disconnect(clock, id);
+
+    g_string_append_printf(json, "    {\"animations\": %d, \"ticks\": %u, \"cpu_us_per_tick\": %.1f, \"cpu_percent\": %.2f}%s\n",
+                           n, tc.ticks, tc.ticks ? cpu * 1e6 / tc.ticks : 0, cpu * 100.0 / wall, last ? "" : ",");
+    gtk_window_destroy(GTK_WINDOW(window));
+    g_main_loop_unref(tc.loop);
+}
+
+// Duração de "startup (main -> first frame)" no trace gravado pelo app
+static double read_startup_ms(const char *trace_path) {
+    gchar *text = NULL;
+    double ms = -1;
+    if (g_file_get_contents(trace_path, &text, NULL, NULL)) {
+        const char *ev = strstr(text, "\"startup (main -> first frame)\"");
+        const char *dur = ev ? strstr(ev, "\"dur\":") : NULL;
+        if (dur)
+            ms = g_ascii_strtod(dur + strlen("\"dur\":"), NULL) / 1000.0;
+    }
+    g_free(text);
+    return ms;
+}
+
+static void bench_startup(const char *dir, GString *json) {
+    gchar *trace = g_build_filename(dir, "startup-trace.json", NULL);
+    gchar *trace_arg = g_strdup_printf("--trace=%s", trace);
+    GArray *ms = g_array_new(FALSE, FALSE, sizeof(double));
+    for (int i = 0; i < STARTUP_RUNS; i++) {
+        char *argv[] = { opt_app, trace_arg, "--splash-min-ms=0", "--quit-after-first-frame", NULL };
+        int status = 0;
+        g_remove(trace);
+        if (!g_spawn_sync(NULL, argv, NULL, G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL, NULL, NULL, &status, NULL))
+            break;
+        double v = read_startup_ms(trace);
+        if (v >= 0)
+            g_array_append_val(ms, v);
+    }
+    g_array_sort(ms, compare_double);
+    if (ms->len > 0)
+        g_string_append_printf(json, "  \"startup\": {\"runs\": %u, \"median_ms\": %.1f, \"min_ms\": %.1f},\n",
+                               ms->len, percentile(ms, 0.5), percentile(ms, 0.0));
+    else
+        g_string_append(json, "  \"startup\": {\"error\": \"o app não gravou o primeiro quadro\"},\n");
+    g_remove(trace);
+    g_array_unref(ms);
+    g_free(trace_arg);
+    g_free(trace);
+}
+
+int main(int argc, char **argv) {
+    GError *error = NULL;
+    GOptionContext *ctx = g_option_context_new("- benchmarks do Zenoka");
+    g_option_context_add_main_entries(ctx, options, NULL);
+    if (!g_option_context_parse(ctx, &argc, &argv, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return 2;
+    }
+    g_option_context_free(ctx);
+
+    // Cache de análises vazio a cada rodada: os números não dependem da anterior
+    gchar *dir = g_dir_make_tmp("zenoka-bench-XXXXXX", &error);
+    if (!dir) {
+        fprintf(stderr, "%s\n", error->message);
+        return 1;
+    }
+    gchar *cache_dir = g_build_filename(dir, "cache", NULL);
+    g_setenv("ZENOKA_CACHE_DIR", cache_dir, TRUE);
+
+    // Na pasta temporária da rodada: nunca uma sobra de outra rodada ou de outro build
+    gchar *media = g_build_filename(dir, "media.mp4", NULL);
+    if (!generate_media(media, opt_frames, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        remove_tree(dir);
+        return 1;
+    }
+
+    GDateTime *date = g_date_time_new_now_utc();
+    gchar *stamp = g_date_time_format_iso8601(date);
+    GString *json = g_string_new("{\n");
+    g_string_append_printf(json, "  \"rev\": \"%s\",\n  \"date\": \"%s\",\n  \"compiler\": \"%s\",\n",
+                           BENCH_REV, stamp, __VERSION__);
+    g_string_append_printf(json, "  \"media\": {\"width\": %d, \"height\": %d, \"fps\": %d, \"frames\": %d, \"bytes\": %" G_GOFFSET_FORMAT "},\n",
+                           MEDIA_W, MEDIA_H, MEDIA_FPS, opt_frames, file_size(media));
+
+    fprintf(stderr, "decode...\n");
+    bench_decode(media, json);
+    fprintf(stderr, "seek...\n");
+    bench_seek(media, json);
+    fprintf(stderr, "export...\n");
+    bench_export(media, dir, json);
+
+    if (gtk_init_check()) {
+        static const int counts[] = { 1, 8, 32, 128 };
+        fprintf(stderr, "animações...\n");
+        g_string_append(json, "  \"anim_tick\": [\n");
+        for (guint i = 0; i < G_N_ELEMENTS(counts); i++)
+            bench_anim(counts[i], json, i + 1 == G_N_ELEMENTS(counts));
+        g_string_append(json, "  ],\n");
+        if (opt_app) {
+            fprintf(stderr, "partida...\n");
+            bench_startup(dir, json);
+        } else {
+            g_string_append(json, "  \"startup\": {\"skipped\": \"sem --app\"},\n");
+        }
+    } else {
+        g_string_append(json, "  \"anim_tick\": {\"skipped\": \"sem display\"},\n");
+        g_string_append(json, "  \"startup\": {\"skipped\": \"sem display\"},\n");
+    }
+    g_string_append(json, "  \"complete\": true\n}\n");
+
+    int status = 0;
+    if (opt_out) {
+        if (!g_file_set_contents(opt_out, json->str, (gssize)json->len, &error)) {
+            fprintf(stderr, "%s\n", error->message);
+            status = 1;
+        } else {
+            fprintf(stderr, "Resultados em %s\n", opt_out);
+        }
+    } else {
+        fputs(json->str, stdout);
+    }
+
+    g_string_free(json, TRUE);
+    g_free(stamp);
+    g_date_time_unref(date);
+    g_free(media);
+    remove_tree(dir);
+    g_free(cache_dir);
+    g_free(dir);
+    return status;
+}